@@ -21,6 +21,14 @@
 
 
 == Version History ==
+15/10/2026 - 0.08 - Refill ends on measured target volume; closes the valve early on no inflow (stuck valve)
+15/10/2026 - 0.07 - Extraction pump events tagged with LOG_SRC_PUMP
+15/10/2026 - 0.06 - Extraction runs per batch volume; extracted volume includes completed batches
+15/10/2026 - 0.05 - Pumps driven by the dosing engine; extraction ends on integrated volume
+                    setupActuators() now called from setup()
+15/10/2026 - 0.04 - Pump/valve/float-switch GPIO and timing via HAL (host simulation hooks)
+15/10/2026 - 0.03 - Blynk writes routed through the control->network SPSC queue; no display redraw from control
+15/10/2026 - 0.02 - Extraction (M5.1) rebuilt as a non-blocking state machine (no more delay())
 01/11/2025 - 0.01 - First installment based on code created by Gemini AI (Google)
 
 == Project file structure ==
@@ -37,6 +45,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - (this file) Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -46,29 +69,19 @@ tpa_reposition    - Control return of water volume
 
 // --- SETUP DOS ATUADORES ---
 void setupActuators() {
-    // Configura o pino da bomba de extracao como OUTPUT
-    pinMode(TPA_EXTRACTION_PUMP_PIN, OUTPUT);
-    digitalWrite(TPA_EXTRACTION_PUMP_PIN, LOW); // Garante que a bomba comeca desligada
+    // Bombas de extração, reposição e buffer: saídas (digital ou PWM) do motor de dosagem
+    setupDosingEngine();
     
     Serial.print(F("Pino da bomba de Extracao configurado: "));
     Serial.println(TPA_EXTRACTION_PUMP_PIN);
 
     // --- SETUP MÓDULO 5.3: ENCHIMENTO DO RAN ---
-    pinMode(RAN_SOLENOID_VALVE_PIN, OUTPUT);
-    digitalWrite(RAN_SOLENOID_VALVE_PIN, RELAY_OFF); // Solenoide NC: OFF = Fechado
+    halPinMode(RAN_SOLENOID_VALVE_PIN, OUTPUT);
+    halDigitalWrite(RAN_SOLENOID_VALVE_PIN, RELAY_OFF); // Solenoide NC: OFF = Fechado
     
-    // O sensor de nível do RAN é uma entrada simples
-    pinMode(RAN_LEVEL_SENSOR_PIN, INPUT_PULLUP); // Assumindo sensor de boia com pull-up
+    // Boia + sensor contínuo de nível (ran_level.ino)
+    setupRanLevel();
 
-    // Configuração da Bomba de Buffer (M5.4) - NOVO
-    pinMode(TPA_BUFFER_PUMP_PIN, OUTPUT);
-    digitalWrite(TPA_BUFFER_PUMP_PIN, RELAY_OFF); // Começa desligada
-    
-    // Configuração inicial
-    ranLevelFull = readRanLevelSensor();
-    ranLevelPercent = ranLevelFull ? 100 : 0; // Estado inicial do RAN
-
- 
     Serial.println(F("Atuadores do RAN configurados. Solenoide FECHADA."));
 
 }
@@ -78,73 +91,116 @@ void setupActuators() {
 // -------------------------------------------------------------
 
 // --- CONTROLE DA BOMBA DE EXTRACAO ---
+// A saída física é do motor de dosagem (startPumpDose em executeTpaExtraction); aqui fica o
+// estado publicado. Desligar também interrompe a dose em andamento.
 void setExtractionPumpState(bool state) {
     if (tpaExtractionPumpState == state) return; // Nao faz nada se o estado for o mesmo
 
     tpaExtractionPumpState = state;
-    // HIGH (ou LOW, dependendo da sua placa/rele) liga a bomba. Assumindo HIGH liga:
-    digitalWrite(TPA_EXTRACTION_PUMP_PIN, state ? HIGH : LOW);
+    if (!state) stopPumpDose(PUMP_EXTRACTION);
 
-    // Sincronizar status com Blynk (usando LED Widget)
-    if (Blynk.connected()) {
-        Blynk.virtualWrite(VPIN_TPA_EXTRACTION_PUMP, state ? 255 : 0); 
-    }
+    // Sincronizar status com Blynk (usando LED Widget) - enfileirado para a tarefa de rede
+    publishVirtualPinInt(VPIN_TPA_EXTRACTION_PUMP, state ? 255 : 0);
 
     // Log de evento
-    String logMsg = state ? F("Bomba de Extracao ATIVADA.") : F("Bomba de Extracao DESLIGADA.");
-    logSystemEvent(state ? "warning" : "info", logMsg.c_str());
-    updateDisplay();
+    logEvent(state ? LOG_LEVEL_WARNING : LOG_LEVEL_INFO, LOG_SRC_PUMP,
+             state ? "Bomba de Extracao ATIVADA." : "Bomba de Extracao DESLIGADA.");
+    // O display é atualizado pela tarefa de UI na próxima fotografia do controle
 }
 
-// --- CÁLCULO DA DURAÇÃO DA BOMBA ---
-// Calcula o tempo em milissegundos necessario para extrair o volume desejado
-unsigned long calculatePumpDuration(float volumeLiters) {
-    // 1 L = 1000 mL
-    float volumeML = volumeLiters * 1000.0f;
-    
-    // Calcula o tempo em segundos: Volume (mL) / Vazao (mL/s)
-    float durationSeconds = volumeML / EXTRACTION_PUMP_FLOW_RATE_ML_PER_SEC;
-    
-    // Converte para milissegundos
-    return (unsigned long)(durationSeconds * 1000.0f);
-}
+// --- VOLUME EXTRAÍDO ATÉ AGORA (M5.1) ---
+// Lotes já concluídos do plano TPA + volume integrado pelo motor de dosagem no lote atual;
+// usado na fotografia de estado enviada à UI.
+float getExtractedVolumeLiters() {
+    if (!tpaPlan.active) return 0.0f;
 
+    float extractedVolumeL = tpaPlan.extractedL;
+    if (tpaExtractionCurrentState == TPA_EXTRACTION_PUMPING) {
+        extractedVolumeL += getPumpDeliveredMl(PUMP_EXTRACTION) / 1000.0f;
+    }
 
-// --- ATUADOR: EXECUTA O CICLO DE EXTRACAO TPA ---
-// Esta funcao sera chamada pelo agendador (TPA Manager)
-void executeTpaExtraction() {
-    if (tpaPumpDurationMs == 0) {
-        Serial.println(F("ERRO: Duracao da bomba zero. Verifique configuracoes TPA."));
-        logSystemEvent("error", "Tentativa de TPA com duracao zero.");
-        return;
+    // Garante que o volume extraído não exceda o total programado
+    if (extractedVolumeL > tpaPlan.extractTargetL) {
+        extractedVolumeL = tpaPlan.extractTargetL;
+    }
+    return extractedVolumeL;
+}
+
+// --- ATUADOR: INICIA O CICLO DE EXTRACAO TPA ---
+// Esta funcao sera chamada pelo plano TPA (tpa_plan.ino), uma vez por lote de extração.
+// NÃO bloqueia: apenas liga a bomba e arma a FSM. O desligamento é feito por runTpaExtractionLoop().
+// Retorna false se a extração não pôde ser iniciada.
+bool executeTpaExtraction(float volumeLiters) {
+    if (volumeLiters <= 0.0f) {
+        Serial.println(F("ERRO: Volume de extracao zero. Verifique configuracoes TPA."));
+        logSystemEvent("error", "Tentativa de TPA com volume zero.");
+        return false;
     }
 
     if (serviceModeActive) {
         Serial.println(F("TPA abortada: Modo de Servico ATIVO."));
         logSystemEvent("warning", "TPA abortada devido ao Modo de Servico.");
-        return;
+        return false;
+    }
+
+    if (tpaExtractionCurrentState == TPA_EXTRACTION_PUMPING) {
+        Serial.println(F("AVISO: Extracao TPA ja esta em andamento."));
+        return false;
     }
     
     Serial.print(F("Iniciando Extracao TPA: "));
-    Serial.print(volumeToExtractLiters, 2);
+    Serial.print(volumeLiters, 2);
     Serial.print(F(" L por "));
-    Serial.print(tpaPumpDurationMs / 1000);
+    Serial.print(calculatePumpDuration(PUMP_EXTRACTION, volumeLiters) / 1000);
     Serial.println(F(" segundos."));
     
     logSystemEvent("info", "TPA Extracao iniciada.");
 
-    // 1. Ligar a bomba
+    // 1. Ligar a bomba (dose terminada pelo volume) e armar a FSM
+    if (!startPumpDose(PUMP_EXTRACTION, volumeLiters * 1000.0f)) {
+        logSystemEvent("error", "Bomba de Extracao nao pode iniciar a dose.");
+        return false;
+    }
+    tpaExtractionStartTime = halMillis(); // --- CAPTURA DO TEMPO INICIAL ---
+    tpaExtractionCurrentState = TPA_EXTRACTION_PUMPING;
     setExtractionPumpState(true); 
-    tpaExtractionStartTime = millis(); // --- CAPTURA DO TEMPO INICIAL ---
+    return true;
+}
 
-    // 2. Esperar o tempo calculado (Aviso: Bloqueia o loop principal e Blynk.run()!)
-    delay(tpaPumpDurationMs); 
+// --- MÁQUINA DE ESTADOS DA EXTRAÇÃO (M5.1) ---
+// Chamada a cada iteração pelo executor do plano TPA (runTpaPlan). Cada chamada é curta (sem delay()).
+void runTpaExtractionLoop() {
+    if (tpaExtractionCurrentState != TPA_EXTRACTION_PUMPING) return;
 
-    // 3. Desligar a bomba
-    setExtractionPumpState(false);
-    
-    logSystemEvent("success", "TPA Extracao concluida.");
-    // Inicia a reposicao (será implementada no Modulo 5.2)
+    // 1. Kill switch: Modo de Serviço desliga a bomba imediatamente
+    if (serviceModeActive) {
+        setExtractionPumpState(false);
+        tpaExtractionCurrentState = TPA_EXTRACTION_ABORTED;
+        Serial.println(F("Extracao TPA interrompida: Modo de Servico ATIVO."));
+        logSystemEvent("warning", "Extracao TPA interrompida pelo Modo de Servico.");
+        return;
+    }
+
+    // 2. Volume atingido: o motor de dosagem já desligou a bomba
+    if (!isPumpDoseActive(PUMP_EXTRACTION)) {
+        setExtractionPumpState(false);
+        tpaExtractionCurrentState = TPA_EXTRACTION_FINISHED;
+        logSystemEvent("success", "TPA Extracao concluida.");
+    }
+}
+
+bool isTpaExtractionFinished() {
+    return tpaExtractionCurrentState == TPA_EXTRACTION_FINISHED;
+}
+
+bool isTpaExtractionAborted() {
+    return tpaExtractionCurrentState == TPA_EXTRACTION_ABORTED;
+}
+
+void resetTpaExtractionFlow() {
+    setExtractionPumpState(false); // Garantir que a bomba esteja desligada
+    tpaExtractionCurrentState = TPA_EXTRACTION_IDLE;
+    Serial.println(F("Fluxo de Extracao (M5.1) resetado."));
 }
 
 // -------------------------------------------------------------
@@ -158,18 +214,46 @@ void executeTpaExtraction() {
 bool readRanLevelSensor() {
     // Retorna TRUE se o nível estiver OK (cheio ou no nível de segurança)
     // Se o sensor de nível for HIGH quando atingir o nível, mude a lógica para 'digitalRead(RAN_LEVEL_SENSOR_PIN) == HIGH'
-    return (digitalRead(RAN_LEVEL_SENSOR_PIN) == LOW); 
+    return (halDigitalRead(RAN_LEVEL_SENSOR_PIN) == LOW); 
 }
 
+static bool ranSolenoidOpen = false;          // Último comando da válvula (para a detecção de vazamento)
+static unsigned long ranRefillLowFlowSinceMs = 0;
+static bool ranRefillLowFlow = false;
+
 // Controle da Válvula Solenoide (NC - Normalmente Fechada)
 // ON (true) = ABERTO, OFF (false) = FECHADO
 void setRANSolenoidState(bool state) {
     // RELAY_ON deve ser LOW para ativar um relé NC
-    digitalWrite(RAN_SOLENOID_VALVE_PIN, state ? RELAY_ON : RELAY_OFF);
+    halDigitalWrite(RAN_SOLENOID_VALVE_PIN, state ? RELAY_ON : RELAY_OFF);
+    ranSolenoidOpen = state;
     Serial.print(F("Valvula Solenoide RAN: "));
     Serial.println(state ? F("ABERTA") : F("FECHADA"));
 }
 
+bool isRanSolenoidOpen() {
+    return ranSolenoidOpen;
+}
+
+// Vazão medida abaixo do mínimo por RAN_VALVE_STUCK_MS, depois da carência de abertura.
+// Sem sensor contínuo não há como saber: fica só o timeout.
+static bool isRanValveStuck() {
+    unsigned long now = halMillis();
+    if (!isRanLevelMeasured() || !ranLevel.rateValid || now - ranRefillStartTime < RAN_VALVE_GRACE_MS) {
+        ranRefillLowFlow = false;
+        return false;
+    }
+    if (ranLevel.fillRateLpm >= RAN_VALVE_MIN_INFLOW_LPM) {
+        ranRefillLowFlow = false;
+        return false;
+    }
+    if (!ranRefillLowFlow) {
+        ranRefillLowFlow = true;
+        ranRefillLowFlowSinceMs = now;
+    }
+    return now - ranRefillLowFlowSinceMs >= RAN_VALVE_STUCK_MS;
+}
+
 
 // --- INICIAR FLUXO DE ENCHIMENTO DO RAN (M5.3) ---
 void startRanRefillFlow() {
@@ -187,8 +271,14 @@ void startRanRefillFlow() {
     }
     
     Serial.println(F("Iniciando Enchimento do RAN (M5.3)..."));
-    logSystemEvent("info", "Iniciando Enchimento do RAN (M5.3).");
-    ranRefillStartTime = millis();
+    if (isRanLevelMeasured()) {
+        LOG_INFO(LOG_SRC_PUMP, "Iniciando Enchimento do RAN (M5.3): %.1f L -> %.1f L.",
+                 ranLevel.liters, ranLevelCal.targetLiters);
+    } else {
+        logSystemEvent("info", "Iniciando Enchimento do RAN (M5.3).");
+    }
+    ranRefillStartTime = halMillis();
+    ranRefillLowFlow = false;
     ranRefillCurrentState = RAN_REFILL_START_DELAY; 
 }
 
@@ -200,31 +290,41 @@ void runRanRefillLoop() {
         return;
     }
 
-    // 1. Monitorar o Sensor de Nível a cada loop
-    ranLevelFull = readRanLevelSensor();
-    ranLevelPercent = ranLevelFull ? 100 : 0;
-    updateRanLevelDisplay(); // Atualiza Blynk e Display
+    // 1. O nível (boia + sensor contínuo) é atualizado pela tarefa "nivel_ran" (ran_level.ino)
 
     // 2. Controlar o fluxo
     switch (ranRefillCurrentState) {
         case RAN_REFILL_START_DELAY:
             // O RAN inicia o enchimento imediatamente
             setRANSolenoidState(true); // Abre a Solenoide
+            ranRefillStartTime = halMillis(); // Base da carência da vazão e do timeout
             ranRefillCurrentState = RAN_REFILL_FILLING;
-            // Configurar um tempo máximo para o alerta de segurança
-            // *** NECESSÁRIO IMPLEMENTAR UM TIMER DE SEGURANÇA AQUI ***
             break;
 
         case RAN_REFILL_FILLING:
-            // Enchendo: Aguarda o sensor de nível
+            // Enchendo: termina no volume alvo medido (ou na boia, o limite físico)
             if (ranLevelFull) {
                 // Nível atingido!
                 setRANSolenoidState(false); // Fecha a Solenoide
                 Serial.println(F("Enchimento RAN concluido: Nivel atingido."));
-                logSystemEvent("info", "Enchimento RAN concluido.");
+                if (isRanLevelMeasured()) {
+                    LOG_INFO(LOG_SRC_PUMP, "Enchimento RAN concluido: %.1f L em %lu s.",
+                             ranLevel.liters, (halMillis() - ranRefillStartTime) / 1000UL);
+                } else {
+                    logSystemEvent("info", "Enchimento RAN concluido.");
+                }
                 ranRefillCurrentState = RAN_REFILL_FINISHED;
-            } else {                                                              // *** Checagem de Timeout ***
-                if (millis() - ranRefillStartTime >= RAN_REFILL_TIMEOUT_MS) {
+            } else if (isRanValveStuck()) {
+                // Válvula aberta sem vazão: travada fechada, sem pressão na osmose ou filtro entupido
+                setRANSolenoidState(false);
+                ranRefillCurrentState = RAN_REFILL_FINISHED;
+                if (!ranRefillAlertSent) {
+                    LOG_CRITICAL(LOG_SRC_PUMP, "FALHA: RAN sem vazao (%.2f L/min) com a valvula aberta. Valvula fechada.",
+                                 ranLevel.fillRateLpm);
+                    ranRefillAlertSent = true;
+                }
+            } else {                                                              // *** Checagem de Timeout (limite de segurança) ***
+                if (halMillis() - ranRefillStartTime >= RAN_REFILL_TIMEOUT_MS) {
                     setRANSolenoidState(false); // **DESLIGA IMEDIATAMENTE POR SEGURANÇA**
                     ranRefillCurrentState = RAN_REFILL_FINISHED; // Move para o estado final                    
                     if (!ranRefillAlertSent) {
@@ -232,11 +332,11 @@ void runRanRefillLoop() {
                         ranRefillAlertSent = true;
                     }
                 }
-                // Implementação do timer de segurança será uma melhoria futura. [cite: 253]
             }
 
             break;
             
+        case RAN_REFILL_IDLE:
         case RAN_REFILL_FINISHED:
             // Estado de parada.
             break;
@@ -266,20 +366,31 @@ void checkRanRefillAlert() {
 
 // --- ATUALIZAÇÃO BLYNK E DISPLAY PARA O RAN ---
 void updateRanLevelDisplay() {
-    // Note: Esta função é chamada repetidamente no runRanRefillLoop()
-    // A logica aqui deve ser leve.
+    // Note: Esta função é chamada a cada leitura da tarefa "nivel_ran" (ran_level.ino)
+    // A logica aqui deve ser leve: só enfileira para a tarefa de rede quando o valor muda.
+    static int lastPublishedPercent = -1;
+    static int lastPublishedAlert = -1;
+    static unsigned long lastVolumePublishMs = 0;
 
     // 1. Enviar para o Blynk
-    if (Blynk.connected()) {
+    if (ranLevelPercent != lastPublishedPercent) {
         // Envia o percentual de nível
-        Blynk.virtualWrite(VPIN_RAN_LEVEL_PERCENT, ranLevelPercent); 
-
-        // Envia o estado de alerta
-        if (ranRefillAlertSent) {
-            Blynk.virtualWrite(VPIN_RAN_REFILL_ALERT, 255);
-        } else {
-            Blynk.virtualWrite(VPIN_RAN_REFILL_ALERT, 0);
-        }
+        publishVirtualPinInt(VPIN_RAN_LEVEL_PERCENT, ranLevelPercent);
+        lastPublishedPercent = ranLevelPercent;
+    }
+
+    // Envia o estado de alerta
+    int alertValue = ranRefillAlertSent ? 255 : 0;
+    if (alertValue != lastPublishedAlert) {
+        publishVirtualPinInt(VPIN_RAN_REFILL_ALERT, alertValue);
+        lastPublishedAlert = alertValue;
+    }
+
+    // Volume e vazão medidos: uma vez por segundo (a zona morta da telemetria filtra o resto)
+    if (isRanLevelMeasured() && halMillis() - lastVolumePublishMs >= RAN_LEVEL_RATE_SLOT_MS) {
+        lastVolumePublishMs = halMillis();
+        publishVirtualPin(VPIN_RAN_VOLUME, ranLevel.liters);
+        if (ranLevel.rateValid) publishVirtualPin(VPIN_RAN_FILL_RATE, ranLevel.fillRateLpm);
     }
 }
 
@@ -288,13 +399,19 @@ void updateRanLevelDisplay() {
 // -------------------------------------------------------------
 
 // --- CONTROLE DA BOMBA DE BUFFER (M5.4) ---
-void setBufferPumpState(bool state) {
-    if (serviceModeActive && state) {
+// Dose exata em mL pelo motor de dosagem. Retorna false se a dose não pôde começar.
+bool setBufferPumpState(bool state) {
+    if (!state) {
+        stopPumpDose(PUMP_BUFFER);
+        Serial.println(F("Bomba de Buffer: DESLIGADA"));
+        return true;
+    }
+    if (serviceModeActive) {
         Serial.println(F("AVISO: Bomba de Buffer bloqueada pelo Modo de Serviço."));
         logSystemEvent("warning", "Bomba Buffer bloqueada (Servico ativo).");
-        return;
+        return false;
     }
-    digitalWrite(TPA_BUFFER_PUMP_PIN, state ? RELAY_ON : RELAY_OFF);
-    Serial.print(F("Bomba de Buffer: "));
-    Serial.println(state ? F("LIGADA") : F("DESLIGADA"));
+    if (!startPumpDose(PUMP_BUFFER, (float)ranBufferVolumeML)) return false;
+    Serial.println(F("Bomba de Buffer: LIGADA"));
+    return true;
 }
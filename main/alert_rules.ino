@@ -0,0 +1,322 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: ALERT_RULES                 |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Table-driven alert rules (hysteresis, dwell, rate of change, interlocks)
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.01 - Rule table persisted in config, per-rule FSM (dwell, hysteresis, rate), replaces fixed temperature/pH alerts
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - (this file) Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- MOTOR DE REGRAS DE ALERTA ---
+// Substitui checkTempAlert()/checkPhAlert(): cada alerta é uma linha de alertRules[] (persistida
+// no config), avaliada uma vez por lote de amostras em sendSensorData() (tarefa de controle).
+// Tempo constante por regra, sem alocação:
+// - Limite alto/baixo com histerese: dispara acima de threshold, só limpa abaixo de threshold - hysteresis.
+// - Dwell: a violação precisa durar dwellS segundos (ruído do ADC não dispara nada).
+// - Debounce de saída: a condição precisa ficar normal por clearS segundos para o alerta limpar.
+// - Taxa de variação: variação do sinal na janela windowS, lida de um anel por minuto (O(1)).
+// - Intertravamento: ALERT_ACTION_STOP_TPA cancela o plano TPA e bloqueia novos ciclos enquanto ativo.
+// Nova sonda = uma linha em ALERT_SIGNALS; novo alerta = uma linha em alertRules (config/JSON).
+
+AlertRule alertRules[ALERT_MAX_RULES];
+AlertRuleState alertRuleStates[ALERT_MAX_RULES];
+
+// Histórico por minuto de cada sinal (para as regras de taxa de variação)
+static float rateHistory[ALERT_SIGNAL_COUNT][ALERT_RATE_SLOTS];
+static uint8_t rateHead[ALERT_SIGNAL_COUNT];       // Próximo slot a gravar
+static uint8_t rateCount[ALERT_SIGNAL_COUNT];      // Slots válidos
+static unsigned long lastRateSampleMs = 0;
+
+static float signalValues[ALERT_SIGNAL_COUNT];
+static bool signalValid[ALERT_SIGNAL_COUNT];
+
+// --- 1. SINAIS: de onde vem cada valor (NAN = leitura indisponível) ---
+static float readAlertTempTank() { float t = getProbeTemperature(TEMP_PROBE_DISPLAY); return t == -999.0f ? NAN : t; }
+static float readAlertTempSump() { float t = getProbeTemperature(TEMP_PROBE_SUMP); return t == -999.0f ? NAN : t; }
+static float readAlertTempRan()  { float t = getProbeTemperature(TEMP_PROBE_RAN); return t == -999.0f ? NAN : t; }
+static float readAlertPh()       { return phCalibrationMode ? NAN : phValue; } // Calibração: sonda fora do aquário
+
+struct AlertSignalDef {
+    const char* name;
+    const char* unit;
+    float (*read)();
+};
+static const AlertSignalDef ALERT_SIGNALS[ALERT_SIGNAL_COUNT] = {
+    { "Temperatura", "C", readAlertTempTank },
+    { "Temp. Sump",  "C", readAlertTempSump },
+    { "Temp. RAN",   "C", readAlertTempRan },
+    { "pH",          "",  readAlertPh },
+};
+
+static const char* const ALERT_KIND_NAMES[ALERT_KIND_COUNT] = { "alto", "baixo", "subindo", "caindo" };
+
+
+// 2. --- DEFAULTS (equivalentes aos alertas antigos + taxa de temperatura) ---
+void setAlertRuleDefaults(AlertRule* rules) {
+    memset(rules, 0, sizeof(AlertRule) * ALERT_MAX_RULES);
+    for (uint8_t i = 0; i < ALERT_MAX_RULES; i++) rules[i].signal = ALERT_SIGNAL_NONE;
+
+    //        sinal                 tipo              severidade           ação                   LED  limite        hist.  dwell clear janela
+    rules[0] = { ALERT_SIGNAL_TEMP_TANK, ALERT_KIND_HIGH, LOG_LEVEL_CRITICAL, ALERT_ACTION_NONE,     VPIN_TEMP_ALERT, UPPER_TEMP,   0.3f,  30,   60,   0 };
+    rules[1] = { ALERT_SIGNAL_TEMP_TANK, ALERT_KIND_LOW,  LOG_LEVEL_CRITICAL, ALERT_ACTION_NONE,     VPIN_TEMP_ALERT, LOWER_TEMP,   0.3f,  30,   60,   0 };
+    rules[2] = { ALERT_SIGNAL_TEMP_TANK, ALERT_KIND_RISE, LOG_LEVEL_WARNING,  ALERT_ACTION_NONE,     0,  0.5f,         0.1f,  0,    300,  600 };
+    rules[3] = { ALERT_SIGNAL_PH,        ALERT_KIND_LOW,  LOG_LEVEL_CRITICAL, ALERT_ACTION_STOP_TPA, VPIN_PH_ALERT, PH_MIN_LIMIT, 0.05f, 60,   120,  0 };
+    rules[4] = { ALERT_SIGNAL_PH,        ALERT_KIND_HIGH, LOG_LEVEL_CRITICAL, ALERT_ACTION_STOP_TPA, VPIN_PH_ALERT, PH_MAX_LIMIT, 0.05f, 60,   120,  0 };
+}
+
+void setupAlertRules() {
+    memset(alertRuleStates, 0, sizeof(alertRuleStates));
+    memset(rateCount, 0, sizeof(rateCount));
+    memset(rateHead, 0, sizeof(rateHead));
+}
+
+
+// 3. --- TAXA DE VARIAÇÃO ---
+static void sampleRateHistory(unsigned long nowMs) {
+    if (lastRateSampleMs != 0 && nowMs - lastRateSampleMs < ALERT_RATE_SLOT_MS) return;
+    lastRateSampleMs = nowMs;
+    for (uint8_t s = 0; s < ALERT_SIGNAL_COUNT; s++) {
+        if (!signalValid[s]) {
+            rateCount[s] = 0; // Buraco na série: recomeça (não compara com leitura antiga)
+            continue;
+        }
+        rateHistory[s][rateHead[s]] = signalValues[s];
+        rateHead[s] = (rateHead[s] + 1) % ALERT_RATE_SLOTS;
+        if (rateCount[s] < ALERT_RATE_SLOTS) rateCount[s]++;
+    }
+}
+
+// Variação do sinal nos últimos windowS segundos; false se ainda não há histórico suficiente
+static bool getSignalDelta(uint8_t signal, uint16_t windowS, float& delta) {
+    uint8_t slots = (uint8_t)(windowS / (ALERT_RATE_SLOT_MS / 1000UL));
+    if (slots < 1) slots = 1;
+    if (slots > ALERT_RATE_SLOTS - 1) slots = ALERT_RATE_SLOTS - 1;
+    if (rateCount[signal] <= slots) return false;
+    uint8_t oldIndex = (rateHead[signal] + ALERT_RATE_SLOTS - 1 - slots) % ALERT_RATE_SLOTS;
+    delta = signalValues[signal] - rateHistory[signal][oldIndex];
+    return true;
+}
+
+
+// 4. --- AVALIAÇÃO ---
+static void reportAlertTransition(uint8_t index, bool active, float value) {
+    const AlertRule& rule = alertRules[index];
+    const AlertSignalDef& sig = ALERT_SIGNALS[rule.signal];
+    const char* kind = ALERT_KIND_NAMES[rule.kind % ALERT_KIND_COUNT];
+    bool rate = rule.kind == ALERT_KIND_RISE || rule.kind == ALERT_KIND_FALL;
+
+    if (active) {
+        if (rate) {
+            LOG_EVENT(rule.severity, LOG_SRC_ALERT, "ALERTA: %s %s %.2f%s em %u min",
+                      sig.name, kind, value, sig.unit, (unsigned)(rule.windowS / 60));
+        } else {
+            LOG_EVENT(rule.severity, LOG_SRC_ALERT, "ALERTA: %s %s: %.2f%s (limite %.2f)",
+                      sig.name, kind, value, sig.unit, rule.threshold);
+        }
+        Serial.print(F("ALERTA: "));
+    } else {
+        LOG_WARNING(LOG_SRC_ALERT, "%s normalizado (%s): %.2f%s", sig.name, kind, value, sig.unit);
+        Serial.print(F("NORMAL: "));
+    }
+    Serial.print(sig.name);
+    Serial.print(F(" "));
+    Serial.print(kind);
+    Serial.print(F(" = "));
+    Serial.println(value, 2);
+
+    if (active && rule.action == ALERT_ACTION_STOP_TPA && isTpaPlanActive()) {
+        abortTpaPlan("intertravamento de alerta");
+    }
+}
+
+// Avança a FSM de uma regra. Tempo constante (uma comparação + uma leitura de anel no pior caso).
+static void evaluateAlertRule(uint8_t index, unsigned long nowMs) {
+    const AlertRule& rule = alertRules[index];
+    AlertRuleState& st = alertRuleStates[index];
+    if (rule.signal >= ALERT_SIGNAL_COUNT || rule.kind >= ALERT_KIND_COUNT) return;
+    if (!signalValid[rule.signal]) return; // Sem leitura: mantém o estado
+
+    float value = signalValues[rule.signal];
+    bool violating;
+    bool clearOk;
+    switch (rule.kind) {
+        case ALERT_KIND_HIGH:
+            violating = value > rule.threshold;
+            clearOk = value < rule.threshold - rule.hysteresis;
+            break;
+        case ALERT_KIND_LOW:
+            violating = value < rule.threshold;
+            clearOk = value > rule.threshold + rule.hysteresis;
+            break;
+        default: {
+            float delta;
+            if (!getSignalDelta(rule.signal, rule.windowS, delta)) return;
+            if (rule.kind == ALERT_KIND_FALL) delta = -delta;
+            value = delta;
+            violating = delta > rule.threshold;
+            clearOk = delta < rule.threshold - rule.hysteresis;
+            break;
+        }
+    }
+    st.lastValue = value;
+
+    switch (st.state) {
+        case ALERT_STATE_IDLE:
+            if (violating) {
+                st.state = ALERT_STATE_PENDING;
+                st.sinceMs = nowMs;
+            }
+            break;
+        case ALERT_STATE_PENDING:
+            if (!violating) {
+                st.state = ALERT_STATE_IDLE; // Pico isolado (ruído): descartado
+            } else if (nowMs - st.sinceMs >= rule.dwellS * 1000UL) {
+                st.state = ALERT_STATE_ACTIVE;
+                st.activations++;
+                reportAlertTransition(index, true, value);
+            }
+            break;
+        case ALERT_STATE_ACTIVE:
+            if (clearOk) {
+                st.state = ALERT_STATE_CLEARING;
+                st.sinceMs = nowMs;
+            }
+            break;
+        case ALERT_STATE_CLEARING:
+            if (!clearOk) {
+                st.state = ALERT_STATE_ACTIVE;
+            } else if (nowMs - st.sinceMs >= rule.clearS * 1000UL) {
+                st.state = ALERT_STATE_IDLE;
+                reportAlertTransition(index, false, value);
+            }
+            break;
+    }
+}
+
+static bool isAlertRuleRaised(uint8_t index) {
+    return alertRuleStates[index].state == ALERT_STATE_ACTIVE ||
+           alertRuleStates[index].state == ALERT_STATE_CLEARING;
+}
+
+// LEDs do Blynk: cada pino acende se qualquer regra ligada a ele estiver ativa
+static void publishAlertLeds() {
+    for (uint8_t i = 0; i < ALERT_MAX_RULES; i++) {
+        uint8_t led = alertRules[i].ledVpin;
+        if (led == 0 || alertRules[i].signal >= ALERT_SIGNAL_COUNT) continue;
+        bool firstWithLed = true;
+        for (uint8_t j = 0; j < i; j++) {
+            if (alertRules[j].ledVpin == led && alertRules[j].signal < ALERT_SIGNAL_COUNT) firstWithLed = false;
+        }
+        if (!firstWithLed) continue; // Pino já publicado
+        bool on = false;
+        for (uint8_t j = i; j < ALERT_MAX_RULES; j++) {
+            if (alertRules[j].ledVpin == led && isAlertRuleRaised(j)) on = true;
+        }
+        publishVirtualPinInt(led, on ? 255 : 0); // O publicador de telemetria descarta repetições
+    }
+}
+
+// Chamada por sendSensorData() (tarefa de controle) a cada lote de amostras
+void evaluateAlertRules() {
+    unsigned long nowMs = halMillis();
+    for (uint8_t s = 0; s < ALERT_SIGNAL_COUNT; s++) {
+        signalValues[s] = ALERT_SIGNALS[s].read();
+        signalValid[s] = !isnan(signalValues[s]);
+    }
+    sampleRateHistory(nowMs);
+
+    for (uint8_t i = 0; i < ALERT_MAX_RULES; i++) {
+        evaluateAlertRule(i, nowMs);
+    }
+    publishAlertLeds();
+}
+
+// Intertravamento consultado por startTpaPlan()
+bool isAlertInterlockActive(uint8_t action) {
+    for (uint8_t i = 0; i < ALERT_MAX_RULES; i++) {
+        if (alertRules[i].action == action && isAlertRuleRaised(i)) return true;
+    }
+    return false;
+}
+
+// Reset manual (botão físico ou Blynk, via CMD_RESET_ALERTS): reconhece os alertas ativos.
+// Se a condição continuar, a regra dispara de novo depois do dwell.
+void resetCriticalAlerts() {
+    bool any = false;
+    for (uint8_t i = 0; i < ALERT_MAX_RULES; i++) {
+        if (alertRuleStates[i].state != ALERT_STATE_IDLE) any = true;
+        alertRuleStates[i].state = ALERT_STATE_IDLE;
+    }
+    if (any) {
+        publishAlertLeds();
+        Serial.println(F("Todos os alertas criticos de sensores resetados."));
+        logSystemEvent("info", "Reset de Alertas Críticos.");
+    } else {
+        Serial.println(F("Nenhum alerta critico ativo para reset."));
+    }
+}
+
+void reportAlertRules() {
+    char line[80];
+    for (uint8_t i = 0; i < ALERT_MAX_RULES; i++) {
+        const AlertRule& rule = alertRules[i];
+        if (rule.signal >= ALERT_SIGNAL_COUNT) continue;
+        snprintf(line, sizeof(line), "%u %-12s %-7s lim %.2f est %u ult %.2f disparos %lu",
+                 i, ALERT_SIGNALS[rule.signal].name, ALERT_KIND_NAMES[rule.kind % ALERT_KIND_COUNT],
+                 rule.threshold, alertRuleStates[i].state, alertRuleStates[i].lastValue,
+                 (unsigned long)alertRuleStates[i].activations);
+        Serial.println(line);
+    }
+}
@@ -21,6 +21,24 @@
 
 
 == Version History ==
+15/10/2026 - 0.20 - PUMP_RUNTIME_SAVE_MS
+15/10/2026 - 0.19 - BUTTON_LONG_PRESS_MS back to Button2's default 200 ms
+15/10/2026 - 0.18 - Config schema 9; TEMP_PROBE_SCAN_MAX
+15/10/2026 - 0.17 - RTC_SQW_PIN moved to GPIO13 (GPIO4 is the 1-Wire bus)
+15/10/2026 - 0.16 - State sync window/period constants; config schema 8
+15/10/2026 - 0.15 - Button debounce/long-press/response constants; light sleep and idle wait limits
+15/10/2026 - 0.14 - RAN level input, geometry and valve-check constants; VPIN_RAN_VOLUME/_FILL_RATE (V43-V44)
+15/10/2026 - 0.13 - Profiler constants, VPIN_DIAGNOSTICS (V42); MAX_SCHEDULER_TASKS raised to 32
+15/10/2026 - 0.12 - Event log constants
+15/10/2026 - 0.11 - TPA plan constants (mode, level delta, batch); config schema 5
+15/10/2026 - 0.10 - Dosing engine constants, VPIN_PUMP_CAL/_ML/_STATUS (V39-V41)
+15/10/2026 - 0.09 - History store constants; MAX_SCHEDULER_TASKS raised to 24
+15/10/2026 - 0.08 - Telemetry publisher constants
+15/10/2026 - 0.07 - OLED page count, 400 kHz I2C clock and flush chunk size
+15/10/2026 - 0.06 - pH acquisition/calibration constants, VPIN_PH_CAL_POINTS
+15/10/2026 - 0.05 - Added FreeRTOS task split and SPSC queue constants
+15/10/2026 - 0.04 - Added DS18B20 multi-probe constants and Blynk pins
+15/10/2026 - 0.03 - Added cooperative task scheduler constants
 01/11/2025 - 0.02 - Added Module 3 constants
 31/10/2025 - 0.01 - First installment based on code created by Gemini AI (Google)
 
@@ -38,6 +56,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -53,12 +86,21 @@ char pass[] = "M3uC4oPr370";                       // WiFi password
 #define VPIN_TEMP       V5    // Virtual PIN no Blynk para representar temperatura
 #define VPIN_RTC_RESET  V10   // Virtual Pin no Blynk para o botão de reset de alerta de bateria
 #define VPIN_TEMP_ALERT V15   // Virtual Pin no Blynk para representar LED de alta temperatura
+#define VPIN_TEMP_SUMP  V36   // Virtual Pin no Blynk para a temperatura do Sump
+#define VPIN_TEMP_RAN   V37   // Virtual Pin no Blynk para a temperatura do RAN
 
 // --- Pinos Virtuais BLYNK (Módulo 2: pH) ---
 #define VPIN_PH_VAL           V11    // Para exibir o valor do pH
 #define VPIN_PH_CAL           V12    // Botão/Menu para acionar a calibração
 #define VPIN_CAL_STATUS       V13    // Para exibir o status da calibração (e.g., "Calibrar pH 7")
 #define VPIN_PH_ALERT         V14    // Para exibir o status do alerta de pH (LED ou Gauge Color)
+#define VPIN_PH_CAL_POINTS    V38    // Número de pontos da calibração de pH (1, 2 ou 3)
+#define VPIN_PUMP_CAL         V39    // Calibração guiada da bomba (1 = Extração, 2 = Reposição, 3 = Buffer)
+#define VPIN_PUMP_CAL_ML      V40    // Volume medido na proveta ao fim da corrida de calibração (mL)
+#define VPIN_PUMP_CAL_STATUS  V41    // Status da calibração da bomba
+#define VPIN_DIAGNOSTICS      V42    // Resumo do profiler (texto, 1/min); escrever 1 imprime o relatório no Serial
+#define VPIN_RAN_VOLUME       V43    // Volume medido no RAN (L)
+#define VPIN_RAN_FILL_RATE    V44    // Vazão líquida no RAN (L/min, negativa = esvaziando)
 #define VPIN_ALERT_RESET      V16    // Botão para resetar alertas criticos (PH, TEMP)
 #define VPIN_SERVICE_MODE     V17    // Switch para ativar/desativar o modo de serviço
 
@@ -85,12 +127,29 @@ char pass[] = "M3uC4oPr370";                       // WiFi password
 #define SCREEN_HEIGHT 64     // Altura do display OLED (em pixels)
 #define OLED_RESET -1        // Pino de Reset (necessário para o ESP32, use -1 para que a biblioteca gerencie)
 #define SCREEN_ADDRESS 0x3C  // Endereço I2C comum para o SSD1306 (pode ser 0x3D)
+#define OLED_PAGE_COUNT (SCREEN_HEIGHT / 8) // Páginas de 8 linhas do SSD1306
+#define OLED_I2C_CLOCK_HZ 400000UL          // Barramento I2C compartilhado (OLED + DS3231) em Fast Mode
+#define OLED_I2C_CHUNK_BYTES 64             // Bytes de dados por transação (buffer do Wire no ESP32 = 128)
 
 // --- ATUADORES TPA (Módulo 5.2: Bombas de extração/reposição) ---
 #define TPA_EXTRACTION_PUMP_PIN 25 // Pino GPIO para Bomba Peristaltica de Extracao
 #define TPA_REPOSITION_PUMP_PIN 23 // Boma peristáltica paa reposição de TPA
 #define TPA_BUFFER_PUMP_PIN 28 // Boma peristáltica paa reposição de TPA
-#define EXTRACTION_PUMP_FLOW_RATE_ML_PER_SEC 10.0 // Vazao da Bomba (10 ml/s = 600 ml/min)
+#define EXTRACTION_PUMP_FLOW_RATE_ML_PER_SEC 10.0 // Vazao padrão de cada bomba até a calibração (10 ml/s = 600 ml/min)
+
+// --- MOTOR DE DOSAGEM (dosing_engine) ---
+#define PUMP_PWM_FIRST_CHANNEL      0        // Canais LEDC 0..2 (só usados com rampa de soft-start)
+#define PUMP_PWM_FREQ_HZ            1000
+#define PUMP_PWM_RESOLUTION_BITS    8
+#define PUMP_PWM_MAX_DUTY           255
+#define PUMP_CAL_RUN_MS             30000UL  // Duração da corrida de calibração guiada
+#define PUMP_FLOW_MIN_ML_PER_SEC    0.05f    // Faixa aceitável da vazão calibrada
+#define PUMP_FLOW_MAX_ML_PER_SEC    200.0f
+#define PUMP_DRIFT_MIN_RUNTIME_H    1.0f     // Uso mínimo entre calibrações para medir desgaste
+#define PUMP_DRIFT_MAX_PCT_PER_100H 20.0f
+#define PUMP_DRIFT_ALPHA            0.5f     // Peso da nova medida de desgaste
+#define PUMP_MAX_WEAR_FRACTION      0.5f     // Compensação máxima (tubo gasto demais: recalibrar)
+#define PUMP_RUNTIME_SAVE_MS        21600000UL // Tempo de uso fora da TPA gravado no máximo a cada 6 h
 
 // --- ATUADORES RAN -Reservatório de água Nova) (Módulo 5.3: Válvula solenóide/sensor de nível) ---
 #define RAN_SOLENOID_VALVE_PIN 24  // Pino GPIO da válvula solenóide
@@ -100,6 +159,48 @@ char pass[] = "M3uC4oPr370";                       // WiFi password
 // 2,000,000 ms (2000 segundos ou ~33.3 minutos)
 #define RAN_REFILL_TIMEOUT_MS (2000UL * 1000UL)
 
+// --- Nível contínuo do RAN (ran_level.ino) ---
+// A boia continua ligada como limite físico de "cheio"; o sensor contínuo mede o volume.
+#define RAN_LEVEL_INPUT_NONE        0          // Só a boia (0% / 100%)
+#define RAN_LEVEL_INPUT_ANALOG      1          // Sensor de pressão/capacitivo 0-3.1 V no ADC1
+#define RAN_LEVEL_INPUT_ULTRASONIC  2          // JSN-SR04T (trigger/eco) acima da água
+#define RAN_LEVEL_INPUT             RAN_LEVEL_INPUT_ANALOG
+#define RAN_LEVEL_ADC_CHANNEL       ADC1_CHANNEL_3  // GPIO39 (só entrada)
+#define RAN_LEVEL_ADC_ATTEN         ADC_ATTEN_DB_11
+#define RAN_LEVEL_ADC_MIN_MV        50.0f      // Fora desta faixa: sensor desconectado/em curto
+#define RAN_LEVEL_ADC_MAX_MV        3100.0f
+#define RAN_LEVEL_TRIG_PIN          18
+#define RAN_LEVEL_ECHO_PIN          19
+#define RAN_LEVEL_ECHO_MIN_US       120UL      // ~2 cm: zona cega do transdutor
+#define RAN_LEVEL_ECHO_MAX_US       25000UL    // ~4 m: sem eco
+#define RAN_LEVEL_SOUND_MM_PER_US   0.1715f    // Ida e volta (343 m/s / 2)
+#define RAN_LEVEL_SAMPLE_PERIOD_MS  100UL      // Tarefa de controle "nivel_ran" (10 leituras/s)
+#define RAN_LEVEL_MEDIAN_WINDOW     9          // Leituras por mediana (ímpar, <= 16)
+#define RAN_LEVEL_IIR_ALPHA         0.2f       // Peso de cada nova mediana (~0.5 s de constante)
+#define RAN_LEVEL_MAX_INVALID       20         // Leituras ruins seguidas até marcar o sensor como ausente
+#define RAN_LEVEL_RATE_SLOT_MS      1000UL     // Um ponto de volume por segundo para a vazão
+#define RAN_LEVEL_RATE_WINDOW_S     30         // Janela da vazão (L/min); anel com um slot a mais
+#define RAN_GEOMETRY_MAX_POINTS     8
+#define RAN_LEVEL_EMPTY_MV_DEFAULT  400.0f     // Calibração padrão: 0.4 V vazio, 2.8 V a 300 mm
+#define RAN_LEVEL_FULL_MV_DEFAULT   2800.0f
+#define RAN_LEVEL_HEIGHT_MM_DEFAULT 300.0f
+#define RAN_LEVEL_EMPTY_MM_DEFAULT  350.0f     // Ultrassônico: eco até o fundo / até a água em 300 mm
+#define RAN_LEVEL_FULL_MM_DEFAULT   50.0f
+#define RAN_CAPACITY_L_DEFAULT      20.0f      // Geometria padrão: prisma de 20 L em 300 mm
+#define RAN_TARGET_L_DEFAULT        19.0f      // Enche até aqui (a boia fica um pouco acima)
+
+// --- Válvula do RAN (detecção de falha pela vazão medida) ---
+#define RAN_VALVE_GRACE_MS          30000UL    // Após abrir: vazão aparece e a janela de 30 s se renova
+#define RAN_VALVE_MIN_INFLOW_LPM    0.2f       // Abaixo disto com a válvula aberta: travada/sem pressão
+#define RAN_VALVE_STUCK_MS          60000UL    // ...por este tempo: fecha e alerta
+#define RAN_VALVE_LEAK_LPM          0.15f      // Subida com a válvula fechada: travada aberta
+#define RAN_VALVE_LEAK_MS           60000UL
+
+// --- Reposição terminada pelo nível ---
+#define RAN_REPOSITION_DOSE_MARGIN  1.25f      // A dose da bomba vira só o limite de segurança
+#define RAN_REPOSITION_MIN_RATIO    0.8f       // Dose acabou com menos que isto medido: aborta (cancela o ciclo)
+#define RAN_MIN_RESERVE_L           0.5f       // Protege a bomba de reposição de rodar a seco
+
 
 // --- PAGINAÇÃO OLED (MÓDULO 5.4: ) ---
 #define OLED_PAGE_BUTTON_PIN    27 // Botao Fisico para mudar a pagina/menu do OLED
@@ -107,6 +208,7 @@ char pass[] = "M3uC4oPr370";                       // WiFi password
 // --- Pinos GPIO Físicos (botões físicos) ---
 #define PH_CAL_BUTTON_PIN       32  // Calibração de pH (já existente)
 #define ALERT_RESET_BUTTON_PIN  33  // Reset de Alerta CRITICO (Temp, pH)
+// GPIO34-39 não têm pull-up interno: os botões nesses pinos precisam de resistor externo (10 kΩ ao 3V3)
 #define SERVICE_MODE_BUTTON_PIN 34  // Ativa/Desativa Modo de Serviço/Manutenção
 #define RTC_RESET_BUTTON_PIN    35  // Reset de Alerta de Bateria/OSF do RTC
 #define UP_BUTTON_PIN           36  // Botão para incremento
@@ -117,6 +219,16 @@ char pass[] = "M3uC4oPr370";                       // WiFi password
 
 // --- Pinos de Hardware ---
 #define ONE_WIRE_BUS 4      // Pino para o Sensor DS18B20
+
+// --- Sondas DS18B20 (Módulo 1: aquisição não bloqueante em sensors.ino) ---
+#define MAX_TEMP_PROBES          3        // Aquário (display), Sump e RAN no mesmo barramento
+#define TEMP_PROBE_SCAN_MAX      8        // Sondas lidas na busca do boot (as excedentes são ignoradas)
+#define TEMP_RES_DISPLAY_BITS    12       // Resolução da sonda do aquário (0.0625 °C, 750 ms)
+#define TEMP_RES_SUMP_BITS       12       // Resolução da sonda do sump
+#define TEMP_RES_RAN_BITS        10       // Resolução da sonda do RAN (0.25 °C, 188 ms)
+#define TEMP_SAMPLE_INTERVAL_MS  5000UL   // Intervalo entre conversões (mesmo período do Ticker)
+#define TEMP_SAMPLE_MAX_AGE_MS   15000UL  // Amostra mais velha que isso é tratada como falha de leitura
+#define TEMP_ACQ_TASK_PERIOD_MS  20UL     // Período da tarefa de aquisição no escalonador
 #define PH_PIN       A0     // Pino analógico onde o módulo de pH está conectado
 
 // --- CONFIGURAÇÕES OBRIGATÓRIAS DO BLYNK IOT ---
@@ -126,6 +238,7 @@ char pass[] = "M3uC4oPr370";                       // WiFi password
 // --- Constantes usadas ---
 // Constantes - Módulo 1 (temperatura, tempo)
 const float UPPER_TEMP = 28.0;           // Limite superior de temperatura
+const float LOWER_TEMP = 24.0;           // Limite inferior de temperatura
 const char* NTPSERVER = "pool.ntp.org";  // Servidores NTP públicos
 const long GMTOFFSET_SEC = -3 * 3600;    // fuso horário de Brasília (UTC-3). -3 horas * 3600 seg/hora
 const int   DAYLIGHTOFFSET_SEC = 0;      // Sem horário de verão
@@ -136,14 +249,139 @@ const float PH_MIN_LIMIT = 6.5;   // Limite mínimo de pH para alerta (Ácido)
 const float PH_MAX_LIMIT = 7.8;   // Limite máximo de pH para alerta (Alcalino)
 #define DEFAULT_PH_OFFSET 0.0     // Offset padrão ao iniciar
 
+// --- Aquisição do pH (ph_sensor.ino) ---
+// Leitura direta do ADC1 (o ADC2 é ocupado pelo Wi-Fi) com curva de calibração do eFuse.
+#define PH_ADC_CHANNEL          ADC1_CHANNEL_0  // GPIO36 (PH_PIN = A0)
+#define PH_ADC_ATTEN            ADC_ATTEN_DB_11 // Faixa de entrada até ~3.1 V
+#define PH_ADC_DEFAULT_VREF_MV  1100            // Vref usada se o eFuse não tiver calibração
+#define PH_ACQ_TASK_PERIOD_MS   10UL     // Período da tarefa de aquisição no escalonador
+#define PH_BURST_SAMPLES        4        // Leituras do ADC por execução (400 amostras/s)
+#define PH_RING_SIZE            64       // Buffer circular de amostras brutas (potência de 2)
+#define PH_MEDIAN_WINDOW        15       // Amostras por mediana (ímpar, <= PH_RING_SIZE)
+#define PH_FILTER_DECIMATION    8        // Uma saída filtrada a cada 8 amostras (50 Hz)
+#define PH_IIR_ALPHA            0.05f    // Peso de cada nova mediana no IIR (~0.4 s de constante)
+
+// --- Calibração do pH (1, 2 ou 3 pontos) ---
+#define PH_NEUTRAL_MV_DEFAULT   1650.0f  // Tensão em pH 7.0 do modelo original (1.65 V)
+#define PH_SLOPE_MV_DEFAULT     200.0f   // Sensibilidade do modelo original (0.2 V/pH)
+#define PH_SLOPE_MV_MIN         50.0f    // Inclinações fora desta faixa indicam sonda/tampão ruim
+#define PH_SLOPE_MV_MAX         400.0f
+#define PH_CAL_BUFFER_NEUTRAL   7.00f    // Tampões na ordem de captura
+#define PH_CAL_BUFFER_ACID      4.00f
+#define PH_CAL_BUFFER_BASE      10.00f
+#define PH_CAL_POINTS_DEFAULT   1        // Compatível com a calibração antiga (só offset)
+#define PH_CAL_STABLE_BAND_MV   1.0f     // Variação máxima da leitura filtrada para aceitar o ponto
+#define PH_CAL_STABLE_WINDOW_MS 10000UL  // Tempo que a leitura deve ficar dentro da faixa
+#define PH_CAL_TIMEOUT_MS       180000UL // Desiste do ponto se não estabilizar em 3 min
+#define PH_CAL_WAIT_TIMEOUT_MS  600000UL // Desiste se o próximo tampão não for confirmado em 10 min
+
 
 // Constantes - hardware_manager
 const float VOLUME_STEP = 0.1; // Ajuste de 100mL
+#define BUTTON_DEBOUNCE_MS        30UL     // Bordas até 30 ms após uma borda aceita são repique
+#define BUTTON_LONG_PRESS_MS      200UL    // Clique longo ao soltar: padrão do Button2 (LONGCLICK_MS), usado desde o início
+#define BUTTON_EDGE_QUEUE_SIZE    16       // Fila ISR -> UI (potência de 2)
+#define BUTTON_RESPONSE_TARGET_US 20000UL  // Borda -> handler: acima disso conta como resposta lenta
+
+// Constantes - Energia e sono leve (power_manager)
+// O sono leve automático exige CONFIG_PM_ENABLE e CONFIG_FREERTOS_USE_TICKLESS_IDLE no sdkconfig
+// (núcleo Arduino compilado como componente do ESP-IDF); sem eles, esp_pm_configure() recusa e
+// o sistema segue só com as esperas longas das tarefas.
+#define ACC_LIGHT_SLEEP           1
+#define PM_CPU_MAX_MHZ            240
+#define PM_CPU_MIN_MHZ            80       // DFS: o APB cai para 80 MHz quando ocioso
+#define RTOS_IDLE_MAX_MS          1000UL   // Espera máxima de uma tarefa sem trabalho agendado
+#define RTOS_NETWORK_IDLE_MAX_MS  50UL     // Blynk.run() é chamado pelo menos a cada 50 ms
+
+// Constantes - Sincronização de estado com o Blynk (state_sync)
+#define STATE_SYNC_TASK_PERIOD_MS 100UL    // Verificação da janela de reconexão e dos envios pendentes
+#define STATE_SYNC_WINDOW_MS      3000UL   // Espera pelas respostas do servidor antes de aplicar o lote
+#define STATE_SYNC_FLOAT_EPSILON  0.001f   // Diferença mínima para um valor float contar como alterado
 
 //Constantes - Módulo 3 (persistência de dados)
-#define CONFIG_FILE_PATH "/config.json"
+#define CONFIG_FILE_PATH "/config.json"               // Formato antigo (só importado uma vez na migração)
+#define CONFIG_JSON_IMPORTED_PATH "/config.json.bak"  // Renomeado após a migração
+#define CONFIG_IMPORT_PATH "/config_import.json"      // JSON enviado manualmente: aplicado no boot e removido
+#define CONFIG_SLOT_A_PATH "/cfg_a.bin"               // Registros binários alternados (gravação atômica A/B)
+#define CONFIG_SLOT_B_PATH "/cfg_b.bin"
+#define CONFIG_MAGIC 0x41434346UL                     // "ACCF"
+#define CONFIG_SCHEMA_VERSION 9                       // Incrementar ao ACRESCENTAR campos no fim de PersistentConfig
+// Capacidade do documento JSON de importação/exportação, derivada do layout exportado
+// (ArduinoJson 6: cada membro/elemento ocupa um slot; na importação as chaves são copiadas)
+#define CONFIG_JSON_TOP_KEYS 26                       // Chaves de primeiro nível em exportConfigJson()
+#define CONFIG_JSON_STRING_BYTES 1400                 // Chaves + ROMs hex copiadas na importação (pior caso, sem deduplicação)
+#define CONFIG_JSON_DOC_SIZE (JSON_OBJECT_SIZE(CONFIG_JSON_TOP_KEYS) \
+    + JSON_ARRAY_SIZE(SCHED_JOB_COUNT) + SCHED_JOB_COUNT * JSON_OBJECT_SIZE(7) \
+    + JSON_ARRAY_SIZE(PUMP_COUNT) + PUMP_COUNT * JSON_OBJECT_SIZE(4) \
+    + JSON_OBJECT_SIZE(5) + JSON_ARRAY_SIZE(RAN_GEOMETRY_MAX_POINTS) + RAN_GEOMETRY_MAX_POINTS * JSON_ARRAY_SIZE(2) \
+    + JSON_ARRAY_SIZE(MAX_TEMP_PROBES) + MAX_TEMP_PROBES * JSON_STRING_SIZE(16) \
+    + JSON_ARRAY_SIZE(ALERT_MAX_RULES) + ALERT_MAX_RULES * JSON_OBJECT_SIZE(10) \
+    + CONFIG_JSON_STRING_BYTES)
+#define CONFIG_SAVE_DEBOUNCE_MS 3000UL                // Grava após 3 s sem novas alterações...
+#define CONFIG_SAVE_MAX_DELAY_MS 30000UL              // ...ou no máximo 30 s após a primeira alteração
+
+
+// Constantes - Serviço de relógio (rtc_time)
+#define RTC_SQW_PIN                13         // SQW/INT do DS3231 (1 Hz, dreno aberto) - GPIO livre, só para o SQW
+#if RTC_SQW_PIN == ONE_WIRE_BUS
+#error "RTC_SQW_PIN nao pode compartilhar o barramento 1-Wire (o SQW puxa a linha para baixo a cada segundo)"
+#endif
+#define CLOCK_SERVICE_PERIOD_MS    1000UL     // Tarefa de UI: ajustes pendentes e saúde do SQW
+#define CLOCK_SQW_TIMEOUT_US       2500000LL  // Sem borda por 2,5 s: SQW considerado ausente
+#define CLOCK_RTC_REREAD_MS        3600000UL  // Sem SQW: relê o RTC uma vez por hora
+#define CLOCK_DRIFT_MIN_INTERVAL_S 86400UL    // Só aprende deriva com ajustes separados por >= 1 dia
+#define CLOCK_DRIFT_MAX_PPM        50.0f      // Medidas acima disso são descartadas (ajuste manual, salto)
+#define CLOCK_DRIFT_ALPHA          0.3f       // Peso da nova medida na média da deriva
+#define CLOCK_MIN_VALID_EPOCH      1577836800UL // 01/01/2020: abaixo disso a hora do TimeLib não foi ajustada
+
+
+// Constantes - Agendador local (tpa_scheduler)
+#define TPA_SCHEDULER_PERIOD_MS   1000UL     // Só compara a hora estimada com o próximo disparo
+#define SCHEDULE_CATCHUP_WINDOW_S 43200UL    // Recupera disparos perdidos há no máximo 12 h
 
 
+// Constantes - Log de eventos (event_log)
+#define EVENT_LOG_COMPILE_LEVEL     LOG_LEVEL_DEBUG   // LOG_DEBUG()... abaixo disso não é compilado
+#define EVENT_LOG_SERIAL_MIN_LEVEL  LOG_LEVEL_DEBUG
+#define EVENT_LOG_BLYNK_MIN_LEVEL   LOG_LEVEL_INFO    // Eventos log_<nivel> no Blynk
+#define EVENT_LOG_FLASH_MIN_LEVEL   LOG_LEVEL_WARNING // Só o que importa vai para a flash
+#define EVENT_RING_SIZE             32        // Registros na RTC lenta (32 x 64 B = 2 KB)
+#define EVENT_TEXT_LEN              48
+#define EVENT_LINE_LEN              112       // Linha formatada (seq;epoch;uptime;nivel;origem;texto)
+#define EVENT_RING_MAGIC            0x45564C47UL // "EVLG"
+#define EVENT_DRAIN_PERIOD_MS       100UL     // Tarefa de rede "eventos"
+#define EVENT_DRAIN_SERIAL_PER_RUN  8
+#define EVENT_DRAIN_BLYNK_PER_RUN   2         // Blynk.logEvent é lento e limitado pelo servidor
+#define EVENT_DRAIN_FLASH_PERIOD_MS 10000UL   // Grava em lote para poupar a flash
+#define EVENT_LOG_FILE_MAX_BYTES    32768UL
+#define EVENT_LOG_PATH              "/events.log"
+#define EVENT_LOG_OLD_PATH          "/events.1.log"
+#define EVENT_CRASH_PATH            "/crash.log"
+
+
+// Constantes - Profiler (profiler)
+#define ACC_PROFILER                1         // 0 = PROFILE_SCOPE() não gera código
+#define PROFILE_HIST_BUCKETS        16        // Faixas log2 de 1 µs a >= 16 ms
+#define PROFILER_SAMPLE_PERIOD_MS   1000UL    // Tarefa de rede "perfil": heap, pilhas e console
+#define PROFILER_PUBLISH_MS         60000UL   // Resumo no VPIN_DIAGNOSTICS
+#define PROFILER_CONSOLE_LINE_LEN   32
+#define CONFIG_EXPORT_PATH          "/config_export.json" // Comando "cfg" do console serial
+
+
+// Constantes - Plano TPA (tpa_plan)
+#define TPA_PLAN_MODE_DEFAULT        TPA_PLAN_SPLIT_BATCH
+#define TPA_MAX_LEVEL_DELTA_L_DEFAULT 2.0f   // Desnível máximo do aquário durante a troca em lotes
+#define TPA_MIN_BATCH_L              0.25f  // Lote mínimo: abaixo disso a rampa da bomba domina
+#define TPA_PLAN_EPSILON_L           0.005f // Sobra de volume considerada zero (5 mL)
+#define TPA_PLAN_REPOSITION_EXTRA_CHUNKS 4  // Lotes de reposição além de 2 por lote de extração
+#define TPA_PLAN_REPOSITION_PUMP_LIMIT 1.5f // Bombeado na reposição <= alvo x isto, senão cancela
+
+
+// Constantes - Regras de alerta (alert_rules)
+#define ALERT_MAX_RULES      12         // Linhas da tabela (persistidas no config)
+#define ALERT_RATE_SLOTS     32         // Histórico por sinal para as regras de taxa
+#define ALERT_RATE_SLOT_MS   60000UL    // Um ponto por minuto: janela máxima de 31 min
+
 // Constantes - Módulo 5 (TPA Reposition)
 const unsigned long SAFETY_PAUSE_MS = 5000; // Constantes de Tempo - 5 segundos para 1.1
 #define RELAY_ON LOW
@@ -153,3 +391,62 @@ const unsigned long SAFETY_PAUSE_MS = 5000; // Constantes de Tempo - 5 segundos
 #define TPA_BUFFER_PAGE_INDEX 3    // Índice da página de configuração de Buffer no OLED (Page 3)
 #define BUFFER_VOLUME_MIN 0
 #define BUFFER_VOLUME_MAX 999
+
+// --- Constantes - Escalonador Cooperativo (task_scheduler) ---
+#define MAX_SCHEDULER_TASKS     32        // Número máximo de tarefas registradas no escalonador
+#define LOOP_HIST_BUCKETS       12        // Faixas do histograma de duração de iteração do loop()
+#define LOOP_BUDGET_US_DEFAULT  20000UL   // Orçamento padrão por iteração do loop() (20 ms)
+#define LOOP_STATS_REPORT_MS    60000UL   // Intervalo do relatório de latência no Serial (60 s)
+#define CONFIG_SAVE_TASK_PERIOD_MS 1000UL // Período da tarefa de persistência de configuração
+#define SENSOR_TELEMETRY_PERIOD_MS 5000UL // Período de envio das leituras (antigo Ticker de 5 s)
+
+// --- Constantes - Tarefas FreeRTOS (rtos_tasks.ino) ---
+// Controle (FSMs de bombas/válvulas) isolado no núcleo 1; Wi-Fi/Blynk/LittleFS no núcleo 0.
+#define RTOS_CONTROL_CORE        1      // Aquisição + FSMs de controle
+#define RTOS_NETWORK_CORE        0      // Blynk, NTP e persistência (mesmo núcleo da pilha Wi-Fi)
+#define RTOS_UI_CORE             1      // Display e botões (prioridade abaixo do controle)
+#define RTOS_CONTROL_PRIORITY    3
+#define RTOS_NETWORK_PRIORITY    2
+#define RTOS_UI_PRIORITY         1
+#define RTOS_CONTROL_STACK       4096   // Bytes
+#define RTOS_NETWORK_STACK       10240  // Bytes (Blynk + ArduinoJson + LittleFS)
+#define RTOS_UI_STACK            4096   // Bytes
+#define RTOS_CONTROL_DELAY_MS    1      // Passo do controle com bomba/válvula/TPA em andamento
+#define RTOS_NETWORK_DELAY_MS    2      // Passo da rede com mensagens na fila de saída
+#define RTOS_UI_DELAY_MS         5      // Passo mínimo da UI
+
+// Filas SPSC entre tarefas (tamanhos em potência de 2; capacidade útil = N - 1)
+#define CMD_QUEUE_SIZE           32     // Comandos Rede/UI -> Controle (cabe um lote da sincronização de estado)
+#define NET_QUEUE_SIZE           32     // Telemetria e eventos Controle/UI -> Rede
+#define NET_MSG_TEXT_LEN         64     // Tamanho máximo do texto de um evento/pino texto
+#define NET_OUTBOX_MAX_PER_RUN   8      // Mensagens enviadas ao Blynk por iteração da tarefa de rede
+#define CONTROL_SNAPSHOT_PERIOD_MS 250UL // Período de publicação do estado para a UI
+#define DISPLAY_REFRESH_MS       250UL  // Período de redesenho do OLED na tarefa de UI
+
+// Auto-teste das filas SPSC no boot (produtor no núcleo 0, consumidor no núcleo 1).
+// Mede vazão e confere a ordem das mensagens. 0 = desativado.
+#define ACC_SPSC_SELFTEST        0
+#define SPSC_SELFTEST_ITEMS      100000UL
+
+// --- Constantes - Publicador de Telemetria (telemetry.ino) ---
+#define TELEMETRY_TICK_MS             100UL  // Período do publicador na tarefa de rede
+#define TELEMETRY_MAX_SENDS_PER_TICK  2      // Teto de envios ao Blynk por tick (20/s)
+#define TELEMETRY_BACKFILL_PER_TICK   1      // Amostras de histórico reenviadas por tick (10/s)
+#define TELEMETRY_MAX_PINS            40     // Pinos virtuais distintos acompanhados
+#define TELEMETRY_BACKFILL_SIZE       512    // Amostras guardadas offline (~40 min de 4 sensores a cada 5 s)
+#define TELEMETRY_NO_DEDUP            -1.0f  // Zona morta "desligada": todo valor pedido é enviado
+
+// --- Constantes - Histórico Local em Flash (history_store.ino) ---
+#define HISTORY_DIR                 "/hist"
+#define HISTORY_INDEX_PATH          "/hist/index.bin"
+#define HISTORY_MAGIC               0x48434341UL // "ACCH"
+#define HISTORY_FORMAT_VERSION      1
+#define HISTORY_SAMPLE_PERIOD_MS    60000UL  // Uma amostra de cada grandeza por minuto
+#define HISTORY_SEGMENT_COUNT       16       // Segmentos no anel (~7,5 dias a 3 amostras/min)
+#define HISTORY_SEGMENT_RECORDS     2048     // Registros por segmento (12 KB por arquivo)
+#define HISTORY_BATCH_RECORDS       64       // Registros acumulados em RAM antes de gravar
+#define HISTORY_FLUSH_INTERVAL_MS   900000UL // Grava o lote parcial pelo menos a cada 15 min
+#define HISTORY_REPORT_INTERVAL_MS  3600000UL // Resumo 24 h / 7 d no Serial a cada hora
+#define HISTORY_QUEUE_SIZE          16       // Fila SPSC Controle -> Rede (potência de 2)
+#define HISTORY_READ_CHUNK          32       // Registros lidos por vez nas varreduras
+#define HISTORY_STORE_TASK_PERIOD_MS 1000UL  // Período do consumidor na tarefa de rede
@@ -21,6 +21,25 @@
 
 
 == Version History ==
+15/10/2026 - 0.18 - Sync version table captured/restored under its lock
+15/10/2026 - 0.17 - JSON document sized from the exported layout (heap), overflow rejected
+15/10/2026 - 0.16 - Dirty flag cleared only if no change arrived during capture/write (change sequence under a portMUX)
+15/10/2026 - 0.15 - Schema 9: DS18B20 ROM->role map (JSON key tempRoms)
+15/10/2026 - 0.14 - JSON import starts from the current config (partial files keep calibrations, alerts, sync state)
+15/10/2026 - 0.13 - Schema 8: per-setting sync state; imported settings win the next sync
+15/10/2026 - 0.12 - Schema 7: RAN level calibration and geometry table (JSON key ranLevel)
+15/10/2026 - 0.11 - Schema 6: alert rule table (JSON key alerts)
+15/10/2026 - 0.10 - Entry point instrumented with PROFILE_SCOPE
+15/10/2026 - 0.09 - Schema 5: TPA plan mode and maximum level delta
+15/10/2026 - 0.08 - Schema 4: per-pump calibration table (JSON 'pumps')
+15/10/2026 - 0.07 - Schema 3: persist learned RTC drift and last NTP sync
+15/10/2026 - 0.06 - Schema 2: schedule jobs (RTC-epoch last run, missed-run policy), JSON schedJobs
+15/10/2026 - 0.05 - Debounce timing via HAL (virtual clock in host simulation)
+15/10/2026 - 0.04 - Binary versioned config record (CRC32) in A/B slots, atomic writes
+                    Debounced/coalesced saves, no longer waits for Blynk connection
+                    JSON kept for one-time migration, import and export
+15/10/2026 - 0.03 - Persist pH neutral point, slopes and calibration point count
+15/10/2026 - 0.02 - Persist main-loop latency budget (task scheduler)
 01/11/2025 - 0.01 - First installment based on code created by Gemini AI (Google)
 
 == Project file structure ==
@@ -37,6 +56,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -49,6 +83,26 @@ tpa_reposition    - Control return of water volume
 // Protótipos de Funções que precisamos chamar (em tpa_manager.ino)
 void calculateTpaVolume(); 
 
+// --- ARMAZENAMENTO DA CONFIGURAÇÃO ---
+// A configuração é uma struct POD (PersistentConfig) gravada em binário com cabeçalho
+// (magic, versão do esquema, tamanho, geração, CRC32) em dois arquivos alternados (A/B).
+// Cada gravação vai para o slot que NÃO contém a geração mais nova: se a energia cair no
+// meio da escrita, o outro slot continua íntegro e é carregado no próximo boot.
+// O JSON fica só como caminho de importação (config antiga / arquivo enviado) e exportação.
+uint32_t configGeneration = 0;          // Geração do último registro válido gravado/carregado
+uint8_t configActiveSlot = 1;           // Slot (0 = A, 1 = B) que contém essa geração
+uint32_t configLastCrc = 0;             // CRC do conteúdo gravado (evita gravar o que não mudou)
+unsigned long configFirstChangeMs = 0;  // Primeira alteração ainda não gravada
+unsigned long configLastChangeMs = 0;   // Última alteração (reinicia o debounce)
+uint32_t configChangeSeq = 0;           // Incrementado a cada markConfigDirty()
+// markConfigDirty() roda no controle e na UI; saveConfig() na rede. O mux protege a flag, os
+// instantes e a sequência juntos.
+static portMUX_TYPE configDirtyMux = portMUX_INITIALIZER_UNLOCKED;
+ConfigStoreStats configStats;
+
+const char* CONFIG_SLOT_PATHS[2] = { CONFIG_SLOT_A_PATH, CONFIG_SLOT_B_PATH };
+
+
 // --- SETUP: INICIALIZA LITTLEFS E CARREGA CONFIG ---
 // Esta função DEVE ser chamada no main.ino setup()
 void setupConfigManager() {
@@ -62,95 +116,565 @@ void setupConfigManager() {
 }
 
 
-void saveConfig() {
-    // Documento JSON estático com tamanho suficiente para todas as configurações
-    StaticJsonDocument<512> doc;
+// --- CONVERSÃO ENTRE AS VARIÁVEIS GLOBAIS E A STRUCT PERSISTIDA ---
 
+void setConfigDefaults(PersistentConfig& cfg) {
+    memset(&cfg, 0, sizeof(cfg));
     // --- MÓDULO 2: Configuração do pH ---
-    doc["phOffset"] = phCalibrationOffset;
-
-    // --- MÓDULO 5: TPA Configuration (CÓDIGO DE PERSISTÊNCIA TPA: ESCRITA) ---
-    doc["tpaVolumeL"] = aquariumTotalVolume;     // Salva o volume total
-    doc["tpaPercent"] = tpaExtractionPercent;    // Salva o percentual de TPA
-    doc["tpaReposL"] = volumeToRepositionLiters; // Salva o volume ajustado
-    doc["bufferVolumeML"] = ranBufferVolumeML;   // Salva o volume de buffer a aplicar
-    
-    // --- NOVO: Agendamento Local TPA ---
-    doc["tpaLocalSched"] = tpaLocalScheduleActive; // Schedule local ativo
-    doc["tpaSchedDay"] = tpaScheduleDay;           // Dia definido (1=Domingo, 2=Segunda...)
-    doc["tpaSchedHour"] = tpaScheduleHour;         // Hora definida (00:00) 
-    doc["tpaSchedMin"] = tpaScheduleMinute;        // Minuto definido (00:00)
-    doc["tpaSchedFreq"] = tpaScheduleFrequency;    // Frequência definida (0=Diária, 1=Semanal, 2=Quinzenal, 3=Mensal)
-
-
-    File configFile = LittleFS.open(CONFIG_FILE_PATH, "w");
-    if (!configFile) {
+    cfg.phOffset = DEFAULT_PH_OFFSET;
+    cfg.phNeutralMv = PH_NEUTRAL_MV_DEFAULT;
+    cfg.phAcidSlopeMv = PH_SLOPE_MV_DEFAULT;
+    cfg.phBaseSlopeMv = PH_SLOPE_MV_DEFAULT;
+    cfg.phCalPoints = PH_CAL_POINTS_DEFAULT;
+    // --- MÓDULO 5: TPA ---
+    cfg.aquariumTotalVolume = 96.0f;     // Valor default de 96L (exemplo)
+    cfg.tpaExtractionPercent = 5.0f;     // Valor default de 5% (exemplo)
+    cfg.volumeToRepositionLiters = 0.0f; // 0 = usa o volume calculado da extração
+    cfg.ranBufferVolumeML = 100;         // Valor default de 100mL (exemplo)
+    // --- Agendamento Local TPA ---
+    cfg.tpaLocalScheduleActive = false;
+    cfg.tpaScheduleDay = 1;              // Default Domingo
+    cfg.tpaScheduleHour = 0;             // Default 00:00
+    cfg.tpaScheduleMinute = 0;
+    cfg.tpaScheduleFrequency = 0;        // Default Diaria
+    // --- Escalonador Cooperativo ---
+    cfg.loopBudgetUs = LOOP_BUDGET_US_DEFAULT;
+    // --- Agendador Local (esquema 2) ---
+    setScheduleJobDefaults(cfg.scheduleJobs);
+    // --- Serviço de Relógio (esquema 3) ---
+    cfg.clockDriftPpm = 0.0f;
+    cfg.clockLastNtpEpoch = 0;
+    // --- Motor de Dosagem (esquema 4) ---
+    setPumpCalibrationDefaults(cfg.pumpCal);
+    // --- Plano TPA (esquema 5) ---
+    cfg.tpaPlanMode = TPA_PLAN_MODE_DEFAULT;
+    cfg.tpaMaxLevelDeltaL = TPA_MAX_LEVEL_DELTA_L_DEFAULT;
+    setAlertRuleDefaults(cfg.alertRules);
+    setRanLevelCalibrationDefaults(cfg.ranLevelCal);
+    // --- Sincronização Blynk (esquema 8): versão 0 = nada pendente ---
+    memset(cfg.syncState, 0, sizeof(cfg.syncState));
+    // --- Sondas DS18B20 (esquema 9): sem mapa, o primeiro boot associa pela ordem de descoberta ---
+    memset(cfg.tempProbeRoms, 0, sizeof(cfg.tempProbeRoms));
+}
+
+void captureConfig(PersistentConfig& cfg) {
+    memset(&cfg, 0, sizeof(cfg)); // Bytes de preenchimento zerados: o CRC só depende dos valores
+    cfg.phOffset = phCalibrationOffset;
+    cfg.phNeutralMv = phCal.neutralMv;
+    cfg.phAcidSlopeMv = phCal.acidSlopeMv;
+    cfg.phBaseSlopeMv = phCal.baseSlopeMv;
+    cfg.phCalPoints = phCal.points;
+    cfg.aquariumTotalVolume = aquariumTotalVolume;
+    cfg.tpaExtractionPercent = tpaExtractionPercent;
+    cfg.volumeToRepositionLiters = volumeToRepositionLiters;
+    cfg.ranBufferVolumeML = ranBufferVolumeML;
+    cfg.tpaLocalScheduleActive = tpaLocalScheduleActive;
+    cfg.tpaScheduleDay = tpaScheduleDay;
+    cfg.tpaScheduleHour = tpaScheduleHour;
+    cfg.tpaScheduleMinute = tpaScheduleMinute;
+    cfg.tpaScheduleFrequency = tpaScheduleFrequency;
+    cfg.loopBudgetUs = loopBudgetUs;
+    memcpy(cfg.scheduleJobs, scheduleJobs, sizeof(cfg.scheduleJobs));
+    // Job TPA: a agenda vive nos campos próprios acima (Blynk/OLED); evita cópia defasada
+    cfg.scheduleJobs[SCHED_JOB_TPA].enabled = tpaLocalScheduleActive;
+    cfg.scheduleJobs[SCHED_JOB_TPA].frequency = (uint8_t)tpaScheduleFrequency;
+    cfg.scheduleJobs[SCHED_JOB_TPA].day = (uint8_t)tpaScheduleDay;
+    cfg.scheduleJobs[SCHED_JOB_TPA].hour = (uint8_t)tpaScheduleHour;
+    cfg.scheduleJobs[SCHED_JOB_TPA].minute = (uint8_t)tpaScheduleMinute;
+    cfg.clockDriftPpm = clockDriftPpm;
+    cfg.clockLastNtpEpoch = clockLastNtpEpoch;
+    memcpy(cfg.pumpCal, pumpCal, sizeof(cfg.pumpCal));
+    cfg.tpaPlanMode = tpaPlanMode;
+    cfg.tpaMaxLevelDeltaL = tpaMaxLevelDeltaL;
+    memcpy(cfg.alertRules, alertRules, sizeof(cfg.alertRules));
+    cfg.ranLevelCal = ranLevelCal;
+    copySyncSettingState(cfg.syncState);
+    memcpy(cfg.tempProbeRoms, tempProbeRoms, sizeof(cfg.tempProbeRoms));
+}
+
+void applyConfig(const PersistentConfig& cfg) {
+    phCalibrationOffset = cfg.phOffset;
+    phCal.neutralMv = cfg.phNeutralMv;
+    phCal.acidSlopeMv = cfg.phAcidSlopeMv;
+    phCal.baseSlopeMv = cfg.phBaseSlopeMv;
+    phCal.points = cfg.phCalPoints;
+    aquariumTotalVolume = cfg.aquariumTotalVolume;
+    tpaExtractionPercent = cfg.tpaExtractionPercent;
+    volumeToRepositionLiters = cfg.volumeToRepositionLiters;
+    ranBufferVolumeML = cfg.ranBufferVolumeML;
+    tpaLocalScheduleActive = cfg.tpaLocalScheduleActive;
+    tpaScheduleDay = cfg.tpaScheduleDay;
+    tpaScheduleHour = cfg.tpaScheduleHour;
+    tpaScheduleMinute = cfg.tpaScheduleMinute;
+    tpaScheduleFrequency = cfg.tpaScheduleFrequency;
+    setLoopBudgetUs(cfg.loopBudgetUs);
+    memcpy(scheduleJobs, cfg.scheduleJobs, sizeof(scheduleJobs));
+    requestScheduleRecompute();
+    clockDriftPpm = cfg.clockDriftPpm;
+    clockLastNtpEpoch = cfg.clockLastNtpEpoch;
+    memcpy(pumpCal, cfg.pumpCal, sizeof(pumpCal));
+    tpaPlanMode = cfg.tpaPlanMode < TPA_PLAN_MODE_COUNT ? cfg.tpaPlanMode : (uint8_t)TPA_PLAN_MODE_DEFAULT;
+    tpaMaxLevelDeltaL = cfg.tpaMaxLevelDeltaL > 0.0f ? cfg.tpaMaxLevelDeltaL : TPA_MAX_LEVEL_DELTA_L_DEFAULT;
+    memcpy(alertRules, cfg.alertRules, sizeof(alertRules));
+    setupAlertRules(); // Tabela nova: estados recomeçam do IDLE
+    if (isRanLevelCalibrationValid(cfg.ranLevelCal)) {
+        ranLevelCal = cfg.ranLevelCal;
+    } else {
+        setRanLevelCalibrationDefaults(ranLevelCal);
+        logSystemEvent("warning", "Calibracao de nivel do RAN invalida. Usando padrao.");
+    }
+    restoreSyncSettingState(cfg.syncState);
+    memcpy(tempProbeRoms, cfg.tempProbeRoms, sizeof(tempProbeRoms));
+}
+
+static uint32_t computeConfigCrc(const PersistentConfig& cfg) {
+    return crc32_le(0, (const uint8_t*)&cfg, sizeof(cfg));
+}
+
+
+// --- LEITURA DE UM SLOT (A ou B) ---
+// Registros de versões anteriores são aceitos: campos novos são sempre acrescentados no FIM
+// da struct, então o prefixo gravado é copiado sobre os defaults.
+bool readConfigSlot(uint8_t slot, PersistentConfig& cfg, uint32_t& generation) {
+    File file = LittleFS.open(CONFIG_SLOT_PATHS[slot], "r");
+    if (!file) return false;
+
+    ConfigRecordHeader header;
+    bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == CONFIG_MAGIC &&
+              header.schemaVersion >= 1 && header.schemaVersion <= CONFIG_SCHEMA_VERSION &&
+              header.payloadSize > 0 && header.payloadSize <= sizeof(PersistentConfig);
+
+    PersistentConfig stored;
+    setConfigDefaults(stored);
+    if (ok) {
+        ok = file.read((uint8_t*)&stored, header.payloadSize) == header.payloadSize &&
+             crc32_le(0, (const uint8_t*)&stored, header.payloadSize) == header.crc;
+    }
+    file.close();
+
+    if (!ok) {
+        configStats.corruptSlots++;
+        return false;
+    }
+    cfg = stored;
+    generation = header.generation;
+    return true;
+}
+
+void loadConfig() {
+    unsigned long startUs = halMicros();
+    PersistentConfig cfg;
+    PersistentConfig candidate;
+    uint32_t generation = 0;
+    bool found = false;
+
+    // 1. Registro binário mais novo entre A e B
+    for (uint8_t slot = 0; slot < 2; slot++) {
+        uint32_t slotGeneration;
+        if (readConfigSlot(slot, candidate, slotGeneration) && (!found || slotGeneration > generation)) {
+            cfg = candidate;
+            generation = slotGeneration;
+            configActiveSlot = slot;
+            found = true;
+        }
+    }
+
+    if (found) {
+        configGeneration = generation;
+        applyConfig(cfg);
+        configLastCrc = computeConfigCrc(cfg);
+        Serial.print(F("Configuracao carregada (geracao "));
+        Serial.print(configGeneration);
+        Serial.print(F(", "));
+        Serial.print(halMicros() - startUs);
+        Serial.println(F(" us)."));
+    } else {
+        // Sem registro binário: defaults primeiro (a migração lê o JSON sobre eles)
+        setConfigDefaults(cfg);
+        applyConfig(cfg);
+        if (importConfigJson(CONFIG_FILE_PATH)) {
+            // 2. Migração: primeira inicialização depois da troca do JSON pelo formato binário
+            Serial.println(F("Configuracao JSON antiga importada. Gravando no formato binario."));
+            logSystemEvent("info", "Configuracao migrada de JSON para binario.");
+            saveConfig();
+            LittleFS.rename(CONFIG_FILE_PATH, CONFIG_JSON_IMPORTED_PATH); // Não importa de novo
+        } else if (configStats.corruptSlots > 0) {
+            // 3. Nada válido: defaults (e registra o motivo, em vez de cair nos defaults em silêncio)
+            Serial.println(F("ERRO: Registros de configuracao corrompidos. Usando padroes."));
+            logSystemEvent("critical", "Configuracao corrompida: valores padrao carregados.");
+        } else {
+            Serial.println(F("ARQUIVO: Configuracao nao encontrada. Usando padroes."));
+        }
+    }
+
+    // Arquivo de importação manual (enviado para a flash): aplicado uma vez e removido
+    if (LittleFS.exists(CONFIG_IMPORT_PATH) && importConfigJson(CONFIG_IMPORT_PATH)) {
+        LittleFS.remove(CONFIG_IMPORT_PATH);
+        Serial.println(F("Configuracao importada de " CONFIG_IMPORT_PATH "."));
+        markAllSettingsChanged(SYNC_SOURCE_IMPORT); // Valores importados vencem o app na próxima sincronização
+        saveConfig();
+    }
+
+    // --- GARANTE QUE O VOLUME DE REPOSIÇÃO COMEÇA IGUAL AO EXTRAÍDO ---
+    // Recalcula o volume e a duracao da bomba com os valores carregados
+    calculateTpaVolume(); 
+    if (volumeToRepositionLiters == 0.0f) {
+        volumeToRepositionLiters = volumeToExtractLiters;
+    }
+}
+
+
+// --- GRAVAÇÃO ATÔMICA (A/B) ---
+// Limpa a flag só se ninguém alterou nada desde a captura: uma alteração feita enquanto o
+// arquivo era gravado continua suja e entra na próxima gravação.
+static void clearConfigDirtyIfUnchanged(uint32_t capturedSeq) {
+    portENTER_CRITICAL(&configDirtyMux);
+    if (configChangeSeq == capturedSeq) configIsDirty = false;
+    portEXIT_CRITICAL(&configDirtyMux);
+}
+
+void saveConfig() {
+    PROFILE_SCOPE(PROF_CONFIG_SAVE);
+    portENTER_CRITICAL(&configDirtyMux);
+    uint32_t capturedSeq = configChangeSeq; // Antes da captura: o que vier depois fica pendente
+    portEXIT_CRITICAL(&configDirtyMux);
+    PersistentConfig cfg;
+    captureConfig(cfg);
+    uint32_t crc = computeConfigCrc(cfg);
+
+    // Conteúdo idêntico ao último gravado (ex.: valor editado e depois desfeito): sem escrita
+    if (configGeneration > 0 && crc == configLastCrc) {
+        clearConfigDirtyIfUnchanged(capturedSeq);
+        configStats.skippedUnchanged++;
+        return;
+    }
+
+    uint8_t targetSlot = configActiveSlot ^ 1; // Nunca sobrescreve o registro válido mais novo
+    ConfigRecordHeader header;
+    header.magic = CONFIG_MAGIC;
+    header.schemaVersion = CONFIG_SCHEMA_VERSION;
+    header.payloadSize = sizeof(PersistentConfig);
+    header.generation = configGeneration + 1;
+    header.crc = crc;
+
+    File file = LittleFS.open(CONFIG_SLOT_PATHS[targetSlot], "w");
+    if (!file) {
         Serial.println(F("ERRO: Falha ao abrir arquivo de configuracao para escrita."));
         logSystemEvent("error", "Falha ao salvar configuracao no LittleFS.");
-        return;
+        configStats.failedWrites++;
+        return; // Continua suja: nova tentativa no próximo período
     }
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              file.write((const uint8_t*)&cfg, sizeof(cfg)) == sizeof(cfg);
+    file.close();
 
-    if (serializeJson(doc, configFile) == 0) {
+    if (!ok) {
         Serial.println(F("ERRO: Falha ao escrever no arquivo de configuracao."));
-        logSystemEvent("error", "Falha na serializacao JSON ao salvar.");
+        logSystemEvent("error", "Gravacao incompleta da configuracao.");
+        configStats.failedWrites++;
+        return;
     }
 
-    configFile.close();
-    configIsDirty = false;
-    Serial.println(F("Configuracoes salvas com sucesso no LittleFS."));
+    // Só agora o novo registro passa a ser o ativo
+    configActiveSlot = targetSlot;
+    configGeneration = header.generation;
+    configLastCrc = crc;
+    clearConfigDirtyIfUnchanged(capturedSeq);
+    configStats.writes++;
+    Serial.print(F("Configuracoes salvas (geracao "));
+    Serial.print(configGeneration);
+    Serial.print(F(", slot "));
+    Serial.print(targetSlot == 0 ? 'A' : 'B');
+    Serial.println(F(")."));
 }
 
-void loadConfig() {
-    if (!LittleFS.exists(CONFIG_FILE_PATH)) {
-        Serial.println(F("ARQUIVO: Arquivo de configuracao nao encontrado. Usando padroes."));
-        // Se o arquivo não existe, definimos os defaults e calculamos TPA.
-        calculateTpaVolume();
-        return;
+
+// --- DEBOUNCE / COALESCÊNCIA ---
+// Qualquer módulo sinaliza a alteração; a gravação acontece quando as edições param por
+// CONFIG_SAVE_DEBOUNCE_MS (ex.: botão UP segurado) ou, no máximo, CONFIG_SAVE_MAX_DELAY_MS
+// depois da primeira alteração.
+void markConfigDirty() {
+    unsigned long now = halMillis();
+    portENTER_CRITICAL(&configDirtyMux);
+    if (!configIsDirty) configFirstChangeMs = now;
+    configLastChangeMs = now;
+    configChangeSeq++;
+    configIsDirty = true;
+    configStats.changeRequests++;
+    portEXIT_CRITICAL(&configDirtyMux);
+}
+
+void checkConfigSave() {
+    unsigned long now = halMillis();
+    portENTER_CRITICAL(&configDirtyMux);
+    bool dirty = configIsDirty;
+    unsigned long firstMs = configFirstChangeMs;
+    unsigned long lastMs = configLastChangeMs;
+    portEXIT_CRITICAL(&configDirtyMux);
+    if (!dirty) return;
+
+    bool quiet = now - lastMs >= CONFIG_SAVE_DEBOUNCE_MS;
+    bool overdue = now - firstMs >= CONFIG_SAVE_MAX_DELAY_MS;
+    if (quiet || overdue) {
+        saveConfig();
     }
+}
+
+
+// --- IMPORTAÇÃO / EXPORTAÇÃO JSON ---
+// Mesmas chaves do antigo /config.json. Chaves ausentes mantêm o valor atual (ou default).
+bool importConfigJson(const char* path) {
+    if (!LittleFS.exists(path)) return false;
 
-    File configFile = LittleFS.open(CONFIG_FILE_PATH, "r");
+    File configFile = LittleFS.open(path, "r");
     if (!configFile) {
         Serial.println(F("ERRO: Falha ao abrir arquivo de configuracao para leitura."));
         logSystemEvent("error", "Falha ao carregar configuracao do LittleFS.");
-        return;
+        return false;
     }
 
-    StaticJsonDocument<512> doc;
+    DynamicJsonDocument doc(CONFIG_JSON_DOC_SIZE); // No heap: ~5 KB não cabem com folga na pilha do chamador
+    if (doc.capacity() == 0) {
+        Serial.println(F("ERRO: Sem memoria para o documento JSON de configuracao."));
+        configFile.close();
+        return false;
+    }
     DeserializationError error = deserializeJson(doc, configFile);
     configFile.close();
 
-    if (error) {
+    if (error || doc.overflowed()) {
         Serial.print(F("ERRO: Falha na leitura JSON: "));
-        Serial.println(error.f_str());
+        if (error) Serial.println(error.f_str());
+        else Serial.println(F("documento cheio (CONFIG_JSON_DOC_SIZE)"));
         logSystemEvent("error", "Falha ao desserializar JSON de configuracao.");
-        return;
+        return false;
     }
-    
+
+    // Parte do estado atual: só as chaves presentes no arquivo mudam (calibrações, deriva,
+    // lastRunEpoch, alertas e versões de sincronização ficam como estão)
+    PersistentConfig cfg;
+    captureConfig(cfg);
+
     // --- MÓDULO 2: Configuração do pH ---
-    phCalibrationOffset = doc["phOffset"] | DEFAULT_PH_OFFSET;
-    
-    // --- MÓDULO 5: TPA Configuration (CÓDIGO DE PERSISTÊNCIA TPA: LEITURA) ---
-    aquariumTotalVolume = doc["tpaVolumeL"] | 96.0f; // Valor default de 96L (exemplo)
-    tpaExtractionPercent = doc["tpaPercent"] | 5.0f; // Valor default de 5% (exemplo)
-    volumeToRepositionLiters = doc["tpaReposL"] | volumeToExtractLiters;
-    ranBufferVolumeML = doc["bufferVolumeML"] | 100; // Valor default de 100mL (exemplo)
-
-    // --- NOVO: Agendamento Local TPA ---
-    tpaLocalScheduleActive = doc["tpaLocalSched"] | false;
-    tpaScheduleDay = doc["tpaSchedDay"] | 1;        // Default Domingo
-    tpaScheduleHour = doc["tpaSchedHour"] | 0;      // Default 00:00
-    tpaScheduleMinute = doc["tpaSchedMin"] | 0;     // Default 00:00
-    tpaScheduleFrequency = doc["tpaSchedFreq"] | 0; // Default Diaria
+    cfg.phOffset = doc["phOffset"] | cfg.phOffset;
+    cfg.phNeutralMv = doc["phNeutralMv"] | cfg.phNeutralMv;
+    cfg.phAcidSlopeMv = doc["phAcidSlope"] | cfg.phAcidSlopeMv;
+    cfg.phBaseSlopeMv = doc["phBaseSlope"] | cfg.phBaseSlopeMv;
+    cfg.phCalPoints = doc["phCalPoints"] | cfg.phCalPoints;
 
+    // --- MÓDULO 5: TPA Configuration ---
+    cfg.aquariumTotalVolume = doc["tpaVolumeL"] | cfg.aquariumTotalVolume;
+    cfg.tpaExtractionPercent = doc["tpaPercent"] | cfg.tpaExtractionPercent;
+    cfg.volumeToRepositionLiters = doc["tpaReposL"] | cfg.volumeToRepositionLiters;
+    cfg.ranBufferVolumeML = doc["bufferVolumeML"] | cfg.ranBufferVolumeML;
+    cfg.tpaPlanMode = doc["tpaPlanMode"] | cfg.tpaPlanMode;
+    cfg.tpaMaxLevelDeltaL = doc["tpaMaxDeltaL"] | cfg.tpaMaxLevelDeltaL;
 
-    // Recalcula o volume e a duracao da bomba com os valores carregados
-    calculateTpaVolume(); 
-    
-    Serial.println(F("Configuracoes carregadas com sucesso."));
+    // --- Agendamento Local TPA ---
+    cfg.tpaLocalScheduleActive = doc["tpaLocalSched"] | cfg.tpaLocalScheduleActive;
+    cfg.tpaScheduleDay = doc["tpaSchedDay"] | cfg.tpaScheduleDay;
+    cfg.tpaScheduleHour = doc["tpaSchedHour"] | cfg.tpaScheduleHour;
+    cfg.tpaScheduleMinute = doc["tpaSchedMin"] | cfg.tpaScheduleMinute;
+    cfg.tpaScheduleFrequency = doc["tpaSchedFreq"] | cfg.tpaScheduleFrequency;
+
+    // --- Escalonador Cooperativo ---
+    cfg.loopBudgetUs = doc["loopBudgetUs"] | cfg.loopBudgetUs;
+
+    // --- Agendador Local: [TPA, Buffer, Completar RAN] (agenda da TPA vem das chaves acima) ---
+    cfg.clockDriftPpm = doc["clockDriftPpm"] | cfg.clockDriftPpm;
+    cfg.clockLastNtpEpoch = doc["clockLastNtp"] | cfg.clockLastNtpEpoch;
+
+    JsonArray jobs = doc["schedJobs"];
+    for (uint8_t i = 0; i < SCHED_JOB_COUNT && i < jobs.size(); i++) {
+        JsonObject in = jobs[i];
+        ScheduleJobConfig& job = cfg.scheduleJobs[i];
+        job.enabled = in["enabled"] | job.enabled;
+        job.frequency = in["freq"] | job.frequency;
+        job.day = in["day"] | job.day;
+        job.hour = in["hour"] | job.hour;
+        job.minute = in["min"] | job.minute;
+        job.missedPolicy = in["missed"] | job.missedPolicy;
+        job.lastRunEpoch = in["lastRun"] | job.lastRunEpoch;
+    }
+
+    // --- Motor de Dosagem: [Extração, Reposição, Buffer] ---
+    JsonArray pumps = doc["pumps"];
+    for (uint8_t i = 0; i < PUMP_COUNT && i < pumps.size(); i++) {
+        JsonObject in = pumps[i];
+        PumpCalibration& pump = cfg.pumpCal[i];
+        pump.flowMlPerSec = in["flow"] | pump.flowMlPerSec;
+        pump.rampMs = in["rampMs"] | pump.rampMs;
+        pump.driftPctPer100h = in["driftPct"] | pump.driftPctPer100h;
+        pump.runtimeSinceCalSec = in["runtimeS"] | pump.runtimeSinceCalSec;
+    }
+
+    // --- Regras de Alerta: se presente, a lista substitui a tabela inteira ---
+    if (doc.containsKey("alerts")) {
+        JsonArray alerts = doc["alerts"];
+        AlertRule* rules = cfg.alertRules;
+        memset(rules, 0, sizeof(cfg.alertRules));
+        for (uint8_t i = 0; i < ALERT_MAX_RULES; i++) rules[i].signal = ALERT_SIGNAL_NONE;
+        for (uint8_t i = 0; i < ALERT_MAX_RULES && i < alerts.size(); i++) {
+            JsonObject in = alerts[i];
+            rules[i].signal = in["signal"] | (uint8_t)ALERT_SIGNAL_NONE;
+            rules[i].kind = in["kind"] | (uint8_t)ALERT_KIND_HIGH;
+            rules[i].severity = in["severity"] | (uint8_t)LOG_LEVEL_WARNING;
+            rules[i].action = in["action"] | (uint8_t)ALERT_ACTION_NONE;
+            rules[i].ledVpin = in["led"] | 0;
+            rules[i].threshold = in["limit"] | 0.0f;
+            rules[i].hysteresis = in["hyst"] | 0.0f;
+            rules[i].dwellS = in["dwellS"] | 0;
+            rules[i].clearS = in["clearS"] | 0;
+            rules[i].windowS = in["windowS"] | 0;
+            if (rules[i].signal >= ALERT_SIGNAL_COUNT || rules[i].kind >= ALERT_KIND_COUNT) {
+                rules[i].signal = ALERT_SIGNAL_NONE; // Linha inválida: ignorada
+            }
+        }
+    }
+
+    // --- Sondas DS18B20: ROM de cada papel em hex (16 dígitos; outro formato mantém o atual) ---
+    JsonArray roms = doc["tempRoms"];
+    for (uint8_t role = 0; role < MAX_TEMP_PROBES && role < roms.size(); role++) {
+        const char* hex = roms[role] | "";
+        if (strlen(hex) != 16) continue;
+        uint8_t rom[8];
+        bool valid = true;
+        for (uint8_t b = 0; b < 8 && valid; b++) {
+            char byteHex[3] = { hex[b * 2], hex[b * 2 + 1], '\0' };
+            char* end;
+            rom[b] = (uint8_t)strtoul(byteHex, &end, 16);
+            valid = *end == '\0';
+        }
+        if (valid) memcpy(cfg.tempProbeRoms[role], rom, 8);
+    }
+
+    // --- Nível do RAN: calibração de dois pontos + tabela de geometria [[mm, L], ...] ---
+    JsonObject ran = doc["ranLevel"];
+    if (!ran.isNull()) {
+        RanLevelCalibration& cal = cfg.ranLevelCal;
+        cal.emptyReading = ran["empty"] | cal.emptyReading;
+        cal.fullReading = ran["full"] | cal.fullReading;
+        cal.fullHeightMm = ran["heightMm"] | cal.fullHeightMm;
+        cal.targetLiters = ran["targetL"] | cal.targetLiters;
+        JsonArray geo = ran["geometry"];
+        if (geo.size() > 0) {
+            cal.geometryPoints = 0;
+            for (uint8_t i = 0; i < RAN_GEOMETRY_MAX_POINTS && i < geo.size(); i++) {
+                cal.geometry[i].heightMm = geo[i][0] | 0.0f;
+                cal.geometry[i].liters = geo[i][1] | 0.0f;
+                cal.geometryPoints++;
+            }
+        }
+    }
+
+    applyConfig(cfg);
+    return true;
 }
 
-void checkConfigSave() {
-    if (configIsDirty && Blynk.connected()) {
-        saveConfig();
+bool exportConfigJson(const char* path) {
+    PersistentConfig cfg;
+    captureConfig(cfg);
+
+    DynamicJsonDocument doc(CONFIG_JSON_DOC_SIZE);
+    if (doc.capacity() == 0) {
+        Serial.println(F("ERRO: Sem memoria para o documento JSON de exportacao."));
+        return false;
+    }
+    doc["schema"] = CONFIG_SCHEMA_VERSION;
+    doc["generation"] = configGeneration;
+    doc["phOffset"] = cfg.phOffset;
+    doc["phNeutralMv"] = cfg.phNeutralMv;
+    doc["phAcidSlope"] = cfg.phAcidSlopeMv;
+    doc["phBaseSlope"] = cfg.phBaseSlopeMv;
+    doc["phCalPoints"] = cfg.phCalPoints;
+    doc["tpaVolumeL"] = cfg.aquariumTotalVolume;
+    doc["tpaPercent"] = cfg.tpaExtractionPercent;
+    doc["tpaReposL"] = cfg.volumeToRepositionLiters;
+    doc["bufferVolumeML"] = cfg.ranBufferVolumeML;
+    doc["tpaPlanMode"] = cfg.tpaPlanMode;
+    doc["tpaMaxDeltaL"] = cfg.tpaMaxLevelDeltaL;
+    doc["tpaLocalSched"] = cfg.tpaLocalScheduleActive;
+    doc["tpaSchedDay"] = cfg.tpaScheduleDay;
+    doc["tpaSchedHour"] = cfg.tpaScheduleHour;
+    doc["tpaSchedMin"] = cfg.tpaScheduleMinute;
+    doc["tpaSchedFreq"] = cfg.tpaScheduleFrequency;
+    doc["loopBudgetUs"] = cfg.loopBudgetUs;
+
+    doc["clockDriftPpm"] = cfg.clockDriftPpm;
+    doc["clockLastNtp"] = cfg.clockLastNtpEpoch;
+
+    JsonArray jobs = doc.createNestedArray("schedJobs");
+    for (uint8_t i = 0; i < SCHED_JOB_COUNT; i++) {
+        const ScheduleJobConfig& job = cfg.scheduleJobs[i];
+        JsonObject out = jobs.createNestedObject();
+        out["enabled"] = job.enabled;
+        out["freq"] = job.frequency;
+        out["day"] = job.day;
+        out["hour"] = job.hour;
+        out["min"] = job.minute;
+        out["missed"] = job.missedPolicy;
+        out["lastRun"] = job.lastRunEpoch;
+    }
+
+    JsonArray pumps = doc.createNestedArray("pumps");
+    for (uint8_t i = 0; i < PUMP_COUNT; i++) {
+        JsonObject out = pumps.createNestedObject();
+        out["flow"] = cfg.pumpCal[i].flowMlPerSec;
+        out["rampMs"] = cfg.pumpCal[i].rampMs;
+        out["driftPct"] = cfg.pumpCal[i].driftPctPer100h;
+        out["runtimeS"] = cfg.pumpCal[i].runtimeSinceCalSec;
+    }
+
+    JsonObject ran = doc.createNestedObject("ranLevel");
+    ran["empty"] = cfg.ranLevelCal.emptyReading;
+    ran["full"] = cfg.ranLevelCal.fullReading;
+    ran["heightMm"] = cfg.ranLevelCal.fullHeightMm;
+    ran["targetL"] = cfg.ranLevelCal.targetLiters;
+    JsonArray geo = ran.createNestedArray("geometry");
+    for (uint8_t i = 0; i < cfg.ranLevelCal.geometryPoints && i < RAN_GEOMETRY_MAX_POINTS; i++) {
+        JsonArray point = geo.createNestedArray();
+        point.add(cfg.ranLevelCal.geometry[i].heightMm);
+        point.add(cfg.ranLevelCal.geometry[i].liters);
+    }
+
+    JsonArray roms = doc.createNestedArray("tempRoms"); // [Aquário, Sump, RAN], hex (zeros = papel livre)
+    for (uint8_t role = 0; role < MAX_TEMP_PROBES; role++) {
+        char hex[17];
+        for (uint8_t b = 0; b < 8; b++) snprintf(hex + b * 2, 3, "%02X", cfg.tempProbeRoms[role][b]);
+        roms.add(hex);
+    }
+
+    JsonArray alerts = doc.createNestedArray("alerts"); // Só as linhas em uso
+    for (uint8_t i = 0; i < ALERT_MAX_RULES; i++) {
+        const AlertRule& rule = cfg.alertRules[i];
+        if (rule.signal >= ALERT_SIGNAL_COUNT) continue;
+        JsonObject out = alerts.createNestedObject();
+        out["signal"] = rule.signal;
+        out["kind"] = rule.kind;
+        out["severity"] = rule.severity;
+        out["action"] = rule.action;
+        out["led"] = rule.ledVpin;
+        out["limit"] = rule.threshold;
+        out["hyst"] = rule.hysteresis;
+        out["dwellS"] = rule.dwellS;
+        out["clearS"] = rule.clearS;
+        out["windowS"] = rule.windowS;
+    }
+
+    // Documento cheio descarta membros em silêncio: melhor falhar do que exportar config truncada
+    if (doc.overflowed()) {
+        Serial.println(F("ERRO: Documento JSON de exportacao estourou CONFIG_JSON_DOC_SIZE."));
+        logSystemEvent("error", "Exportacao JSON abortada: documento cheio.");
+        return false;
     }
-}
\ No newline at end of file
+
+    File file = LittleFS.open(path, "w");
+    if (!file) {
+        Serial.println(F("ERRO: Falha ao abrir arquivo de exportacao."));
+        return false;
+    }
+    bool ok = serializeJson(doc, file) > 0;
+    file.close();
+    return ok;
+}
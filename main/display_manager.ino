@@ -21,6 +21,13 @@
 
 
 == Version History ==
+15/10/2026 - 0.07 - Page 1 schedule fields drawn from uiSnapshot
+15/10/2026 - 0.06 - Main page shows measured RAN volume
+15/10/2026 - 0.05 - Diagnostics page (4) from the profiler; updateDisplay/flushDirtyPages instrumented
+15/10/2026 - 0.04 - Clock from clockNowEpoch()/formatClockTime (no I2C, no String)
+15/10/2026 - 0.03 - Incremental renderer: value signatures per page, dirty SSD1306 page/column flush
+                    Single clear/flush in updateDisplay(); removed double display() and P2/P3 placeholder overlays
+15/10/2026 - 0.02 - Dashboard reads process values from the control task snapshot (UI task)
 02/11/2025 - 0.01 - Re-factored to implement OLED pagination
 01/11/2025 - 0.01 - First installment based on code created by Gemini AI (Google)
 
@@ -38,6 +45,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -48,7 +70,16 @@ tpa_reposition    - Control return of water volume
 #include "utils.h"
 
 // Define o objeto display (extern em global.h, mas inicializado aqui)
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+// O barramento fica em 400 kHz durante e depois das transferências (o DS3231 também suporta)
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, OLED_I2C_CLOCK_HZ, OLED_I2C_CLOCK_HZ);
+
+// --- RENDERIZAÇÃO INCREMENTAL ---
+// oledShadow guarda o que o painel está mostrando. Cada quadro é desenhado no framebuffer da
+// biblioteca e só as colunas alteradas de cada página do SSD1306 (8 linhas) vão para o I2C.
+uint8_t oledShadow[SCREEN_WIDTH * OLED_PAGE_COUNT];
+uint32_t lastPageSignature = 0;         // Assinatura dos valores exibidos no último quadro
+bool displayFullRefreshPending = false; // Reenvia a tela inteira no próximo quadro (ex.: erro I2C)
+DisplayStats displayStats;
 
 // Array para mapear a Frequencia para String
 const char* freqNames[] = {"Diaria", "Semanal", "Quinzenal", "Mensal"};
@@ -59,6 +90,7 @@ const char* dayNames[] = {"N/A", "Dom", "Seg", "Ter", "Qua", "Qui", "Sex", "Sab"
 // --- SETUP DO DISPLAY ---
 void setupDisplay() {
     Wire.begin(); 
+    Wire.setClock(OLED_I2C_CLOCK_HZ); // OLED e RTC no mesmo barramento
 
     if(!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
         Serial.println(F("Falha ao inicializar SSD1306. Verifique conexao e endereco I2C."));
@@ -77,16 +109,167 @@ void setupDisplay() {
     display.setCursor(0, 20);
     display.println(F("OLED OK."));
     display.display();
+    memcpy(oledShadow, display.getBuffer(), sizeof(oledShadow)); // Painel e sombra sincronizados
     delay(2000);
 }
 
 
+// --- ASSINATURA DOS VALORES DE CADA PÁGINA ---
+// Os valores são quantizados na mesma precisão em que aparecem na tela, para que ruído
+// abaixo do último dígito não provoque redesenho.
+static uint32_t mixSignature(uint32_t hash, int32_t value) {
+    for (int i = 0; i < 4; i++) {           // FNV-1a, byte a byte
+        hash ^= (uint8_t)(value >> (i * 8));
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static int32_t quantize(float value, float scale) {
+    return (int32_t)lroundf(value * scale);
+}
+
+uint32_t computePageSignature(int page) {
+    uint32_t h = mixSignature(2166136261UL, page);
+    switch (page) {
+        case 0:
+            h = mixSignature(h, (int32_t)clockNowEpoch()); // Relógio com segundos
+            h = mixSignature(h, quantize(uiSnapshot.temperatureC, 10.0f));
+            h = mixSignature(h, quantize(uiSnapshot.phValue, 100.0f));
+            h = mixSignature(h, quantize(phCalibrationOffset, 1000.0f));
+            h = mixSignature(h, uiSnapshot.tpaMasterState);
+            h = mixSignature(h, quantize(uiSnapshot.extractedVolumeL, 100.0f));
+            h = mixSignature(h, quantize(volumeToExtractLiters, 10.0f));
+            h = mixSignature(h, uiSnapshot.serviceMode);
+            h = mixSignature(h, uiSnapshot.ranLevelPercent);
+            h = mixSignature(h, isnan(uiSnapshot.ranLevelLiters) ? -1 : (int32_t)lroundf(uiSnapshot.ranLevelLiters * 10.0f));
+            h = mixSignature(h, uiSnapshot.ranLevelFull);
+            break;
+        case 1:
+            h = mixSignature(h, tpaLocalScheduleActive);
+            h = mixSignature(h, quantize(volumeToExtractLiters, 100.0f));
+            h = mixSignature(h, quantize(tpaExtractionPercent, 10.0f));
+            h = mixSignature(h, uiSnapshot.tpaScheduleDay);
+            h = mixSignature(h, uiSnapshot.tpaScheduleHour);
+            h = mixSignature(h, uiSnapshot.tpaScheduleMinute);
+            h = mixSignature(h, uiSnapshot.tpaScheduleFrequency);
+            h = mixSignature(h, page1EditMode);
+            break;
+        case 2:
+            h = mixSignature(h, quantize(volumeToExtractLiters, 100.0f));
+            h = mixSignature(h, quantize(volumeToRepositionLiters, 100.0f));
+            h = mixSignature(h, page2EditMode);
+            break;
+        case 3:
+            h = mixSignature(h, ranBufferVolumeML);
+            h = mixSignature(h, page3EditMode);
+            break;
+        case 4:
+            // Amostrado 1x/s pela tarefa "perfil": o quadro muda no máximo nesse ritmo
+            h = mixSignature(h, profilerSystem.freeHeap / 1024);
+            h = mixSignature(h, profilerSystem.largestBlock / 1024);
+            h = mixSignature(h, profilerSystem.minFreeHeap / 1024);
+            for (uint8_t i = 0; i < SCHED_GROUP_COUNT; i++) h = mixSignature(h, profilerSystem.stackFreeBytes[i]);
+            for (uint8_t i = 0; i < PROF_PROBE_COUNT; i++) {
+                h = mixSignature(h, profileCyclesToUs(profileProbes[i].maxCycles) / 100);
+                h = mixSignature(h, getProfilePercentileUs(i, 99));
+            }
+            break;
+    }
+    return h;
+}
+
+
+// --- ENVIO DAS PÁGINAS SUJAS ---
+// Compara o framebuffer com a sombra página a página e envia só a faixa de colunas
+// [primeira, última] que mudou. Retorna os bytes trafegados no I2C (endereço + controle + dados).
+size_t flushDirtyPages() {
+    PROFILE_SCOPE(PROF_OLED_FLUSH);
+    uint8_t* buffer = display.getBuffer();
+    if (buffer == nullptr) return 0; // display.begin() falhou
+
+    if (displayFullRefreshPending) {
+        // Sombra invertida = todas as colunas diferentes = quadro completo
+        for (size_t i = 0; i < sizeof(oledShadow); i++) oledShadow[i] = ~buffer[i];
+        displayFullRefreshPending = false;
+    }
+
+    size_t bytesSent = 0;
+    for (uint8_t page = 0; page < OLED_PAGE_COUNT; page++) {
+        const uint8_t* row = buffer + page * SCREEN_WIDTH;
+        uint8_t* shadowRow = oledShadow + page * SCREEN_WIDTH;
+
+        int first = -1;
+        int last = -1;
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            if (row[x] != shadowRow[x]) {
+                if (first < 0) first = x;
+                last = x;
+            }
+        }
+        if (first < 0) continue; // Página intacta
+
+        // Janela de escrita (modo de endereçamento horizontal configurado pelo begin())
+        display.ssd1306_command(SSD1306_PAGEADDR);
+        display.ssd1306_command(page);
+        display.ssd1306_command(page);
+        display.ssd1306_command(SSD1306_COLUMNADDR);
+        display.ssd1306_command(first);
+        display.ssd1306_command(last);
+        bytesSent += 6 * 3;
+
+        for (int x = first; x <= last; ) {
+            int chunk = min(OLED_I2C_CHUNK_BYTES, last - x + 1);
+            Wire.beginTransmission(SCREEN_ADDRESS);
+            Wire.write((uint8_t)0x40); // Co = 0, D/C = 1: bytes de dados
+            Wire.write(row + x, chunk);
+            if (Wire.endTransmission() != 0) {
+                displayFullRefreshPending = true; // Estado do painel incerto
+            }
+            bytesSent += chunk + 2;
+            x += chunk;
+        }
+        memcpy(shadowRow + first, row + first, last - first + 1);
+    }
+    return bytesSent;
+}
+
+// --- RELATÓRIO DO DISPLAY (tarefa de UI) ---
+void reportDisplayStats() {
+    Serial.print(F("OLED: quadros="));
+    Serial.print(displayStats.frames);
+    Serial.print(F(" ignorados="));
+    Serial.print(displayStats.skippedFrames);
+    Serial.print(F(" ultimo="));
+    Serial.print(displayStats.lastFrameUs);
+    Serial.print(F("us/"));
+    Serial.print(displayStats.lastFrameBytes);
+    Serial.print(F("B max="));
+    Serial.print(displayStats.maxFrameUs);
+    Serial.print(F("us media="));
+    Serial.print(displayStats.frames ? displayStats.totalBytes / displayStats.frames : 0);
+    Serial.println(F("B/quadro"));
+}
+
+
 // --- ATUALIZAÇÃO PRINCIPAL DO DISPLAY ---
+// Única função que limpa o framebuffer e fala com o painel. As funções de página apenas desenham.
 void updateDisplay() {
-    display.clearDisplay(); 
+    PROFILE_SCOPE(PROF_DISPLAY);
+    unsigned long startUs = micros();
+    int page = (currentPage >= 0 && currentPage < NUM_OLED_PAGES) ? currentPage : 0;
+
+    // 0. Nada mudou desde o último quadro: sem redesenho e sem tráfego I2C
+    uint32_t signature = computePageSignature(page);
+    if (signature == lastPageSignature && !displayFullRefreshPending) {
+        displayStats.skippedFrames++;
+        return;
+    }
+
+    display.clearDisplay();
     
     // 1. Renderiza a pagina atual
-    switch (currentPage) {
+    switch (page) {
         case 0:
             renderPage0Dashboard();
             break;
@@ -95,40 +278,50 @@ void updateDisplay() {
             break;
         case 2:
             renderPage2TpaReposition();
-            display.setTextSize(2); display.setCursor(0, 20);
-            display.println(F("P2: TPA Reposicao"));
             break;
         case 3:
             renderPage3TpaBuffer();
-            display.setTextSize(2); display.setCursor(0, 20);
-            display.println(F("P3: Inj. Buffer"));
+            break;
+        case 4:
+            renderPage4Diagnostics();
             break;
         default:
             renderPage0Dashboard();
             break;
     }
 
-    // 2. Exibir o que foi desenhado no buffer
-    display.display();
+    // 2. Envia apenas as páginas/colunas que mudaram
+    size_t bytesSent = flushDirtyPages();
+    lastPageSignature = signature;
+
+    unsigned long frameUs = micros() - startUs;
+    displayStats.frames++;
+    displayStats.lastFrameUs = frameUs;
+    if (frameUs > displayStats.maxFrameUs) displayStats.maxFrameUs = frameUs;
+    displayStats.lastFrameBytes = bytesSent;
+    displayStats.totalBytes += bytesSent;
 }
 
 
 // --- PÁGINA 0: DASHBOARD ---
+// Os valores de processo vêm da fotografia publicada pela tarefa de controle (uiSnapshot),
+// e não das variáveis globais que o controle altera em outro núcleo.
 void renderPage0Dashboard() {
-    display.clearDisplay();
     display.setTextSize(1);
     display.setTextColor(SSD1306_WHITE);
 
     // --- LINHA 1: TÍTULO / HORA ---
     display.setCursor(0, 0);
     display.print(F("AQUARIO ACC | "));
-    display.print(getCurrentTimeString());
+    char timeStr[9];
+    formatClockTime(timeStr, sizeof(timeStr));
+    display.print(timeStr);
 
     // --- LINHA 2: TEMPERATURA ---
     display.setCursor(0, 10);
     display.print(F("Temp: "));
     display.setTextSize(2);
-    display.print(temperatureC, 1);
+    display.print(uiSnapshot.temperatureC, 1);
     display.print((char)247); // Símbolo de grau
     display.print(F("C"));
     display.setTextSize(1);
@@ -137,7 +330,7 @@ void renderPage0Dashboard() {
     display.setCursor(0, 30);
     display.print(F("pH: "));
     display.setTextSize(2);
-    display.print(phValue, 2);
+    display.print(uiSnapshot.phValue, 2);
     display.setTextSize(1);
 
     // --- LINHA 3.1 STATUS E PH OFFSET (Rodapé) ---
@@ -150,15 +343,16 @@ void renderPage0Dashboard() {
     // --- LINHA 4: STATUS TPA (NOVA IMPLEMENTAÇÃO) ---
     display.setCursor(0, 50);
 
-    if (tpaMasterCurrentState != TPA_MASTER_IDLE && tpaMasterCurrentState != TPA_MASTER_COMPLETED) {
+    TpaMasterState tpaState = (TpaMasterState)uiSnapshot.tpaMasterState;
+    if (tpaState != TPA_MASTER_IDLE && tpaState != TPA_MASTER_COMPLETED) {
         // TPA em progresso (M5.1 ou M5.2)
 
         // 1. Determina o Status
         const __FlashStringHelper* statusText;
         
-        if (tpaMasterCurrentState == TPA_MASTER_EXTRACTION_RUNNING_M51) {
+        if (tpaState == TPA_MASTER_EXTRACTION_RUNNING_M51) {
             statusText = F("TPA: EXTRAINDO ");
-        } else if (tpaMasterCurrentState == TPA_MASTER_REPOSITION_RUNNING_M52) {
+        } else if (tpaState == TPA_MASTER_REPOSITION_RUNNING_M52) {
             statusText = F("TPA: REPOSICIONANDO ");
         } else {
             statusText = F("TPA: AQUARDANDO "); // Para futuros estados
@@ -166,29 +360,15 @@ void renderPage0Dashboard() {
         display.print(statusText);
 
         // 2. Calcula Volume em Tempo Real (Apenas se for Extração M5.1)
-        if (tpaMasterCurrentState == TPA_MASTER_EXTRACTION_RUNNING_M51) {
-            
-            // Vazão em Litros/ms: (ML/s / 1000) / 1000 = L/ms
-            const float FLOW_RATE_L_PER_MS = EXTRACTION_PUMP_FLOW_RATE_ML_PER_SEC / 1000000.0f; 
-            
-            // Tempo decorrido (em ms)
-            unsigned long elapsedTimeMs = millis() - tpaExtractionStartTime;
-            
-            // Volume Extraído (Liters)
-            float extractedVolumeL = (float)elapsedTimeMs * FLOW_RATE_L_PER_MS;
-
-            // Garante que o volume extraído não exceda o total programado
-            if (extractedVolumeL > volumeToExtractLiters) {
-                extractedVolumeL = volumeToExtractLiters;
-            }
-
+        if (tpaState == TPA_MASTER_EXTRACTION_RUNNING_M51) {
+            // Volume extraído calculado pelo controle (getExtractedVolumeLiters())
             // Exibe Volume Atual / Volume Total
-            display.print(extractedVolumeL, 2); // Volume extraído (xx.xx)
+            display.print(uiSnapshot.extractedVolumeL, 2); // Volume extraído (xx.xx)
             display.print(F("/"));
             display.print(volumeToExtractLiters, 1); // Volume total (tt.t)
             display.print(F(" L"));
 
-        } else if (tpaMasterCurrentState == TPA_MASTER_REPOSITION_RUNNING_M52) {
+        } else if (tpaState == TPA_MASTER_REPOSITION_RUNNING_M52) {
             // Para Reposição M5.2, exibir a porcentagem ou a duração restante seria mais complexo 
             // no display (que tem pouco espaço). Simplificamos para mostrar o total.
             display.print(volumeToExtractLiters, 1); 
@@ -200,19 +380,23 @@ void renderPage0Dashboard() {
     }
 
     // Se estiver no Modo de Serviço, sobrescreve o status
-    if (serviceModeActive) {
+    if (uiSnapshot.serviceMode) {
         display.setCursor(90, 50);
         display.print(F("SERVICE!")); 
     }
     // --- LINHA 5: Nível do RAN ---
     display.setCursor(0, 56); // Ultima linha
     display.print(F("RAN: "));
-    display.print(ranLevelPercent);
-    display.print(F("% ("));
-    display.print(ranLevelFull ? F("OK") : F("BAIXO"));
-    display.print(F(")"));
-    
-    display.display(); // Envia o buffer para o display
+    display.print(uiSnapshot.ranLevelPercent);
+    if (!isnan(uiSnapshot.ranLevelLiters)) {
+        display.print(F("% "));
+        display.print(uiSnapshot.ranLevelLiters, 1); // Volume medido pelo sensor contínuo
+        display.print(F("L"));
+    } else {
+        display.print(F("% ("));
+        display.print(uiSnapshot.ranLevelFull ? F("OK") : F("BAIXO"));
+        display.print(F(")"));
+    }
 }
 
 
@@ -239,21 +423,21 @@ void renderPage1TpaSchedule() {
     // Linha 3: Dia
     display.setCursor(0, 32);
     display.print(F("Dia: "));
-    display.print(dayNames[tpaScheduleDay]); 
+    display.print(dayNames[uiSnapshot.tpaScheduleDay]); 
 
     // Linha 4: Hora
     display.setCursor(0, 42);
     display.print(F("Hora: "));
-    if (tpaScheduleHour < 10) display.print('0');
-    display.print(tpaScheduleHour);
+    if (uiSnapshot.tpaScheduleHour < 10) display.print('0');
+    display.print(uiSnapshot.tpaScheduleHour);
     display.print(F(":"));
-    if (tpaScheduleMinute < 10) display.print('0');
-    display.print(tpaScheduleMinute);
+    if (uiSnapshot.tpaScheduleMinute < 10) display.print('0');
+    display.print(uiSnapshot.tpaScheduleMinute);
 
     // Linha 5: Frequencia
     display.setCursor(0, 52);
     display.print(F("Freq: "));
-    display.print(freqNames[tpaScheduleFrequency]);
+    display.print(freqNames[uiSnapshot.tpaScheduleFrequency]);
     
     // --- LÓGICA DE MODO DE EDICAO/SELEÇÃO (REALCE) ---
     int y_pos = 0;
@@ -275,15 +459,15 @@ void renderPage1TpaSchedule() {
         // 3. Re-escreve o valor do campo sobre o realce
         display.setCursor(x_start + 1, y_pos);
         if (page1EditMode == 0) {
-            display.print(dayNames[tpaScheduleDay]);
+            display.print(dayNames[uiSnapshot.tpaScheduleDay]);
         } else if (page1EditMode == 1) {
-            if (tpaScheduleHour < 10) display.print('0');
-            display.print(tpaScheduleHour);
+            if (uiSnapshot.tpaScheduleHour < 10) display.print('0');
+            display.print(uiSnapshot.tpaScheduleHour);
         } else if (page1EditMode == 2) {
-            if (tpaScheduleMinute < 10) display.print('0');
-            display.print(tpaScheduleMinute);
+            if (uiSnapshot.tpaScheduleMinute < 10) display.print('0');
+            display.print(uiSnapshot.tpaScheduleMinute);
         } else if (page1EditMode == 3) {
-            display.print(freqNames[tpaScheduleFrequency]);
+            display.print(freqNames[uiSnapshot.tpaScheduleFrequency]);
         }
         
         // 4. Volta a cor do texto para BRANCO (para o restante do display)
@@ -298,8 +482,6 @@ void renderPage1TpaSchedule() {
         display.setCursor(110, 52);
         display.print(F("SAVE"));
     }
-
-     display.display();
 }
 
 
@@ -307,7 +489,6 @@ void renderPage1TpaSchedule() {
 // --- PÁGINA 2: TPA (REPOSIÇÃO) 
 //-----------------------------------------------
 void renderPage2TpaReposition() {
-    display.clearDisplay();
     display.setTextSize(1);
     display.setTextColor(SSD1306_WHITE);
 
@@ -352,9 +533,8 @@ void renderPage2TpaReposition() {
         display.setCursor(10, 40);
         display.print(volumeToRepositionLiters, 2);
         display.setTextSize(1); 
+        display.setTextColor(SSD1306_WHITE);
     }
-    
-    display.display();
 }
 
 
@@ -362,7 +542,6 @@ void renderPage2TpaReposition() {
 // --- PÁGINA 3: BUFFER 
 //-----------------------------------------------
 void renderPage3TpaBuffer() {
-    display.clearDisplay();
     display.setTextColor(SSD1306_WHITE);
     display.setTextSize(1);
     
@@ -412,6 +591,57 @@ void renderPage3TpaBuffer() {
     } else {
         display.print(F("SELECT CURTO para editar volume."));
     }
+}
 
-    display.display();
-}
\ No newline at end of file
+//-----------------------------------------------
+// Página 4: Diagnóstico (profiler.ino)
+// Heap/maior bloco, folga de pilha por tarefa e o pior caso das sondas mais lentas.
+//-----------------------------------------------
+void renderPage4Diagnostics() {
+    display.setTextColor(SSD1306_WHITE);
+    display.setTextSize(1);
+
+    display.setCursor(0, 0);
+    display.print(F("DIAGNOSTICO"));
+    display.drawFastHLine(0, 9, 128, SSD1306_WHITE); // Linha separadora
+
+    // --- LINHA 1: Heap livre / maior bloco (KB) ---
+    display.setCursor(0, 12);
+    display.print(F("Heap "));
+    display.print(profilerSystem.freeHeap / 1024);
+    display.print(F("k blk "));
+    display.print(profilerSystem.largestBlock / 1024);
+    display.print(F("k m"));
+    display.print(profilerSystem.minFreeHeap / 1024);
+
+    // --- LINHA 2: Folga mínima de pilha (controle/rede/UI) ---
+    display.setCursor(0, 22);
+    display.print(F("Pilha C"));
+    display.print(profilerSystem.stackFreeBytes[SCHED_GROUP_CONTROL]);
+    display.print(F(" R"));
+    display.print(profilerSystem.stackFreeBytes[SCHED_GROUP_NETWORK]);
+    display.print(F(" U"));
+    display.print(profilerSystem.stackFreeBytes[SCHED_GROUP_UI]);
+
+    // --- LINHAS 3-5: As três sondas com maior latência máxima (ms) ---
+    uint8_t shown[3] = { PROF_PROBE_COUNT, PROF_PROBE_COUNT, PROF_PROBE_COUNT };
+    for (uint8_t rank = 0; rank < 3; rank++) {
+        uint32_t worst = 0;
+        for (uint8_t i = 0; i < PROF_PROBE_COUNT; i++) {
+            if (i == shown[0] || i == shown[1]) continue;
+            if (profileProbes[i].calls > 0 && profileProbes[i].maxCycles >= worst) {
+                worst = profileProbes[i].maxCycles;
+                shown[rank] = i;
+            }
+        }
+        if (shown[rank] == PROF_PROBE_COUNT) break;
+
+        display.setCursor(0, 34 + rank * 10);
+        display.print(getProfileProbeName(shown[rank]));
+        display.setCursor(66, 34 + rank * 10);
+        display.print(getProfilePercentileUs(shown[rank], 99) / 1000.0f, 1);
+        display.print(F("/"));
+        display.print(profileCyclesToUs(worst) / 1000.0f, 1);
+        display.print(F("ms"));
+    }
+}
@@ -0,0 +1,354 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: DOSING_ENGINE               |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Per-pump flow calibration and volume-terminated dosing (extraction, reposition, buffer)
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.04 - calculatePumpDuration() checks the pump index before reading its calibration
+15/10/2026 - 0.03 - Pump runtime kept in RAM; persisted once per TPA plan or every 6 h (not per dose)
+15/10/2026 - 0.02 - Entry point instrumented with PROFILE_SCOPE
+15/10/2026 - 0.01 - First installment: calibration table, guided calibration, PWM soft-start, wear drift
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - (this file) Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- MOTOR DE DOSAGEM VOLUMÉTRICA ---
+// Cada bomba peristáltica tem a sua vazão calibrada (tubos e motores diferentes). Uma dose é
+// definida em mL: o motor integra o volume entregue (vazão efetiva x potência aplicada x dt) a
+// cada passagem da tarefa de controle e desliga a bomba quando o alvo é atingido. A rampa
+// PWM opcional (soft-start) entra na integração, então não altera o volume final.
+// A vazão efetiva cai com o desgaste do tubo: o motor acumula o tempo de uso desde a última
+// calibração e aplica a perda por 100 h aprendida entre duas calibrações.
+PumpCalibration pumpCal[PUMP_COUNT];
+PumpDose pumpDoses[PUMP_COUNT];
+
+// Tempo de uso (desgaste) acumulado só em RAM: gravado uma vez ao fim do plano TPA ou, fora
+// dele, no máximo a cada PUMP_RUNTIME_SAVE_MS (uma dose não vale uma gravação A/B inteira)
+static bool pumpRuntimeUnsaved = false;
+static unsigned long pumpRuntimeUnsavedSinceMs = 0;
+
+// Bomba aguardando o volume medido da calibração guiada (-1 = nenhuma)
+int8_t pumpCalAwaitingPump = -1;
+float pumpCalAwaitingFullOnSec = 0.0f;  // Tempo equivalente a potência máxima da corrida
+
+struct PumpHardware {
+    uint8_t pin;
+    bool activeHigh;              // Extração: HIGH liga; relés de reposição/buffer: RELAY_ON (LOW)
+    uint8_t pwmChannel;           // Canal LEDC usado quando rampMs > 0
+    const char* name;
+};
+const PumpHardware PUMP_HW[PUMP_COUNT] = {
+    { TPA_EXTRACTION_PUMP_PIN, true,  PUMP_PWM_FIRST_CHANNEL,     "Extracao" },
+    { TPA_REPOSITION_PUMP_PIN, false, PUMP_PWM_FIRST_CHANNEL + 1, "Reposicao" },
+    { TPA_BUFFER_PUMP_PIN,     false, PUMP_PWM_FIRST_CHANNEL + 2, "Buffer" }
+};
+bool pumpPwmAttached[PUMP_COUNT] = { false, false, false };
+
+
+// --- DEFAULTS (usados por setConfigDefaults) ---
+void setPumpCalibrationDefaults(PumpCalibration* cal) {
+    for (uint8_t i = 0; i < PUMP_COUNT; i++) {
+        cal[i].flowMlPerSec = EXTRACTION_PUMP_FLOW_RATE_ML_PER_SEC; // Até a primeira calibração
+        cal[i].rampMs = 0;                                          // Sem soft-start (relé)
+        cal[i].reserved = 0;
+        cal[i].driftPctPer100h = 0.0f;
+        cal[i].runtimeSinceCalSec = 0.0f;
+    }
+}
+
+
+// --- SAÍDA FÍSICA ---
+// duty: 0 (desligada) a PUMP_PWM_MAX_DUTY. Sem rampa a saída é digital (relé).
+static void writePumpOutput(uint8_t pump, uint16_t duty) {
+    const PumpHardware& hw = PUMP_HW[pump];
+    if (pumpPwmAttached[pump]) {
+        ledcWrite(hw.pwmChannel, hw.activeHigh ? duty : (PUMP_PWM_MAX_DUTY - duty));
+    } else {
+        bool on = duty > 0;
+        halDigitalWrite(hw.pin, hw.activeHigh ? (on ? HIGH : LOW) : (on ? RELAY_ON : RELAY_OFF));
+    }
+}
+
+// Chamada no setup() depois de setupConfigManager(): a rampa de cada bomba vem da configuração
+void setupDosingEngine() {
+    for (uint8_t i = 0; i < PUMP_COUNT; i++) {
+        const PumpHardware& hw = PUMP_HW[i];
+        if (pumpCal[i].rampMs > 0) {
+            ledcSetup(hw.pwmChannel, PUMP_PWM_FREQ_HZ, PUMP_PWM_RESOLUTION_BITS);
+            ledcAttachPin(hw.pin, hw.pwmChannel);
+            pumpPwmAttached[i] = true;
+        } else {
+            halPinMode(hw.pin, OUTPUT);
+        }
+        memset(&pumpDoses[i], 0, sizeof(PumpDose));
+        writePumpOutput(i, 0); // Todas começam desligadas
+    }
+}
+
+
+// --- VAZÃO EFETIVA E DURAÇÃO PREVISTA ---
+float getPumpEffectiveFlow(uint8_t pump) {
+    const PumpCalibration& cal = pumpCal[pump];
+    float wear = cal.driftPctPer100h / 100.0f * (cal.runtimeSinceCalSec / 360000.0f);
+    if (wear > PUMP_MAX_WEAR_FRACTION) wear = PUMP_MAX_WEAR_FRACTION;
+    return cal.flowMlPerSec * (1.0f - wear);
+}
+
+// Tempo previsto para entregar o volume (planejamento, display e logs). O término real é pelo
+// volume integrado em runDosingEngine(). A rampa linear entrega metade da vazão no seu período.
+unsigned long calculatePumpDuration(uint8_t pump, float volumeLiters) {
+    if (pump >= PUMP_COUNT || volumeLiters <= 0.0f) return 0; // Antes de indexar pumpCal[]
+    float flow = getPumpEffectiveFlow(pump);
+    if (flow <= 0.0f) return 0;
+    float durationMs = (volumeLiters * 1000.0f / flow) * 1000.0f + pumpCal[pump].rampMs / 2.0f;
+    return (unsigned long)durationMs;
+}
+
+
+// --- DOSES ---
+bool startPumpDose(uint8_t pump, float volumeMl) {
+    if (pump >= PUMP_COUNT || volumeMl <= 0.0f || getPumpEffectiveFlow(pump) <= 0.0f) return false;
+    if (serviceModeActive) {
+        Serial.print(F("AVISO: Bomba bloqueada pelo Modo de Servico: "));
+        Serial.println(PUMP_HW[pump].name);
+        return false;
+    }
+    if (pumpDoses[pump].active) return false;
+
+    PumpDose& dose = pumpDoses[pump];
+    dose.active = true;
+    dose.calibrating = false;
+    dose.targetMl = volumeMl;
+    dose.deliveredMl = 0.0f;
+    dose.fullOnSec = 0.0f;
+    dose.startUs = halMicros();
+    dose.lastUs = dose.startUs;
+    dose.duty = (pumpCal[pump].rampMs > 0) ? 0 : PUMP_PWM_MAX_DUTY;
+    writePumpOutput(pump, dose.duty);
+
+    Serial.print(F("Dosagem: "));
+    Serial.print(PUMP_HW[pump].name);
+    Serial.print(F(" -> "));
+    Serial.print(volumeMl, 1);
+    Serial.println(F(" mL"));
+    return true;
+}
+
+void stopPumpDose(uint8_t pump) {
+    if (pump >= PUMP_COUNT) return;
+    PumpDose& dose = pumpDoses[pump];
+    writePumpOutput(pump, 0);
+    if (!dose.active) return;
+    dose.active = false;
+    dose.duty = 0;
+    pumpCal[pump].runtimeSinceCalSec += dose.fullOnSec; // Desgaste do tubo (gravado em lote)
+    if (!pumpRuntimeUnsaved) pumpRuntimeUnsavedSinceMs = halMillis();
+    pumpRuntimeUnsaved = true;
+}
+
+// Fim do plano TPA (ou intervalo vencido): um único markConfigDirty() para todas as doses
+void flushPumpRuntime() {
+    if (!pumpRuntimeUnsaved) return;
+    pumpRuntimeUnsaved = false;
+    markConfigDirty();
+}
+
+bool isPumpDoseActive(uint8_t pump) {
+    return pump < PUMP_COUNT && pumpDoses[pump].active;
+}
+
+float getPumpDeliveredMl(uint8_t pump) {
+    return pump < PUMP_COUNT ? pumpDoses[pump].deliveredMl : 0.0f;
+}
+
+
+// --- TAREFA DE CONTROLE (crítica, a cada passagem) ---
+void runDosingEngine() {
+    PROFILE_SCOPE(PROF_DOSING);
+    if (pumpRuntimeUnsaved && !isTpaPlanActive() &&
+        halMillis() - pumpRuntimeUnsavedSinceMs >= PUMP_RUNTIME_SAVE_MS) {
+        flushPumpRuntime(); // Doses avulsas (buffer/agenda) fora de um plano TPA
+    }
+    unsigned long nowUs = halMicros();
+    for (uint8_t i = 0; i < PUMP_COUNT; i++) {
+        PumpDose& dose = pumpDoses[i];
+        if (!dose.active) continue;
+
+        // Kill switch também no nível da bomba
+        if (serviceModeActive) {
+            stopPumpDose(i);
+            continue;
+        }
+
+        float dtSec = (float)(nowUs - dose.lastUs) / 1000000.0f;
+        dose.lastUs = nowUs;
+        float power = (float)dose.duty / (float)PUMP_PWM_MAX_DUTY; // Vazão ~ proporcional ao duty
+        dose.fullOnSec += power * dtSec;
+        dose.deliveredMl += getPumpEffectiveFlow(i) * power * dtSec;
+
+        // Rampa de soft-start
+        uint16_t rampMs = pumpCal[i].rampMs;
+        if (rampMs > 0 && dose.duty < PUMP_PWM_MAX_DUTY) {
+            unsigned long elapsedMs = (nowUs - dose.startUs) / 1000UL;
+            dose.duty = (elapsedMs >= rampMs) ? PUMP_PWM_MAX_DUTY : (uint16_t)((uint32_t)PUMP_PWM_MAX_DUTY * elapsedMs / rampMs);
+            writePumpOutput(i, dose.duty);
+        }
+
+        if (dose.calibrating) {
+            if (nowUs - dose.startUs >= PUMP_CAL_RUN_MS * 1000UL) finishPumpCalibrationRun(i);
+        } else if (dose.deliveredMl >= dose.targetMl) {
+            stopPumpDose(i);
+        }
+    }
+}
+
+
+// --- CALIBRAÇÃO GUIADA ---
+// 1. startPumpCalibration(): bomba liga por PUMP_CAL_RUN_MS (com a rampa configurada);
+// 2. o usuário mede o volume na proveta e informa no Blynk (VPIN_PUMP_CAL_ML);
+// 3. finishPumpCalibration(): nova vazão = mL medidos / tempo equivalente a potência máxima.
+void publishPumpCalStatus(const char* text) {
+    Serial.print(F("BOMBA CAL: "));
+    Serial.println(text);
+    publishVirtualPinText(VPIN_PUMP_CAL_STATUS, text);
+}
+
+bool startPumpCalibration(uint8_t pump) {
+    if (pump >= PUMP_COUNT) return false;
+    if (tpaMasterCurrentState != TPA_MASTER_IDLE || pumpDoses[pump].active || serviceModeActive) {
+        publishPumpCalStatus("Calibracao recusada: bomba/TPA em uso ou modo servico");
+        return false;
+    }
+    PumpDose& dose = pumpDoses[pump];
+    dose.active = true;
+    dose.calibrating = true;
+    dose.targetMl = 0.0f;
+    dose.deliveredMl = 0.0f;
+    dose.fullOnSec = 0.0f;
+    dose.startUs = halMicros();
+    dose.lastUs = dose.startUs;
+    dose.duty = (pumpCal[pump].rampMs > 0) ? 0 : PUMP_PWM_MAX_DUTY;
+    writePumpOutput(pump, dose.duty);
+    pumpCalAwaitingPump = -1;
+
+    char status[NET_MSG_TEXT_LEN];
+    snprintf(status, sizeof(status), "%s: dosando %lus na proveta...", PUMP_HW[pump].name, PUMP_CAL_RUN_MS / 1000UL);
+    publishPumpCalStatus(status);
+    logSystemEvent("info", "Calibracao de bomba iniciada.");
+    return true;
+}
+
+void finishPumpCalibrationRun(uint8_t pump) {
+    pumpCalAwaitingFullOnSec = pumpDoses[pump].fullOnSec;
+    pumpCalAwaitingPump = (int8_t)pump;
+    stopPumpDose(pump);
+    pumpCal[pump].runtimeSinceCalSec -= pumpCalAwaitingFullOnSec; // A corrida de calibração não conta como desgaste
+
+    char status[NET_MSG_TEXT_LEN];
+    snprintf(status, sizeof(status), "%s: informe o volume medido (mL)", PUMP_HW[pump].name);
+    publishPumpCalStatus(status);
+}
+
+void finishPumpCalibration(float measuredMl) {
+    if (pumpCalAwaitingPump < 0 || pumpCalAwaitingFullOnSec <= 0.0f) {
+        publishPumpCalStatus("Nenhuma calibracao aguardando volume");
+        return;
+    }
+    uint8_t pump = (uint8_t)pumpCalAwaitingPump;
+    PumpCalibration& cal = pumpCal[pump];
+    float newFlow = measuredMl / pumpCalAwaitingFullOnSec;
+    if (measuredMl <= 0.0f || newFlow < PUMP_FLOW_MIN_ML_PER_SEC || newFlow > PUMP_FLOW_MAX_ML_PER_SEC) {
+        publishPumpCalStatus("Volume invalido. Calibracao descartada");
+        pumpCalAwaitingPump = -1;
+        return;
+    }
+
+    // Perda de vazão por 100 h de uso, medida entre esta e a calibração anterior
+    float runtimeHours = cal.runtimeSinceCalSec / 3600.0f;
+    if (runtimeHours >= PUMP_DRIFT_MIN_RUNTIME_H && cal.flowMlPerSec > 0.0f) {
+        float lossPct = (cal.flowMlPerSec - newFlow) / cal.flowMlPerSec * 100.0f;
+        float measured = lossPct / (runtimeHours / 100.0f);
+        if (measured < 0.0f) measured = 0.0f;          // Vazão subiu (tubo novo): sem desgaste
+        if (measured > PUMP_DRIFT_MAX_PCT_PER_100H) measured = PUMP_DRIFT_MAX_PCT_PER_100H;
+        cal.driftPctPer100h = (cal.driftPctPer100h == 0.0f) ? measured
+                                                            : cal.driftPctPer100h + PUMP_DRIFT_ALPHA * (measured - cal.driftPctPer100h);
+    }
+    cal.flowMlPerSec = newFlow;
+    cal.runtimeSinceCalSec = 0.0f;
+    pumpCalAwaitingPump = -1;
+    markConfigDirty();
+    calculateTpaVolume(); // Duração prevista da extração com a nova vazão
+
+    char status[NET_MSG_TEXT_LEN];
+    snprintf(status, sizeof(status), "OK %s: %.2f mL/s (desgaste %.1f%%/100h)", PUMP_HW[pump].name, newFlow, cal.driftPctPer100h);
+    publishPumpCalStatus(status);
+    logSystemEvent("info", "Calibracao de bomba concluida.");
+}
+
+
+// --- HANDLERS BLYNK (tarefa de rede: só enviam o comando) ---
+// 1 = Extração, 2 = Reposição, 3 = Buffer
+BLYNK_WRITE(VPIN_PUMP_CAL) {
+    int pump = param.asInt();
+    if (pump >= 1 && pump <= PUMP_COUNT) {
+        postControlCommand(CMD_PUMP_CALIBRATE, pump - 1);
+    }
+}
+
+// Volume medido na proveta (mL, enviado em décimos de mL)
+BLYNK_WRITE(VPIN_PUMP_CAL_ML) {
+    float measuredMl = param.asFloat();
+    if (measuredMl > 0.0f) {
+        postControlCommand(CMD_PUMP_CAL_RESULT, (int32_t)lroundf(measuredMl * 10.0f));
+    }
+}
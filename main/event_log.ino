@@ -0,0 +1,356 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: EVENT_LOG                   |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Allocation-free structured event log: RTC-memory crash ring drained to Serial, Blynk and flash
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.02 - Entry point instrumented with PROFILE_SCOPE
+15/10/2026 - 0.01 - Lock-free RTC-memory event ring, async drain (Serial/Blynk/flash), post-mortem trail
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - (this file) Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+#include <esp_system.h>
+#include <stdarg.h>
+
+// --- LOG DE EVENTOS ESTRUTURADO ---
+// Qualquer tarefa grava direto no anel (sem String, sem malloc, sem fila por tarefa): o
+// registro é formatado dentro do próprio slot. A tarefa de rede esvazia o anel para o
+// Serial, o Blynk (eventos log_<nivel>) e a flash, cada um com seu cursor: o Blynk offline
+// não descarta nada enquanto o anel não der a volta.
+// O anel fica na memória RTC lenta (RTC_NOINIT_ATTR): sobrevive a watchdog, panic e
+// reset por software, e no boot seguinte vira a trilha pós-morte (/crash.log).
+
+RTC_NOINIT_ATTR static EventLogRing eventRing;
+
+EventLogStats eventLogStats;
+
+static uint32_t serialCursor = 0;          // Próximo seq a enviar em cada destino
+static uint32_t blynkCursor = 0;
+static uint32_t flashCursor = 0;
+static uint32_t postMortemFirstSeq = 0;    // Trilha do boot anterior: [first, end) pendente de gravar
+static uint32_t postMortemEndSeq = 0;
+static unsigned long lastFlashDrainMs = 0;
+static unsigned long lastStatsReportMs = 0;
+
+static const char* const LOG_LEVEL_NAMES[LOG_LEVEL_COUNT] = {
+    "debug", "info", "success", "warning", "error", "critical"
+};
+static const char* const LOG_SOURCE_NAMES[LOG_SRC_COUNT] = {
+    "SYS", "TPA", "PH", "TEMP", "CLOCK", "CONFIG", "PUMP", "NET", "ALERT"
+};
+
+// Categoria antiga (texto) -> nível; desconhecida vira info
+static uint8_t levelFromCategory(const char* category) {
+    for (uint8_t i = 0; i < LOG_LEVEL_COUNT; i++) {
+        if (strcmp(category, LOG_LEVEL_NAMES[i]) == 0) return i;
+    }
+    return LOG_LEVEL_INFO;
+}
+
+
+// 1. --- GRAVAÇÃO (qualquer tarefa) ---
+// Reserva o slot com fetch_add no head; seq = 0 marca "em escrita" e o seq final publica o
+// registro (release). Quem lê confere o seq antes e depois da cópia.
+static EventRecord* reserveEventSlot(uint8_t level, uint8_t source, uint32_t& seq) {
+    uint32_t index = __atomic_fetch_add(&eventRing.head, 1, __ATOMIC_RELAXED);
+    EventRecord* slot = &eventRing.slots[index % EVENT_RING_SIZE];
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    slot->epoch = clockIsValid() ? clockNowEpoch() : 0;
+    slot->uptimeMs = halMillis();
+    slot->level = level;
+    slot->source = source;
+    slot->bootCount = (uint8_t)eventRing.bootCount;
+    seq = index + 1;
+    return slot;
+}
+
+static void commitEventSlot(EventRecord* slot, uint32_t seq) {
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&eventLogStats.written, 1, __ATOMIC_RELAXED);
+}
+
+void logEvent(uint8_t level, uint8_t source, const char* message) {
+    if (level >= LOG_LEVEL_COUNT || eventRing.magic != EVENT_RING_MAGIC) return;
+    uint32_t seq;
+    EventRecord* slot = reserveEventSlot(level, source < LOG_SRC_COUNT ? source : (uint8_t)LOG_SRC_SYSTEM, seq);
+    strncpy(slot->text, message, EVENT_TEXT_LEN - 1);
+    slot->text[EVENT_TEXT_LEN - 1] = '\0';
+    commitEventSlot(slot, seq);
+}
+
+// Formata direto no slot (vsnprintf na pilha da tarefa chamadora, sem heap)
+void logEventf(uint8_t level, uint8_t source, const char* format, ...) {
+    if (level >= LOG_LEVEL_COUNT || eventRing.magic != EVENT_RING_MAGIC) return;
+    uint32_t seq;
+    EventRecord* slot = reserveEventSlot(level, source < LOG_SRC_COUNT ? source : (uint8_t)LOG_SRC_SYSTEM, seq);
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot->text, EVENT_TEXT_LEN, format, args);
+    va_end(args);
+    commitEventSlot(slot, seq);
+}
+
+// -------------------------------------------------------------------
+// FUNÇÃO LOG EVENTOS: Para registro no Blink
+// -------------------------------------------------------------------
+/**
+ * Registra um evento com as categorias genéricas (log_info, log_critical, etc.), que no
+ * Blynk economizam o limite de 5 eventos únicos da conta gratuita.
+ * @param category "info", "success", "warning", "error" ou "critical".
+ * @param message A descrição detalhada do evento.
+ */
+void logSystemEvent(const char* category, const char* message) {
+    logEvent(levelFromCategory(category), LOG_SRC_SYSTEM, message);
+}
+
+
+// 2. --- LEITURA ---
+// EVENT_READ_OK: registro copiado. NOT_READY: ainda não publicado. LAPPED: o anel já
+// sobrescreveu este seq (o cursor deve pular para o mais antigo disponível).
+enum EventReadResult { EVENT_READ_OK, EVENT_READ_NOT_READY, EVENT_READ_LAPPED };
+
+static EventReadResult readEventRecord(uint32_t seq, EventRecord& out) {
+    const EventRecord* slot = &eventRing.slots[(seq - 1) % EVENT_RING_SIZE];
+    uint32_t before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (before == 0 || before < seq) return EVENT_READ_NOT_READY;
+    if (before > seq) return EVENT_READ_LAPPED;
+    memcpy(&out, slot, sizeof(out));
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq) return EVENT_READ_LAPPED;
+    return EVENT_READ_OK;
+}
+
+// Lê o próximo registro do cursor; conta e pula o que foi perdido por volta do anel
+static bool nextEventRecord(uint32_t& cursor, EventRecord& out, unsigned long& dropped) {
+    uint32_t head = __atomic_load_n(&eventRing.head, __ATOMIC_ACQUIRE);
+    while (cursor < head) {
+        EventReadResult result = readEventRecord(cursor + 1, out);
+        if (result == EVENT_READ_OK) {
+            cursor++;
+            return true;
+        }
+        if (result == EVENT_READ_NOT_READY) return false; // Escritor no meio da gravação
+        uint32_t oldest = head > EVENT_RING_SIZE ? head - EVENT_RING_SIZE : 0;
+        if (cursor < oldest) {
+            dropped += oldest - cursor;
+            cursor = oldest;
+        } else {
+            dropped++;
+            cursor++;
+        }
+    }
+    return false;
+}
+
+static int formatEventLine(const EventRecord& rec, char* buf, size_t len) {
+    return snprintf(buf, len, "%lu;%lu;%lu;%s;%s;%s\n",
+                    (unsigned long)rec.seq, (unsigned long)rec.epoch, (unsigned long)rec.uptimeMs,
+                    LOG_LEVEL_NAMES[rec.level % LOG_LEVEL_COUNT],
+                    LOG_SOURCE_NAMES[rec.source % LOG_SRC_COUNT], rec.text);
+}
+
+
+// 3. --- BOOT: INICIALIZAÇÃO E TRILHA PÓS-MORTE ---
+// Chamar logo após Serial.begin(): daí em diante qualquer logSystemEvent() já é registrado.
+void setupEventLog() {
+    esp_reset_reason_t reason = esp_reset_reason();
+    // Power-on (ou brownout profundo) deixa lixo na RTC: só confia com a assinatura intacta
+    bool keepRing = eventRing.magic == EVENT_RING_MAGIC && reason != ESP_RST_POWERON;
+
+    if (!keepRing) {
+        memset(&eventRing, 0, sizeof(eventRing));
+        eventRing.magic = EVENT_RING_MAGIC;
+    } else {
+        eventRing.bootCount++;
+    }
+
+    // Os destinos começam no fim: eventos do boot anterior não são reenviados ao Blynk
+    serialCursor = blynkCursor = flashCursor = eventRing.head;
+
+    bool crash = keepRing && (reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+                              reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT ||
+                              reason == ESP_RST_BROWNOUT);
+    if (crash) {
+        postMortemEndSeq = eventRing.head;
+        postMortemFirstSeq = postMortemEndSeq > EVENT_RING_SIZE ? postMortemEndSeq - EVENT_RING_SIZE : 0;
+        eventLogStats.postMortemEvents = postMortemEndSeq - postMortemFirstSeq;
+
+        Serial.print(F("LOG: Reset anormal (motivo "));
+        Serial.print((int)reason);
+        Serial.print(F("). Ultimos eventos antes da queda: "));
+        Serial.println(eventLogStats.postMortemEvents);
+        char line[EVENT_LINE_LEN];
+        EventRecord rec;
+        for (uint32_t seq = postMortemFirstSeq + 1; seq <= postMortemEndSeq; seq++) {
+            if (readEventRecord(seq, rec) != EVENT_READ_OK) continue;
+            formatEventLine(rec, line, sizeof(line));
+            Serial.print(line);
+        }
+    }
+
+    logEventf(crash ? LOG_LEVEL_ERROR : LOG_LEVEL_INFO, LOG_SRC_SYSTEM,
+              "Boot %lu (reset %d)", (unsigned long)eventRing.bootCount, (int)reason);
+}
+
+
+// 4. --- ESVAZIAMENTO (tarefa de rede: dona do Blynk e do LittleFS) ---
+
+static void drainEventsToSerial() {
+    EventRecord rec;
+    char line[EVENT_LINE_LEN];
+    for (uint8_t i = 0; i < EVENT_DRAIN_SERIAL_PER_RUN; i++) {
+        if (!nextEventRecord(serialCursor, rec, eventLogStats.droppedSerial)) break;
+        if (rec.level < EVENT_LOG_SERIAL_MIN_LEVEL) continue;
+        formatEventLine(rec, line, sizeof(line));
+        Serial.print(F("EVT;"));
+        Serial.print(line);
+    }
+}
+
+static void drainEventsToBlynk() {
+    if (!Blynk.connected()) return; // Offline: o cursor espera (sem descartar)
+    EventRecord rec;
+    char eventCode[16];
+    for (uint8_t i = 0; i < EVENT_DRAIN_BLYNK_PER_RUN; i++) {
+        if (!nextEventRecord(blynkCursor, rec, eventLogStats.droppedBlynk)) break;
+        if (rec.level < EVENT_LOG_BLYNK_MIN_LEVEL) continue;
+        snprintf(eventCode, sizeof(eventCode), "log_%s", LOG_LEVEL_NAMES[rec.level % LOG_LEVEL_COUNT]);
+        Blynk.logEvent(eventCode, rec.text);
+        eventLogStats.sentBlynk++;
+    }
+}
+
+// Gira o arquivo quando passa do limite (uma geração antiga: /events.1.log)
+static void rotateEventFileIfNeeded() {
+    File file = LittleFS.open(EVENT_LOG_PATH, "r");
+    if (!file) return;
+    size_t size = file.size();
+    file.close();
+    if (size < EVENT_LOG_FILE_MAX_BYTES) return;
+    LittleFS.remove(EVENT_LOG_OLD_PATH);
+    LittleFS.rename(EVENT_LOG_PATH, EVENT_LOG_OLD_PATH);
+}
+
+// Grava em lote (um open/close por rodada) só os níveis >= EVENT_LOG_FLASH_MIN_LEVEL
+static void drainEventsToFlash() {
+    char line[EVENT_LINE_LEN];
+    EventRecord rec;
+
+    // Trilha pós-morte do boot anterior: uma vez, em arquivo próprio
+    if (postMortemEndSeq > postMortemFirstSeq) {
+        File crashFile = LittleFS.open(EVENT_CRASH_PATH, "w");
+        if (crashFile) {
+            for (uint32_t seq = postMortemFirstSeq + 1; seq <= postMortemEndSeq; seq++) {
+                if (readEventRecord(seq, rec) != EVENT_READ_OK) continue; // Já sobrescrito
+                int n = formatEventLine(rec, line, sizeof(line));
+                crashFile.write((const uint8_t*)line, n < (int)sizeof(line) ? n : sizeof(line) - 1);
+            }
+            crashFile.close();
+            Serial.println(F("LOG: Trilha pos-morte gravada em " EVENT_CRASH_PATH));
+        }
+        postMortemFirstSeq = postMortemEndSeq = 0;
+    }
+
+    if (halMillis() - lastFlashDrainMs < EVENT_DRAIN_FLASH_PERIOD_MS) return;
+    lastFlashDrainMs = halMillis();
+    if (flashCursor == __atomic_load_n(&eventRing.head, __ATOMIC_ACQUIRE)) return;
+
+    rotateEventFileIfNeeded();
+    File file;
+    uint16_t written = 0;
+    while (nextEventRecord(flashCursor, rec, eventLogStats.droppedFlash)) {
+        if (rec.level < EVENT_LOG_FLASH_MIN_LEVEL) continue;
+        if (!file) {
+            file = LittleFS.open(EVENT_LOG_PATH, "a");
+            if (!file) {
+                eventLogStats.flashErrors++;
+                return;
+            }
+        }
+        int n = formatEventLine(rec, line, sizeof(line));
+        file.write((const uint8_t*)line, n < (int)sizeof(line) ? n : sizeof(line) - 1);
+        written++;
+    }
+    if (file) {
+        file.close();
+        eventLogStats.flashWrites++;
+        eventLogStats.flashLines += written;
+    }
+}
+
+// Tarefa de rede "eventos"
+void runEventLogDrain() {
+    PROFILE_SCOPE(PROF_EVENT_DRAIN);
+    drainEventsToSerial();
+    drainEventsToBlynk();
+    drainEventsToFlash();
+
+    if (halMillis() - lastStatsReportMs >= LOOP_STATS_REPORT_MS) {
+        lastStatsReportMs = halMillis();
+        reportEventLogStats();
+    }
+}
+
+void reportEventLogStats() {
+    Serial.print(F("LOG: gravados "));
+    Serial.print(eventLogStats.written);
+    Serial.print(F(", Blynk "));
+    Serial.print(eventLogStats.sentBlynk);
+    Serial.print(F(", perdidos serial/blynk/flash "));
+    Serial.print(eventLogStats.droppedSerial);
+    Serial.print(F("/"));
+    Serial.print(eventLogStats.droppedBlynk);
+    Serial.print(F("/"));
+    Serial.print(eventLogStats.droppedFlash);
+    Serial.print(F(", boot "));
+    Serial.println(eventRing.bootCount);
+}
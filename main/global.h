@@ -21,6 +21,21 @@
 
 
 == Version History ==
+15/10/2026 - 0.17 - soc/gpio_struct.h for the button ISR re-arm
+15/10/2026 - 0.16 - tempProbeRoms map; PersistentConfig schema 9
+15/10/2026 - 0.15 - State sync setting/version types; PersistentConfig schema 8
+15/10/2026 - 0.14 - Button edge/stats types (Button2 removed); power stats types
+15/10/2026 - 0.13 - Profiler probe/stat types and PROFILE_SCOPE; NUM_OLED_PAGES = 5
+15/10/2026 - 0.12 - Event log level/source/record/ring types and LOG_* macros; NetMessage without category
+15/10/2026 - 0.11 - TPA plan stage/resource/status types, TpaPlanState; reposition ABORTED state; config schema 5
+15/10/2026 - 0.10 - History store record/summary types
+15/10/2026 - 0.09 - Telemetry policy/slot/sample/stats types
+15/10/2026 - 0.08 - DisplayStats
+15/10/2026 - 0.07 - PhCalibration model and calibration state
+15/10/2026 - 0.06 - Added scheduler groups, FreeRTOS task handles and SPSC message types
+                    Removed Ticker (replaced by scheduler tasks)
+15/10/2026 - 0.05 - Added DS18B20 probe table and acquisition states
+15/10/2026 - 0.04 - Added extraction FSM state (M5.1) and cooperative scheduler structures
 02/11/2025 - 0.03 - Added TPA management flags and variables
 01/11/2025 - 0.02 - Moved all libraries from other files to this one. Added all flag
                     varables from module 2 (pH)
@@ -40,6 +55,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -52,7 +82,6 @@ tpa_reposition    - Control return of water volume
 #include <DallasTemperature.h>    // Usada em sensors.ino
 //#include <DS3232RTC>              // RTC DS3232 Lib from Jack Christensen
 #include <RTClib.h>               // Utilizada para comunicação com módulo RTC. Principalmente utilizada em rtc_time.ino
-#include <Ticker.h>               // Utilizada para efetuar o schedule de funções de coletas de dados. Utilizada em main.ino
 #include <time.h>                 // Adicione esta biblioteca para o NTP. Utilizada em rtc_time.ino
 #include <TimeLib.h>              // Para declarar as funções hour(), minute() e second()
 #include <Arduino.h>              // Used on ph_sensor.ino
@@ -60,11 +89,19 @@ tpa_reposition    - Control return of water volume
 #include <LittleFS.h>             // Para gerenciamento do sistema de arquivos
 #include <Adafruit_GFX.h>         // Para uso de OLED Display (em main.ino)
 #include <Adafruit_SSD1306.h>     // Para uso de OLED Display (em main.ino)
-#include <Button2.h>              // Para lidar com botões
+#include <driver/gpio.h>          // Despertar do sono leve pelos botões (power_manager.ino)
+#include <soc/gpio_struct.h>      // Tipo de interrupção por pino trocado na ISR dos botões (hardware_manager.ino)
+#include <esp_pm.h>               // Gerência de energia: DFS e sono leve automático (power_manager.ino)
+#include <esp_sleep.h>
+#include <driver/adc.h>           // Leitura direta do ADC1 (ph_sensor.ino)
+#include <esp_adc_cal.h>          // Curva de calibração do ADC gravada no eFuse (ph_sensor.ino)
+#include <esp_timer.h>            // Base de tempo em us do serviço de relógio (rtc_time.ino)
+#include <rom/crc.h>              // crc32_le() da ROM (config_manager.ino)
+#include "spsc_queue.h"           // Fila SPSC sem lock entre tarefas FreeRTOS (rtos_tasks.ino)
+#include "hal.h"                  // Tempo e GPIO abstraídos (relógio virtual na simulação nativa)
 
 // --- DECLARAÇÕES DE OBJETOS/INSTÂNCIAS GLOBAIS ---
 // Elas SÃO DEFINIDAS (alocadas) APENAS em main.ino
-extern Ticker sensorDataTicker; 
 extern OneWire oneWire;
 extern DallasTemperature sensors;
 extern RTC_DS3231 rtc;
@@ -74,16 +111,55 @@ extern RTC_DS3231 rtc;
 extern bool rtc_ok;            // Usada para definir o estado do RTC
 extern bool rtc_osf_flag;      // Estado do Oscillator Stop Flag, usado para controlar bateria do RTC
 extern bool rtcOsfAlertSent;   // Flag para garantir que o alerta de OSF seja enviado apenas uma vez
-extern bool highTempAlertSent; // Usada para defnir o volume de alertas no Blynk
-extern bool phAlertSent;       // Flag para controle de envio de alerta de pH
 extern bool configIsDirty;     // Flag para definir que configurações devem ser salvas em SPIFFS/LittleFS
 
 // --- VARIÁVEIS DE ESTADO E CALIBRAÇÃO (Módulo 2: pH) ---
 extern float phValue;             // Último valor lido do pH
 extern float phCalibrationOffset; // Offset para ajuste de calibração (ex: -1.5)
 extern bool phCalibrationMode;    // Flag para indicar que o sistema está em modo de calibração
+
+// Modelo de conversão: pH = 7.0 + (neutralMv - mV) / inclinação (+ phCalibrationOffset)
+struct PhCalibration {
+    float neutralMv;          // Tensão no pino em pH 7.0
+    float acidSlopeMv;        // mV por unidade de pH abaixo de 7.0
+    float baseSlopeMv;        // mV por unidade de pH acima de 7.0
+    uint8_t points;           // Pontos usados na próxima calibração (1, 2 ou 3)
+};
+enum PhCalState {
+    PH_CAL_IDLE,              // Sem calibração em andamento
+    PH_CAL_STABILIZING,       // Aguardando a leitura estabilizar no tampão atual
+    PH_CAL_WAIT_NEXT_BUFFER   // Aguardando o usuário trocar de tampão e confirmar
+};
+extern PhCalibration phCal;
+extern PhCalState phCalCurrentState;
+extern float phFilteredMv;        // Saída do filtro mediana + IIR (mV no pino)
+extern bool phFilterPrimed;       // true depois da primeira saída do filtro
 extern float temperatureC;        // Utilizada em sensors.ino
 
+// --- Sondas de Temperatura DS18B20 (Módulo 1: sensors.ino) ---
+enum TempProbeRole {
+    TEMP_PROBE_DISPLAY = 0,  // Aquário principal (exibida no OLED e em VPIN_TEMP)
+    TEMP_PROBE_SUMP = 1,     // Sump
+    TEMP_PROBE_RAN = 2       // Reservatório de água nova
+};
+enum TempAcqState {
+    TEMP_ACQ_IDLE,           // Aguardando o próximo disparo de conversão
+    TEMP_ACQ_CONVERTING,     // Conversão em andamento em todas as sondas
+    TEMP_ACQ_COLLECTING      // Lendo os resultados, uma sonda por chamada
+};
+struct TempProbe {
+    DeviceAddress address;      // Endereço ROM guardado no setup (evita busca no barramento)
+    bool present;               // Sonda encontrada no boot
+    uint8_t resolution;         // Resolução configurada (9-12 bits)
+    float lastTempC;            // Última amostra válida
+    unsigned long sampleTimeMs; // millis() do disparo da conversão da última amostra
+    bool sampleValid;           // false se a última leitura falhou
+    unsigned long errorCount;   // Leituras com falha desde o boot
+};
+extern TempProbe tempProbes[MAX_TEMP_PROBES];
+extern DeviceAddress tempProbeRoms[MAX_TEMP_PROBES]; // ROM -> papel persistido (zeros = papel livre)
+extern int tempProbeCount;
+
 // --- Variáveis de Configuracao TPA (Módulo 5.1: TPA) ---
 extern float aquariumTotalVolume;   // Volume total do aquario em Litros
 extern float tpaExtractionPercent;  // Percentual de agua a ser extraida (%)
@@ -96,13 +172,6 @@ extern unsigned long tpaExtractionStartTime; // millis() que marca o inicio da e
 
 // --- VARIÁVEIS DE USO COM BOTÕES FÍSICOS ---
 extern bool serviceModeActive; // Estado do modo de manutencao
-extern Button2 oledPageButton;
-extern Button2 upButton;
-extern Button2 downButton;
-extern Button2 phCalButton;
-extern Button2 alertResetButton;
-extern Button2 serviceModeButton;
-extern Button2 rtcResetButton;
 
 // --- MÓDULO 5: Agendamento Local (Fallback) ---
 extern bool tpaLocalScheduleActive;     // Ativa o agendamento local (fallback)
@@ -110,13 +179,22 @@ extern int tpaScheduleDay;              // Dia da semana (1=Dom, 7=Sab ou dia do
 extern int tpaScheduleHour;             // Hora da execucao (0-23)
 extern int tpaScheduleMinute;           // Minuto da execucao (0-59)
 extern int tpaScheduleFrequency;        // 0=Diaria, 1=Semanal, 2=Quinzenal, 3=Mensal
-extern unsigned long lastTpaExecution;  // millis() ou RTC time da ultima execucao local
 
 // --- Variáveis de Gerenciamento de Display (Para hardware_manager e display_manager) ---
-#define NUM_OLED_PAGES 4  // Total de paginas implementadas no OLED (0, 1, 2, 3...)
+#define NUM_OLED_PAGES 5  // Total de paginas implementadas no OLED (0, 1, 2, 3, 4 = diagnóstico)
 extern int currentPage;   // Rastreia a pagina atual exibida no OLED (usada pelo hardware_manager para trocar)
 extern int page1EditMode; // Rastreia qual item da Página 1 (TPA Agendamento) esta sendo editado (0=Dia, 1=Hora, 2=Minuto, 3=Freq, 4=Salvar)
 extern int page2EditMode; // Rastreia o modo de edicao da Pagina 2 (0=Visualizar, 1=Editar Volume)
+// Estatísticas do renderizador incremental do OLED (display_manager.ino)
+struct DisplayStats {
+    unsigned long frames;          // Quadros efetivamente desenhados/enviados
+    unsigned long skippedFrames;   // Atualizações ignoradas (nenhum valor exibido mudou)
+    unsigned long lastFrameUs;     // Render + envio I2C do último quadro
+    unsigned long maxFrameUs;      // Pior quadro desde o boot
+    unsigned long lastFrameBytes;  // Bytes I2C do último quadro
+    unsigned long totalBytes;      // Bytes I2C desde o boot
+};
+extern DisplayStats displayStats;
 extern int page3EditMode; // Rastreia o modo de edicao da Pagina 3 (Buffer)
 
 //Variáveis para uso de reposição de TPA (tpa_reposition)
@@ -130,13 +208,92 @@ enum TpaMasterState {
     TPA_MASTER_COMPLETED                 // Ciclo TPA completo
 };
 extern TpaMasterState tpaMasterCurrentState;
+struct TpaCycleStats {            // Tempo fim-a-fim do ciclo (medido por halMillis: real ou virtual)
+    unsigned long started;
+    unsigned long completed;
+    unsigned long aborted;
+    unsigned long startMs;        // Início do ciclo em andamento
+    unsigned long lastDurationMs;
+    unsigned long maxDurationMs;
+};
+extern TpaCycleStats tpaCycleStats;
+
+// --- Plano TPA (tpa_plan.ino) ---
+// Estágios do ciclo como grafo: cada um tem dependências (estágios que precisam terminar antes)
+// e recursos físicos que ocupa. O executor inicia em paralelo tudo que estiver pronto e livre.
+enum TpaStage {
+    TPA_STAGE_TOPUP = 0,          // Completa o RAN antes da reposição (pulado se a boia já indica cheio)
+    TPA_STAGE_EXTRACT = 1,        // M5.1 Aquário -> descarte
+    TPA_STAGE_REPOSITION = 2,     // M5.2 RAN -> Aquário
+    TPA_STAGE_REFILL = 3,         // M5.3 Osmose -> RAN (repõe o que a reposição consumiu)
+    TPA_STAGE_BUFFER = 4,         // M5.4 Buffer -> RAN (na água nova)
+    TPA_STAGE_COUNT = 5
+};
+#define TPA_STAGE_BIT(stage)   (1U << (stage))
+#define TPA_STAGES_FULL_CYCLE  0x1F
+enum TpaResource {                // Máscara: dois estágios com o mesmo bit nunca rodam juntos
+    TPA_RES_TANK_OUT = 0x01,      // Bomba de extração
+    TPA_RES_TANK_IN = 0x02,       // Bomba de reposição
+    TPA_RES_RAN = 0x04,           // Conteúdo do RAN: não se dilui a água que está indo para o aquário
+    TPA_RES_BUFFER = 0x08         // Bomba de buffer
+};
+enum TpaStageStatus {
+    TPA_STAGE_PENDING,
+    TPA_STAGE_RUNNING,
+    TPA_STAGE_DONE,
+    TPA_STAGE_SKIPPED             // Fora da máscara do plano (fluxos parciais)
+};
+enum TpaPlanMode {
+    TPA_PLAN_SEQUENTIAL = 0,      // Extração inteira, pausa, reposição inteira (comportamento original)
+    TPA_PLAN_SPLIT_BATCH = 1,     // Extração e reposição em lotes sobrepostos (nível do aquário estável)
+    TPA_PLAN_MODE_COUNT = 2
+};
+struct TpaStageDef {
+    uint8_t dependsOn;            // TPA_STAGE_BIT() dos estágios que precisam terminar antes
+    uint8_t streamsFrom;          // Estágio produtor: pode começar antes dele, limitado ao que ele já entregou
+    uint8_t resources;            // TpaResource
+    const char* name;
+};
+struct TpaPlanState {
+    bool active;
+    uint8_t mode;                 // TpaPlanMode em uso neste ciclo
+    uint8_t stageMask;            // Estágios incluídos (TPA_STAGES_FULL_CYCLE ou fluxos parciais)
+    uint8_t status[TPA_STAGE_COUNT];
+    unsigned long stageStartMs[TPA_STAGE_COUNT];
+    unsigned long stageEndMs[TPA_STAGE_COUNT];
+    float extractTargetL;
+    float repositionTargetL;
+    float batchL;                 // Lote de extração (no sequencial = volume todo)
+    float extractedL;             // Lotes concluídos (volume integrado pelo motor de dosagem)
+    float repositionedL;
+    float repositionChunkL;       // Lote de reposição em andamento
+    bool extractBatchRunning;
+    bool repositionChunkRunning;
+    uint16_t repositionChunks;    // Lotes de reposição iniciados no ciclo
+    uint16_t repositionChunkLimit;
+    float repositionPumpedL;      // Estimativa do motor de dosagem somada (teto de água bombeada)
+    float maxLevelDeficitL;       // Maior diferença extraído - reposto observada no ciclo
+};
+extern TpaPlanState tpaPlan;
+extern uint8_t tpaPlanMode;       // Persistido (esquema 5)
+extern float tpaMaxLevelDeltaL;   // Desnível máximo do aquário no modo em lotes (L), persistido
+
+// --- Módulo 5.1 (actuators_manager.ino: Extração) ---
+enum ExtractionState {
+    TPA_EXTRACTION_IDLE,                 // Extração inativa
+    TPA_EXTRACTION_PUMPING,              // Bomba de extração ligada, aguardando o tempo calculado
+    TPA_EXTRACTION_FINISHED,             // Volume extraído, pronto para a Reposição (M5.2)
+    TPA_EXTRACTION_ABORTED               // Interrompida (ex: Modo de Serviço ativado durante a extração)
+};
+extern ExtractionState tpaExtractionCurrentState;
 
 // --- Módulo 5.2 (tpa_reposition.ino) ---
 enum RepositionState {
     TPA_REPOSITION_IDLE,
     TPA_REPOSITION_WAIT_SAFETY_PAUSE,
     TPA_REPOSITION_TRANSFER_RAN_TO_AQUARIO,
-    TPA_REPOSITION_FINISHED
+    TPA_REPOSITION_FINISHED,
+    TPA_REPOSITION_ABORTED             // Bomba não pôde iniciar, RAN vazio ou lote sem o RAN baixar
 };
 extern RepositionState tpaRepositionCurrentState;
 
@@ -155,6 +312,33 @@ extern int ranLevelPercent;       // Nível do RAN em percentual (0-100)
 extern bool ranRefillAlertSent;   // Flag para garantir que o alerta de falha de enchimento seja enviado apenas uma vez
 extern unsigned long ranRefillStartTime; // Captura o início do procedimento de enchimento do RAN
 
+// --- Nível contínuo do RAN (ran_level.ino) ---
+struct RanGeometryPoint {         // Altura da água -> volume (interpolação linear entre pontos)
+    float heightMm;
+    float liters;
+};
+struct RanLevelCalibration {      // POD persistido no config
+    float emptyReading;           // Leitura filtrada com o RAN vazio (mV no analógico, mm de eco no ultrassônico)
+    float fullReading;            // Leitura filtrada com a água em fullHeightMm
+    float fullHeightMm;
+    float targetLiters;           // Volume de "cheio" do enchimento (a boia continua como limite físico)
+    uint8_t geometryPoints;       // Pontos válidos em geometry[] (crescentes em altura)
+    RanGeometryPoint geometry[RAN_GEOMETRY_MAX_POINTS];
+};
+struct RanLevelState {            // Só em RAM (escrito pela tarefa de controle)
+    bool measured;                // Sensor contínuo presente e com leitura plausível
+    float reading;                // Saída do filtro (unidade do sensor)
+    float heightMm;
+    float liters;
+    float fillRateLpm;            // Vazão líquida no RAN (+ enchendo, - esvaziando)
+    bool rateValid;               // Já há RAN_LEVEL_RATE_WINDOW_S de histórico
+    uint32_t samples;
+    uint32_t rejected;            // Leituras fora da faixa (eco perdido, ADC saturado)
+    uint32_t leakEvents;          // Subidas com a válvula fechada (válvula travada aberta)
+};
+extern RanLevelCalibration ranLevelCal;
+extern RanLevelState ranLevel;
+
 // --- Variáveis de Monitoramento do reposição ---
 extern unsigned long repositionPreviousMillis;
 extern unsigned long repositionIntervalMs; // Tempo de espera/execução atual (em ms)
@@ -174,6 +358,600 @@ enum BufferDosingState {
     TPA_BUFFER_FINISHED                  // Dosagem concluída
 };
 extern BufferDosingState tpaBufferCurrentState; // **NOVO** Estado atual do M5.4
+
+// --- Escalonador Cooperativo (task_scheduler.ino) ---
+// Cada grupo é executado por uma tarefa FreeRTOS própria (ver rtos_tasks.ino)
+enum SchedulerGroup {
+    SCHED_GROUP_CONTROL = 0,   // Aquisição e FSMs de controle (núcleo 1, maior prioridade)
+    SCHED_GROUP_NETWORK = 1,   // Blynk, NTP e persistência (núcleo 0)
+    SCHED_GROUP_UI = 2,        // Display e botões (baixa prioridade)
+    SCHED_GROUP_COUNT
+};
+typedef void (*SchedulerTaskFn)();
+struct SchedulerTask {
+    const char* name;          // Nome curto para relatórios
+    uint8_t group;             // SchedulerGroup que executa a tarefa
+    SchedulerTaskFn fn;        // Função executada (não pode bloquear)
+    unsigned long periodMs;    // Intervalo mínimo entre execuções (0 = toda iteração)
+    bool critical;             // true = nunca é adiada pelo orçamento do loop
+    unsigned long lastRunMs;   // millis() da última execução
+    unsigned long runCount;    // Número de execuções
+    unsigned long deferCount;  // Número de vezes que foi adiada por falta de orçamento
+    unsigned long maxRunUs;    // Pior tempo de execução medido (us)
+};
+
+// Estatísticas de duração de cada iteração do loop() (janela de LOOP_STATS_REPORT_MS)
+struct LoopStats {
+    unsigned long windowStartMs;               // Início da janela atual
+    unsigned long iterations;                  // Iterações na janela
+    unsigned long windowMaxUs;                 // Pior iteração na janela
+    unsigned long lifetimeMaxUs;               // Pior iteração desde o boot
+    unsigned long overruns;                    // Iterações acima do orçamento na janela
+    unsigned long deferredRuns;                // Execuções adiadas na janela
+    unsigned long lastOverrunUs;               // Duração do último estouro
+    const char* lastOverrunTask;               // Tarefa mais lenta na iteração do último estouro
+    unsigned long histogram[LOOP_HIST_BUCKETS]; // Distribuição das durações (ver LOOP_HIST_BOUNDS_US)
+};
+extern SchedulerTask schedulerTasks[MAX_SCHEDULER_TASKS];
+extern int schedulerTaskCount;
+extern LoopStats loopStats[SCHED_GROUP_COUNT];
+extern const char* schedulerGroupNames[SCHED_GROUP_COUNT];
+extern unsigned long loopBudgetUs; // Orçamento por iteração do loop() em us (persistido em config)
+
+// --- Tarefas FreeRTOS e filas SPSC (rtos_tasks.ino) ---
+// Comandos que alteram atuadores são sempre aplicados pela tarefa de controle
+enum ControlCommandType {
+    CMD_START_TPA,             // arg = TpaCycleSource
+    CMD_SET_SERVICE_MODE,      // arg = 0/1
+    CMD_PH_CALIBRATE,          // Inicia/avança/cancela a calibração de pH
+    CMD_PUMP_CALIBRATE,        // arg = DosingPump: corrida de calibração guiada
+    CMD_PUMP_CAL_RESULT,       // arg = volume medido em décimos de mL
+    CMD_RESET_ALERTS,          // Reconhece os alertas ativos (botão físico ou Blynk)
+    CMD_RESET_SENSOR_DATA,     // Descarta as leituras de temperatura/pH atuais (botão ALERT_RESET longo)
+    CMD_RESET_RTC_OSF,         // Limpa o alerta de perda de energia do RTC (botão RTC_RESET)
+    CMD_SET_SETTING,           // arg = SyncSettingId | (SyncSource << 8), value = novo valor
+    CMD_APPLY_SETTING_EFFECTS  // arg = efeitos acumulados (SYNC_EFFECT_*) de um lote de CMD_SET_SETTING
+};
+enum TpaCycleSource {
+    TPA_SOURCE_BLYNK_MANUAL,
+    TPA_SOURCE_BLYNK_SCHEDULE,
+    TPA_SOURCE_LOCAL_SCHEDULE
+};
+struct ControlCommand {
+    uint8_t type;              // ControlCommandType
+    int32_t arg;
+    float value;               // CMD_SET_SETTING
+};
+
+// Mensagens para a tarefa de rede (única que fala com o Blynk)
+enum NetMessageType {
+    NET_MSG_PIN_INT,           // Blynk.virtualWrite(pin, int)
+    NET_MSG_PIN_FLOAT,         // Blynk.virtualWrite(pin, float)
+    NET_MSG_PIN_TEXT           // Blynk.virtualWrite(pin, texto)
+};
+struct NetMessage {
+    uint8_t type;              // NetMessageType
+    uint8_t vpin;              // Pino virtual (mensagens de pino)
+    int32_t intValue;
+    float floatValue;
+    char text[NET_MSG_TEXT_LEN];
+};
+
+// Fotografia do estado de processo publicada pelo controle para a UI
+struct ControlSnapshot {
+    unsigned long timestampMs;
+    float temperatureC;
+    float phValue;
+    uint8_t tpaMasterState;    // TpaMasterState
+    float extractedVolumeL;    // Volume extraído até agora (M5.1)
+    bool serviceMode;
+    int ranLevelPercent;
+    bool ranLevelFull;
+    float ranLevelLiters;      // NAN sem sensor contínuo
+    uint8_t tpaScheduleDay;    // Agenda local (Página 1 e botões UP/DOWN)
+    uint8_t tpaScheduleHour;
+    uint8_t tpaScheduleMinute;
+    uint8_t tpaScheduleFrequency;
+};
+
+extern TaskHandle_t controlTaskHandle;
+extern TaskHandle_t networkTaskHandle;
+extern TaskHandle_t uiTaskHandle;
+extern SpscQueue<ControlCommand, CMD_QUEUE_SIZE> netToControlQueue;
+extern SpscQueue<ControlCommand, CMD_QUEUE_SIZE> uiToControlQueue;
+extern SpscQueue<NetMessage, NET_QUEUE_SIZE> controlToNetQueue;
+extern SpscQueue<NetMessage, NET_QUEUE_SIZE> uiToNetQueue;
+extern SpscLatest<ControlSnapshot> controlToUiSnapshot;
+// --- Publicador de Telemetria (telemetry.ino) ---
+struct TelemetryPolicy {
+    uint8_t vpin;
+    float deadband;               // Variação mínima para publicar (TELEMETRY_NO_DEDUP = sempre)
+    unsigned long minIntervalMs;  // Intervalo mínimo entre envios do pino (coalescência)
+    unsigned long maxIntervalMs;  // Reenvio do último valor mesmo sem mudança (0 = nunca)
+    bool backfill;                // Offline: guarda amostras com hora para reenviar depois
+};
+struct TelemetrySlot {
+    uint8_t vpin;
+    uint8_t type;                 // NetMessageType do último pedido
+    bool pending;                 // Há um valor pedido ainda não avaliado/enviado
+    bool hasSent;
+    int32_t intValue;             // Último valor pedido
+    float floatValue;
+    char text[NET_MSG_TEXT_LEN];
+    float lastSentValue;          // Último valor numérico enviado
+    uint32_t lastSentHash;        // Hash do último texto enviado
+    unsigned long lastSentMs;
+    const TelemetryPolicy* policy;
+};
+struct TelemetrySample {          // 12 bytes por amostra no buffer offline
+    uint32_t epoch;               // Hora do RTC (Unix) em que o valor foi produzido
+    uint8_t vpin;
+    uint8_t type;
+    float value;
+};
+struct TelemetryStats {
+    unsigned long submitted;      // Pedidos recebidos dos módulos
+    unsigned long sent;           // Escritas ao vivo no Blynk
+    unsigned long suppressed;     // Descartados pela zona morta
+    unsigned long coalesced;      // Substituídos por um valor mais novo antes do envio
+    unsigned long backfilled;     // Amostras de histórico reenviadas após reconexão
+    unsigned long backfillDropped; // Amostras perdidas (buffer cheio ou sem hora válida)
+    unsigned long overflow;       // Pinos além de TELEMETRY_MAX_PINS (enviados sem política)
+};
+extern TelemetryStats telemetryStats;
+
+// --- Histórico Local em Flash (history_store.ino) ---
+enum HistoryChannel {
+    HISTORY_CH_TEMPERATURE = 0,   // 0.01 °C
+    HISTORY_CH_PH = 1,            // 0.001 pH
+    HISTORY_CH_RAN_LEVEL = 2,     // 1 %
+    HISTORY_VALUE_CHANNELS = 3,   // Canais com mín/máx/média
+    HISTORY_CH_TPA_EVENT = 3      // Marcos do ciclo TPA (HistoryEvent)
+};
+enum HistoryRecordKind {
+    HISTORY_REC_ABSOLUTE = 0,     // Valor absoluto (primeiro do canal no segmento)
+    HISTORY_REC_DELTA = 1,        // Diferença para o valor anterior do mesmo canal
+    HISTORY_REC_EVENT = 2         // Código de evento (sem delta)
+};
+enum HistoryEvent {
+    HISTORY_EVT_TPA_STARTED = 1,
+    HISTORY_EVT_EXTRACTION_DONE = 2,
+    HISTORY_EVT_REPOSITION_DONE = 3,
+    HISTORY_EVT_TPA_COMPLETED = 4,
+    HISTORY_EVT_TPA_ABORTED = 5
+};
+struct __attribute__((packed)) HistoryRecord { // 6 bytes em flash
+    uint16_t dtSec;               // Segundos desde o registro anterior do segmento
+    uint8_t channel;              // HistoryChannel
+    uint8_t kind;                 // HistoryRecordKind
+    int16_t value;                // Delta ou valor absoluto quantizado
+};
+struct HistorySample {            // Amostra absoluta (fila do controle e resultado da decodificação)
+    uint32_t epoch;
+    uint8_t channel;
+    uint8_t kind;
+    int16_t value;
+};
+struct HistorySegmentHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;                 // Sequência crescente (slot = seq % HISTORY_SEGMENT_COUNT)
+    uint32_t baseEpoch;           // Época do início do segmento
+};
+struct HistoryIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+struct HistoryChannelSummary {
+    int16_t min;
+    int16_t max;
+    int32_t sum;
+    uint32_t count;
+};
+struct HistorySegmentSummary {
+    uint32_t seq;                 // 0 = slot vazio
+    uint32_t firstEpoch;
+    uint32_t lastEpoch;
+    uint32_t records;
+    uint32_t events;
+    HistoryChannelSummary channels[HISTORY_VALUE_CHANNELS];
+};
+struct HistoryDecoder {           // Estado do delta (codificação e decodificação)
+    uint32_t epoch;
+    int16_t lastValue[HISTORY_VALUE_CHANNELS];
+    bool hasValue[HISTORY_VALUE_CHANNELS];
+};
+struct HistoryRangeResult {
+    float min;
+    float max;
+    float mean;
+    uint32_t count;
+    int16_t minRaw;
+    int16_t maxRaw;
+    int64_t sumRaw;
+};
+extern SpscQueue<HistorySample, HISTORY_QUEUE_SIZE> controlToHistoryQueue;
+
+// --- Motor de Dosagem (dosing_engine.ino) ---
+enum DosingPump {
+    PUMP_EXTRACTION = 0,          // Aquário -> descarte (M5.1)
+    PUMP_REPOSITION = 1,          // RAN -> aquário (M5.2)
+    PUMP_BUFFER = 2,              // Buffer -> RAN (M5.4)
+    PUMP_COUNT = 3
+};
+struct PumpCalibration {          // Persistido em PersistentConfig (POD)
+    float flowMlPerSec;           // Vazão medida na última calibração (potência máxima)
+    uint16_t rampMs;              // Soft-start PWM (0 = saída digital/relé)
+    uint16_t reserved;
+    float driftPctPer100h;        // Perda de vazão por 100 h de uso (aprendida)
+    float runtimeSinceCalSec;     // Uso acumulado desde a calibração
+};
+struct PumpDose {
+    bool active;
+    bool calibrating;             // Corrida de calibração (termina por tempo, não por volume)
+    uint16_t duty;                // Potência atual (0..PUMP_PWM_MAX_DUTY)
+    float targetMl;
+    float deliveredMl;            // Volume integrado até agora
+    float fullOnSec;              // Tempo equivalente a potência máxima
+    unsigned long startUs;
+    unsigned long lastUs;
+};
+extern PumpCalibration pumpCal[PUMP_COUNT];
+extern PumpDose pumpDoses[PUMP_COUNT];
+
+// --- Serviço de Relógio (rtc_time.ino) ---
+enum ClockSource {
+    CLOCK_SRC_NONE = 0,           // Só a data de compilação + tempo ligado (hora NÃO confiável)
+    CLOCK_SRC_RTC = 1,            // DS3231 (realinhado pelo SQW de 1 Hz)
+    CLOCK_SRC_NTP = 2             // NTP/Blynk sem RTC funcional (extrapolado pelo esp_timer)
+};
+struct ClockStats {
+    unsigned long sqwEdges;       // Bordas do SQW recebidas
+    unsigned long rtcReads;       // Leituras I2C do RTC (boot + releituras sem SQW)
+    unsigned long ntpSyncs;
+    unsigned long sqwLost;        // Vezes que o SQW parou
+};
+extern ClockSource clockSource;
+extern float clockDriftPpm;
+extern uint32_t clockLastNtpEpoch;
+extern ClockStats clockStats;
+
+// --- Agendador Local (tpa_scheduler.ino) ---
+enum ScheduleJobKind {
+    SCHED_JOB_TPA = 0,            // Ciclo TPA completo (usa tpaLocalScheduleActive/tpaSchedule*)
+    SCHED_JOB_BUFFER_DOSE = 1,    // Só a dosagem de buffer no RAN (M5.4)
+    SCHED_JOB_RAN_TOPUP = 2,      // Só completar o RAN até a boia (M5.3)
+    SCHED_JOB_COUNT = 3
+};
+enum ScheduleFrequency {
+    SCHED_FREQ_DAILY = 0,
+    SCHED_FREQ_WEEKLY = 1,        // day: 1 = Dom ... 7 = Sab
+    SCHED_FREQ_BIWEEKLY = 2,      // Semanal, no mínimo 13 dias após a última execução
+    SCHED_FREQ_MONTHLY = 3        // day: dia do mês (1-31, limitado ao último dia)
+};
+enum ScheduleMissedPolicy {
+    SCHED_MISSED_SKIP = 0,        // Disparo perdido (equipamento desligado) é descartado
+    SCHED_MISSED_RUN_ONCE = 1     // Executa uma vez no boot, se dentro de SCHEDULE_CATCHUP_WINDOW_S
+};
+struct ScheduleJobConfig {        // Persistido em PersistentConfig (POD)
+    bool enabled;
+    uint8_t frequency;            // ScheduleFrequency
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t missedPolicy;         // ScheduleMissedPolicy
+    uint8_t reserved[2];
+    uint32_t lastRunEpoch;        // Epoch do RTC da última execução (0 = nunca)
+};
+struct ScheduleJobState {         // Só em RAM, recalculado a cada mudança
+    uint32_t nextFireEpoch;
+    bool catchUpPending;
+    bool deferLogged;
+};
+extern ScheduleJobConfig scheduleJobs[SCHED_JOB_COUNT];
+extern ScheduleJobState scheduleJobStates[SCHED_JOB_COUNT];
+
+// --- Log de Eventos (event_log.ino) ---
+enum LogLevel {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO = 1,
+    LOG_LEVEL_SUCCESS = 2,
+    LOG_LEVEL_WARNING = 3,
+    LOG_LEVEL_ERROR = 4,
+    LOG_LEVEL_CRITICAL = 5,
+    LOG_LEVEL_COUNT = 6
+};
+enum LogSource {                  // Origem do evento (coluna própria no arquivo/Serial)
+    LOG_SRC_SYSTEM = 0,           // logSystemEvent() genérico
+    LOG_SRC_TPA,
+    LOG_SRC_PH,
+    LOG_SRC_TEMP,
+    LOG_SRC_CLOCK,
+    LOG_SRC_CONFIG,
+    LOG_SRC_PUMP,
+    LOG_SRC_NET,
+    LOG_SRC_ALERT,
+    LOG_SRC_COUNT
+};
+struct EventRecord {              // 64 bytes: cabe EVENT_RING_SIZE deles na RTC lenta
+    uint32_t seq;                 // 0 = em escrita; senão índice + 1 (publica o registro)
+    uint32_t epoch;               // 0 se o relógio ainda não é válido
+    uint32_t uptimeMs;
+    uint8_t level;                // LogLevel
+    uint8_t source;               // LogSource
+    uint8_t bootCount;            // Boot que gravou (8 bits baixos)
+    uint8_t reserved;
+    char text[EVENT_TEXT_LEN];
+};
+struct EventLogRing {             // RTC_NOINIT_ATTR: sobrevive a watchdog/panic, não a power-on
+    uint32_t magic;               // EVENT_RING_MAGIC
+    uint32_t bootCount;
+    uint32_t head;                // Total de registros reservados (fetch_add)
+    uint32_t reserved;
+    EventRecord slots[EVENT_RING_SIZE];
+};
+struct EventLogStats {
+    unsigned long written;
+    unsigned long sentBlynk;
+    unsigned long droppedSerial;  // Sobrescritos antes de chegar ao destino
+    unsigned long droppedBlynk;
+    unsigned long droppedFlash;
+    unsigned long flashWrites;    // Rodadas de gravação (um open/close cada)
+    unsigned long flashLines;
+    unsigned long flashErrors;
+    unsigned long postMortemEvents; // Eventos do boot anterior recuperados após queda
+};
+extern EventLogStats eventLogStats;
+
+// Níveis abaixo de EVENT_LOG_COMPILE_LEVEL somem na compilação (nem a formatação é gerada)
+#define LOG_EVENT(level, source, ...) \
+    do { if ((level) >= EVENT_LOG_COMPILE_LEVEL) logEventf((level), (source), __VA_ARGS__); } while (0)
+#define LOG_DEBUG(source, ...)    LOG_EVENT(LOG_LEVEL_DEBUG, source, __VA_ARGS__)
+#define LOG_INFO(source, ...)     LOG_EVENT(LOG_LEVEL_INFO, source, __VA_ARGS__)
+#define LOG_WARNING(source, ...)  LOG_EVENT(LOG_LEVEL_WARNING, source, __VA_ARGS__)
+#define LOG_ERROR(source, ...)    LOG_EVENT(LOG_LEVEL_ERROR, source, __VA_ARGS__)
+#define LOG_CRITICAL(source, ...) LOG_EVENT(LOG_LEVEL_CRITICAL, source, __VA_ARGS__)
+
+// --- Profiler de Execução (profiler.ino) ---
+enum ProfileProbe {               // Um ponto de entrada medido por sonda (ordem = PROFILE_PROBE_NAMES)
+    PROF_BLYNK_RUN = 0,           // Blynk.run() (rede)
+    PROF_DISPLAY,                 // updateDisplay() (UI)
+    PROF_OLED_FLUSH,              // Envio I2C das páginas sujas (UI)
+    PROF_TEMP_ACQ,                // Conversões OneWire (controle)
+    PROF_PH_ACQ,                  // Aquisição do ADC de pH (controle)
+    PROF_CONFIG_SAVE,             // saveConfig() no LittleFS (rede)
+    PROF_HISTORY_STORE,           // Histórico no LittleFS (rede)
+    PROF_TPA_LOOP,                // runTpaManagerLoop() / plano TPA (controle)
+    PROF_DOSING,                  // Motor de dosagem (controle)
+    PROF_EVENT_DRAIN,             // Anel de eventos -> Serial/Blynk/flash (rede)
+    PROF_TELEMETRY,               // Publicador de telemetria (rede)
+    PROF_RAN_LEVEL,               // Aquisição do nível do RAN (controle)
+    PROF_PROBE_COUNT
+};
+struct ProfileProbeStats {
+    uint32_t calls;
+    uint64_t totalCycles;
+    uint32_t maxCycles;
+    uint32_t lastCycles;
+    uint32_t hist[PROFILE_HIST_BUCKETS]; // Faixa b = [2^(b-1), 2^b) µs
+};
+struct ProfilerSystemStats {
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;         // Marca d'água desde o boot (ou do último "prof reset")
+    uint32_t largestBlock;        // Maior bloco alocável: cai com a fragmentação
+    uint32_t minLargestBlock;
+    uint32_t stackFreeBytes[SCHED_GROUP_COUNT]; // Folga mínima da pilha por tarefa FreeRTOS
+};
+extern ProfileProbeStats profileProbes[PROF_PROBE_COUNT];
+extern ProfilerSystemStats profilerSystem;
+
+void profileRecord(uint8_t probe, uint32_t cycles);
+#if ACC_PROFILER
+// Mede do ponto da declaração até o fim do escopo (inclui todos os return)
+struct ProfileScope {
+    uint8_t probe;
+    uint32_t startCycles;
+    explicit ProfileScope(uint8_t p) : probe(p), startCycles(halCycleCount()) {}
+    ~ProfileScope() { profileRecord(probe, halCycleCount() - startCycles); }
+};
+#define PROFILE_SCOPE(probe) ProfileScope profileScope_(probe)
+#else
+#define PROFILE_SCOPE(probe) do {} while (0)
+#endif
+
+// --- Regras de Alerta (alert_rules.ino) ---
+enum AlertSignal {                // Grandezas que as regras podem observar (ordem = ALERT_SIGNALS)
+    ALERT_SIGNAL_TEMP_TANK = 0,
+    ALERT_SIGNAL_TEMP_SUMP,
+    ALERT_SIGNAL_TEMP_RAN,
+    ALERT_SIGNAL_PH,
+    ALERT_SIGNAL_COUNT,
+    ALERT_SIGNAL_NONE = 0xFF      // Linha da tabela sem uso
+};
+enum AlertKind {
+    ALERT_KIND_HIGH = 0,          // Valor > limite
+    ALERT_KIND_LOW,               // Valor < limite
+    ALERT_KIND_RISE,              // Subiu mais que o limite dentro da janela
+    ALERT_KIND_FALL,              // Caiu mais que o limite dentro da janela
+    ALERT_KIND_COUNT
+};
+enum AlertAction {
+    ALERT_ACTION_NONE = 0,
+    ALERT_ACTION_STOP_TPA         // Cancela o plano TPA e bloqueia novos ciclos enquanto ativo
+};
+enum AlertState {
+    ALERT_STATE_IDLE = 0,
+    ALERT_STATE_PENDING,          // Violando, aguardando dwellS
+    ALERT_STATE_ACTIVE,
+    ALERT_STATE_CLEARING          // Normalizado, aguardando clearS
+};
+struct AlertRule {                // POD persistido no config (uma linha da tabela)
+    uint8_t signal;               // AlertSignal (ALERT_SIGNAL_NONE = livre)
+    uint8_t kind;                 // AlertKind
+    uint8_t severity;             // LogLevel do evento de disparo
+    uint8_t action;               // AlertAction
+    uint8_t ledVpin;              // LED virtual aceso enquanto ativo (0 = nenhum)
+    float threshold;              // Limite (unidade do sinal; por janela nas regras de taxa)
+    float hysteresis;             // Margem para normalizar
+    uint16_t dwellS;              // Violação contínua antes de disparar
+    uint16_t clearS;              // Normalidade contínua antes de limpar
+    uint16_t windowS;             // Janela das regras de taxa
+};
+struct AlertRuleState {           // Só em RAM
+    uint8_t state;                // AlertState
+    unsigned long sinceMs;        // Início da fase PENDING/CLEARING
+    float lastValue;              // Último valor avaliado (ou variação, nas regras de taxa)
+    uint32_t activations;
+};
+extern AlertRule alertRules[ALERT_MAX_RULES];
+extern AlertRuleState alertRuleStates[ALERT_MAX_RULES];
+
+// --- Botões por interrupção (hardware_manager.ino) ---
+enum ButtonId {                   // Ordem = tabela BUTTONS[]
+    BTN_OLED_PAGE = 0,
+    BTN_UP,
+    BTN_DOWN,
+    BTN_PH_CAL,
+    BTN_ALERT_RESET,
+    BTN_SERVICE_MODE,
+    BTN_RTC_RESET,
+    BTN_COUNT
+};
+typedef void (*ButtonHandler)();
+struct ButtonEdge {               // Empurrada pela ISR na fila para a tarefa de UI
+    uint8_t button;               // ButtonId
+    uint8_t level;                // Nível do pino logo após a borda
+    uint32_t timeUs;              // esp_timer_get_time() da borda (32 bits: ~71 min de volta)
+};
+struct ButtonStats {
+    unsigned long edges;          // Bordas recebidas das ISRs
+    unsigned long bounces;        // Descartadas pela janela de debounce
+    unsigned long resyncs;        // Bordas perdidas (sono leve/repique) corrigidas pela leitura do pino
+    unsigned long clicks;
+    unsigned long longPresses;
+    unsigned long slowResponses;  // Borda -> handler acima de BUTTON_RESPONSE_TARGET_US
+    uint32_t maxResponseUs;
+    uint32_t lastResponseUs;
+};
+extern ButtonStats buttonStats;
+
+// --- Energia e sono leve (power_manager.ino) ---
+enum PowerBusySource {            // Quem impede o sono leve (bits de powerBusyMask)
+    POWER_BUSY_CONTROL = 0x01,    // Bomba, válvula, TPA ou calibração em andamento
+    POWER_BUSY_LEVEL_ECHO = 0x02  // Eco ultrassônico do RAN medido por interrupção
+};
+struct PowerGroupStats {          // Por tarefa FreeRTOS (janela de LOOP_STATS_REPORT_MS)
+    uint64_t busyUs;              // Acordada (executando o escalonador)
+    uint64_t blockedUs;           // Bloqueada esperando trabalho
+    unsigned long timedWakes;     // Acordou pelo prazo da próxima tarefa
+    unsigned long notifiedWakes;  // Acordou por notificação (botão, comando)
+    uint64_t wakeLateSumUs;       // Atraso do despertar em relação ao prazo pedido
+    uint32_t wakeLateMaxUs;
+};
+struct PowerStats {
+    PowerGroupStats groups[SCHED_GROUP_COUNT];
+    int64_t windowStartUs;
+    bool lightSleepEnabled;       // esp_pm_configure() aceitou o sono leve
+    unsigned long busyLockAcquires;
+};
+extern PowerStats powerStats;
+
+// --- Sincronização de estado com o Blynk (state_sync.ino) ---
+enum SyncSettingId {              // Ordem = tabela SYNC_SETTINGS[]
+    SYNC_SET_TOTAL_VOLUME = 0,
+    SYNC_SET_EXTRACTION_PERCENT,
+    SYNC_SET_REPOSITION_VOLUME,
+    SYNC_SET_BUFFER_VOLUME,
+    SYNC_SET_PH_CAL_POINTS,
+    SYNC_SET_LOCAL_SCHEDULE,
+    SYNC_SET_SCHEDULE_FREQUENCY,
+    SYNC_SET_SCHEDULE_DAY,
+    SYNC_SET_SCHEDULE_HOUR,
+    SYNC_SET_SCHEDULE_MINUTE,
+    SYNC_SET_COUNT
+};
+enum SyncSource {                 // Quem fez a última alteração
+    SYNC_SOURCE_DEFAULT = 0,      // Valor de fábrica / nunca alterado
+    SYNC_SOURCE_LOCAL,            // Botões do OLED
+    SYNC_SOURCE_BLYNK,            // App (ao vivo ou na reconexão)
+    SYNC_SOURCE_IMPORT            // Arquivo de importação JSON
+};
+struct SyncSettingState {         // POD persistido no config (esquema 8)
+    uint32_t version;             // Cresce a cada alteração do valor
+    uint32_t syncedVersion;       // Versão que o servidor Blynk já tem (diferente = envio pendente)
+    float syncedValue;            // Valor do servidor na última sincronização (base da comparação)
+    uint32_t modifiedEpoch;       // Hora da última alteração (0 = sem hora válida)
+    uint8_t source;               // SyncSource
+};
+struct StateSyncStats {
+    unsigned long syncs;          // Reconexões sincronizadas
+    unsigned long requested;      // Pinos pedidos ao servidor
+    unsigned long unchanged;      // Respostas iguais ao valor local (nenhum efeito)
+    unsigned long applied;        // Valores do servidor aplicados
+    unsigned long pushed;         // Valores locais enviados ao servidor
+    unsigned long conflicts;      // Alterados dos dois lados: vale o local
+    unsigned long missing;        // Pinos sem resposta dentro da janela
+    unsigned long lastDurationMs;
+};
+extern SyncSettingState syncSettingState[SYNC_SET_COUNT];
+extern StateSyncStats stateSyncStats;
+
+// --- Configuração Persistente (config_manager.ino) ---
+// Struct POD gravada em binário. Campos novos SEMPRE no fim (e CONFIG_SCHEMA_VERSION + 1):
+// registros antigos são lidos sobre os defaults e continuam válidos.
+struct PersistentConfig {
+    float phOffset;
+    float phNeutralMv;
+    float phAcidSlopeMv;
+    float phBaseSlopeMv;
+    uint8_t phCalPoints;
+    bool tpaLocalScheduleActive;
+    float aquariumTotalVolume;
+    float tpaExtractionPercent;
+    float volumeToRepositionLiters;
+    int32_t ranBufferVolumeML;
+    int32_t tpaScheduleDay;
+    int32_t tpaScheduleHour;
+    int32_t tpaScheduleMinute;
+    int32_t tpaScheduleFrequency;
+    uint32_t loopBudgetUs;
+    // --- Esquema 2 ---
+    ScheduleJobConfig scheduleJobs[SCHED_JOB_COUNT]; // Job TPA: agenda vem dos campos acima, aqui só lastRunEpoch/política
+    // --- Esquema 3 ---
+    float clockDriftPpm;          // Deriva do RTC aprendida do NTP
+    uint32_t clockLastNtpEpoch;   // Referência da compensação de deriva
+    // --- Esquema 4 ---
+    PumpCalibration pumpCal[PUMP_COUNT];
+    // --- Esquema 5 ---
+    uint8_t tpaPlanMode;          // TpaPlanMode
+    float tpaMaxLevelDeltaL;
+    // --- Esquema 6 ---
+    AlertRule alertRules[ALERT_MAX_RULES];
+    // --- Esquema 7 ---
+    RanLevelCalibration ranLevelCal;
+    // --- Esquema 8 ---
+    SyncSettingState syncState[SYNC_SET_COUNT];
+    // --- Esquema 9 ---
+    uint8_t tempProbeRoms[MAX_TEMP_PROBES][8]; // ROM DS18B20 de cada papel (TempProbeRole)
+};
+struct ConfigRecordHeader {
+    uint32_t magic;               // CONFIG_MAGIC
+    uint16_t schemaVersion;       // Versão do esquema que gravou o registro
+    uint16_t payloadSize;         // sizeof(PersistentConfig) na versão que gravou
+    uint32_t generation;          // Cresce a cada gravação: o maior válido entre A/B vence
+    uint32_t crc;                 // CRC32 do payload
+};
+struct ConfigStoreStats {
+    unsigned long changeRequests; // Chamadas a markConfigDirty()
+    unsigned long writes;         // Registros efetivamente gravados
+    unsigned long skippedUnchanged; // Salvamentos evitados (conteúdo igual ao gravado)
+    unsigned long failedWrites;
+    unsigned long corruptSlots;   // Slots rejeitados (magic/versão/CRC) na carga
+};
+extern ConfigStoreStats configStats;
+extern uint32_t configGeneration;
+
+extern ControlSnapshot uiSnapshot; // Última fotografia recebida pela UI (usada pelo display_manager)
 // --- (Aqui entrarão as variáveis do Módulo 2: pH, etc.) ---
 // extern float phValue;
 // extern bool phCalibrationMode;
\ No newline at end of file
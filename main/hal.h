@@ -0,0 +1,113 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: HAL.H                       |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Thin hardware abstraction (time and GPIO) so control logic can run against a virtual clock
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.04 - Comment points to the sim/ harness (DS3231 on the virtual clock)
+15/10/2026 - 0.03 - With ACC_LIGHT_SLEEP (DFS) the profiler clock is esp_timer µs instead of CCOUNT
+15/10/2026 - 0.02 - halCycleCount()/halCyclesPerUs() for the profiler
+15/10/2026 - 0.01 - First installment: inline time/GPIO wrappers with host-simulation hooks
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - (this file) Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#pragma once // Garante que este arquivo seja incluído apenas uma vez
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// --- CAMADA DE ABSTRAÇÃO DE HARDWARE (HAL) ---
+// Os módulos de lógica (tpa_manager, tpa_reposition, actuators_manager, config_manager)
+// acessam tempo e pinos SOMENTE por estas funções. No ESP32 elas são inline e chamam o
+// core do Arduino diretamente (custo zero). Num build nativo de simulação o harness define
+// ACC_HOST_SIM=1 e fornece as funções sim*(): relógio virtual (avança quanto o teste quiser,
+// sem esperar), pinos simulados e a boia do RAN falsa.
+// Blynk, LittleFS e RTClib não passam por aqui: o harness usa os próprios cabeçalhos no lugar
+// das bibliotecas (servidor Blynk de mentira, sistema de arquivos em memória, DS3231 contando
+// pelo mesmo relógio virtual); o harness fica em sim/ (veja o README).
+#ifndef ACC_HOST_SIM
+#define ACC_HOST_SIM 0
+#endif
+
+#if ACC_HOST_SIM
+
+// Implementadas pelo harness de simulação (não fazem parte do firmware)
+unsigned long simMillis();
+unsigned long simMicros();
+void simPinMode(uint8_t pin, uint8_t mode);
+void simDigitalWrite(uint8_t pin, uint8_t level);
+int simDigitalRead(uint8_t pin);
+
+inline unsigned long halMillis() { return simMillis(); }
+inline unsigned long halMicros() { return simMicros(); }
+inline void halPinMode(uint8_t pin, uint8_t mode) { simPinMode(pin, mode); }
+inline void halDigitalWrite(uint8_t pin, uint8_t level) { simDigitalWrite(pin, level); }
+inline int halDigitalRead(uint8_t pin) { return simDigitalRead(pin); }
+inline uint32_t halCycleCount() { return (uint32_t)simMicros(); } // 1 "ciclo" por µs virtual
+inline uint32_t halCyclesPerUs() { return 1; }
+
+#else
+
+inline unsigned long halMillis() { return millis(); }
+inline unsigned long halMicros() { return micros(); }
+inline void halPinMode(uint8_t pin, uint8_t mode) { pinMode(pin, mode); }
+inline void halDigitalWrite(uint8_t pin, uint8_t level) { digitalWrite(pin, level); }
+inline int halDigitalRead(uint8_t pin) { return digitalRead(pin); }
+#if ACC_LIGHT_SLEEP
+// Com DFS a frequência da CPU muda no meio de uma medida e o CCOUNT deixa de ser convertível em
+// tempo: o profiler passa a contar µs do esp_timer (1 "ciclo" por µs, volta em ~71 min).
+inline uint32_t halCycleCount() { return (uint32_t)esp_timer_get_time(); }
+inline uint32_t halCyclesPerUs() { return 1; }
+#else
+inline uint32_t halCycleCount() { return ESP.getCycleCount(); }  // CCOUNT do núcleo (dá a volta em ~17 s a 240 MHz)
+inline uint32_t halCyclesPerUs() { return ESP.getCpuFreqMHz(); }
+#endif
+
+#endif
@@ -21,6 +21,15 @@
 
 
 == Version History ==
+15/10/2026 - 0.12 - Sensor/RTC reset buttons post control commands; UP/DOWN read the schedule from uiSnapshot
+15/10/2026 - 0.11 - Button ISR is level-triggered and re-arms the opposite level (light-sleep wake shares the pin's interrupt type)
+15/10/2026 - 0.10 - UP/DOWN da Página 1 enviam o valor novo ao controle em vez de escrever a agenda.
+15/10/2026 - 0.09 - OLED schedule edits bump the setting version (sent to Blynk)
+15/10/2026 - 0.08 - Buttons by GPIO interrupt + edge queue (no Button2 polling), GPIO wakeup, response time stats
+15/10/2026 - 0.07 - Schedule edits request next-fire recompute
+15/10/2026 - 0.06 - UP/DOWN schedule edits now mark config dirty (debounced save)
+15/10/2026 - 0.05 - pH calibration button posts a command to the control task
+15/10/2026 - 0.04 - Service mode toggle posted as a command to the control task
 02/11/2025 - 0.03 - Re-factoring code to use Buttons2 library
 02/11/2025 - 0.02 - Re-factoring code to know use a page button, and combination of
                     short, long press for several inputs and actions
@@ -40,25 +49,52 @@ hardware_manager  - (this file) Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 #include "config.h"
 #include "global.h"
 #include "utils.h"
 
-// --- DECLARAÇÃO DE OBJETOS Button2 (Estas deveriam ser movidas para global.h) ---
-// Estes objetos gerenciam o estado de cada botão físico
-Button2 oledPageButton;
-Button2 upButton;
-Button2 downButton;
-Button2 phCalButton;
-Button2 alertResetButton;
-Button2 serviceModeButton;
-Button2 rtcResetButton;
-
-// --- FUNÇÕES DE NAVEGAÇÃO E EDIÇÃO (CALLBACKS DO Button2) ---
-
-void handleOledPageTap(Button2& btn) {
+// --- BOTÕES POR INTERRUPÇÃO ---
+// Cada borda de um botão dispara uma ISR que só carimba o tempo, empurra a borda numa fila SPSC
+// e acorda a tarefa de UI. O debounce é feito pelos carimbos de tempo: a primeira borda depois de
+// um período estável é aceita na hora (resposta rápida) e as bordas seguintes dentro de
+// BUTTON_DEBOUNCE_MS são repique. Clique curto/longo é decidido ao soltar, como no Button2.
+// Sem polling: a tarefa de UI pode ficar bloqueada (e o chip em sono leve) até o próximo toque.
+ButtonStats buttonStats;
+
+struct ButtonDef {
+    uint8_t pin;
+    ButtonHandler onClick;        // Soltou antes de BUTTON_LONG_PRESS_MS (NULL = ignorado)
+    ButtonHandler onLongPress;    // Soltou depois de BUTTON_LONG_PRESS_MS (NULL = ignorado)
+};
+struct ButtonState {
+    bool pressed;                 // Estado aceito (após debounce)
+    uint32_t lastEdgeUs;          // Última borda aceita (início da janela de debounce)
+    uint32_t pressedAtUs;
+};
+
+static SpscQueue<ButtonEdge, BUTTON_EDGE_QUEUE_SIZE> buttonEdgeQueue; // Produtor: ISRs (núcleo 1); consumidor: UI
+static ButtonState buttonStates[BTN_COUNT];
+
+// --- FUNÇÕES DE NAVEGAÇÃO E EDIÇÃO (HANDLERS DOS BOTÕES) ---
+
+void handleOledPageTap() {
     int logMode = -1; // Usada para o log no final
     
     // --- LÓGICA DE EDIÇÃO: Página 1 (Agendamento TPA) ---
@@ -96,7 +132,7 @@ void handleOledPageTap(Button2& btn) {
     }
 }
 
-void handleOledPageLongPress(Button2& btn) {
+void handleOledPageLongPress() {
     // 1. Sai de qualquer modo de edição ao trocar de página
     page1EditMode = -1;
     page2EditMode = 0;
@@ -109,138 +145,271 @@ void handleOledPageLongPress(Button2& btn) {
     Serial.println(currentPage);
 }
 
-void handleUpTap(Button2& btn) {
+// Campo da Página 1 -> configuração sincronizada com o Blynk (mesma ordem de page1EditMode)
+static const uint8_t PAGE1_SYNC_SETTINGS[4] = {
+    SYNC_SET_SCHEDULE_DAY, SYNC_SET_SCHEDULE_HOUR, SYNC_SET_SCHEDULE_MINUTE, SYNC_SET_SCHEDULE_FREQUENCY
+};
+
+// Último valor enviado pela UI: toques rápidos chegam antes da próxima fotografia do controle
+static int page1PendingField = -1;
+static int page1PendingValue = 0;
+static unsigned long page1PendingMs = 0;
+
+// Valor atual de um campo da Página 1, lido da fotografia (nunca das variáveis do controle)
+static int getPage1FieldValue(int field) {
+    if (field == page1PendingField && (long)(uiSnapshot.timestampMs - page1PendingMs) <= 0) {
+        return page1PendingValue; // Fotografia ainda anterior ao envio
+    }
+    switch (field) {
+        case 0: return uiSnapshot.tpaScheduleDay;
+        case 1: return uiSnapshot.tpaScheduleHour;
+        case 2: return uiSnapshot.tpaScheduleMinute;
+        default: return uiSnapshot.tpaScheduleFrequency;
+    }
+}
+
+// Gravado uma única vez quando as edições param (debounce); enviado ao Blynk (agora ou na reconexão)
+static void postPage1FieldValue(int field, int value) {
+    page1PendingField = field;
+    page1PendingValue = value;
+    page1PendingMs = millis();
+    postLocalSettingChange(PAGE1_SYNC_SETTINGS[field], (float)value);
+}
+
+void handleUpTap() {
     if (currentPage == 1 && page1EditMode != -1 && page1EditMode != 4) {
-        // Lógica de incremento da Pagina 1
+        // Lógica de incremento da Pagina 1 (o controle aplica; a UI só calcula o valor novo)
+        int current = getPage1FieldValue(page1EditMode);
+        int value = current;
         switch (page1EditMode) {
             case 0: // Dia (tpaScheduleDay)
-                tpaScheduleDay = (tpaScheduleDay % 7) + 1; // 1 a 7
+                value = (current % 7) + 1; // 1 a 7
                 break;
             case 1: // Hora (tpaScheduleHour)
-                tpaScheduleHour = (tpaScheduleHour + 1) % 24; // 0 a 23
+                value = (current + 1) % 24; // 0 a 23
                 break;
             case 2: // Minuto (tpaScheduleMinute)
-                tpaScheduleMinute = (tpaScheduleMinute + 1) % 60; // 0 a 59
+                value = (current + 1) % 60; // 0 a 59
                 break;
             case 3: // Frequência (tpaScheduleFrequency)
-                tpaScheduleFrequency = (tpaScheduleFrequency + 1) % 4; // 0 a 3
+                value = (current + 1) % 4; // 0 a 3
                 break;
         }
+        postPage1FieldValue(page1EditMode, value);
         Serial.print(F("Botao UP: Valor ajustado. Campo: ")); Serial.println(page1EditMode);
     }
 }
 
-void handleDownTap(Button2& btn) {
+void handleDownTap() {
     if (currentPage == 1 && page1EditMode != -1 && page1EditMode != 4) {
-        // Lógica de decremento da Pagina 1
+        // Lógica de decremento da Pagina 1 (o controle aplica; a UI só calcula o valor novo)
+        int current = getPage1FieldValue(page1EditMode);
+        int value = current;
         switch (page1EditMode) {
             case 0: // Dia (tpaScheduleDay)
-                tpaScheduleDay = (tpaScheduleDay == 1) ? 7 : (tpaScheduleDay - 1); // 1 a 7
+                value = (current == 1) ? 7 : (current - 1); // 1 a 7
                 break;
             case 1: // Hora (tpaScheduleHour)
-                tpaScheduleHour = (tpaScheduleHour == 0) ? 23 : (tpaScheduleHour - 1); // 0 a 23
+                value = (current == 0) ? 23 : (current - 1); // 0 a 23
                 break;
             case 2: // Minuto (tpaScheduleMinute)
-                tpaScheduleMinute = (tpaScheduleMinute == 0) ? 59 : (tpaScheduleMinute - 1); // 0 a 59
+                value = (current == 0) ? 59 : (current - 1); // 0 a 59
                 break;
             case 3: // Frequência (tpaScheduleFrequency)
-                tpaScheduleFrequency = (tpaScheduleFrequency == 0) ? 3 : (tpaScheduleFrequency - 1); // 0 a 3
+                value = (current == 0) ? 3 : (current - 1); // 0 a 3
                 break;
         }
+        postPage1FieldValue(page1EditMode, value);
         Serial.print(F("Botao DOWN: Valor ajustado. Campo: ")); Serial.println(page1EditMode);
     }
 }
 
-// --- FUNÇÕES DE AÇÃO (CALLBACKS DO Button2) ---
+// --- FUNÇÕES DE AÇÃO (HANDLERS DOS BOTÕES) ---
 
-void handleAlertResetTap(Button2& btn) {
+void handleAlertResetTap() {
     // Ação: Reset de Alertas Críticos (Short Press)
-    resetCriticalAlerts();
+    postControlCommand(CMD_RESET_ALERTS, 0);
     Serial.println(F("Botao ALERT_RESET acionado (CURTO): Reset de Alertas."));
-    logSystemEvent("info", "Reset de Alertas Críticos.");
 }
 
-void handleAlertResetLongPress(Button2& btn) {
+void handleAlertResetLongPress() {
     // Ação: Reset de Valores Min/Max de Sensores (Long Press)
     // Se estiver em uma página de configuração (ex: 2), poderia forçar o salvamento.
     // Usaremos a ação de reset de min/max dos sensores.
-    resetSensorData();
+    postControlCommand(CMD_RESET_SENSOR_DATA, 0); // Leituras são do controle
     Serial.println(F("Botao ALERT_RESET (LONGO): Reset de valores min/max dos sensores."));
-    logSystemEvent("info", "Reset de min/max dos sensores.");
 }
 
-void handleRtcResetTap(Button2& btn) {
+void handleRtcResetTap() {
     // Ação: Reset de Alerta de Perda de Energia RTC (Short Press)
-    resetRtcOsfAlert();
+    postControlCommand(CMD_RESET_RTC_OSF, 0); // rtc_osf_flag é do controle (que registra o evento)
     Serial.println(F("Botao RTC_RESET acionado (CURTO): Reset de Alerta de Bateria RTC."));
-    logSystemEvent("info", "Alerta OSF RTC resetado manualmente.");
 }
 
-void handlePhCalLongPress(Button2& btn) {
-    // Ação: Iniciar Calibração de pH (Long Press)
-    executePhCalibration();
-    Serial.println(F("Botao PH_CAL acionado (LONGO): Calibracao de PH iniciada."));
-    logSystemEvent("info", "Calibração de PH iniciada.");
+void handlePhCalLongPress() {
+    // Ação: Iniciar / confirmar próximo tampão / cancelar a Calibração de pH (Long Press)
+    // A sequência roda na tarefa de controle sem bloquear (ver executePhCalibration()).
+    postControlCommand(CMD_PH_CALIBRATE, 0);
+    Serial.println(F("Botao PH_CAL acionado (LONGO): comando de calibracao de PH enviado."));
 }
 
-void handleServiceModeLongPress(Button2& btn) {
+void handleServiceModeLongPress() {
     // Ação: Alternar Modo de Serviço (Long Press)
-    serviceModeActive = !serviceModeActive;
-    String logMsg = serviceModeActive ? F("Modo Servico ATIVADO.") : F("Modo Servico DESATIVADO.");
-    Serial.println(logMsg);
-    logSystemEvent("warning", logMsg.c_str());
+    // A tarefa de controle aplica o novo estado, registra o log e sincroniza o Blynk.
+    Serial.println(F("Botao SERVICE_MODE (LONGO): Alternando Modo de Servico."));
+    postControlCommand(CMD_SET_SERVICE_MODE, uiSnapshot.serviceMode ? 0 : 1);
+}
+
 
-    // Sincroniza o estado com o Blynk
-    Blynk.virtualWrite(VPIN_SERVICE_MODE, serviceModeActive ? 1 : 0);
+// Ordem = ButtonId
+static const ButtonDef BUTTONS[BTN_COUNT] = {
+    { OLED_PAGE_BUTTON_PIN,    handleOledPageTap,   handleOledPageLongPress },
+    { UP_BUTTON_PIN,           handleUpTap,         NULL },
+    { DOWN_BUTTON_PIN,         handleDownTap,       NULL },
+    { PH_CAL_BUTTON_PIN,       NULL,                handlePhCalLongPress },
+    { ALERT_RESET_BUTTON_PIN,  handleAlertResetTap, handleAlertResetLongPress },
+    { SERVICE_MODE_BUTTON_PIN, NULL,                handleServiceModeLongPress },
+    { RTC_RESET_BUTTON_PIN,    handleRtcResetTap,   NULL },
+};
+
+
+// --- ISR: uma por pino (arg = ButtonId) ---
+// Interrupção por NÍVEL, não por borda: o despertar do sono leve por GPIO só aceita nível e
+// gpio_wakeup_enable() reescreve o tipo de interrupção do pino. Para não disparar sem parar com o
+// botão segurado, a ISR arma o nível oposto ao que acabou de ler (direto no registrador, seguro
+// em IRAM): cada disparo vira uma "borda". Se o pino mudar entre a leitura e o rearme, o nível
+// armado já está presente e a ISR roda de novo com a leitura certa.
+static inline gpio_int_type_t buttonArmLevel(int level) {
+    return level == LOW ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL; // Espera a próxima mudança
+}
+
+static void IRAM_ATTR onButtonEdge(void* arg) {
+    ButtonEdge edge;
+    edge.button = (uint8_t)(uintptr_t)arg;
+    uint8_t pin = BUTTONS[edge.button].pin;
+    edge.level = (uint8_t)digitalRead(pin);
+    GPIO.pin[pin].int_type = buttonArmLevel(edge.level); // Mantém o bit de despertar (wakeup_enable)
+    edge.timeUs = (uint32_t)esp_timer_get_time();
+    buttonEdgeQueue.push(edge); // Fila cheia: a borda se perde, a releitura do pino corrige
+    notifySchedulerGroupFromIsr(SCHED_GROUP_UI);
 }
 
 
-// --- SETUP: INICIALIZAÇÃO DOS BOTÕES FÍSICOS (COM Button2) ---
+// --- SETUP: INICIALIZAÇÃO DOS BOTÕES FÍSICOS (POR INTERRUPÇÃO) ---
 void setupHardwareButtons() {
-    Serial.println(F("Configurando pinos de botoes fisicos com Button2..."));
+    Serial.println(F("Configurando botoes fisicos por interrupcao..."));
+    memset(&buttonStats, 0, sizeof(buttonStats));
+
+    for (uint8_t i = 0; i < BTN_COUNT; i++) {
+        // Botão fecha para GND (LOW = pressionado). GPIO34-39 são só entrada e NÃO têm pull-up
+        // interno: nesses pinos o INPUT_PULLUP não faz nada e o resistor externo é obrigatório.
+        halPinMode(BUTTONS[i].pin, INPUT_PULLUP);
+        int level = halDigitalRead(BUTTONS[i].pin);
+        buttonStates[i].pressed = (level == LOW);
+        buttonStates[i].lastEdgeUs = (uint32_t)esp_timer_get_time();
+        buttonStates[i].pressedAtUs = buttonStates[i].lastEdgeUs;
+        attachInterruptArg(BUTTONS[i].pin, onButtonEdge, (void*)(uintptr_t)i, level == LOW ? ONHIGH : ONLOW);
+    }
 
-    // --- 1. Botões de NAVEGAÇÃO OLED ---
-    oledPageButton.begin(OLED_PAGE_BUTTON_PIN);
-    oledPageButton.setClickHandler(handleOledPageTap); 
-    oledPageButton.setLongClickHandler(handleOledPageLongPress);
+    Serial.println(F("Botoes fisicos configurados (ISR + fila + debounce por tempo)."));
+}
 
-    upButton.begin(UP_BUTTON_PIN);
-    upButton.setClickHandler(handleUpTap); 
+// Sono leve: a mudança de nível de qualquer botão acorda o chip (chamada por setupPowerManagement).
+// gpio_wakeup_enable() grava o tipo de interrupção do pino: passa o mesmo nível que a ISR armaria,
+// para o despertar e a interrupção do botão continuarem sendo a mesma coisa.
+void enableButtonWakeups() {
+    for (uint8_t i = 0; i < BTN_COUNT; i++) {
+        gpio_wakeup_enable((gpio_num_t)BUTTONS[i].pin, buttonArmLevel(halDigitalRead(BUTTONS[i].pin)));
+    }
+}
 
-    downButton.begin(DOWN_BUTTON_PIN);
-    downButton.setClickHandler(handleDownTap);
 
-    // --- 2. Botões de AÇÃO ---
-    phCalButton.begin(PH_CAL_BUTTON_PIN);
-    phCalButton.setLongClickHandler(handlePhCalLongPress); 
+// --- DEBOUNCE E DECODIFICAÇÃO (tarefa de UI) ---
+static void dispatchButtonRelease(uint8_t id, uint32_t edgeUs, uint32_t heldUs) {
+    bool longPress = heldUs >= BUTTON_LONG_PRESS_MS * 1000UL;
+    ButtonHandler handler = longPress ? BUTTONS[id].onLongPress : BUTTONS[id].onClick;
+    if (handler == NULL) return;
+
+    if (longPress) buttonStats.longPresses++;
+    else buttonStats.clicks++;
+    handler();
+
+    // Tempo de resposta: da borda de soltar até o handler terminar
+    uint32_t responseUs = (uint32_t)esp_timer_get_time() - edgeUs;
+    buttonStats.lastResponseUs = responseUs;
+    if (responseUs > buttonStats.maxResponseUs) buttonStats.maxResponseUs = responseUs;
+    if (responseUs > BUTTON_RESPONSE_TARGET_US) {
+        buttonStats.slowResponses++;
+        LOG_WARNING(LOG_SRC_SYSTEM, "Botao %u respondeu em %lu us (meta %lu us)", id,
+                    (unsigned long)responseUs, (unsigned long)BUTTON_RESPONSE_TARGET_US);
+    }
+}
 
-    alertResetButton.begin(ALERT_RESET_BUTTON_PIN);
-    alertResetButton.setClickHandler(handleAlertResetTap); // CORREÇÃO
-    alertResetButton.setLongClickHandler(handleAlertResetLongPress); // CORREÇÃO
+static void applyButtonLevel(uint8_t id, bool pressed, uint32_t timeUs) {
+    ButtonState& st = buttonStates[id];
+    if (timeUs - st.lastEdgeUs < BUTTON_DEBOUNCE_MS * 1000UL) {
+        buttonStats.bounces++; // Repique: o estado final é conferido pela releitura do pino
+        return;
+    }
+    if (pressed == st.pressed) return; // Borda oposta perdida: nada mudou
+    st.pressed = pressed;
+    st.lastEdgeUs = timeUs;
+    if (pressed) {
+        st.pressedAtUs = timeUs;
+    } else {
+        dispatchButtonRelease(id, timeUs, timeUs - st.pressedAtUs);
+    }
+}
 
-    serviceModeButton.begin(SERVICE_MODE_BUTTON_PIN);
-    serviceModeButton.setLongClickHandler(handleServiceModeLongPress); 
+// Depois da janela de debounce o pino precisa concordar com o estado aceito. Se não concordar,
+// a última borda foi engolida pelo repique ou aconteceu durante o sono leve (sem ISR).
+static void resyncButtonLevels() {
+    uint32_t nowUs = (uint32_t)esp_timer_get_time();
+    for (uint8_t i = 0; i < BTN_COUNT; i++) {
+        if (nowUs - buttonStates[i].lastEdgeUs < BUTTON_DEBOUNCE_MS * 1000UL) continue;
+        bool pressed = (halDigitalRead(BUTTONS[i].pin) == LOW);
+        if (pressed != buttonStates[i].pressed) {
+            buttonStats.resyncs++;
+            applyButtonLevel(i, pressed, nowUs);
+        }
+    }
+}
 
-    rtcResetButton.begin(RTC_RESET_BUTTON_PIN);
-    rtcResetButton.setClickHandler(handleRtcResetTap); // CORREÇÃO
+// Prazo (ms) até a UI precisar reler os pinos: fim da janela de debounce mais próxima
+unsigned long getButtonNextCheckMs() {
+    uint32_t nowUs = (uint32_t)esp_timer_get_time();
+    unsigned long nextMs = RTOS_IDLE_MAX_MS;
+    for (uint8_t i = 0; i < BTN_COUNT; i++) {
+        uint32_t sinceUs = nowUs - buttonStates[i].lastEdgeUs;
+        if (sinceUs < BUTTON_DEBOUNCE_MS * 1000UL) {
+            unsigned long remainingMs = (BUTTON_DEBOUNCE_MS * 1000UL - sinceUs) / 1000UL + 1;
+            if (remainingMs < nextMs) nextMs = remainingMs;
+        }
+    }
+    return nextMs;
+}
 
-    Serial.println(F("Botoes fisicos configurados. Logica manual removida."));
+void reportButtonStats() {
+    char line[112];
+    snprintf(line, sizeof(line), "BOTOES: bordas %lu repiques %lu ressinc %lu cliques %lu longos %lu lentos %lu",
+             buttonStats.edges, buttonStats.bounces, buttonStats.resyncs, buttonStats.clicks,
+             buttonStats.longPresses, buttonStats.slowResponses);
+    Serial.println(line);
+    snprintf(line, sizeof(line), "BOTOES: resposta ultima %lu us max %lu us (meta %lu us), fila perdidas %lu",
+             (unsigned long)buttonStats.lastResponseUs, (unsigned long)buttonStats.maxResponseUs,
+             (unsigned long)BUTTON_RESPONSE_TARGET_US, (unsigned long)buttonEdgeQueue.dropped());
+    Serial.println(line);
 }
 
 
 // --- LOOP: FUNÇÃO PRINCIPAL DE GERENCIAMENTO DE HARDWARE ---
-// Esta função é chamada repetidamente no loop() principal (main.ino)
+// Tarefa de UI: roda quando uma ISR a notifica (ou no prazo das outras tarefas de UI).
+// Sem bordas na fila, custa só a releitura de 7 pinos.
 void runHardwareManagerLoop() {
-    // Otimizado: Apenas chame o método loop() de cada botão.
-    // A lógica de debounce, tempo e disparo das ações foi delegada ao Button2.
-    oledPageButton.loop();
-    upButton.loop();
-    downButton.loop();
-    phCalButton.loop();
-    alertResetButton.loop();
-    serviceModeButton.loop();
-    rtcResetButton.loop();
-
-    // NOTA: Toda a lógica de detecção de botão manual (processButton, handleShortPress,
-    // handleLongPress) que estava aqui foi REMOVIDA.
+    ButtonEdge edge;
+    while (buttonEdgeQueue.pop(edge)) {
+        buttonStats.edges++;
+        if (edge.button < BTN_COUNT) applyButtonLevel(edge.button, edge.level == LOW, edge.timeUs);
+    }
+    resyncButtonLevels();
 }
@@ -0,0 +1,478 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: HISTORY_STORE               |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Append-only sensor/TPA history on LittleFS with per-segment summaries
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.03 - Entry point instrumented with PROFILE_SCOPE
+15/10/2026 - 0.02 - Timestamps from clockNowEpoch(); validity from clockIsValid()
+15/10/2026 - 0.01 - First installment: delta-encoded segment ring, batched writes, range queries
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - (this file) Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+// history_store.ino
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- HISTÓRICO LOCAL EM FLASH (LittleFS) ---
+// Produtor: a tarefa de controle amostra temperatura, pH e nível do RAN a cada
+// HISTORY_SAMPLE_PERIOD_MS e registra os eventos de TPA. As amostras seguem por fila SPSC.
+// Consumidor: a tarefa de rede (dona do LittleFS) codifica, agrupa em RAM e grava em lote.
+//
+// Formato: HISTORY_SEGMENT_COUNT arquivos /hist/segNN.bin usados em anel. Cada segmento tem um
+// cabeçalho (época base) seguido de registros fixos de 6 bytes com o tempo e o valor em delta
+// (o valor é absoluto no primeiro registro de cada canal no segmento ou se o delta estourar).
+// Ao fechar um segmento, o resumo dele (mín/máx/soma/contagem por canal) vai para
+// /hist/index.bin. As consultas "últimas 24 h / 7 d" leem os resumos e só decodificam os
+// segmentos que cruzam as bordas do intervalo.
+
+SpscQueue<HistorySample, HISTORY_QUEUE_SIZE> controlToHistoryQueue; // Controle -> Rede
+
+HistorySegmentSummary historyIndex[HISTORY_SEGMENT_COUNT]; // Resumos (o do segmento aberto fica em RAM)
+uint32_t historyCurrentSeq = 0;         // Sequência do segmento aberto (0 = nenhum ainda)
+uint32_t historyNextSeq = 1;            // Sequência do próximo segmento a abrir
+bool historyReady = false;              // LittleFS montado e /hist disponível
+
+HistoryDecoder historyEncoder;          // Estado do codificador (último tempo/valor por canal)
+HistoryRecord historyBatch[HISTORY_BATCH_RECORDS]; // Registros ainda não gravados
+int historyBatchCount = 0;
+unsigned long historyLastFlushMs = 0;
+unsigned long historyLastReportMs = 0;
+
+// Unidades de quantização por canal (valor gravado = valor real * escala)
+const float HISTORY_CHANNEL_SCALE[HISTORY_VALUE_CHANNELS] = { 100.0f, 1000.0f, 1.0f };
+const char* HISTORY_CHANNEL_NAMES[HISTORY_VALUE_CHANNELS] = { "Temp", "pH", "RAN%" };
+
+
+// --- FUNÇÕES AUXILIARES ---
+
+static void historySegmentPath(uint32_t seq, char* path, size_t len) {
+    snprintf(path, len, "%s/seg%02u.bin", HISTORY_DIR, (unsigned)(seq % HISTORY_SEGMENT_COUNT));
+}
+
+static HistorySegmentSummary& currentHistorySummary() {
+    return historyIndex[historyCurrentSeq % HISTORY_SEGMENT_COUNT];
+}
+
+static void resetHistoryDecoder(HistoryDecoder& d, uint32_t baseEpoch) {
+    memset(&d, 0, sizeof(d));
+    d.epoch = baseEpoch;
+}
+
+static void resetHistorySummary(HistorySegmentSummary& s, uint32_t seq, uint32_t baseEpoch) {
+    memset(&s, 0, sizeof(s));
+    s.seq = seq;
+    s.firstEpoch = baseEpoch;
+    s.lastEpoch = baseEpoch;
+    for (int ch = 0; ch < HISTORY_VALUE_CHANNELS; ch++) {
+        s.channels[ch].min = INT16_MAX;
+        s.channels[ch].max = INT16_MIN;
+    }
+}
+
+static void accumulateHistorySummary(HistorySegmentSummary& s, const HistorySample& sample) {
+    s.lastEpoch = sample.epoch;
+    s.records++;
+    if (sample.channel >= HISTORY_VALUE_CHANNELS) {
+        s.events++;
+        return;
+    }
+    HistoryChannelSummary& c = s.channels[sample.channel];
+    if (sample.value < c.min) c.min = sample.value;
+    if (sample.value > c.max) c.max = sample.value;
+    c.sum += sample.value;
+    c.count++;
+}
+
+// Aplica um registro ao estado do decodificador e devolve a amostra absoluta
+void decodeHistoryRecord(HistoryDecoder& d, const HistoryRecord& r, HistorySample& out) {
+    d.epoch += r.dtSec;
+    out.epoch = d.epoch;
+    out.channel = r.channel;
+    out.kind = r.kind;
+    if (r.kind == HISTORY_REC_DELTA && r.channel < HISTORY_VALUE_CHANNELS) {
+        out.value = d.lastValue[r.channel] + r.value;
+    } else {
+        out.value = r.value;
+    }
+    if (r.channel < HISTORY_VALUE_CHANNELS) {
+        d.lastValue[r.channel] = out.value;
+        d.hasValue[r.channel] = true;
+    }
+}
+
+
+// --- PRODUTOR (tarefa de controle) ---
+
+bool pushHistorySample(uint8_t channel, uint8_t kind, int16_t value) {
+    // Sem hora confiável a amostra não pode ser posicionada no tempo
+    if (!clockIsValid()) return false;
+
+    HistorySample sample;
+    sample.epoch = clockNowEpoch();
+    sample.channel = channel;
+    sample.kind = kind;
+    sample.value = value;
+    return controlToHistoryQueue.push(sample);
+}
+
+// Tarefa do escalonador (controle): uma amostra de cada grandeza por período
+void sampleHistory() {
+    if (temperatureC != -999.0f) {
+        pushHistorySample(HISTORY_CH_TEMPERATURE, HISTORY_REC_ABSOLUTE, (int16_t)lroundf(temperatureC * HISTORY_CHANNEL_SCALE[HISTORY_CH_TEMPERATURE]));
+    }
+    if (phFilterPrimed && !phCalibrationMode) {
+        pushHistorySample(HISTORY_CH_PH, HISTORY_REC_ABSOLUTE, (int16_t)lroundf(phValue * HISTORY_CHANNEL_SCALE[HISTORY_CH_PH]));
+    }
+    pushHistorySample(HISTORY_CH_RAN_LEVEL, HISTORY_REC_ABSOLUTE, (int16_t)ranLevelPercent);
+}
+
+// Marcos do ciclo TPA (HistoryEvent)
+void recordHistoryEvent(uint8_t eventCode) {
+    pushHistorySample(HISTORY_CH_TPA_EVENT, HISTORY_REC_EVENT, eventCode);
+}
+
+
+// --- CONSUMIDOR (tarefa de rede) ---
+
+void setupHistoryStore() {
+    historyReady = false;
+    if (!LittleFS.exists(HISTORY_DIR) && !LittleFS.mkdir(HISTORY_DIR)) {
+        Serial.println(F("ERRO: Historico: nao foi possivel criar o diretorio."));
+        logSystemEvent("error", "Historico local indisponivel (LittleFS).");
+        return;
+    }
+
+    memset(historyIndex, 0, sizeof(historyIndex));
+    File indexFile = LittleFS.open(HISTORY_INDEX_PATH, "r");
+    if (indexFile) {
+        HistoryIndexHeader header;
+        bool valid = indexFile.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+                     header.magic == HISTORY_MAGIC && header.version == HISTORY_FORMAT_VERSION &&
+                     indexFile.read((uint8_t*)historyIndex, sizeof(historyIndex)) == sizeof(historyIndex);
+        indexFile.close();
+        if (!valid) {
+            Serial.println(F("AVISO: Historico: indice invalido. Iniciando novo historico."));
+            memset(historyIndex, 0, sizeof(historyIndex));
+        }
+    }
+
+    // O índice só guarda segmentos fechados: o aberto é o seguinte ao de maior sequência.
+    // Seu resumo é refeito lendo o arquivo (pode não existir se o boot anterior parou antes).
+    uint32_t lastClosedSeq = 0;
+    for (int i = 0; i < HISTORY_SEGMENT_COUNT; i++) {
+        if (historyIndex[i].seq > lastClosedSeq) lastClosedSeq = historyIndex[i].seq;
+    }
+    historyNextSeq = lastClosedSeq + 1;
+    historyCurrentSeq = historyNextSeq;
+    if (recoverHistorySegment()) {
+        historyNextSeq++;
+    } else {
+        historyCurrentSeq = 0; // Criado na primeira amostra (precisa da época base)
+    }
+
+    historyBatchCount = 0;
+    historyLastFlushMs = millis();
+    historyReady = true;
+    Serial.print(F("Historico: segmento atual "));
+    Serial.println(historyCurrentSeq);
+}
+
+// Relê o segmento aberto para reconstruir o resumo e o estado do codificador
+bool recoverHistorySegment() {
+    char path[24];
+    historySegmentPath(historyCurrentSeq, path, sizeof(path));
+    File segment = LittleFS.open(path, "r");
+    if (!segment) return false;
+
+    HistorySegmentHeader header;
+    if (segment.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != HISTORY_MAGIC || header.seq != historyCurrentSeq) {
+        segment.close();
+        return false;
+    }
+
+    HistorySegmentSummary& summary = currentHistorySummary();
+    resetHistorySummary(summary, header.seq, header.baseEpoch);
+    resetHistoryDecoder(historyEncoder, header.baseEpoch);
+
+    HistoryRecord chunk[HISTORY_READ_CHUNK];
+    size_t bytes;
+    while ((bytes = segment.read((uint8_t*)chunk, sizeof(chunk))) >= sizeof(HistoryRecord)) {
+        for (size_t i = 0; i < bytes / sizeof(HistoryRecord); i++) {
+            HistorySample sample;
+            decodeHistoryRecord(historyEncoder, chunk[i], sample);
+            accumulateHistorySummary(summary, sample);
+        }
+    }
+    segment.close();
+    return true;
+}
+
+// Fecha o segmento atual (resumo vai para o índice) e abre o próximo slot do anel
+void rotateHistorySegment(uint32_t baseEpoch) {
+    flushHistoryBatch();
+
+    if (historyCurrentSeq > 0) {
+        saveHistoryIndex(); // Resumo do segmento que fecha passa a valer no índice
+    }
+    historyCurrentSeq = historyNextSeq++;
+
+    char path[24];
+    historySegmentPath(historyCurrentSeq, path, sizeof(path));
+    File segment = LittleFS.open(path, "w"); // Sobrescreve o slot mais antigo do anel
+    if (!segment) {
+        Serial.println(F("ERRO: Historico: falha ao criar segmento."));
+        return;
+    }
+    HistorySegmentHeader header = { HISTORY_MAGIC, HISTORY_FORMAT_VERSION, historyCurrentSeq, baseEpoch };
+    segment.write((const uint8_t*)&header, sizeof(header));
+    segment.close();
+
+    // O resumo do slot reaproveitado é descartado junto com os dados antigos
+    resetHistorySummary(currentHistorySummary(), historyCurrentSeq, baseEpoch);
+    resetHistoryDecoder(historyEncoder, baseEpoch);
+}
+
+void saveHistoryIndex() {
+    File indexFile = LittleFS.open(HISTORY_INDEX_PATH, "w");
+    if (!indexFile) {
+        Serial.println(F("ERRO: Historico: falha ao gravar indice."));
+        return;
+    }
+    HistoryIndexHeader header = { HISTORY_MAGIC, HISTORY_FORMAT_VERSION };
+    indexFile.write((const uint8_t*)&header, sizeof(header));
+    indexFile.write((const uint8_t*)historyIndex, sizeof(historyIndex));
+    indexFile.close();
+}
+
+// Codifica uma amostra no lote em RAM (grava quando o lote enche)
+void appendHistorySample(const HistorySample& sample) {
+    HistorySegmentSummary& summary = currentHistorySummary();
+    bool needsRotation = historyCurrentSeq == 0 ||
+                         summary.records >= HISTORY_SEGMENT_RECORDS ||
+                         sample.epoch < historyEncoder.epoch ||            // Relógio voltou
+                         sample.epoch - historyEncoder.epoch > 0xFFFFUL;   // Lacuna maior que o delta
+    if (needsRotation) {
+        rotateHistorySegment(sample.epoch);
+    }
+
+    HistoryRecord record;
+    record.dtSec = (uint16_t)(sample.epoch - historyEncoder.epoch);
+    record.channel = sample.channel;
+    record.kind = sample.kind;
+    record.value = sample.value;
+
+    if (sample.kind != HISTORY_REC_EVENT && sample.channel < HISTORY_VALUE_CHANNELS &&
+        historyEncoder.hasValue[sample.channel]) {
+        int32_t delta = (int32_t)sample.value - historyEncoder.lastValue[sample.channel];
+        if (delta >= INT16_MIN && delta <= INT16_MAX) {
+            record.kind = HISTORY_REC_DELTA;
+            record.value = (int16_t)delta;
+        }
+    }
+
+    HistorySample decoded;
+    decodeHistoryRecord(historyEncoder, record, decoded);
+    accumulateHistorySummary(currentHistorySummary(), decoded);
+
+    historyBatch[historyBatchCount++] = record;
+    if (historyBatchCount >= HISTORY_BATCH_RECORDS) {
+        flushHistoryBatch();
+    }
+}
+
+// Uma única escrita (append) por lote para reduzir o desgaste da flash
+void flushHistoryBatch() {
+    historyLastFlushMs = millis();
+    if (historyBatchCount == 0 || historyCurrentSeq == 0) return;
+
+    char path[24];
+    historySegmentPath(historyCurrentSeq, path, sizeof(path));
+    File segment = LittleFS.open(path, "a");
+    if (!segment) {
+        Serial.println(F("ERRO: Historico: falha ao abrir segmento para gravacao."));
+        return; // O lote continua em RAM; nova tentativa no próximo período
+    }
+    segment.write((const uint8_t*)historyBatch, historyBatchCount * sizeof(HistoryRecord));
+    segment.close();
+    historyBatchCount = 0;
+}
+
+// Tarefa do escalonador (rede): consome a fila e grava em lote
+void runHistoryStore() {
+    PROFILE_SCOPE(PROF_HISTORY_STORE);
+    if (!historyReady) return;
+
+    HistorySample sample;
+    while (controlToHistoryQueue.pop(sample)) {
+        appendHistorySample(sample);
+    }
+
+    unsigned long now = millis();
+    if (historyBatchCount > 0 && now - historyLastFlushMs >= HISTORY_FLUSH_INTERVAL_MS) {
+        flushHistoryBatch();
+    }
+    if (now - historyLastReportMs >= HISTORY_REPORT_INTERVAL_MS) {
+        historyLastReportMs = now;
+        reportHistorySummary();
+    }
+}
+
+
+// --- CONSULTAS (tarefa de rede) ---
+
+static void accumulateRangeSample(HistoryRangeResult& out, int16_t value) {
+    if (out.count == 0 || value < out.minRaw) out.minRaw = value;
+    if (out.count == 0 || value > out.maxRaw) out.maxRaw = value;
+    out.sumRaw += value;
+    out.count++;
+}
+
+// Decodifica um segmento (e, se for o aberto, o lote em RAM) somando só as amostras do intervalo
+static void scanHistorySegment(uint32_t seq, uint8_t channel, uint32_t fromEpoch, uint32_t toEpoch, HistoryRangeResult& out) {
+    char path[24];
+    historySegmentPath(seq, path, sizeof(path));
+    File segment = LittleFS.open(path, "r");
+    if (!segment) return;
+
+    HistorySegmentHeader header;
+    if (segment.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || header.seq != seq) {
+        segment.close();
+        return;
+    }
+
+    HistoryDecoder decoder;
+    resetHistoryDecoder(decoder, header.baseEpoch);
+    HistorySample sample;
+
+    HistoryRecord chunk[HISTORY_READ_CHUNK];
+    size_t bytes;
+    while ((bytes = segment.read((uint8_t*)chunk, sizeof(chunk))) >= sizeof(HistoryRecord)) {
+        for (size_t i = 0; i < bytes / sizeof(HistoryRecord); i++) {
+            decodeHistoryRecord(decoder, chunk[i], sample);
+            if (sample.channel == channel && sample.epoch >= fromEpoch && sample.epoch <= toEpoch) {
+                accumulateRangeSample(out, sample.value);
+            }
+        }
+    }
+    segment.close();
+
+    if (seq == historyCurrentSeq) {
+        for (int i = 0; i < historyBatchCount; i++) {
+            decodeHistoryRecord(decoder, historyBatch[i], sample);
+            if (sample.channel == channel && sample.epoch >= fromEpoch && sample.epoch <= toEpoch) {
+                accumulateRangeSample(out, sample.value);
+            }
+        }
+    }
+}
+
+/**
+ * Mín/máx/média de um canal entre duas épocas (inclusive).
+ * Segmentos inteiramente dentro do intervalo usam só o resumo; no máximo os dois das
+ * bordas são decodificados.
+ */
+bool queryHistoryRange(uint8_t channel, uint32_t fromEpoch, uint32_t toEpoch, HistoryRangeResult& out) {
+    memset(&out, 0, sizeof(out));
+    if (!historyReady || channel >= HISTORY_VALUE_CHANNELS) return false;
+
+    for (int i = 0; i < HISTORY_SEGMENT_COUNT; i++) {
+        const HistorySegmentSummary& s = historyIndex[i];
+        if (s.seq == 0 || s.records == 0) continue;
+        if (s.lastEpoch < fromEpoch || s.firstEpoch > toEpoch) continue;
+
+        if (s.firstEpoch >= fromEpoch && s.lastEpoch <= toEpoch) {
+            const HistoryChannelSummary& c = s.channels[channel];
+            if (c.count == 0) continue;
+            if (out.count == 0 || c.min < out.minRaw) out.minRaw = c.min;
+            if (out.count == 0 || c.max > out.maxRaw) out.maxRaw = c.max;
+            out.sumRaw += c.sum;
+            out.count += c.count;
+        } else {
+            scanHistorySegment(s.seq, channel, fromEpoch, toEpoch, out);
+        }
+    }
+
+    if (out.count == 0) return false;
+    float scale = HISTORY_CHANNEL_SCALE[channel];
+    out.min = out.minRaw / scale;
+    out.max = out.maxRaw / scale;
+    out.mean = (float)((double)out.sumRaw / out.count) / scale;
+    return true;
+}
+
+void reportHistorySummary() {
+    if (!clockIsValid()) return;
+    uint32_t now = clockNowEpoch();
+    const uint32_t spans[2] = { 24UL * 3600UL, 7UL * 24UL * 3600UL };
+    const char* spanNames[2] = { "24h", "7d" };
+
+    for (int ch = 0; ch < HISTORY_VALUE_CHANNELS; ch++) {
+        for (int s = 0; s < 2; s++) {
+            HistoryRangeResult r;
+            if (!queryHistoryRange(ch, now - spans[s], now, r)) continue;
+            Serial.print(F("HISTORICO "));
+            Serial.print(HISTORY_CHANNEL_NAMES[ch]);
+            Serial.print(F(" "));
+            Serial.print(spanNames[s]);
+            Serial.print(F(": min="));
+            Serial.print(r.min, 2);
+            Serial.print(F(" max="));
+            Serial.print(r.max, 2);
+            Serial.print(F(" media="));
+            Serial.print(r.mean, 2);
+            Serial.print(F(" n="));
+            Serial.println(r.count);
+        }
+    }
+}
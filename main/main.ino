@@ -21,6 +21,23 @@
 
 
 == Version History ==
+15/10/2026 - 0.21 - Temperature probes discovered after the config load (ROM->role map)
+15/10/2026 - 0.20 - Network task 'sync' (Blynk state sync)
+15/10/2026 - 0.19 - setupPowerManagement() before the RTOS tasks (automatic light sleep)
+15/10/2026 - 0.18 - Control task 'nivel_ran' (continuous RAN level)
+15/10/2026 - 0.17 - sendSensorData evaluates the alert rule table once per batch
+15/10/2026 - 0.16 - Network task 'perfil' (profiler sampling + serial console)
+15/10/2026 - 0.15 - logSystemEvent moved to event_log; setupEventLog() first in setup; network task 'eventos'
+15/10/2026 - 0.14 - setupActuators() in setup; control task 'dosagem'
+15/10/2026 - 0.13 - setupClockService() after RTC init; UI task 'relogio'; VPIN_TIME from fixed buffer
+15/10/2026 - 0.12 - History store setup and sampling/consumer tasks
+15/10/2026 - 0.11 - Telemetry publisher task; VPIN_TIME through the publisher
+15/10/2026 - 0.10 - OLED statistics report task
+15/10/2026 - 0.09 - pH acquisition task registered in the control group
+15/10/2026 - 0.08 - Work split in FreeRTOS tasks (control core 1, network core 0, UI); Ticker removed
+                    sendSensorData() now only reads/publishes; Blynk traffic goes through SPSC queues
+15/10/2026 - 0.07 - DS18B20 probes discovered once at boot; acquisition runs as a scheduler task
+15/10/2026 - 0.06 - loop() now runs the cooperative task scheduler; every FSM registers as a task
 01/11/2025 - 0.05 - add Blynk log function to normalize events. Added Utils.h to function prototype.
                     House cleaning, moving prototypes, includes to .H correct file. Added on setup()
                     code to retrieve pH calibration data
@@ -43,6 +60,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -53,7 +85,6 @@ tpa_reposition    - Control return of water volume
 
 // --- Instanciação Global (Definições) ---
 // É aqui que as variáveis são realmente criadas e alocadas na memória.
-Ticker sensorDataTicker; 
 OneWire oneWire(ONE_WIRE_BUS);
 DallasTemperature sensors(&oneWire);
 
@@ -68,14 +99,12 @@ bool rtc_osf_flag = false; // Oscillator Stop Flag
 bool rtcOsfAlertSent = false; //Alerta de RTC 
 
 // Variáveis de estado - Módulo 1 (tempo e temperatura)
-bool highTempAlertSent = false; // Usada para defnir o volume de alertas no Blynk
 float temperatureC = 0.0f;      // Usada em display.manager.ino
 
 // Variáveis de estado - Módulo 2 (pH)
 float phValue = 7.0;             // Inicializado com um valor neutro
 float phCalibrationOffset = 0.0; // Começa sem offset (deve ser salvo em EEPROM/LittleFS em um projeto final)
 bool phCalibrationMode = false;  // O sistema não inicia em modo de calibração
-bool phAlertSent = false;        // Começa sem alerta
 
 // Variáveis de estado - Botões físicos
 bool serviceModeActive = false; // Implementacao da variavel
@@ -101,6 +130,7 @@ float volumeToExtractLiters = 0.0f;
 unsigned long tpaPumpDurationMs = 0;
 float volumeToRepositionLiters = 0.0f;
 unsigned long tpaExtractionStartTime = 0; // --- CAPTURA DO TEMPO INICIAL ---
+ExtractionState tpaExtractionCurrentState = TPA_EXTRACTION_IDLE;
 
 // --- Definições Globais TPA (Módulo 5.2 - tpa_reposition) ---
 RepositionState tpaRepositionCurrentState = TPA_REPOSITION_IDLE; 
@@ -113,7 +143,6 @@ int tpaScheduleDay = 1;              // Dia da semana (1=Dom, 7=Sab ou dia do me
 int tpaScheduleHour = 0;             // Hora da execucao (0-23)
 int tpaScheduleMinute = 0;           // Minuto da execucao (0-59)
 int tpaScheduleFrequency = 0;        // 0=Diaria, 1=Semanal, 2=Quinzenal, 3=Mensal
-unsigned long lastTpaExecution = 0;  // millis() ou RTC time da ultima execucao local
 TpaMasterState tpaMasterCurrentState = TPA_MASTER_IDLE;
 
 // --- Variáveis de Gerenciamento do RAN ---
@@ -129,8 +158,9 @@ bool ranRefillAlertSent = false;
 void setup() {
   // 1. Iniciliza a serial
   Serial.begin(115200);
+  setupEventLog(); // Anel de eventos na RTC (e trilha pós-morte se o último reset foi anormal)
   
-  sensors.begin();
+  setupPhSensor();          // ADC1 + caracterização do eFuse para a aquisição do pH
   
   // 2. Tentar inicializar o RTC
   if (!rtc.begin()) {
@@ -145,6 +175,8 @@ void setup() {
     }
   }
 
+  setupClockService(); // Única leitura do RTC; daí em diante a hora é extrapolada (SQW 1 Hz)
+
   // 3. Inicialização da Conexão (Não Bloqueante)
   Blynk.config(auth, "blynk.cloud", 80); // Configure as credenciais.
   Blynk.connect(0); // Tenta iniciar a conexão (timeout de 0 segundos)
@@ -156,6 +188,9 @@ void setup() {
   
   // 5. Inicializar o LittleFS e carregar as configuracoes salvas (ph, TPA, etc)
   setupConfigManager();
+  setupTemperatureProbes(); // Busca o barramento OneWire uma única vez (papéis pelo mapa ROM do config)
+  setupHistoryStore(); // Histórico local (LittleFS já montado)
+  setupActuators();    // Bombas (motor de dosagem, com a calibração carregada), válvula e boia do RAN
 
   // 6. Inicializar Pinos Físicos (Chamando o novo gerenciador de botões)
   setupHardwareButtons(); // Inicializa todos os pinos de botõs (32, 33, 34, 35)
@@ -163,8 +198,43 @@ void setup() {
   // 7. Inicializar Display OLED (NOVO)
   setupDisplay();
 
-  // 8. Inicializa o Ticker
-  sensorDataTicker.attach(5.0, sendSensorData); 
+  // 8. Registra as tarefas cooperativas por grupo (ordem de registro = ordem de execução)
+  // Críticas (true) nunca são adiadas: são as FSMs que ligam/desligam bombas e válvulas.
+  setupTaskScheduler();
+  // 8.1 Controle (núcleo 1): comandos, FSMs da TPA e aquisição
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "comandos", processControlCommands, 0, true);
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "dosagem", runDosingEngine, 0, true);       // Integra volume e desliga bombas
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "tpa", runTpaManagerLoop, 0, true);          // Coordena M5.1 -> M5.2 -> M5.3
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "agenda", runTpaScheduler, TPA_SCHEDULER_PERIOD_MS, false); // Agendamento local
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "reposicao", runTpaRepositionLoop, 0, true); // FSM M5.2
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "enchimento", runRanRefillLoop, 0, true);    // FSM M5.3
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "nivel_ran", runRanLevelAcquisition, RAN_LEVEL_SAMPLE_PERIOD_MS, true); // Boia + nível contínuo
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "temperatura", runTemperatureAcquisition, TEMP_ACQ_TASK_PERIOD_MS, false);
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "ph", runPhAcquisition, PH_ACQ_TASK_PERIOD_MS, false);
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "sensores", sendSensorData, SENSOR_TELEMETRY_PERIOD_MS, false);
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "historico", sampleHistory, HISTORY_SAMPLE_PERIOD_MS, false);
+  registerSchedulerTask(SCHED_GROUP_CONTROL, "snapshot", publishControlSnapshot, CONTROL_SNAPSHOT_PERIOD_MS, false);
+  // 8.2 Rede (núcleo 0): Blynk, saída de telemetria, hora e persistência
+  registerSchedulerTask(SCHED_GROUP_NETWORK, "blynk", runBlynkTask, 0, false);
+  registerSchedulerTask(SCHED_GROUP_NETWORK, "saida", runNetworkOutbox, 0, false);
+  registerSchedulerTask(SCHED_GROUP_NETWORK, "telemetria", runTelemetryPublisher, TELEMETRY_TICK_MS, false);
+  registerSchedulerTask(SCHED_GROUP_NETWORK, "sync", runStateSync, STATE_SYNC_TASK_PERIOD_MS, false); // Sincronização de configurações
+  registerSchedulerTask(SCHED_GROUP_NETWORK, "rede", runNetworkHousekeeping, SENSOR_TELEMETRY_PERIOD_MS, false);
+  registerSchedulerTask(SCHED_GROUP_NETWORK, "historico", runHistoryStore, HISTORY_STORE_TASK_PERIOD_MS, false);
+  registerSchedulerTask(SCHED_GROUP_NETWORK, "config", checkConfigSave, CONFIG_SAVE_TASK_PERIOD_MS, false);
+  registerSchedulerTask(SCHED_GROUP_NETWORK, "eventos", runEventLogDrain, EVENT_DRAIN_PERIOD_MS, false); // Anel -> Serial/Blynk/flash
+  registerSchedulerTask(SCHED_GROUP_NETWORK, "perfil", runProfilerTask, PROFILER_SAMPLE_PERIOD_MS, false); // Heap/pilhas + console serial
+  // 8.3 UI (baixa prioridade): botões e display
+  registerSchedulerTask(SCHED_GROUP_UI, "botoes", runHardwareManagerLoop, 0, false);
+  registerSchedulerTask(SCHED_GROUP_UI, "display", runDisplayTask, DISPLAY_REFRESH_MS, false);
+  registerSchedulerTask(SCHED_GROUP_UI, "relogio", runClockService, CLOCK_SERVICE_PERIOD_MS, false); // Ajuste NTP/RTC (I2C)
+  registerSchedulerTask(SCHED_GROUP_UI, "oled_stats", reportDisplayStats, LOOP_STATS_REPORT_MS, false);
+
+  // 9. Energia: sono leve automático quando as tarefas estão bloqueadas (power_manager.ino)
+  setupPowerManagement();
+
+  // 10. Cria as tarefas FreeRTOS (a partir daqui cada grupo roda na sua tarefa)
+  setupRtosTasks();
   Serial.println(F("--- Sistema Base Inicializado! ---"));
 }
 
@@ -172,23 +242,9 @@ void setup() {
 // ---                LOOP                ---
 // --- ================================== ---
 void loop() {
-// 1. Cham as rotinas de medição
-  Blynk.run(); 
-
-// 2. Averigua os Botões Físicos
-  runHardwareManagerLoop(); 
-
-// 3. Gerenciamento de FSMs de Controle (NOVO e prioritário)
-  // Essas funcoes devem rodar a cada loop para garantir tempo real e nao-bloqueio.
-  runTpaManagerLoop();      // Coordena o fluxo geral (M5.1 -> M5.2 -> M5.3)
-  runTpaRepositionLoop();   // Execução NÃO-BLOQUEANTE da FSM M5.2
-
-// 4. Gerenciamento de FSMs de Controle (NOVO e prioritário)
-  runRanRefillLoop();        // Executa o enchimento do RAN (M5.3)
-
-// 5. Salvar Configuração (Lógica Lenta)
-  checkConfigSave();
-
+// Todo o trabalho roda nas tarefas FreeRTOS criadas em setupRtosTasks() (rtos_tasks.ino).
+// A tarefa do loop() do Arduino não é mais necessária e é removida para liberar a pilha.
+  vTaskDelete(NULL);
 }
 
 // ----------------------------------------------------------------------
@@ -196,57 +252,47 @@ void loop() {
 // ----------------------------------------------------------------------
 
 // -------------------------------------------------------------------
-// FUNÇÃO CENTRAL: Chamada pelo Ticker
+// FUNÇÃO CENTRAL: Leituras periódicas (tarefa de CONTROLE)
 // -------------------------------------------------------------------
+// Apenas lê e publica: os envios ao Blynk são enfileirados para a tarefa de rede e o
+// display é redesenhado pela tarefa de UI.
 void sendSensorData() {
-  // 1. LÓGICA RTC/BATERIA
-  if (rtc_ok && rtc_osf_flag && !rtcOsfAlertSent) {
-      if (Blynk.connected()) {
-          Blynk.logEvent("rtc_battery_low", F("Bateria do RTC falhou! Usando tempo da Internet."));
-      }
-      rtcOsfAlertSent = true;
-  }
-
-  // 2. LEITURA DE TEMPERATURA
+  // 1. LEITURA DE TEMPERATURA (última amostra publicada pelo pipeline; não acessa o barramento)
   float tempC = readTemperature();
   if (tempC != -999.0) {
-    Blynk.virtualWrite(VPIN_TEMP, tempC);
-    checkTempAlert(tempC); // Verifica e envia alerta se necessário
+    publishVirtualPin(VPIN_TEMP, tempC);
   }
+  float sumpC = getProbeTemperature(TEMP_PROBE_SUMP);
+  if (sumpC != -999.0) publishVirtualPin(VPIN_TEMP_SUMP, sumpC);
+  float ranC = getProbeTemperature(TEMP_PROBE_RAN);
+  if (ranC != -999.0) publishVirtualPin(VPIN_TEMP_RAN, ranC);
 
-  // 3. LEITURA DE PH
+  // 2. LEITURA DE PH
     if (!phCalibrationMode) { // Não leia/envie dados se estiver no meio da calibração
         float currentPh = readPH();
-        Blynk.virtualWrite(VPIN_PH_VAL, currentPh);
-        // Aqui entraria a função checkPhAlert(currentPh) se fosse implementada
+        publishVirtualPin(VPIN_PH_VAL, currentPh);
     }
 
-  // 4. LEITURA DE TEMPO
-  Blynk.virtualWrite(VPIN_TIME, getCurrentTimeString());
-
-  // 5. ATUALIZAR DISPLAY OLED
-  updateDisplay();
-
-  // 6. Atualiza arquivo de persistência
-  checkConfigSave();
-
+  // 3. REGRAS DE ALERTA (temperaturas e pH do lote atual)
+  evaluateAlertRules();
 }
 
 // -------------------------------------------------------------------
-// FUNÇÃO LOG EVENTOS: Para registro no Blink
+// FUNÇÃO PERIÓDICA DE REDE: hora e alerta de bateria do RTC (tarefa de REDE)
 // -------------------------------------------------------------------
-/**
- * Envia um evento Blynk usando as categorias genéricas (log_info, log_critical, etc.)
- * para economizar o limite de 5 eventos únicos da conta gratuita.
- * @param category Deve ser "info", "warning", "critical", ou "content".
- * @param message A descrição detalhada do evento.
- */
-void logSystemEvent(const char* category, const char* message) {
-    if (Blynk.connected()) {
-        String eventCode = "log_";
-        eventCode += category;
-        Blynk.logEvent(eventCode.c_str(), message);
-    }
+void runNetworkHousekeeping() {
+  // 1. LÓGICA RTC/BATERIA
+  if (rtc_ok && rtc_osf_flag && !rtcOsfAlertSent) {
+      if (Blynk.connected()) {
+          Blynk.logEvent("rtc_battery_low", F("Bateria do RTC falhou! Usando tempo da Internet."));
+      }
+      rtcOsfAlertSent = true;
+  }
+
+  // 2. LEITURA DE TEMPO (o publicador limita o envio a 1 por minuto)
+  char timeStr[9];
+  formatClockTime(timeStr, sizeof(timeStr));
+  publishVirtualPinText(VPIN_TIME, timeStr);
 }
 
 // -------------------------------------------------------------------
@@ -255,12 +301,7 @@ void logSystemEvent(const char* category, const char* message) {
 BLYNK_WRITE(VPIN_SERVICE_MODE) {
     int switchState = param.asInt();
     
-    // Atualiza o estado da variável global
-    serviceModeActive = (switchState == 1); 
-    
-    String logMsg = serviceModeActive ? F("Modo Servico ATIVADO via Blynk.") : F("Modo Servico DESATIVADO via Blynk.");
-    Serial.println(logMsg);
-    logSystemEvent("warning", logMsg.c_str());
-    
-    // O display será atualizado no proximo sendSensorData
-}
\ No newline at end of file
+    // O estado é aplicado pela tarefa de controle (que também registra o log e devolve o valor ao Blynk)
+    Serial.println(F("Comando Blynk: Modo Servico recebido."));
+    postControlCommand(CMD_SET_SERVICE_MODE, switchState == 1 ? 1 : 0);
+}
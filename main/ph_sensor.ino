@@ -21,6 +21,14 @@
 
 
 == Version History ==
+15/10/2026 - 0.09 - Timeout while waiting for the next buffer aborts the calibration
+15/10/2026 - 0.08 - pH calibration points go through the state sync
+15/10/2026 - 0.07 - Fixed temperature/pH alert checks moved to the alert rule table (alert_rules)
+15/10/2026 - 0.06 - Entry point instrumented with PROFILE_SCOPE
+15/10/2026 - 0.05 - pH alert formatted into the event ring (no String)
+15/10/2026 - 0.04 - Oversampled ADC1 acquisition (ring buffer + median + IIR, eFuse characterisation)
+                    Non-blocking 1/2/3-point calibration with stability detection, saved in config
+15/10/2026 - 0.03 - Calibration/alert Blynk writes published through the FreeRTOS task queues
 01/11/2025 - 0.02 - Adjusted Blynk events to new log function. Included utils.h
                     Created executePhCalibration() as instead og Blynk handler
                     to allow re-usage of calibration process with different interfaces.
@@ -42,6 +50,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -52,156 +75,259 @@ tpa_reposition    - Control return of water volume
 #include "utils.h"
 
 
-// Protótipos das funções que serão definidas aqui:
-float readPH();
-void handlePhCalibration(int buttonState);
+// --- ESTADO DA AQUISIÇÃO (Módulo 2: pH) ---
+// Amostras brutas do ADC1 entram num buffer circular; a cada PH_FILTER_DECIMATION amostras
+// a mediana das últimas PH_MEDIAN_WINDOW é convertida em mV (curva do eFuse) e passa por um IIR.
+esp_adc_cal_characteristics_t phAdcChars;   // Caracterização do ADC1 lida do eFuse no boot
+uint16_t phRawRing[PH_RING_SIZE];           // Buffer circular de leituras brutas (0-4095)
+uint32_t phRawCount = 0;                    // Total de amostras escritas (índice = count % tamanho)
+uint8_t phSamplesSinceFilter = 0;           // Amostras desde a última saída filtrada
+float phFilteredMv = 0.0f;                  // Saída do filtro IIR (mV no pino)
+bool phFilterPrimed = false;                // true após a primeira mediana
 
-// --- 1. FUNÇÃO DE LEITURA E CONVERSÃO DE PH ---
-// Esta função faz a leitura bruta e aplica a conversão para pH.
-// Nota: O ponto neutro (pH 7.0) é geralmente 1500mV. O A0 do ESP32 tem Vref 3.3V.
-// O ponto neutro do módulo de pH é ajustado via potenciômetro (3.3V/2 = 1.65V, se o módulo for 3.3V)
-// Assumiremos uma conversão básica, que será corrigida pelo offset.
+// --- ESTADO DA CALIBRAÇÃO (não bloqueante) ---
+PhCalibration phCal = { PH_NEUTRAL_MV_DEFAULT, PH_SLOPE_MV_DEFAULT, PH_SLOPE_MV_DEFAULT, PH_CAL_POINTS_DEFAULT };
+PhCalState phCalCurrentState = PH_CAL_IDLE;
+uint8_t phCalPointIndex = 0;                // Ponto em captura (0 = pH 7, 1 = pH 4, 2 = pH 10)
+float phCalCapturedMv[3];                   // Tensão estável capturada em cada tampão
+unsigned long phCalStateStartMs = 0;        // Início do ponto atual (para o timeout)
+unsigned long phCalWindowStartMs = 0;       // Início da janela de estabilidade
+float phCalWindowMinMv = 0.0f;
+float phCalWindowMaxMv = 0.0f;
 
-float readPH() {
-    // 1. Leitura do valor analógico
-    int analogValue = analogRead(PH_PIN);
+// Tampões usados na ordem de captura
+const float PH_CAL_BUFFERS[3] = { PH_CAL_BUFFER_NEUTRAL, PH_CAL_BUFFER_ACID, PH_CAL_BUFFER_BASE };
 
-    // 2. Conversão para Tensão (Assumindo 3.3V Vref e ADC de 12 bits = 4095)
-    // Se o seu ESP estiver usando 10 bits (1023), ajuste para 1023.
-    // ESP32: ADC de 12 bits (0-4095).
-    float voltage = (float)analogValue / 4095.0 * 3.3; // Tensão lida no pino
 
-    // 3. Conversão para pH (Fórmula baseada em um modelo DFrobot ou similar)
-    // O valor de 1.65V (meia tensão) é onde o pH é 7.0. A sensibilidade é de aprox. 5.7 * pH/V
-    
-    // A fórmula mais comum é:
-    // pH = 7 + ((2.5 - Tensão) / 0.18) (Para Vref 5V e pH 7.0 em 2.5V)
-    
-    // Para 3.3V, vamos simplificar para:
-    // pH = 7.0 - ((voltage - 1.65) / 0.2) 
-    // O '0.2' é um coeficiente de sensibilidade que será corrigido pelo offset
+// --- 1. SETUP DO ADC (eFuse) ---
+void setupPhSensor() {
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(PH_ADC_CHANNEL, PH_ADC_ATTEN);
 
-    // Para fins de simulação e calibração por offset, usaremos uma fórmula base
-    float raw_pH = 7.0 - ((voltage - 1.65) / 0.2); 
-    
-    // 4. Aplicar o Offset de Calibração
-    float final_pH = raw_pH + phCalibrationOffset;
-    
-    // 5. Atualizar a variável global e retornar
-    phValue = final_pH;
-    
+    // Usa a calibração de fábrica gravada no eFuse (Two Point ou Vref); senão, a Vref padrão
+    esp_adc_cal_value_t calType = esp_adc_cal_characterize(ADC_UNIT_1, PH_ADC_ATTEN, ADC_WIDTH_BIT_12,
+                                                           PH_ADC_DEFAULT_VREF_MV, &phAdcChars);
+    if (calType == ESP_ADC_CAL_VAL_EFUSE_TP) {
+        Serial.println(F("pH: ADC caracterizado pelo eFuse (Two Point)."));
+    } else if (calType == ESP_ADC_CAL_VAL_EFUSE_VREF) {
+        Serial.println(F("pH: ADC caracterizado pelo eFuse (Vref)."));
+    } else {
+        Serial.println(F("AVISO: pH: eFuse sem calibracao do ADC. Usando Vref padrao."));
+        logSystemEvent("warning", "ADC do pH sem calibracao de fabrica (eFuse).");
+    }
+
+    phRawCount = 0;
+    phSamplesSinceFilter = 0;
+    phFilterPrimed = false;
+}
+
+// Mediana das últimas PH_MEDIAN_WINDOW amostras (ordenação por inserção numa cópia local)
+static uint16_t computePhRawMedian() {
+    uint16_t window[PH_MEDIAN_WINDOW];
+    for (int i = 0; i < PH_MEDIAN_WINDOW; i++) {
+        uint16_t v = phRawRing[(phRawCount - 1 - i) % PH_RING_SIZE];
+        int j = i - 1;
+        while (j >= 0 && window[j] > v) {
+            window[j + 1] = window[j];
+            j--;
+        }
+        window[j + 1] = v;
+    }
+    return window[PH_MEDIAN_WINDOW / 2];
+}
+
+// --- 2. TAREFA DE AQUISIÇÃO (escalonador, grupo de controle) ---
+// Cada execução lê uma rajada curta do ADC1 (alguns us por leitura) e nunca espera.
+void runPhAcquisition() {
+    PROFILE_SCOPE(PROF_PH_ACQ);
+    for (int i = 0; i < PH_BURST_SAMPLES; i++) {
+        phRawRing[phRawCount % PH_RING_SIZE] = (uint16_t)adc1_get_raw(PH_ADC_CHANNEL);
+        phRawCount++;
+        phSamplesSinceFilter++;
+    }
+
+    if (phRawCount < PH_MEDIAN_WINDOW || phSamplesSinceFilter < PH_FILTER_DECIMATION) return;
+    phSamplesSinceFilter = 0;
+
+    // Mediana remove picos isolados; a conversão em mV só é feita uma vez por saída
+    float medianMv = (float)esp_adc_cal_raw_to_voltage(computePhRawMedian(), &phAdcChars);
+    if (!phFilterPrimed) {
+        phFilteredMv = medianMv;
+        phFilterPrimed = true;
+    } else {
+        phFilteredMv += PH_IIR_ALPHA * (medianMv - phFilteredMv);
+    }
+
+    if (phCalCurrentState == PH_CAL_STABILIZING) {
+        runPhCalibrationStep();
+    } else if (phCalCurrentState == PH_CAL_WAIT_NEXT_BUFFER &&
+               millis() - phCalStateStartMs >= PH_CAL_WAIT_TIMEOUT_MS) {
+        // Sem confirmação a calibração ficaria aberta para sempre: pH sem publicação, regras de
+        // alerta suspensas e o controle preso no ciclo rápido (isControlBusy)
+        cancelPhCalibration("Calibracao de pH abortada: proximo tampao nao confirmado.");
+    }
+}
+
+// --- 3. CONVERSÃO PARA PH ---
+// pH = 7.0 + (mV neutro - mV lido) / inclinação. A inclinação do lado ácido e do lado
+// alcalino pode ser diferente (calibração de 3 pontos). O offset antigo continua como ajuste fino.
+float convertMvToPh(float mv) {
+    float slope = (mv >= phCal.neutralMv) ? phCal.acidSlopeMv : phCal.baseSlopeMv;
+    return PH_CAL_BUFFER_NEUTRAL + (phCal.neutralMv - mv) / slope + phCalibrationOffset;
+}
+
+float readPH() {
+    // Sem custo de ADC aqui: apenas converte a última saída do filtro
+    if (phFilterPrimed) {
+        phValue = convertMvToPh(phFilteredMv);
+    }
     return phValue;
 }
 
 
-// --- 2. FUNÇÃO CENTRAL DE CALIBRAÇÃO (REUTILIZÁVEL) ---
-// Esta função contém a lógica de calibração. Ela pode ser chamada
-// pelo Blynk, por um botão físico, ou por qualquer outra fonte.
-void executePhCalibration() {
-    Serial.println(F("CALIBRAÇÃO DE PH (Offset Simples) INICIADA."));
-        
-    // 1. Inicia o modo de calibração
-    phCalibrationMode = true; 
-    
-    // 2. Faz uma leitura de estabilização (mantendo a lógica)
-    float sumVoltage = 0;
-    int numReadings = 10;
-    
-    for (int i = 0; i < numReadings; i++) {
-        // Assume-se que o PH_PIN está sendo lido com ADC de 12 bits (4095) e Vref 3.3V
-        sumVoltage += (float)analogRead(PH_PIN) / 4095.0 * 3.3; 
-        delay(50); 
+// --- 4. CALIBRAÇÃO MULTIPONTO (NÃO BLOQUEANTE) ---
+// Sequência: pH 7.0 -> pH 4.0 (2 pontos) -> pH 10.0 (3 pontos).
+// Cada ponto aguarda a tensão filtrada ficar dentro de PH_CAL_STABLE_BAND_MV por
+// PH_CAL_STABLE_WINDOW_MS. Entre pontos, o usuário troca a sonda de tampão e confirma.
+
+void publishPhCalStatus(const char* text) {
+    Serial.print(F("pH CAL: "));
+    Serial.println(text);
+    publishVirtualPinText(VPIN_CAL_STATUS, text);
+}
+
+void beginPhCalibrationPoint() {
+    phCalCurrentState = PH_CAL_STABILIZING;
+    phCalStateStartMs = millis();
+    phCalWindowStartMs = phCalStateStartMs;
+    phCalWindowMinMv = phFilteredMv;
+    phCalWindowMaxMv = phFilteredMv;
+
+    char status[NET_MSG_TEXT_LEN];
+    snprintf(status, sizeof(status), "Estabilizando em pH %.2f (%u/%u)",
+             PH_CAL_BUFFERS[phCalPointIndex], phCalPointIndex + 1, phCal.points);
+    publishPhCalStatus(status);
+}
+
+void startPhCalibration(uint8_t points) {
+    phCal.points = constrain(points, (uint8_t)1, (uint8_t)3);
+    phCalPointIndex = 0;
+    phCalibrationMode = true; // sendSensorData() não publica pH durante a calibração
+    logSystemEvent("info", "Calibracao de pH iniciada.");
+    beginPhCalibrationPoint();
+}
+
+void cancelPhCalibration(const char* reason) {
+    phCalCurrentState = PH_CAL_IDLE;
+    phCalibrationMode = false;
+    publishPhCalStatus(reason);
+    logSystemEvent("warning", reason);
+}
+
+// Chamada a cada nova saída filtrada enquanto um ponto está estabilizando
+void runPhCalibrationStep() {
+    unsigned long now = millis();
+
+    if (now - phCalStateStartMs >= PH_CAL_TIMEOUT_MS) {
+        cancelPhCalibration("Calibracao de pH abortada: leitura nao estabilizou.");
+        return;
     }
-    float measuredVoltage = sumVoltage / numReadings;
 
-    // 3. Cálculos de Offset
-    const float neutralVoltage = 1.65; // Tensão alvo para pH 7.0
-    const float sensitivity = 0.2;     // Coeficiente de sensibilidade (para fórmula base)
-    
-    // pH Bruto = 7.0 - ((Tensão Lida - Tensão Neutra) / Sensibilidade)
-    float raw_pH_at_7 = 7.0 - ((measuredVoltage - neutralVoltage) / sensitivity); 
-    
-    // O offset é a diferença para levar o valor bruto a 7.0
-    phCalibrationOffset = 7.0 - raw_pH_at_7;
-    
-    // 4. Finaliza e Notifica
+    // Janela deslizante simples: qualquer excursão fora da faixa reinicia a contagem
+    if (phFilteredMv < phCalWindowMinMv) phCalWindowMinMv = phFilteredMv;
+    if (phFilteredMv > phCalWindowMaxMv) phCalWindowMaxMv = phFilteredMv;
+    if (phCalWindowMaxMv - phCalWindowMinMv > PH_CAL_STABLE_BAND_MV) {
+        phCalWindowStartMs = now;
+        phCalWindowMinMv = phFilteredMv;
+        phCalWindowMaxMv = phFilteredMv;
+        return;
+    }
+    if (now - phCalWindowStartMs < PH_CAL_STABLE_WINDOW_MS) return;
+
+    phCalCapturedMv[phCalPointIndex] = phFilteredMv;
+    Serial.print(F("pH CAL: ponto capturado em "));
+    Serial.print(phFilteredMv, 1);
+    Serial.println(F(" mV"));
+    phCalPointIndex++;
+
+    if (phCalPointIndex >= phCal.points) {
+        finishPhCalibration();
+        return;
+    }
+
+    phCalCurrentState = PH_CAL_WAIT_NEXT_BUFFER;
+    phCalStateStartMs = now; // Base do timeout da confirmação
+    char status[NET_MSG_TEXT_LEN];
+    snprintf(status, sizeof(status), "Coloque a sonda em pH %.2f e confirme",
+             PH_CAL_BUFFERS[phCalPointIndex]);
+    publishPhCalStatus(status);
+}
+
+void finishPhCalibration() {
+    float neutralMv = phCalCapturedMv[0];
+    float acidSlope = phCal.acidSlopeMv; // 1 ponto: mantém as inclinações atuais
+    float baseSlope = phCal.baseSlopeMv;
+
+    if (phCal.points >= 2) {
+        acidSlope = (phCalCapturedMv[1] - neutralMv) / (PH_CAL_BUFFER_NEUTRAL - PH_CAL_BUFFER_ACID);
+        baseSlope = acidSlope;
+    }
+    if (phCal.points >= 3) {
+        baseSlope = (neutralMv - phCalCapturedMv[2]) / (PH_CAL_BUFFER_BASE - PH_CAL_BUFFER_NEUTRAL);
+    }
+
+    if (acidSlope < PH_SLOPE_MV_MIN || acidSlope > PH_SLOPE_MV_MAX ||
+        baseSlope < PH_SLOPE_MV_MIN || baseSlope > PH_SLOPE_MV_MAX) {
+        cancelPhCalibration("Calibracao de pH rejeitada: inclinacao fora da faixa.");
+        return;
+    }
+
+    phCal.neutralMv = neutralMv;
+    phCal.acidSlopeMv = acidSlope;
+    phCal.baseSlopeMv = baseSlope;
+    phCalibrationOffset = 0.0f; // O ponto neutro medido já incorpora o antigo offset
+    phCalCurrentState = PH_CAL_IDLE;
     phCalibrationMode = false;
-    
-    // Logs no Serial
-    Serial.print(F("Leitura de Tensão (Media): ")); Serial.print(measuredVoltage, 4); Serial.println(F("V"));
-    Serial.print(F("pH Bruto Calculado: ")); Serial.print(raw_pH_at_7, 2);
-    Serial.print(F(" | Novo Offset Aplicado: ")); Serial.println(phCalibrationOffset, 3);
-    
-    // 5. Notificação Blynk
-    if (Blynk.connected()) {
-        Blynk.virtualWrite(VPIN_CAL_STATUS, String(F("Offset: ")) + phCalibrationOffset);
-        String msg = String(F("Novo offset de pH aplicado: ")) + phCalibrationOffset;
-        logSystemEvent("info", msg.c_str());
+    markConfigDirty();          // Persistido pela tarefa de rede (checkConfigSave)
+
+    char status[NET_MSG_TEXT_LEN];
+    snprintf(status, sizeof(status), "OK: %.1fmV %.1f/%.1f mV/pH", neutralMv, acidSlope, baseSlope);
+    publishPhCalStatus(status);
+    logSystemEvent("success", "Nova calibracao de pH aplicada.");
+}
+
+// --- 5. FUNÇÃO CENTRAL DE CALIBRAÇÃO (REUTILIZÁVEL) ---
+// Esta função contém a lógica de calibração. Ela pode ser chamada
+// pelo Blynk, por um botão físico, ou por qualquer outra fonte (sempre na tarefa de controle).
+// Ocioso: inicia | Aguardando tampão: confirma o próximo ponto | Estabilizando: cancela.
+void executePhCalibration() {
+    switch (phCalCurrentState) {
+        case PH_CAL_IDLE:
+            startPhCalibration(phCal.points);
+            break;
+        case PH_CAL_WAIT_NEXT_BUFFER:
+            beginPhCalibrationPoint();
+            break;
+        case PH_CAL_STABILIZING:
+            cancelPhCalibration("Calibracao de pH cancelada pelo usuario.");
+            break;
     }
-    
-    // 6. Persistência de dados (salvando no SPIFFS/LitleFS)
-    saveConfig();
-    
 }
 
-// --- 3. MANIPULADOR BLYNK (WRAPPER) ---
-// O BLYNK_WRITE apenas reage ao pino virtual e chama a função central
+// --- 6. MANIPULADORES BLYNK (WRAPPER) ---
+// O BLYNK_WRITE apenas reage ao pino virtual e encaminha o comando à tarefa de controle
 BLYNK_WRITE(VPIN_PH_CAL) {
     int buttonState = param.asInt();
     
     if (buttonState == 1) { // Ação ao pressionar (DOWN) o botão no Blynk
-        executePhCalibration();
+        postControlCommand(CMD_PH_CALIBRATE, 0);
     }
 }
 
-// --- 3. LÓGICA DE ALERTA DE PH ---
-void checkPhAlert(float currentPh) {
-    bool alertCondition = false;
-    String alertMessage = "";
-
-    if (currentPh < PH_MIN_LIMIT) {
-        alertCondition = true;
-        alertMessage = String(F("ALERTA: PH MUITO ÁCIDO! Valor: ")) + currentPh;
-    } else if (currentPh > PH_MAX_LIMIT) {
-        alertCondition = true;
-        alertMessage = String(F("ALERTA: PH MUITO ALCALINO! Valor: ")) + currentPh;
+// Número de pontos da próxima calibração (1 = offset, 2 = pH 7/4, 3 = pH 7/4/10)
+BLYNK_WRITE(VPIN_PH_CAL_POINTS) {
+    int points = param.asInt();
+    if (points >= 1 && points <= 3 && phCalCurrentState == PH_CAL_IDLE) {
+        receiveBlynkSetting(SYNC_SET_PH_CAL_POINTS, (float)points); // Aplica (ou guarda para o lote da reconexão)
     }
-
-    if (alertCondition) {
-        // A condição de alerta está ativa
-
-        if (!phAlertSent) {
-            // Envia o alerta apenas se ainda não tiver sido enviado
-            Serial.println(alertMessage);
-            
-            if (Blynk.connected()) {
-                logSystemEvent("critical", alertMessage.c_str());
-                // Blynk.logEvent("ph_alert", alertMessage);
-                Blynk.virtualWrite(VPIN_PH_ALERT, 255); // Ex: Acende o LED (valor 255)
-            }
-            phAlertSent = true;
-        }
-
-    } else {
-        // Condição normal: o pH está dentro dos limites
-
-        if (phAlertSent) {
-            // Envia notificação de "tudo resolvido" se o alerta estava ativo
-            Serial.println(F("PH ESTÁVEL. Condição de alerta resolvida."));
-            
-            if (Blynk.connected()) {
-                logSystemEvent("warning", "O pH voltou aos limites operacionais.");
-                // Blynk.logEvent("ph_stable", "O pH voltou aos limites operacionais.");
-                Blynk.virtualWrite(VPIN_PH_ALERT, 0); // Ex: Apaga o LED (valor 0)
-            }
-            // Resetar a flag para permitir um novo alerta no futuro
-            phAlertSent = false;
-        }
-        
-        // Se a condição estava normal, apenas garante que o LED está desligado (0)
-        // Isso evita que o Blynk.virtualWrite seja chamado a cada loop se o LED já estiver em 0
-        if (Blynk.connected()) {
-            Blynk.virtualWrite(VPIN_PH_ALERT, 0); 
-        }
-    }
-}
\ No newline at end of file
+}
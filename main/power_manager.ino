@@ -0,0 +1,202 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: POWER_MANAGER               |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Power: tickless idle waits, automatic light sleep, idle/wake-latency statistics
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.01 - Deadline/notification waits for the RTOS tasks, automatic light sleep with busy lock, idle and wake-latency stats
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - (this file) Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- ENERGIA E SONO LEVE ---
+// As três tarefas FreeRTOS bloqueiam até o prazo da próxima tarefa periódica do grupo ou até uma
+// notificação (ISR de botão, comando na fila). Com os dois núcleos ociosos, o FreeRTOS sem tick
+// e a gerência de energia do ESP-IDF colocam o chip em sono leve automático; ele acorda no próximo
+// timer, num beacon DTIM do Wi-Fi (modem sleep) ou numa borda de botão (despertar por GPIO).
+// Enquanto há bomba/válvula/TPA em andamento, a tarefa de controle segura um impedimento de sono
+// (ESP_PM_NO_LIGHT_SLEEP): os tempos de dose não dependem do despertar.
+// Mede, por grupo, o tempo acordado/bloqueado e o atraso do despertar em relação ao prazo pedido.
+// Obs.: durante o sono leve as bordas do SQW do RTC se perdem (despertar por GPIO é por nível e o
+// SQW fica baixo meio segundo); o serviço de relógio trata como SQW ausente e relê o RTC de tempos
+// em tempos, extrapolando pelo esp_timer (que segue contando no sono leve).
+
+PowerStats powerStats;
+
+static uint8_t powerBusyMask = 0;              // PowerBusySource ativos
+static bool busyLockHeld = false;
+static int64_t lastWakeUs[SCHED_GROUP_COUNT];  // Fim da última espera de cada grupo
+#if ACC_LIGHT_SLEEP
+static esp_pm_lock_handle_t noSleepLock = NULL;
+#endif
+
+
+// 1. --- SETUP ---
+void setupPowerManagement() {
+    memset(&powerStats, 0, sizeof(powerStats));
+    powerStats.windowStartUs = esp_timer_get_time();
+    for (uint8_t g = 0; g < SCHED_GROUP_COUNT; g++) lastWakeUs[g] = powerStats.windowStartUs;
+
+#if ACC_LIGHT_SLEEP
+    esp_pm_config_esp32_t pmConfig;
+    pmConfig.max_freq_mhz = PM_CPU_MAX_MHZ;
+    pmConfig.min_freq_mhz = PM_CPU_MIN_MHZ;
+    pmConfig.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&pmConfig);
+    if (err != ESP_OK) {
+        Serial.println(F("AVISO: Sono leve indisponivel (sdkconfig sem PM/tickless). Apenas esperas longas."));
+        LOG_WARNING(LOG_SRC_SYSTEM, "Sono leve indisponivel: %s", esp_err_to_name(err));
+        return;
+    }
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "acc_busy", &noSleepLock);
+
+    enableButtonWakeups();         // Toque em qualquer botão acorda o chip
+    esp_sleep_enable_gpio_wakeup();
+    WiFi.setSleep(true);           // Modem sleep: o rádio acorda só nos beacons DTIM
+
+    powerStats.lightSleepEnabled = true;
+    Serial.println(F("Energia: sono leve automatico ativo (DFS 80-240 MHz)."));
+    logSystemEvent("info", "Sono leve automatico ativo.");
+
+    if (powerBusyMask != 0) { // Algum módulo já pediu para ficar acordado no setup (ex.: eco ultrassônico)
+        esp_pm_lock_acquire(noSleepLock);
+        busyLockHeld = true;
+        powerStats.busyLockAcquires++;
+    }
+#else
+    Serial.println(F("Energia: sono leve desativado (ACC_LIGHT_SLEEP = 0)."));
+#endif
+}
+
+// Segura/libera o impedimento de sono leve. Só a tarefa de controle chama depois do setup().
+void setPowerBusy(uint8_t source, bool busy) {
+    if (busy) powerBusyMask |= source;
+    else powerBusyMask &= ~source;
+
+#if ACC_LIGHT_SLEEP
+    if (!powerStats.lightSleepEnabled || noSleepLock == NULL) return;
+    bool wantLock = powerBusyMask != 0;
+    if (wantLock == busyLockHeld) return;
+    if (wantLock) {
+        esp_pm_lock_acquire(noSleepLock);
+        powerStats.busyLockAcquires++;
+    } else {
+        esp_pm_lock_release(noSleepLock);
+    }
+    busyLockHeld = wantLock;
+#endif
+}
+
+
+// 2. --- ESPERA DAS TAREFAS ---
+// Bloqueia a tarefa chamadora por até waitMs ou até notifySchedulerGroup(). Substitui o vTaskDelay
+// fixo: a espera acompanha o prazo real do próximo trabalho do grupo.
+void waitForSchedulerWork(uint8_t group, unsigned long waitMs) {
+    PowerGroupStats& st = powerStats.groups[group];
+    if (waitMs < 1) waitMs = 1;
+
+    int64_t startUs = esp_timer_get_time();
+    st.busyUs += (uint64_t)(startUs - lastWakeUs[group]);
+
+    uint32_t notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+
+    int64_t endUs = esp_timer_get_time();
+    lastWakeUs[group] = endUs;
+    st.blockedUs += (uint64_t)(endUs - startUs);
+    if (notified) {
+        st.notifiedWakes++;
+        return;
+    }
+    // Despertar pelo prazo: quanto passou do pedido (tick, saída do sono leve, preempção)
+    st.timedWakes++;
+    int64_t lateUs = (endUs - startUs) - (int64_t)waitMs * 1000;
+    if (lateUs < 0) lateUs = 0;
+    st.wakeLateSumUs += (uint64_t)lateUs;
+    if ((uint32_t)lateUs > st.wakeLateMaxUs) st.wakeLateMaxUs = (uint32_t)lateUs;
+}
+
+
+// 3. --- RELATÓRIO ---
+// Ocioso por núcleo = parte da janela em que nenhuma tarefa ACC do núcleo estava acordada
+// (não inclui a pilha Wi-Fi/lwIP do núcleo 0).
+void reportPowerStats() {
+    int64_t nowUs = esp_timer_get_time();
+    float windowUs = (float)(nowUs - powerStats.windowStartUs);
+    if (windowUs <= 0.0f) return;
+
+    char line[112];
+    for (uint8_t g = 0; g < SCHED_GROUP_COUNT; g++) {
+        const PowerGroupStats& st = powerStats.groups[g];
+        unsigned long avgLateUs = st.timedWakes ? (unsigned long)(st.wakeLateSumUs / st.timedWakes) : 0;
+        snprintf(line, sizeof(line), "ENERGIA [%s]: acordada %.1f%% despertares %lu prazo / %lu notif, atraso med %lu us max %lu us",
+                 schedulerGroupNames[g], st.busyUs * 100.0f / windowUs, st.timedWakes, st.notifiedWakes,
+                 avgLateUs, (unsigned long)st.wakeLateMaxUs);
+        Serial.println(line);
+    }
+    float core1Busy = (powerStats.groups[SCHED_GROUP_CONTROL].busyUs + powerStats.groups[SCHED_GROUP_UI].busyUs) * 100.0f / windowUs;
+    float core0Busy = powerStats.groups[SCHED_GROUP_NETWORK].busyUs * 100.0f / windowUs;
+    snprintf(line, sizeof(line), "ENERGIA: ocioso nucleo0 %.1f%% nucleo1 %.1f%%, sono leve %s, impedimento %s (%lu)",
+             100.0f - core0Busy, 100.0f - core1Busy, powerStats.lightSleepEnabled ? "ATIVO" : "inativo",
+             busyLockHeld ? "SIM" : "nao", powerStats.busyLockAcquires);
+    Serial.println(line);
+    reportButtonStats();
+
+    // Nova janela
+    for (uint8_t g = 0; g < SCHED_GROUP_COUNT; g++) {
+        PowerGroupStats& st = powerStats.groups[g];
+        st.busyUs = st.blockedUs = st.wakeLateSumUs = 0;
+        st.timedWakes = st.notifiedWakes = 0;
+        st.wakeLateMaxUs = 0;
+    }
+    powerStats.windowStartUs = nowUs;
+}
@@ -0,0 +1,275 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: PROFILER                    |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Runtime profiler: per-subsystem latency histograms, heap/stack watermarks, serial console
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.05 - Probe clock note: esp_timer when DFS is enabled
+15/10/2026 - 0.04 - Console commands 'temp' and 'temp reset'
+15/10/2026 - 0.03 - Console command 'sync'
+15/10/2026 - 0.02 - Console command 'power' (idle/wake-latency and button response stats)
+15/10/2026 - 0.01 - Cycle-counter probes, heap/stack watermarks, OLED page, serial console and Blynk summary
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - (this file) Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- PROFILER DE EXECUÇÃO ---
+// PROFILE_SCOPE(PROF_x) no início de cada ponto de entrada mede a duração pelo contador de
+// ciclos do núcleo (CCOUNT; com sono leve/DFS ativo, µs do esp_timer - ver hal.h): contagem de
+// chamadas, total, máximo e histograma log2 em µs.
+// Cada sonda pertence a uma única tarefa (as tarefas são fixas em núcleos), então o registro
+// não precisa de trava; quem lê (display, console) aceita um valor levemente defasado.
+// A tarefa de rede "perfil" amostra heap e pilhas, atende o console serial e publica o resumo
+// no Blynk (VPIN_DIAGNOSTICS).
+
+ProfileProbeStats profileProbes[PROF_PROBE_COUNT];
+ProfilerSystemStats profilerSystem;
+
+static const char* const PROFILE_PROBE_NAMES[PROF_PROBE_COUNT] = {
+    "blynk", "display", "oled_i2c", "onewire", "ph_adc", "cfg_save",
+    "hist_fs", "tpa", "dosagem", "eventos", "telemetria",
+    "nivel_ran"
+};
+
+static char consoleLine[PROFILER_CONSOLE_LINE_LEN];
+static uint8_t consoleLength = 0;
+static unsigned long lastPublishMs = 0;
+
+
+// 1. --- REGISTRO (caminho quente: sem divisão além do log2, sem trava) ---
+void profileRecord(uint8_t probe, uint32_t cycles) {
+    if (probe >= PROF_PROBE_COUNT) return;
+    ProfileProbeStats& stats = profileProbes[probe];
+    stats.calls++;
+    stats.totalCycles += cycles;
+    stats.lastCycles = cycles;
+    if (cycles > stats.maxCycles) stats.maxCycles = cycles;
+
+    uint32_t us = cycles / halCyclesPerUs();
+    uint8_t bucket = us == 0 ? 0 : (uint8_t)(32 - __builtin_clz(us)); // [2^(b-1), 2^b) µs
+    if (bucket >= PROFILE_HIST_BUCKETS) bucket = PROFILE_HIST_BUCKETS - 1;
+    stats.hist[bucket]++;
+}
+
+uint32_t profileCyclesToUs(uint32_t cycles) {
+    return cycles / halCyclesPerUs();
+}
+
+// Percentil aproximado pelo histograma (limite superior da faixa, em µs)
+uint32_t getProfilePercentileUs(uint8_t probe, uint8_t percent) {
+    const ProfileProbeStats& stats = profileProbes[probe];
+    if (stats.calls == 0) return 0;
+    uint32_t target = (uint32_t)(((uint64_t)stats.calls * percent + 99) / 100);
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < PROFILE_HIST_BUCKETS; b++) {
+        seen += stats.hist[b];
+        if (seen >= target) return 1UL << b;
+    }
+    return 1UL << (PROFILE_HIST_BUCKETS - 1);
+}
+
+void resetProfiler() {
+    memset(profileProbes, 0, sizeof(profileProbes));
+    profilerSystem.minFreeHeap = profilerSystem.freeHeap;
+    profilerSystem.minLargestBlock = profilerSystem.largestBlock;
+    Serial.println(F("PERFIL: Estatisticas zeradas."));
+}
+
+
+// 2. --- AMOSTRAGEM DE MEMÓRIA (heap, maior bloco livre, pilhas) ---
+static void sampleProfilerSystem() {
+    profilerSystem.freeHeap = ESP.getFreeHeap();
+    profilerSystem.largestBlock = ESP.getMaxAllocHeap();
+    if (profilerSystem.minFreeHeap == 0 || profilerSystem.freeHeap < profilerSystem.minFreeHeap) {
+        profilerSystem.minFreeHeap = profilerSystem.freeHeap;
+    }
+    if (profilerSystem.minLargestBlock == 0 || profilerSystem.largestBlock < profilerSystem.minLargestBlock) {
+        profilerSystem.minLargestBlock = profilerSystem.largestBlock;
+    }
+
+    // No ESP-IDF a marca d'água da pilha vem em bytes (menor folga desde a criação da tarefa)
+    TaskHandle_t handles[SCHED_GROUP_COUNT] = { controlTaskHandle, networkTaskHandle, uiTaskHandle };
+    for (uint8_t i = 0; i < SCHED_GROUP_COUNT; i++) {
+        profilerSystem.stackFreeBytes[i] = handles[i] ? uxTaskGetStackHighWaterMark(handles[i]) : 0;
+    }
+}
+
+
+// 3. --- RELATÓRIO NO SERIAL ---
+void reportProfiler() {
+    Serial.println(F("--- PERFIL (us) ---"));
+    Serial.println(F("sonda        chamadas   media    p99     max"));
+    char line[80];
+    for (uint8_t i = 0; i < PROF_PROBE_COUNT; i++) {
+        const ProfileProbeStats& stats = profileProbes[i];
+        if (stats.calls == 0) continue;
+        uint32_t avgUs = profileCyclesToUs((uint32_t)(stats.totalCycles / stats.calls));
+        snprintf(line, sizeof(line), "%-12s %8lu %7lu %6lu %7lu",
+                 PROFILE_PROBE_NAMES[i], (unsigned long)stats.calls, (unsigned long)avgUs,
+                 (unsigned long)getProfilePercentileUs(i, 99),
+                 (unsigned long)profileCyclesToUs(stats.maxCycles));
+        Serial.println(line);
+    }
+    snprintf(line, sizeof(line), "heap %lu (min %lu) maior bloco %lu (min %lu)",
+             (unsigned long)profilerSystem.freeHeap, (unsigned long)profilerSystem.minFreeHeap,
+             (unsigned long)profilerSystem.largestBlock, (unsigned long)profilerSystem.minLargestBlock);
+    Serial.println(line);
+    snprintf(line, sizeof(line), "pilha livre: controle %lu rede %lu ui %lu",
+             (unsigned long)profilerSystem.stackFreeBytes[SCHED_GROUP_CONTROL],
+             (unsigned long)profilerSystem.stackFreeBytes[SCHED_GROUP_NETWORK],
+             (unsigned long)profilerSystem.stackFreeBytes[SCHED_GROUP_UI]);
+    Serial.println(line);
+}
+
+// Histograma de uma sonda: "prof <nome>"
+static void reportProfileHistogram(uint8_t probe) {
+    const ProfileProbeStats& stats = profileProbes[probe];
+    Serial.print(F("Histograma "));
+    Serial.println(PROFILE_PROBE_NAMES[probe]);
+    for (uint8_t b = 0; b < PROFILE_HIST_BUCKETS; b++) {
+        if (stats.hist[b] == 0) continue;
+        Serial.print(F("  < "));
+        Serial.print(1UL << b);
+        Serial.print(F(" us: "));
+        Serial.println(stats.hist[b]);
+    }
+}
+
+
+// 4. --- CONSOLE SERIAL (tarefa de rede: dona do LittleFS, então pode exportar a config) ---
+static void printFileToSerial(const char* path) {
+    File file = LittleFS.open(path, "r");
+    if (!file) return;
+    while (file.available()) Serial.write(file.read());
+    file.close();
+    Serial.println();
+}
+
+static void handleConsoleCommand(char* cmd) {
+    if (strcmp(cmd, "prof") == 0) {
+        reportProfiler();
+    } else if (strcmp(cmd, "prof reset") == 0) {
+        resetProfiler();
+    } else if (strncmp(cmd, "prof ", 5) == 0) {
+        for (uint8_t i = 0; i < PROF_PROBE_COUNT; i++) {
+            if (strcmp(cmd + 5, PROFILE_PROBE_NAMES[i]) == 0) {
+                reportProfileHistogram(i);
+                return;
+            }
+        }
+        Serial.println(F("PERFIL: Sonda desconhecida."));
+    } else if (strcmp(cmd, "loop") == 0) {
+        for (uint8_t g = 0; g < SCHED_GROUP_COUNT; g++) reportLoopStats(g);
+    } else if (strcmp(cmd, "log") == 0) {
+        reportEventLogStats();
+    } else if (strcmp(cmd, "ran") == 0) {
+        reportRanLevel();
+    } else if (strcmp(cmd, "alert") == 0) {
+        reportAlertRules(); // Leitura da tabela (escrita só pela tarefa de controle)
+    } else if (strcmp(cmd, "temp") == 0) {
+        reportTemperatureProbes();
+    } else if (strcmp(cmd, "temp reset") == 0) {
+        clearTemperatureProbeMap();
+    } else if (strcmp(cmd, "sync") == 0) {
+        reportStateSyncStats();
+    } else if (strcmp(cmd, "power") == 0) {
+        reportPowerStats(); // Abre nova janela de medição
+    } else if (strcmp(cmd, "cfg") == 0) {
+        if (exportConfigJson(CONFIG_EXPORT_PATH)) printFileToSerial(CONFIG_EXPORT_PATH);
+    } else if (cmd[0] != '\0') {
+        Serial.println(F("Comandos: prof | prof reset | prof <sonda> | loop | log | alert | ran | power | sync | temp | temp reset | cfg"));
+    }
+}
+
+static void pollSerialConsole() {
+    while (Serial.available() > 0) {
+        char c = (char)Serial.read();
+        if (c == '\r') continue;
+        if (c == '\n') {
+            consoleLine[consoleLength] = '\0';
+            handleConsoleCommand(consoleLine);
+            consoleLength = 0;
+        } else if (consoleLength < PROFILER_CONSOLE_LINE_LEN - 1) {
+            consoleLine[consoleLength++] = c;
+        }
+    }
+}
+
+
+// 5. --- TAREFA DE REDE "perfil" ---
+void runProfilerTask() {
+    sampleProfilerSystem();
+    pollSerialConsole();
+
+    // Resumo no Blynk: heap, maior bloco, pior latência de Blynk.run() e do quadro do OLED
+    if (halMillis() - lastPublishMs >= PROFILER_PUBLISH_MS) {
+        lastPublishMs = halMillis();
+        char text[NET_MSG_TEXT_LEN];
+        snprintf(text, sizeof(text), "heap %luk blk %luk blynk %lums oled %lums",
+                 (unsigned long)(profilerSystem.freeHeap / 1024),
+                 (unsigned long)(profilerSystem.largestBlock / 1024),
+                 (unsigned long)(profileCyclesToUs(profileProbes[PROF_BLYNK_RUN].maxCycles) / 1000),
+                 (unsigned long)(profileCyclesToUs(profileProbes[PROF_DISPLAY].maxCycles) / 1000));
+        publishVirtualPinText(VPIN_DIAGNOSTICS, text);
+    }
+}
+
+// Texto curto de uma sonda para a página de diagnóstico do OLED: "nome p99/max ms"
+const char* getProfileProbeName(uint8_t probe) {
+    return probe < PROF_PROBE_COUNT ? PROFILE_PROBE_NAMES[probe] : "";
+}
+
+// Pedido do Blynk: relatório completo no Serial na próxima passagem da tarefa de rede
+BLYNK_WRITE(VPIN_DIAGNOSTICS) {
+    if (param.asInt() == 1) reportProfiler();
+}
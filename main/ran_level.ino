@@ -0,0 +1,344 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: RAN_LEVEL                   |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Continuous RAN level sensing (filter, geometry table, fill rate, valve checks)
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.03 - Calibration with a zero final volume (capacity) is rejected
+15/10/2026 - 0.02 - Ultrasonic echo holds the no-light-sleep lock
+15/10/2026 - 0.01 - Analog/ultrasonic level input next to the float: median+IIR filter, geometry table to litres, fill rate, stuck valve detection
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - (this file) Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- NÍVEL CONTÍNUO DO RAN ---
+// A boia só diz "cheio" ou "não cheio". Este módulo lê um sensor contínuo (analógico no ADC1 ou
+// ultrassônico por eco), filtra (mediana + IIR), converte em altura pela calibração de dois pontos
+// e em litros pela tabela de geometria do reservatório, e calcula a vazão líquida (L/min).
+// - Enchimento (M5.3) termina no volume alvo e fecha a válvula se a vazão não aparecer.
+// - Reposição (M5.2) termina no volume que saiu do RAN (a dose da bomba vira só limite).
+// - Com a válvula fechada, subida de nível = válvula travada aberta (alerta).
+// A tarefa de controle "nivel_ran" é a única que escreve ranLevel/ranLevelFull/ranLevelPercent.
+
+RanLevelCalibration ranLevelCal;
+RanLevelState ranLevel;
+
+static float levelRing[16];                        // Leituras brutas válidas (mV ou mm)
+static uint8_t levelRingCount = 0;
+static uint8_t levelRingHead = 0;
+static uint8_t levelInvalidCount = 0;
+static bool levelFilterPrimed = false;
+
+static float levelRateRing[RAN_LEVEL_RATE_WINDOW_S + 1]; // Um volume por segundo
+static uint8_t levelRateHead = 0;
+static uint8_t levelRateCount = 0;
+static unsigned long lastLevelRateSlotMs = 0;
+
+static unsigned long levelLeakSinceMs = 0;
+static bool levelLeakSuspected = false;
+static bool levelLeakAlarmed = false;
+
+#if RAN_LEVEL_INPUT == RAN_LEVEL_INPUT_ANALOG
+static esp_adc_cal_characteristics_t levelAdcChars;
+#elif RAN_LEVEL_INPUT == RAN_LEVEL_INPUT_ULTRASONIC
+// Largura do eco medida pela interrupção (bordas de subida e descida)
+static portMUX_TYPE levelEchoMux = portMUX_INITIALIZER_UNLOCKED;
+static volatile int64_t echoRiseUs = 0;
+static volatile uint32_t echoWidthUs = 0;
+static volatile bool echoReady = false;
+
+void IRAM_ATTR onRanLevelEcho() {
+    int64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&levelEchoMux);
+    if (digitalRead(RAN_LEVEL_ECHO_PIN) == HIGH) {
+        echoRiseUs = nowUs;
+    } else if (echoRiseUs != 0) {
+        echoWidthUs = (uint32_t)(nowUs - echoRiseUs);
+        echoRiseUs = 0;
+        echoReady = true;
+    }
+    portEXIT_CRITICAL_ISR(&levelEchoMux);
+}
+#endif
+
+
+// 1. --- CALIBRAÇÃO E GEOMETRIA ---
+void setRanLevelCalibrationDefaults(RanLevelCalibration& cal) {
+    memset(&cal, 0, sizeof(cal));
+#if RAN_LEVEL_INPUT == RAN_LEVEL_INPUT_ULTRASONIC
+    cal.emptyReading = RAN_LEVEL_EMPTY_MM_DEFAULT;
+    cal.fullReading = RAN_LEVEL_FULL_MM_DEFAULT;
+#else
+    cal.emptyReading = RAN_LEVEL_EMPTY_MV_DEFAULT;
+    cal.fullReading = RAN_LEVEL_FULL_MV_DEFAULT;
+#endif
+    cal.fullHeightMm = RAN_LEVEL_HEIGHT_MM_DEFAULT;
+    cal.targetLiters = RAN_TARGET_L_DEFAULT;
+    // Prisma: dois pontos bastam. Tanques cônicos/irregulares ganham pontos intermediários no JSON.
+    cal.geometryPoints = 2;
+    cal.geometry[0] = { 0.0f, 0.0f };
+    cal.geometry[1] = { RAN_LEVEL_HEIGHT_MM_DEFAULT, RAN_CAPACITY_L_DEFAULT };
+}
+
+// Calibração carregada do config/JSON: rejeita tabelas que quebrariam a interpolação
+bool isRanLevelCalibrationValid(const RanLevelCalibration& cal) {
+    if (cal.geometryPoints < 2 || cal.geometryPoints > RAN_GEOMETRY_MAX_POINTS) return false;
+    if (cal.fullHeightMm <= 0.0f || fabsf(cal.fullReading - cal.emptyReading) < 1.0f) return false;
+    for (uint8_t i = 1; i < cal.geometryPoints; i++) {
+        if (cal.geometry[i].heightMm <= cal.geometry[i - 1].heightMm) return false;
+        if (cal.geometry[i].liters < cal.geometry[i - 1].liters) return false;
+    }
+    // Último ponto = capacidade (divisor do percentual): tabela toda em 0 L não mede nada
+    if (!(cal.geometry[cal.geometryPoints - 1].liters > 0.0f)) return false;
+    return true;
+}
+
+float getRanCapacityLiters() {
+    return ranLevelCal.geometry[ranLevelCal.geometryPoints - 1].liters;
+}
+
+// Altura -> litros: interpolação linear por trechos; acima do último ponto, segue o último trecho
+static float litersFromHeight(float heightMm) {
+    const RanGeometryPoint* geo = ranLevelCal.geometry;
+    uint8_t last = ranLevelCal.geometryPoints - 1;
+    if (heightMm <= geo[0].heightMm) return geo[0].liters;
+    uint8_t i = 1;
+    while (i < last && heightMm > geo[i].heightMm) i++;
+    float span = geo[i].heightMm - geo[i - 1].heightMm;
+    return geo[i - 1].liters + (heightMm - geo[i - 1].heightMm) * (geo[i].liters - geo[i - 1].liters) / span;
+}
+
+
+// 2. --- SETUP ---
+void setupRanLevel() {
+    // Boia: limite físico de "cheio" (HIGH = abaixo do nível, LOW = cheio; pull-up)
+    halPinMode(RAN_LEVEL_SENSOR_PIN, INPUT_PULLUP);
+    ranLevelFull = readRanLevelSensor();
+    ranLevelPercent = ranLevelFull ? 100 : 0;
+    memset(&ranLevel, 0, sizeof(ranLevel));
+
+#if RAN_LEVEL_INPUT == RAN_LEVEL_INPUT_ANALOG
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(RAN_LEVEL_ADC_CHANNEL, RAN_LEVEL_ADC_ATTEN);
+    esp_adc_cal_characterize(ADC_UNIT_1, RAN_LEVEL_ADC_ATTEN, ADC_WIDTH_BIT_12, PH_ADC_DEFAULT_VREF_MV, &levelAdcChars);
+    Serial.println(F("Nivel RAN: sensor analogico no ADC1 + boia."));
+#elif RAN_LEVEL_INPUT == RAN_LEVEL_INPUT_ULTRASONIC
+    halPinMode(RAN_LEVEL_TRIG_PIN, OUTPUT);
+    halDigitalWrite(RAN_LEVEL_TRIG_PIN, LOW);
+    halPinMode(RAN_LEVEL_ECHO_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(RAN_LEVEL_ECHO_PIN), onRanLevelEcho, CHANGE);
+    setPowerBusy(POWER_BUSY_LEVEL_ECHO, true); // O eco é cronometrado por interrupção: sem sono leve
+    Serial.println(F("Nivel RAN: sensor ultrassonico + boia."));
+#else
+    Serial.println(F("Nivel RAN: somente boia (sem sensor continuo)."));
+#endif
+}
+
+
+// 3. --- AQUISIÇÃO ---
+// Uma leitura crua do sensor; NAN se fora da faixa plausível
+static float readRawLevel() {
+#if RAN_LEVEL_INPUT == RAN_LEVEL_INPUT_ANALOG
+    uint32_t raw = 0;
+    for (uint8_t i = 0; i < 4; i++) raw += (uint32_t)adc1_get_raw(RAN_LEVEL_ADC_CHANNEL);
+    float mv = (float)esp_adc_cal_raw_to_voltage(raw / 4, &levelAdcChars);
+    return (mv < RAN_LEVEL_ADC_MIN_MV || mv > RAN_LEVEL_ADC_MAX_MV) ? NAN : mv;
+#elif RAN_LEVEL_INPUT == RAN_LEVEL_INPUT_ULTRASONIC
+    // Colhe o eco do disparo anterior (100 ms atrás) e dispara o próximo: nunca espera o eco
+    float mm = NAN;
+    portENTER_CRITICAL(&levelEchoMux);
+    bool ready = echoReady;
+    uint32_t widthUs = echoWidthUs;
+    echoReady = false;
+    echoRiseUs = 0;
+    portEXIT_CRITICAL(&levelEchoMux);
+    if (ready && widthUs >= RAN_LEVEL_ECHO_MIN_US && widthUs <= RAN_LEVEL_ECHO_MAX_US) {
+        mm = widthUs * RAN_LEVEL_SOUND_MM_PER_US;
+    }
+    halDigitalWrite(RAN_LEVEL_TRIG_PIN, HIGH);
+    delayMicroseconds(10); // Pulso de disparo do transdutor
+    halDigitalWrite(RAN_LEVEL_TRIG_PIN, LOW);
+    return mm;
+#else
+    return NAN;
+#endif
+}
+
+// Mediana das últimas RAN_LEVEL_MEDIAN_WINDOW leituras (ordenação por inserção numa cópia local)
+static float computeLevelMedian() {
+    float window[RAN_LEVEL_MEDIAN_WINDOW];
+    uint8_t n = levelRingCount < RAN_LEVEL_MEDIAN_WINDOW ? levelRingCount : RAN_LEVEL_MEDIAN_WINDOW;
+    for (uint8_t i = 0; i < n; i++) {
+        float v = levelRing[(levelRingHead + 16 - 1 - i) % 16];
+        int j = i - 1;
+        while (j >= 0 && window[j] > v) {
+            window[j + 1] = window[j];
+            j--;
+        }
+        window[j + 1] = v;
+    }
+    return window[n / 2];
+}
+
+static void markLevelLost() {
+    if (ranLevel.measured) {
+        LOG_ERROR(LOG_SRC_PUMP, "Sensor de nivel do RAN sem leitura valida. Usando so a boia.");
+    }
+    ranLevel.measured = false;
+    ranLevel.rateValid = false;
+    levelFilterPrimed = false;
+    levelRingCount = 0;
+    levelRateCount = 0;
+}
+
+// Vazão líquida pela diferença de volume na janela (anel de um ponto por segundo)
+static void updateFillRate(unsigned long nowMs) {
+    if (nowMs - lastLevelRateSlotMs < RAN_LEVEL_RATE_SLOT_MS) return;
+    lastLevelRateSlotMs = nowMs;
+    const uint8_t slots = RAN_LEVEL_RATE_WINDOW_S + 1;
+    levelRateRing[levelRateHead] = ranLevel.liters;
+    levelRateHead = (levelRateHead + 1) % slots;
+    if (levelRateCount < slots) levelRateCount++;
+    if (levelRateCount == slots) {
+        float oldest = levelRateRing[levelRateHead]; // Próximo a ser sobrescrito = o mais antigo
+        ranLevel.fillRateLpm = (ranLevel.liters - oldest) * 60.0f / RAN_LEVEL_RATE_WINDOW_S;
+        ranLevel.rateValid = true;
+    }
+}
+
+// Válvula fechada e o nível subindo: travada aberta (ou vazamento da osmose)
+static void checkValveLeak(unsigned long nowMs) {
+    bool rising = ranLevel.rateValid && ranLevel.fillRateLpm > RAN_VALVE_LEAK_LPM;
+    if (isRanSolenoidOpen() || isPumpDoseActive(PUMP_BUFFER) || !rising) {
+        levelLeakSuspected = false;
+        levelLeakAlarmed = false;
+        return;
+    }
+    if (!levelLeakSuspected) {
+        levelLeakSuspected = true;
+        levelLeakSinceMs = nowMs;
+    } else if (!levelLeakAlarmed && nowMs - levelLeakSinceMs >= RAN_VALVE_LEAK_MS) {
+        levelLeakAlarmed = true;
+        ranLevel.leakEvents++;
+        setRANSolenoidState(false); // Reforça o comando de fechar
+        ranRefillAlertSent = true;
+        LOG_CRITICAL(LOG_SRC_PUMP, "RAN subindo %.2f L/min com a valvula FECHADA (valvula travada aberta?)",
+                     ranLevel.fillRateLpm);
+    }
+}
+
+// Tarefa do escalonador (grupo de controle, RAN_LEVEL_SAMPLE_PERIOD_MS)
+void runRanLevelAcquisition() {
+    PROFILE_SCOPE(PROF_RAN_LEVEL);
+    unsigned long nowMs = halMillis();
+    bool floatFull = readRanLevelSensor();
+
+    float reading = readRawLevel();
+    if (isnan(reading)) {
+        ranLevel.rejected++;
+        if (levelInvalidCount < 255) levelInvalidCount++;
+        if (levelInvalidCount >= RAN_LEVEL_MAX_INVALID) markLevelLost();
+    } else {
+        levelInvalidCount = 0;
+        ranLevel.samples++;
+        levelRing[levelRingHead] = reading;
+        levelRingHead = (levelRingHead + 1) % 16;
+        if (levelRingCount < 16) levelRingCount++;
+
+        if (levelRingCount >= RAN_LEVEL_MEDIAN_WINDOW) {
+            float median = computeLevelMedian();
+            if (!levelFilterPrimed) {
+                ranLevel.reading = median;
+                levelFilterPrimed = true;
+            } else {
+                ranLevel.reading += RAN_LEVEL_IIR_ALPHA * (median - ranLevel.reading);
+            }
+            float height = (ranLevel.reading - ranLevelCal.emptyReading) /
+                           (ranLevelCal.fullReading - ranLevelCal.emptyReading) * ranLevelCal.fullHeightMm;
+            ranLevel.heightMm = height > 0.0f ? height : 0.0f;
+            ranLevel.liters = litersFromHeight(ranLevel.heightMm);
+            if (!ranLevel.measured) LOG_INFO(LOG_SRC_PUMP, "Nivel RAN medido: %.2f L", ranLevel.liters);
+            ranLevel.measured = true;
+        }
+    }
+
+    if (ranLevel.measured) {
+        updateFillRate(nowMs);
+        checkValveLeak(nowMs);
+        int percent = (int)lroundf(ranLevel.liters * 100.0f / getRanCapacityLiters());
+        ranLevelPercent = percent < 0 ? 0 : (percent > 100 ? 100 : percent);
+        ranLevelFull = floatFull || ranLevel.liters >= ranLevelCal.targetLiters;
+    } else {
+        ranLevelPercent = floatFull ? 100 : 0;
+        ranLevelFull = floatFull;
+    }
+
+    updateRanLevelDisplay(); // Só enfileira quando o valor muda
+}
+
+bool isRanLevelMeasured() {
+    return ranLevel.measured;
+}
+
+void reportRanLevel() {
+    char line[96];
+    snprintf(line, sizeof(line), "RAN: %s %.1f L (%d%%) alt %.0f mm leitura %.1f vazao %.2f L/min boia %s",
+             ranLevel.measured ? "medido" : "SEM SENSOR", ranLevel.liters, ranLevelPercent, ranLevel.heightMm,
+             ranLevel.reading, ranLevel.rateValid ? ranLevel.fillRateLpm : 0.0f,
+             readRanLevelSensor() ? "cheio" : "baixo");
+    Serial.println(line);
+    snprintf(line, sizeof(line), "RAN: amostras %lu rejeitadas %lu vazamentos %lu alvo %.1f L / cap %.1f L",
+             (unsigned long)ranLevel.samples, (unsigned long)ranLevel.rejected,
+             (unsigned long)ranLevel.leakEvents, ranLevelCal.targetLiters, getRanCapacityLiters());
+    Serial.println(line);
+}
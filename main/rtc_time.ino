@@ -23,6 +23,11 @@
 
 
 == Version History ==
+15/10/2026 - 0.05 - BLYNK_CONNECTED() starts the versioned state sync instead of Blynk.syncAll()
+15/10/2026 - 0.04 - Clock service: single RTC read, esp_timer extrapolation, DS3231 1 Hz SQW edge alignment
+                    NTP-learned RTC drift compensation; NTP adjust applied on the UI task (I2C owner)
+                    Allocation-free formatClockTime/formatClockDateTime replace getCurrentTimeString()
+15/10/2026 - 0.03 - NTP sync requests schedule recompute
 31/10/2025 - 0.02 - Adjusted Blynk events to new log function. Included utils.h
                     Added checkRtcOsf() to deal with power lost
 31/10/2025 - 0.01 - First installment based on code created by Gemini AI (Google)
@@ -41,6 +46,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -51,49 +71,116 @@ tpa_reposition    - Control return of water volume
 // Define o objeto RTC (global, extern em global.h)
 RTC_DS3231 rtc;
 
-// --- FUNÇÕES GERAIS DE HORA ---
+// --- SERVIÇO DE RELÓGIO ---
+// O DS3231 é lido UMA vez (boot, e depois só se o SQW falhar). A hora é extrapolada a partir
+// de uma base (epoch inteiro + instante do esp_timer), sem I2C e sem alocação. Com o SQW de
+// 1 Hz ligado em RTC_SQW_PIN, cada borda de descida (virada do segundo no DS3231) realinha a
+// base: a hora fica presa aos segundos do RTC, não ao cristal do ESP32.
+// A deriva do próprio RTC em relação ao NTP é aprendida nos ajustes e compensada na leitura.
+portMUX_TYPE clockMux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t clockBaseEpoch = 0;            // Epoch (segundos inteiros) no instante clockBaseUs
+int64_t clockBaseUs = 0;                // esp_timer_get_time() no mesmo instante
+volatile int64_t clockLastEdgeUs = 0;   // Última borda do SQW (0 = nenhuma)
+ClockSource clockSource = CLOCK_SRC_NONE;
+bool clockSqwActive = false;
+float clockDriftPpm = 0.0f;             // Deriva do RTC aprendida do NTP (persistida)
+uint32_t clockLastNtpEpoch = 0;         // Último ajuste pelo NTP (persistido, referência da deriva)
+unsigned long clockLastRtcReadMs = 0;
+ClockStats clockStats;
 
-// Função principal para obter a hora atual para LOGICA (retorna um objeto DateTime)
-DateTime getDateTimeNow() {
-    // 1. Prioriza o RTC fisico se estiver OK
-    if (rtc_ok && !rtc_osf_flag) {
-        return rtc.now();
-    } 
-    
-    // 2. Fallback para hora NTP/Internet (se o Blynk estiver conectado)
-    if (Blynk.connected()) {
-        // A função now() do TimeLib (incluída pelo Blynk) retorna a hora sincronizada
-        return DateTime(year(), month(), day(), hour(), minute(), second());
+// Pedido de ajuste vindo da tarefa de rede: aplicado pela tarefa de UI, dona do barramento I2C
+volatile bool clockNtpPending = false;
+uint32_t clockNtpPendingEpoch = 0;
+int64_t clockNtpPendingUs = 0;
+
+
+// Borda do SQW: o segundo do DS3231 acabou de virar
+void IRAM_ATTR onRtcSqwEdge() {
+    int64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&clockMux);
+    if (clockSource == CLOCK_SRC_RTC) {
+        // Arredonda para o segundo inteiro mais próximo; a primeira borda após a leitura
+        // (base no meio do segundo) sempre avança pelo menos 1
+        uint32_t step = (uint32_t)((nowUs - clockBaseUs + 500000) / 1000000);
+        clockBaseEpoch += (step == 0) ? 1 : step;
+        clockBaseUs = nowUs;
+    }
+    clockLastEdgeUs = nowUs;
+    clockStats.sqwEdges++;
+    portEXIT_CRITICAL_ISR(&clockMux);
+}
+
+static void setClockBase(uint32_t epoch, int64_t atUs, ClockSource source) {
+    portENTER_CRITICAL(&clockMux);
+    clockBaseEpoch = epoch;
+    clockBaseUs = atUs;
+    clockSource = source;
+    portEXIT_CRITICAL(&clockMux);
+}
+
+// Epoch sem compensação de deriva (segundos do RTC)
+static uint32_t clockRawEpoch() {
+    portENTER_CRITICAL(&clockMux);
+    uint32_t base = clockBaseEpoch;
+    int64_t baseUs = clockBaseUs;
+    portEXIT_CRITICAL(&clockMux);
+    return base + (uint32_t)((esp_timer_get_time() - baseUs) / 1000000);
+}
+
+// --- LEITURAS (qualquer tarefa, sem I2C, sem alocação) ---
+uint32_t clockNowEpoch() {
+    uint32_t raw = clockRawEpoch();
+    if (clockSource == CLOCK_SRC_RTC && clockLastNtpEpoch != 0 && raw > clockLastNtpEpoch && clockDriftPpm != 0.0f) {
+        float correction = clockDriftPpm * 1e-6f * (float)(raw - clockLastNtpEpoch);
+        raw += (int32_t)lroundf(correction);
     }
+    return raw;
+}
+
+// false enquanto a hora vier só da data de compilação (RTC ausente/sem bateria e sem NTP)
+bool clockIsValid() {
+    return clockSource != CLOCK_SRC_NONE;
+}
 
-    // 3. Fallback final: Retorna uma hora padrao (necessario para evitar erros de tipo)
-    // Se o RTC e o Blynk estiverem OFF, retorna o ultimo registro de boot
-    return DateTime(F(__DATE__), F(__TIME__));
+// Função principal para obter a hora atual para LOGICA (retorna um objeto DateTime)
+DateTime getDateTimeNow() {
+    return DateTime(clockNowEpoch());
 }
 
+// "HH:MM:SS" no buffer do chamador (mínimo 9 bytes)
+void formatClockTime(char* buf, size_t len) {
+    uint32_t secondsOfDay = clockNowEpoch() % 86400UL;
+    snprintf(buf, len, "%02u:%02u:%02u", (unsigned)(secondsOfDay / 3600), (unsigned)((secondsOfDay / 60) % 60), (unsigned)(secondsOfDay % 60));
+}
 
-// Função auxiliar para obter a hora atual para DISPLAY (retorna uma String)
-String getCurrentTimeString() {
-    DateTime now = getDateTimeNow();
-    
-    String timeStr = "";
-    if (now.hour() < 10) timeStr += '0';
-    timeStr += now.hour();
-    timeStr += ':';
-    if (now.minute() < 10) timeStr += '0';
-    timeStr += now.minute();
-    timeStr += ':';
-    if (now.second() < 10) timeStr += '0';
-    timeStr += now.second();
-    
-    return timeStr;
+// "DD/MM/AAAA HH:MM:SS" no buffer do chamador (mínimo 20 bytes)
+void formatClockDateTime(char* buf, size_t len) {
+    DateTime now(clockNowEpoch());
+    snprintf(buf, len, "%02u/%02u/%04u %02u:%02u:%02u", now.day() % 100u, now.month() % 100u, now.year() % 10000u,
+             now.hour() % 100u, now.minute() % 100u, now.second() % 100u); // Largura fixa: cabe nos 20 bytes
 }
 
 
 // --- SETUP E SINCRONIZAÇÃO RTC ---
 
-time_t getRtcTime() {
-    return rtc.now().unixtime();
+// Chamada no setup() depois do rtc.begin(): única leitura do RTC no caminho normal
+void setupClockService() {
+    if (rtc_ok && !rtc_osf_flag) {
+        setClockBase(rtc.now().unixtime(), esp_timer_get_time(), CLOCK_SRC_RTC);
+        clockStats.rtcReads++;
+        clockLastRtcReadMs = millis();
+        rtc.writeSqwPinMode(DS3231_SquareWave1Hz);
+        pinMode(RTC_SQW_PIN, INPUT_PULLUP); // SQW do DS3231 é dreno aberto
+        attachInterrupt(digitalPinToInterrupt(RTC_SQW_PIN), onRtcSqwEdge, FALLING);
+    } else {
+        // Sem hora confiável: segue a partir da data de compilação (monotônica, marcada inválida)
+        setClockBase(DateTime(F(__DATE__), F(__TIME__)).unixtime(), esp_timer_get_time(), CLOCK_SRC_NONE);
+    }
+
+    char buf[20];
+    formatClockDateTime(buf, sizeof(buf));
+    Serial.print(clockIsValid() ? F("Relogio: RTC ") : F("Relogio: SEM HORA VALIDA (aguardando NTP) "));
+    Serial.println(buf);
 }
 
 void setupRTC() {
@@ -105,18 +192,7 @@ void setupRTC() {
         rtc_ok = true;
         checkRtcStatus();
     }
-
-    // Seta a flag do TimeLib para usar o RTC como fonte principal
-    if (rtc_ok) {
-        // Sincroniza o TimeLib com a hora do RTC no boot
-        setSyncProvider(getRtcTime); 
-        // Se a hora for invalida (menos que 2020), nao usa o RTC
-        if (year() < 2020) {
-             Serial.println(F("RTC com hora invalida. Aguardando NTP."));
-        } else {
-             Serial.println("RTC OK. Hora: " + getCurrentTimeString());
-        }
-    }
+    setupClockService();
 }
 
 void checkRtcStatus() {
@@ -132,29 +208,91 @@ void checkRtcStatus() {
     rtc.clearAlarm(2);
 }
 
+// Pode ser chamada de qualquer tarefa: o ajuste do RTC (I2C) é feito por runClockService()
 void syncRtcFromNtp(time_t ntpTime) {
-    if (!rtc_ok) return;
-    
-    // Converte time_t para DateTime
-    DateTime ntpDt(ntpTime); 
-    
-    // Seta a hora do RTC
-    rtc.adjust(ntpDt); 
-    rtc_osf_flag = false; // Reseta a flag apos ajuste
-    
+    if ((uint32_t)ntpTime < CLOCK_MIN_VALID_EPOCH) {
+        Serial.println(F("AVISO: Hora da Internet ainda nao disponivel. RTC nao ajustado."));
+        return;
+    }
+    clockNtpPendingEpoch = (uint32_t)ntpTime;
+    clockNtpPendingUs = esp_timer_get_time();
+    clockNtpPending = true;
+}
+
+// Aplica o NTP: aprende a deriva do RTC desde o último ajuste, acerta o RTC e a base
+static void applyNtpSync(uint32_t ntpEpoch, int64_t stampUs) {
+    // Hora que o RTC daria no instante do NTP (base + esp_timer, sem compensação)
+    portENTER_CRITICAL(&clockMux);
+    uint32_t rtcEpoch = clockBaseEpoch + (uint32_t)((stampUs - clockBaseUs) / 1000000);
+    portEXIT_CRITICAL(&clockMux);
+    if (clockSource == CLOCK_SRC_RTC && clockLastNtpEpoch != 0 &&
+        rtcEpoch > clockLastNtpEpoch + CLOCK_DRIFT_MIN_INTERVAL_S) {
+        float measuredPpm = ((float)((int32_t)(ntpEpoch - rtcEpoch)) / (float)(rtcEpoch - clockLastNtpEpoch)) * 1e6f;
+        if (fabsf(measuredPpm) <= CLOCK_DRIFT_MAX_PPM) {
+            clockDriftPpm = (clockDriftPpm == 0.0f) ? measuredPpm
+                                                    : clockDriftPpm + CLOCK_DRIFT_ALPHA * (measuredPpm - clockDriftPpm);
+            Serial.print(F("Relogio: deriva do RTC "));
+            Serial.print(clockDriftPpm, 2);
+            Serial.println(F(" ppm."));
+        }
+    }
+
+    if (rtc_ok) {
+        // Escrever os segundos zera a contagem do DS3231: a próxima borda do SQW vem 1 s depois
+        uint32_t epochNow = ntpEpoch + (uint32_t)((esp_timer_get_time() - stampUs) / 1000000);
+        rtc.adjust(DateTime(epochNow));
+        rtc_osf_flag = false; // Reseta a flag apos ajuste
+        setClockBase(epochNow, esp_timer_get_time(), CLOCK_SRC_RTC);
+    } else {
+        setClockBase(ntpEpoch, stampUs, CLOCK_SRC_NTP);
+    }
+    clockLastNtpEpoch = ntpEpoch;
+    clockStats.ntpSyncs++;
+    markConfigDirty();          // Persiste deriva e referência
+    requestScheduleRecompute(); // Próximos disparos dependem do relógio
+
     Serial.println(F("RTC ajustado pelo NTP."));
     logSystemEvent("info", "RTC sincronizado via NTP.");
 }
 
+// Tarefa de UI (1 s): mesma tarefa do OLED, então só ela usa o I2C
+void runClockService() {
+    if (clockNtpPending) {
+        clockNtpPending = false;
+        applyNtpSync(clockNtpPendingEpoch, clockNtpPendingUs);
+    }
+
+    // Sem hora válida: adota a hora do TimeLib quando o Blynk a fornecer
+    if (!clockIsValid() && timeStatus() == timeSet && (uint32_t)now() >= CLOCK_MIN_VALID_EPOCH) {
+        applyNtpSync((uint32_t)now(), esp_timer_get_time());
+    }
+
+    if (clockSource != CLOCK_SRC_RTC) return;
+
+    // Saúde do SQW: sem bordas, a hora passa a depender do cristal do ESP32
+    bool sqwAlive = clockLastEdgeUs != 0 && esp_timer_get_time() - clockLastEdgeUs < CLOCK_SQW_TIMEOUT_US;
+    if (sqwAlive != clockSqwActive) {
+        clockSqwActive = sqwAlive;
+        if (!sqwAlive) clockStats.sqwLost++;
+        Serial.println(sqwAlive ? F("Relogio: SQW 1 Hz ativo.") : F("AVISO: SQW do RTC ausente. Extrapolando pelo esp_timer."));
+    }
+    // Sem SQW, relê o RTC de tempos em tempos para limitar o erro do cristal
+    if (!clockSqwActive && millis() - clockLastRtcReadMs >= CLOCK_RTC_REREAD_MS) {
+        clockLastRtcReadMs = millis();
+        setClockBase(rtc.now().unixtime(), esp_timer_get_time(), CLOCK_SRC_RTC);
+        clockStats.rtcReads++;
+    }
+}
+
 
 // --- HANDLERS BLYNK ---
 
 // Chamado automaticamente quando o Blynk se conecta
 BLYNK_CONNECTED() {
-    // Solicita o tempo atual do servidor Blynk para sincronizar o RTC
+    // Sincroniza só as configurações, por versão (state_sync.ino): nada de Blynk.syncAll(),
+    // que reexecutava todos os BLYNK_WRITE (inclusive botões de comando) a cada reconexão
     if (Blynk.connected()) {
-        Blynk.syncAll();
-        // A função BLYNK_APP_CONNECTED será chamada logo apos, onde o NTP sera usado
+        startStateSync();
     }
 }
 
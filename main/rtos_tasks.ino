@@ -0,0 +1,448 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: RTOS_TASKS                  |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: FreeRTOS task split (control, network, UI) and SPSC messaging between them
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.09 - CMD_RESET_SENSOR_DATA / CMD_RESET_RTC_OSF; snapshot carries the local schedule
+15/10/2026 - 0.08 - Task loop bodies split into run*TaskIteration() so the native harness (sim/) can step them
+15/10/2026 - 0.07 - Fotografia da UI sempre a mais recente; CMD_SET_SETTING/CMD_APPLY_SETTING_EFFECTS aplicam configurações no controle.
+15/10/2026 - 0.06 - Tasks block until the next deadline or a notification (tickless idle); control busy lock
+15/10/2026 - 0.05 - Events no longer travel through the SPSC outbox (event_log ring)
+15/10/2026 - 0.04 - CMD_PUMP_CALIBRATE / CMD_PUMP_CAL_RESULT
+15/10/2026 - 0.03 - Pin messages routed through the telemetry publisher
+15/10/2026 - 0.02 - CMD_PH_CALIBRATE command
+15/10/2026 - 0.01 - First installment: dual-core task split with lock-free SPSC queues
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - (this file) FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+// rtos_tasks.ino
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- ARQUITETURA DE TAREFAS ---
+// Controle (núcleo 1, prioridade mais alta): aquisição e FSMs (TPA, reposição, enchimento, buffer).
+// Rede     (núcleo 0): Blynk.run(), NTP, envio de telemetria/eventos e persistência no LittleFS.
+// UI       (núcleo 1, prioridade mais baixa): botões e redesenho do OLED.
+// As tarefas NÃO compartilham estado mutável de controle: conversam por filas SPSC sem lock.
+// Assim, um travamento do Wi-Fi ou uma ida lenta à nuvem nunca atrasa o desligamento de uma bomba.
+TaskHandle_t controlTaskHandle = NULL;
+TaskHandle_t networkTaskHandle = NULL;
+TaskHandle_t uiTaskHandle = NULL;
+
+// Uma fila por par produtor/consumidor (requisito da fila SPSC)
+SpscQueue<ControlCommand, CMD_QUEUE_SIZE> netToControlQueue;       // Rede -> Controle
+SpscQueue<ControlCommand, CMD_QUEUE_SIZE> uiToControlQueue;        // UI -> Controle
+SpscQueue<NetMessage, NET_QUEUE_SIZE> controlToNetQueue;           // Controle -> Rede
+SpscQueue<NetMessage, NET_QUEUE_SIZE> uiToNetQueue;                // UI -> Rede
+SpscLatest<ControlSnapshot> controlToUiSnapshot;                   // Controle -> UI (só a mais recente)
+
+ControlSnapshot uiSnapshot;              // Cópia local da UI (só a tarefa de UI escreve)
+unsigned long lastDisplayRefreshMs = 0;
+
+
+// --- CORPO DAS TAREFAS FREERTOS ---
+
+// Cada tarefa dorme até a próxima tarefa periódica do seu grupo vencer ou até ser notificada
+// (comando, borda de botão). Só o controle com hardware em movimento mantém o passo de 1 ms.
+// Com todas bloqueadas, o FreeRTOS sem tick deixa o chip entrar em sono leve (power_manager.ino).
+// Uma iteração de cada tarefa fica numa função própria (devolve a espera em ms): o harness de
+// simulação nativa (sim/) chama as mesmas iterações num escalonador de eventos com relógio virtual.
+unsigned long runControlTaskIteration() {
+    unsigned long waitMs = runTaskScheduler(SCHED_GROUP_CONTROL);
+    bool busy = isControlBusy();
+    setPowerBusy(POWER_BUSY_CONTROL, busy);
+    if (busy) waitMs = RTOS_CONTROL_DELAY_MS; // FSMs de bomba/válvula: resolução de 1 ms
+    return waitMs;
+}
+
+unsigned long runNetworkTaskIteration() {
+    unsigned long waitMs = runTaskScheduler(SCHED_GROUP_NETWORK);
+    if (waitMs > RTOS_NETWORK_IDLE_MAX_MS) waitMs = RTOS_NETWORK_IDLE_MAX_MS; // Blynk.run()
+    if (!controlToNetQueue.isEmpty() || !uiToNetQueue.isEmpty()) waitMs = RTOS_NETWORK_DELAY_MS;
+    return waitMs;
+}
+
+unsigned long runUiTaskIteration() {
+    unsigned long waitMs = runTaskScheduler(SCHED_GROUP_UI);
+    unsigned long buttonMs = getButtonNextCheckMs(); // Fim da janela de debounce
+    if (buttonMs < waitMs) waitMs = buttonMs;
+    if (waitMs < RTOS_UI_DELAY_MS) waitMs = RTOS_UI_DELAY_MS;
+    return waitMs;
+}
+
+void controlTaskMain(void* param) {
+    (void)param;
+    for (;;) waitForSchedulerWork(SCHED_GROUP_CONTROL, runControlTaskIteration());
+}
+
+void networkTaskMain(void* param) {
+    (void)param;
+    for (;;) waitForSchedulerWork(SCHED_GROUP_NETWORK, runNetworkTaskIteration());
+}
+
+void uiTaskMain(void* param) {
+    (void)param;
+    for (;;) waitForSchedulerWork(SCHED_GROUP_UI, runUiTaskIteration());
+}
+
+// Trabalho do controle que não pode esperar o próximo período: bombas, válvula e FSMs da TPA
+bool isControlBusy() {
+    for (uint8_t p = 0; p < PUMP_COUNT; p++) {
+        if (isPumpDoseActive(p)) return true;
+    }
+    return isTpaPlanActive() || tpaMasterCurrentState != TPA_MASTER_IDLE ||
+           (ranRefillCurrentState != RAN_REFILL_IDLE && ranRefillCurrentState != RAN_REFILL_FINISHED) ||
+           (tpaRepositionCurrentState != TPA_REPOSITION_IDLE && tpaRepositionCurrentState != TPA_REPOSITION_FINISHED) ||
+           phCalCurrentState != PH_CAL_IDLE;
+}
+
+static TaskHandle_t getGroupTaskHandle(uint8_t group) {
+    switch (group) {
+        case SCHED_GROUP_CONTROL: return controlTaskHandle;
+        case SCHED_GROUP_NETWORK: return networkTaskHandle;
+        default:                  return uiTaskHandle;
+    }
+}
+
+void notifySchedulerGroup(uint8_t group) {
+    TaskHandle_t handle = getGroupTaskHandle(group);
+    if (handle != NULL) xTaskNotifyGive(handle);
+}
+
+void IRAM_ATTR notifySchedulerGroupFromIsr(uint8_t group) {
+    TaskHandle_t handle = getGroupTaskHandle(group);
+    if (handle == NULL) return;
+    BaseType_t higherPriorityWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(handle, &higherPriorityWoken);
+    portYIELD_FROM_ISR(higherPriorityWoken);
+}
+
+// --- SETUP: Cria as tarefas (chamada no fim do setup(), após registrar as tarefas cooperativas) ---
+void setupRtosTasks() {
+#if ACC_SPSC_SELFTEST
+    runSpscQueueSelfTest();
+#endif
+
+    BaseType_t okControl = xTaskCreatePinnedToCore(controlTaskMain, "acc_control", RTOS_CONTROL_STACK, NULL,
+                                                   RTOS_CONTROL_PRIORITY, &controlTaskHandle, RTOS_CONTROL_CORE);
+    BaseType_t okNetwork = xTaskCreatePinnedToCore(networkTaskMain, "acc_network", RTOS_NETWORK_STACK, NULL,
+                                                   RTOS_NETWORK_PRIORITY, &networkTaskHandle, RTOS_NETWORK_CORE);
+    BaseType_t okUi = xTaskCreatePinnedToCore(uiTaskMain, "acc_ui", RTOS_UI_STACK, NULL,
+                                              RTOS_UI_PRIORITY, &uiTaskHandle, RTOS_UI_CORE);
+
+    if (okControl != pdPASS || okNetwork != pdPASS || okUi != pdPASS) {
+        Serial.println(F("ERRO CRITICO: Falha ao criar tarefas FreeRTOS."));
+        logSystemEvent("critical", "Falha ao criar tarefas FreeRTOS.");
+        return;
+    }
+    Serial.println(F("Tarefas FreeRTOS criadas: controle (nucleo 1), rede (nucleo 0), UI."));
+}
+
+// Identifica o grupo da tarefa chamadora. setup() e contextos desconhecidos são tratados
+// como "rede": falam direto com o Blynk (antes das tarefas existirem não há concorrência).
+int getCurrentTaskGroup() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (self != NULL && self == controlTaskHandle) return SCHED_GROUP_CONTROL;
+    if (self != NULL && self == uiTaskHandle) return SCHED_GROUP_UI;
+    return SCHED_GROUP_NETWORK;
+}
+
+
+// --- COMANDOS PARA O CONTROLE ---
+
+static void sendControlCommand(const ControlCommand& cmd) {
+    int group = getCurrentTaskGroup();
+    if (group == SCHED_GROUP_CONTROL) {
+        applyControlCommand(cmd); // Já estamos na tarefa de controle
+        return;
+    }
+
+    bool queued = (group == SCHED_GROUP_UI) ? uiToControlQueue.push(cmd) : netToControlQueue.push(cmd);
+    if (!queued) {
+        Serial.println(F("ERRO: Fila de comandos do controle cheia. Comando descartado."));
+        return;
+    }
+    notifySchedulerGroup(SCHED_GROUP_CONTROL); // O controle pode estar dormindo até o próximo período
+}
+
+void postControlCommand(uint8_t type, int32_t arg) {
+    ControlCommand cmd;
+    cmd.type = type;
+    cmd.arg = arg;
+    cmd.value = 0.0f;
+    sendControlCommand(cmd);
+}
+
+// Configurações sincronizadas (state_sync.ino) só são escritas pela tarefa de controle
+void postControlSetting(uint8_t id, float value, uint8_t source) {
+    ControlCommand cmd;
+    cmd.type = CMD_SET_SETTING;
+    cmd.arg = (int32_t)id | ((int32_t)source << 8);
+    cmd.value = value;
+    sendControlCommand(cmd);
+}
+
+// Tarefa de controle (crítica): aplica os comandos na ordem em que chegaram de cada produtor
+void processControlCommands() {
+    ControlCommand cmd;
+    while (netToControlQueue.pop(cmd)) applyControlCommand(cmd);
+    while (uiToControlQueue.pop(cmd)) applyControlCommand(cmd);
+}
+
+void applyControlCommand(const ControlCommand& cmd) {
+    switch (cmd.type) {
+        case CMD_START_TPA:
+            if (cmd.arg == TPA_SOURCE_BLYNK_MANUAL) {
+                startTpaCycle("Blynk (manual)");
+            } else if (cmd.arg == TPA_SOURCE_BLYNK_SCHEDULE) {
+                startTpaCycle("Blynk (agendamento)");
+            } else {
+                startTpaCycle("agendamento local");
+            }
+            break;
+
+        case CMD_SET_SERVICE_MODE: {
+            bool newState = (cmd.arg != 0);
+            if (serviceModeActive == newState) break;
+            serviceModeActive = newState; // As FSMs verificam este flag na mesma tarefa
+            const char* logMsg = serviceModeActive ? "Modo Servico ATIVADO." : "Modo Servico DESATIVADO.";
+            Serial.println(logMsg);
+            logSystemEvent("warning", logMsg);
+            publishVirtualPinInt(VPIN_SERVICE_MODE, serviceModeActive ? 1 : 0); // Sincroniza o Blynk
+            break;
+        }
+
+        case CMD_PH_CALIBRATE:
+            executePhCalibration();
+            break;
+
+        case CMD_PUMP_CALIBRATE:
+            startPumpCalibration((uint8_t)cmd.arg);
+            break;
+
+        case CMD_PUMP_CAL_RESULT:
+            finishPumpCalibration(cmd.arg / 10.0f);
+            break;
+        case CMD_RESET_ALERTS:
+            resetCriticalAlerts();
+            break;
+
+        case CMD_RESET_SENSOR_DATA:
+            resetSensorData();
+            break;
+
+        case CMD_RESET_RTC_OSF:
+            resetRtcOsfAlert();
+            break;
+
+        case CMD_SET_SETTING:
+            applySettingValue((uint8_t)(cmd.arg & 0xFF), cmd.value, (uint8_t)((cmd.arg >> 8) & 0xFF));
+            break;
+
+        case CMD_APPLY_SETTING_EFFECTS:
+            runSettingEffects((uint8_t)cmd.arg);
+            break;
+    }
+}
+
+
+// --- SAÍDA PARA O BLYNK (TELEMETRIA E EVENTOS) ---
+
+void publishVirtualPin(uint8_t vpin, float value) {
+    NetMessage msg;
+    msg.type = NET_MSG_PIN_FLOAT;
+    msg.vpin = vpin;
+    msg.floatValue = value;
+    enqueueNetMessage(msg);
+}
+
+void publishVirtualPinInt(uint8_t vpin, int32_t value) {
+    NetMessage msg;
+    msg.type = NET_MSG_PIN_INT;
+    msg.vpin = vpin;
+    msg.intValue = value;
+    enqueueNetMessage(msg);
+}
+
+void publishVirtualPinText(uint8_t vpin, const char* text) {
+    NetMessage msg;
+    msg.type = NET_MSG_PIN_TEXT;
+    msg.vpin = vpin;
+    strncpy(msg.text, text, NET_MSG_TEXT_LEN - 1);
+    msg.text[NET_MSG_TEXT_LEN - 1] = '\0';
+    enqueueNetMessage(msg);
+}
+
+// Controle e UI apenas enfileiram; a tarefa de rede (ou o setup()) envia direto
+bool enqueueNetMessage(const NetMessage& msg) {
+    switch (getCurrentTaskGroup()) {
+        case SCHED_GROUP_CONTROL:
+            return controlToNetQueue.push(msg);
+        case SCHED_GROUP_UI:
+            return uiToNetQueue.push(msg);
+        default:
+            deliverNetMessage(msg);
+            return true;
+    }
+}
+
+// Executada apenas na tarefa de rede. Pinos passam pelo publicador de telemetria
+// (zona morta, intervalos e histórico offline); eventos vão pelo anel do event_log.ino.
+void deliverNetMessage(const NetMessage& msg) {
+    switch (msg.type) {
+        case NET_MSG_PIN_INT:
+        case NET_MSG_PIN_FLOAT:
+        case NET_MSG_PIN_TEXT:
+            submitTelemetry(msg);
+            break;
+    }
+}
+
+// Tarefa de rede: envia no máximo NET_OUTBOX_MAX_PER_RUN mensagens por iteração para
+// não atrasar o Blynk.run() quando houver rajadas.
+void runNetworkOutbox() {
+    NetMessage msg;
+    int sent = 0;
+    while (sent < NET_OUTBOX_MAX_PER_RUN && controlToNetQueue.pop(msg)) {
+        deliverNetMessage(msg);
+        sent++;
+    }
+    while (sent < NET_OUTBOX_MAX_PER_RUN && uiToNetQueue.pop(msg)) {
+        deliverNetMessage(msg);
+        sent++;
+    }
+}
+
+
+// --- ESTADO DE PROCESSO PARA A UI ---
+
+// Tarefa de controle: fotografa as variáveis de processo (escritas apenas pelo controle)
+void publishControlSnapshot() {
+    ControlSnapshot snap;
+    snap.timestampMs = millis();
+    snap.temperatureC = temperatureC;
+    snap.phValue = phValue;
+    snap.tpaMasterState = (uint8_t)tpaMasterCurrentState;
+    snap.extractedVolumeL = getExtractedVolumeLiters();
+    snap.serviceMode = serviceModeActive;
+    snap.ranLevelPercent = ranLevelPercent;
+    snap.ranLevelFull = ranLevelFull;
+    snap.ranLevelLiters = isRanLevelMeasured() ? ranLevel.liters : NAN;
+    snap.tpaScheduleDay = (uint8_t)tpaScheduleDay;
+    snap.tpaScheduleHour = (uint8_t)tpaScheduleHour;
+    snap.tpaScheduleMinute = (uint8_t)tpaScheduleMinute;
+    snap.tpaScheduleFrequency = (uint8_t)tpaScheduleFrequency;
+    controlToUiSnapshot.write(snap); // UI atrasada: a fotografia nova substitui a não lida
+}
+
+// Tarefa de UI: sempre a fotografia mais recente
+void receiveControlSnapshots() {
+    controlToUiSnapshot.read(uiSnapshot);
+}
+
+// Tarefa de UI: o redesenho do OLED só acontece aqui (o barramento I2C do display não é
+// mais acessado pelas FSMs de controle).
+void runDisplayTask() {
+    receiveControlSnapshots();
+    updateDisplay();
+}
+
+
+// --- AUTO-TESTE DAS FILAS SPSC ---
+#if ACC_SPSC_SELFTEST
+SpscQueue<uint32_t, 256> selfTestQueue;
+volatile bool selfTestProducerDone = false;
+
+void spscSelfTestProducer(void* param) {
+    for (uint32_t i = 0; i < SPSC_SELFTEST_ITEMS; ) {
+        if (selfTestQueue.push(i)) {
+            i++;
+        } else {
+            taskYIELD(); // Fila cheia: deixa o consumidor andar
+        }
+    }
+    selfTestProducerDone = true;
+    vTaskDelete(NULL);
+}
+
+// Produtor no núcleo 0, consumidor (esta função) no núcleo 1. Confere a sequência e mede a vazão.
+void runSpscQueueSelfTest() {
+    Serial.println(F("SPSC: iniciando auto-teste de vazao/ordem..."));
+    selfTestProducerDone = false;
+
+    unsigned long startUs = micros();
+    xTaskCreatePinnedToCore(spscSelfTestProducer, "spsc_test", 2048, NULL, 1, NULL, 0);
+
+    uint32_t expected = 0;
+    uint32_t orderErrors = 0;
+    uint32_t value;
+    while (expected < SPSC_SELFTEST_ITEMS) {
+        if (selfTestQueue.pop(value)) {
+            if (value != expected) orderErrors++;
+            expected = value + 1;
+        }
+    }
+    unsigned long elapsedUs = micros() - startUs;
+
+    Serial.print(F("SPSC: "));
+    Serial.print(SPSC_SELFTEST_ITEMS);
+    Serial.print(F(" itens em "));
+    Serial.print(elapsedUs);
+    Serial.print(F("us ("));
+    Serial.print(elapsedUs > 0 ? (unsigned long)((uint64_t)SPSC_SELFTEST_ITEMS * 1000000ULL / elapsedUs) : 0);
+    Serial.print(F(" itens/s), erros de ordem="));
+    Serial.print(orderErrors);
+    Serial.print(F(", fila cheia="));
+    Serial.println(selfTestQueue.dropped());
+}
+#endif
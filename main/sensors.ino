@@ -22,6 +22,13 @@
 
 
 == Version History ==
+15/10/2026 - 0.09 - resetSensorData() runs on the control task and no longer writes zero readings
+15/10/2026 - 0.08 - Probe roles from a persisted ROM->role map (missing roles stay absent, new ROMs take free roles)
+15/10/2026 - 0.07 - Fixed temperature/pH alert checks moved to the alert rule table (alert_rules)
+15/10/2026 - 0.06 - Entry point instrumented with PROFILE_SCOPE
+15/10/2026 - 0.05 - Temperature alert formatted into the event ring (no String)
+15/10/2026 - 0.04 - Alert pins/events published through the FreeRTOS task queues
+15/10/2026 - 0.03 - Non-blocking multi-probe DS18B20 pipeline (cached ROMs, per-probe resolution)
 11/01/2025 - 0.02 - Adjusted Blynk events to new log function. Included utils.h
 31/10/2025 - 0.01 - First installment based on code created by Gemini AI (Google)
 
@@ -39,6 +46,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -49,66 +71,237 @@ tpa_reposition    - Control return of water volume
 // DECLARAÇÕES EXTERNAS
 extern OneWire oneWire;
 extern DallasTemperature sensors;
-extern bool highTempAlertSent;
 
-// --- Sub-rotina de Leitura de Temperatura ---
-float readTemperature() {
-  sensors.requestTemperatures();
-  float tempC = sensors.getTempCByIndex(0);
-  
-  // Tratar leitura de erro (se o sensor retornar -127)
-  if (tempC == -127.00) {
-    Serial.println(F("ERRO: Falha ao ler sensor DS18B20!"));
-    return -999.0; // Retorna um valor de erro conhecido
+// --- PIPELINE DE AQUISIÇÃO DS18B20 (NÃO BLOQUEANTE) ---
+// 1. setupTemperatureProbes(): busca o barramento UMA vez, guarda os endereços ROM e a resolução de cada sonda.
+// 2. runTemperatureAcquisition() (tarefa do escalonador):
+//    IDLE -> dispara a conversão em TODAS as sondas de uma vez (Skip ROM) e retorna imediatamente;
+//    CONVERTING -> aguarda o tempo de conversão da maior resolução sem bloquear;
+//    COLLECTING -> lê UMA sonda por chamada pelo endereço (sem nova busca no barramento) e publica a amostra.
+// readTemperature() apenas devolve a última amostra publicada (custo zero para o Ticker).
+TempProbe tempProbes[MAX_TEMP_PROBES];
+int tempProbeCount = 0;
+TempAcqState tempAcqState = TEMP_ACQ_IDLE;
+unsigned long tempAcqCycleStartMs = 0;   // Início do ciclo de aquisição atual (disparo da conversão)
+unsigned long tempConversionWaitMs = 0;  // Tempo de conversão da maior resolução configurada
+int tempCollectIndex = 0;                // Próxima sonda a ser lida no estado COLLECTING
+
+// Resolução por sonda, na ordem dos papéis (ver TempProbeRole em global.h)
+const uint8_t TEMP_PROBE_RESOLUTION[MAX_TEMP_PROBES] = {
+    TEMP_RES_DISPLAY_BITS, TEMP_RES_SUMP_BITS, TEMP_RES_RAN_BITS
+};
+const char* tempProbeNames[MAX_TEMP_PROBES] = {"Aquario", "Sump", "RAN"};
+
+// Mapa ROM -> papel (persistido no config). Zeros = papel ainda sem sonda associada.
+DeviceAddress tempProbeRoms[MAX_TEMP_PROBES];
+
+static bool isTempRomBound(const uint8_t* rom) {
+  for (int b = 0; b < 8; b++) {
+    if (rom[b] != 0) return true;
   }
-  return tempC;
+  return false;
 }
 
-// --- Lógica de Alerta de Temperatura ---
-void checkTempAlert(float tempC) {
-  if (tempC > UPPER_TEMP && !highTempAlertSent) {
-    if (Blynk.connected()) {
-      String msg = String("Temperatura alta: ") + tempC + F("°C");
-      logSystemEvent("critical", msg.c_str());
-      // Blynk.logEvent("high_temp_alert", String(F("ALERTA: Temperatura Alta: ")) + tempC + "C");
-      Blynk.virtualWrite(VPIN_TEMP_ALERT, 255); // Acende LED V15
+static void printTempRom(const uint8_t* rom) {
+  for (int b = 0; b < 8; b++) {
+    if (rom[b] < 0x10) Serial.print('0');
+    Serial.print(rom[b], 16);
+  }
+}
+
+// --- SETUP: Descoberta das sondas (única busca no barramento OneWire) ---
+// Chamada depois do loadConfig(): o papel de cada sonda vem do mapa ROM persistido, nunca da
+// posição na busca. Sonda de um papel ausente deixa o papel ausente (sem "empurrar" as outras);
+// ROM desconhecida ocupa um papel ainda livre e o mapa é gravado.
+void setupTemperatureProbes() {
+  sensors.begin();
+  sensors.setWaitForConversion(false); // requestTemperatures() passa a retornar imediatamente
+
+  DeviceAddress foundRoms[TEMP_PROBE_SCAN_MAX];
+  int found = sensors.getDeviceCount();
+  int foundCount = 0;
+  for (int i = 0; i < found && foundCount < TEMP_PROBE_SCAN_MAX; i++) {
+    if (sensors.getAddress(foundRoms[foundCount], i)) foundCount++;
+  }
+
+  tempProbeCount = 0;
+  uint8_t maxResolution = 9;
+  bool mapChanged = false;
+  bool foundUsed[TEMP_PROBE_SCAN_MAX] = {false};
+
+  for (int role = 0; role < MAX_TEMP_PROBES; role++) {
+    TempProbe& probe = tempProbes[role];
+    probe.present = false;
+    probe.resolution = TEMP_PROBE_RESOLUTION[role];
+    probe.lastTempC = -999.0;
+    probe.sampleTimeMs = 0;
+    probe.sampleValid = false;
+    probe.errorCount = 0;
+  }
+
+  // 1. Papéis já associados: procura a ROM gravada
+  for (int role = 0; role < MAX_TEMP_PROBES; role++) {
+    if (!isTempRomBound(tempProbeRoms[role])) continue;
+    for (int i = 0; i < foundCount; i++) {
+      if (!foundUsed[i] && memcmp(foundRoms[i], tempProbeRoms[role], 8) == 0) {
+        memcpy(tempProbes[role].address, foundRoms[i], 8);
+        tempProbes[role].present = true;
+        foundUsed[i] = true;
+        break;
+      }
     }
-    Serial.println(F("ALERTA: Temperatura elevada detectada."));
-    highTempAlertSent = true;
-  } 
-  
-  // Resetar o alerta se a temperatura baixar
-  else if (tempC <= UPPER_TEMP && highTempAlertSent) {
-    if (Blynk.connected()) {
-        logSystemEvent("warning", "A temperatura voltou aos limites normais.");
-        // Blynk.logEvent("high_temp_alert", F("A temperatura voltou aos limites normais."));
-        Blynk.virtualWrite(VPIN_TEMP_ALERT, 0); // Apaga LED V15
+    if (!tempProbes[role].present) {
+      LOG_WARNING(LOG_SRC_TEMP, "Sonda DS18B20 [%s] ausente: papel sem leitura.", tempProbeNames[role]);
     }
-    highTempAlertSent = false;
-    Serial.println(F("AVISO: Temperatura normalizada. Alerta resetado."));
   }
-}
 
-// Resetar o alerta se botão físico for pressionado
-void resetCriticalAlerts() {
-    if (highTempAlertSent || phAlertSent) {
-        // Resetar Alertas de Temperatura e pH
-        highTempAlertSent = false;
-        phAlertSent = false;
-        
-        // Limpar LEDs virtuais
-        if (Blynk.connected()) {
-            Blynk.virtualWrite(VPIN_TEMP_ALERT, 0);
-            Blynk.virtualWrite(VPIN_PH_ALERT, 0);
-        }
-        Serial.println(F("Todos os alertas criticos de sensores resetados."));
-    } else {
-        Serial.println(F("Nenhum alerta critico ativo para reset."));
+  // 2. ROMs novas: papéis nunca associados, na ordem dos papéis
+  for (int i = 0; i < foundCount; i++) {
+    if (foundUsed[i]) continue;
+    int freeRole = -1;
+    for (int role = 0; role < MAX_TEMP_PROBES; role++) {
+      if (!isTempRomBound(tempProbeRoms[role])) {
+        freeRole = role;
+        break;
+      }
     }
+    if (freeRole < 0) {
+      // Sonda trocada: o papel antigo continua reservado até o comando de console "temp reset"
+      Serial.print(F("AVISO: DS18B20 desconhecida ignorada ROM="));
+      printTempRom(foundRoms[i]);
+      Serial.println();
+      LOG_WARNING(LOG_SRC_TEMP, "DS18B20 desconhecida ignorada (sem papel livre).");
+      continue;
+    }
+    memcpy(tempProbeRoms[freeRole], foundRoms[i], 8);
+    memcpy(tempProbes[freeRole].address, foundRoms[i], 8);
+    tempProbes[freeRole].present = true;
+    foundUsed[i] = true;
+    mapChanged = true;
+    LOG_INFO(LOG_SRC_TEMP, "DS18B20 nova associada ao papel [%s].", tempProbeNames[freeRole]);
+  }
+
+  for (int role = 0; role < MAX_TEMP_PROBES; role++) {
+    TempProbe& probe = tempProbes[role];
+    if (!probe.present) continue;
+    sensors.setResolution(probe.address, probe.resolution);
+    if (probe.resolution > maxResolution) maxResolution = probe.resolution;
+    tempProbeCount++;
+
+    Serial.print(F("DS18B20 ["));
+    Serial.print(tempProbeNames[role]);
+    Serial.print(F("] ROM="));
+    printTempRom(probe.address);
+    Serial.print(F(" res="));
+    Serial.print(probe.resolution);
+    Serial.println(F(" bits"));
+  }
+  if (mapChanged) markConfigDirty(); // Gravado pela tarefa de rede (checkConfigSave)
+
+  tempConversionWaitMs = sensors.millisToWaitForConversion(maxResolution);
+  tempAcqState = TEMP_ACQ_IDLE;
+
+  if (tempProbeCount == 0) {
+    Serial.println(F("ERRO: Nenhuma sonda DS18B20 encontrada!"));
+    logSystemEvent("critical", "Nenhuma sonda DS18B20 encontrada.");
+  }
+}
+
+// Console: mapa atual (papel, ROM, presença)
+void reportTemperatureProbes() {
+  for (int role = 0; role < MAX_TEMP_PROBES; role++) {
+    Serial.print(F("DS18B20 ["));
+    Serial.print(tempProbeNames[role]);
+    Serial.print(F("] ROM="));
+    if (isTempRomBound(tempProbeRoms[role])) printTempRom(tempProbeRoms[role]);
+    else Serial.print(F("(livre)"));
+    Serial.println(tempProbes[role].present ? F(" presente") : F(" ausente"));
+  }
+}
+
+// Console "temp reset": esquece o mapa; no próximo boot os papéis são refeitos pela ordem de descoberta
+void clearTemperatureProbeMap() {
+  memset(tempProbeRoms, 0, sizeof(tempProbeRoms));
+  markConfigDirty();
+  Serial.println(F("Mapa de sondas DS18B20 apagado. Reinicie para reassociar."));
+  logSystemEvent("warning", "Mapa de sondas DS18B20 apagado.");
+}
+
+// --- TAREFA DO ESCALONADOR: Aquisição em pipeline ---
+void runTemperatureAcquisition() {
+  PROFILE_SCOPE(PROF_TEMP_ACQ);
+  if (tempProbeCount == 0) return;
+  unsigned long nowMs = millis();
+
+  switch (tempAcqState) {
+    case TEMP_ACQ_IDLE:
+      // Dispara uma nova conversão a cada TEMP_SAMPLE_INTERVAL_MS
+      if (tempAcqCycleStartMs != 0 && nowMs - tempAcqCycleStartMs < TEMP_SAMPLE_INTERVAL_MS) break;
+      sensors.requestTemperatures(); // Todas as sondas convertem em paralelo (um único comando)
+      tempAcqCycleStartMs = nowMs;
+      tempAcqState = TEMP_ACQ_CONVERTING;
+      break;
+
+    case TEMP_ACQ_CONVERTING:
+      if (nowMs - tempAcqCycleStartMs >= tempConversionWaitMs) {
+        tempCollectIndex = 0;
+        tempAcqState = TEMP_ACQ_COLLECTING;
+      }
+      break;
+
+    case TEMP_ACQ_COLLECTING:
+      // Pula as posições sem sonda e lê no máximo uma sonda por chamada
+      while (tempCollectIndex < MAX_TEMP_PROBES && !tempProbes[tempCollectIndex].present) tempCollectIndex++;
+
+      if (tempCollectIndex < MAX_TEMP_PROBES) {
+        publishTemperatureSample(tempCollectIndex, sensors.getTempC(tempProbes[tempCollectIndex].address), tempAcqCycleStartMs);
+        tempCollectIndex++;
+      } else {
+        tempAcqState = TEMP_ACQ_IDLE;
+      }
+      break;
+  }
+}
+
+// Registra a amostra com carimbo de tempo (millis()) na sonda correspondente
+void publishTemperatureSample(int role, float tempC, unsigned long timestampMs) {
+  TempProbe& probe = tempProbes[role];
+
+  if (tempC == DEVICE_DISCONNECTED_C) {
+    probe.errorCount++;
+    probe.sampleValid = false;
+    Serial.print(F("ERRO: Falha ao ler sensor DS18B20 ["));
+    Serial.print(tempProbeNames[role]);
+    Serial.println(F("]!"));
+    return;
+  }
+
+  probe.lastTempC = tempC;
+  probe.sampleTimeMs = timestampMs;
+  probe.sampleValid = true;
+
+  if (role == TEMP_PROBE_DISPLAY) {
+    temperatureC = tempC; // Usada pelo display_manager
+  }
+}
+
+// Última amostra válida e recente de uma sonda, ou -999.0 (mesmo código de erro de antes)
+float getProbeTemperature(int role) {
+  if (role < 0 || role >= MAX_TEMP_PROBES) return -999.0;
+  const TempProbe& probe = tempProbes[role];
+  if (!probe.present || !probe.sampleValid) return -999.0;
+  if (millis() - probe.sampleTimeMs > TEMP_SAMPLE_MAX_AGE_MS) return -999.0; // Amostra velha
+  return probe.lastTempC;
+}
+
+// --- Sub-rotina de Leitura de Temperatura ---
+// Não acessa mais o barramento: devolve a última amostra da sonda do aquário.
+float readTemperature() {
+  return getProbeTemperature(TEMP_PROBE_DISPLAY);
 }
 
 // --- RESET MANUAL DA FLAG OSF DO RTC ---
-// Chamado por um botão físico para resetar o alerta de perda de energia
+// Pedido pelo botão físico, aplicado na tarefa de controle (CMD_RESET_RTC_OSF)
 void resetRtcOsfAlert() {
     if (rtc_osf_flag) {
         rtc_osf_flag = false;
@@ -126,17 +319,13 @@ void resetRtcOsfAlert() {
 }
 
 // --- RESET MANUAL DOS VALORES MIN/MAX DOS SENSORES (NOVO) ---
-// Chamado por um botão físico (Long Press em ALERT_RESET_BUTTON_PIN)
+// Pedido pelo botão físico (Long Press em ALERT_RESET_BUTTON_PIN), aplicado na tarefa de
+// controle (CMD_RESET_SENSOR_DATA). Sem zerar as leituras: um 0 seria gravado no
+// histórico e enviado ao Blynk como se fosse medido. A temperatura volta ao código "sem leitura"
+// (-999, que o histórico ignora) até a próxima amostra e o filtro do pH recomeça da próxima mediana.
 void resetSensorData() {
-    // Resetar para extremos, para que o proximo valor lido se torne o novo min/max
-    temperatureC = 0.0f; 
-    phValue = 0.0f;
-
-    // Atualiza o Blynk para 0 (assumindo que VPIN_TEMP_MIN/MAX e VPIN_PH_MIN/MAX existem)
-    if (Blynk.connected()) {
-        Blynk.virtualWrite(VPIN_TEMP, 0); 
-        Blynk.virtualWrite(VPIN_PH_VAL, 0);
-    }
+    temperatureC = -999.0f;
+    phFilterPrimed = false;
 
     Serial.println(F("Registros de Min/Max de sensores resetados."));
     logSystemEvent("info", "Registros de Min/Max de sensores limpos manualmente.");
@@ -149,7 +338,7 @@ BLYNK_WRITE(VPIN_ALERT_RESET) {
     
     if (buttonState == 1) { 
         Serial.println(F("Comando Blynk: Reset de Alertas Criticos recebido."));
-        // Chama a mesma função que o botão físico chama
-        resetCriticalAlerts(); 
+        // Mesmo comando do botão físico (as regras vivem na tarefa de controle)
+        postControlCommand(CMD_RESET_ALERTS, 0);
     }
 }
\ No newline at end of file
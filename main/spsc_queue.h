@@ -0,0 +1,160 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: SPSC_QUEUE.H                |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Lock-free single-producer/single-consumer ring buffer used between FreeRTOS tasks
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.02 - SpscLatest: buffer triplo (último valor vence) para a fotografia Controle -> UI.
+15/10/2026 - 0.01 - First installment: fixed-size lock-free SPSC queue
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - (this file) Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#pragma once // Garante que este arquivo seja incluído apenas uma vez
+
+#include <atomic>
+#include <stdint.h>
+
+// --- FILA SPSC (Single Producer / Single Consumer) SEM LOCK ---
+// Buffer circular de tamanho fixo (sem alocação dinâmica) para troca de mensagens entre
+// duas tarefas FreeRTOS, inclusive em núcleos diferentes. Regras de uso:
+//  - exatamente UMA tarefa chama push() e UMA tarefa chama pop() em cada fila;
+//  - N deve ser potência de 2 (capacidade útil = N - 1 itens);
+//  - push() nunca bloqueia: se a fila estiver cheia, o item é descartado e contado em dropped().
+// O índice head_ só é escrito pelo produtor e tail_ só pelo consumidor; a ordem de
+// publicação é garantida pelos pares release/acquire.
+template <typename T, uint16_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue: N deve ser potencia de 2");
+
+public:
+    SpscQueue() : head_(0), tail_(0), dropped_(0) {}
+
+    // Chamado APENAS pelo produtor
+    bool push(const T& item) {
+        uint16_t head = head_.load(std::memory_order_relaxed);
+        uint16_t next = (head + 1) & (N - 1);
+        if (next == tail_.load(std::memory_order_acquire)) {
+            dropped_++; // Fila cheia: o produtor nunca espera o consumidor
+            return false;
+        }
+        buffer_[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Chamado APENAS pelo consumidor
+    bool pop(T& item) {
+        uint16_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false; // Fila vazia
+        }
+        item = buffer_[tail];
+        tail_.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    uint16_t size() const {
+        return (head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire)) & (N - 1);
+    }
+
+    uint16_t capacity() const { return N - 1; }
+    uint32_t dropped() const { return dropped_; } // Escrito só pelo produtor; leitura aproximada
+
+private:
+    T buffer_[N];
+    std::atomic<uint16_t> head_; // Próxima posição de escrita (produtor)
+    std::atomic<uint16_t> tail_; // Próxima posição de leitura (consumidor)
+    uint32_t dropped_;           // Itens descartados por fila cheia
+};
+
+
+// --- ÚLTIMO VALOR SPSC (buffer triplo) SEM LOCK ---
+// Para estado que só interessa na versão mais recente (ex.: fotografia Controle -> UI): o
+// produtor nunca espera nem perde a escrita nova; uma escrita ainda não lida é SUBSTITUÍDA.
+// Três posições: o produtor escreve na sua ("back"), o consumidor lê da sua ("front") e a do
+// meio é trocada atomicamente, com um bit indicando que tem valor novo. Mesmas regras da fila:
+// uma única tarefa chama write() e uma única chama read().
+template <typename T>
+class SpscLatest {
+public:
+    SpscLatest() : middle_(1), back_(2), front_(0), overwritten_(0) {}
+
+    // Chamado APENAS pelo produtor
+    void write(const T& item) {
+        buffer_[back_] = item;
+        uint8_t old = middle_.exchange((uint8_t)(back_ | FRESH), std::memory_order_acq_rel);
+        if (old & FRESH) overwritten_++; // O consumidor não chegou a ver a anterior
+        back_ = old & INDEX_MASK;
+    }
+
+    // Chamado APENAS pelo consumidor: false se não há valor novo desde a última leitura
+    bool read(T& item) {
+        if (!(middle_.load(std::memory_order_acquire) & FRESH)) return false;
+        uint8_t old = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = old & INDEX_MASK;
+        item = buffer_[front_];
+        return true;
+    }
+
+    uint32_t overwritten() const { return overwritten_; } // Escrito só pelo produtor; leitura aproximada
+
+private:
+    static const uint8_t FRESH = 0x04;
+    static const uint8_t INDEX_MASK = 0x03;
+    T buffer_[3];
+    std::atomic<uint8_t> middle_; // Índice da posição do meio | FRESH
+    uint8_t back_;                // Posição do produtor
+    uint8_t front_;               // Posição do consumidor
+    uint32_t overwritten_;        // Escritas substituídas antes de lidas
+};
@@ -0,0 +1,404 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: STATE_SYNC                  |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Versioned delta state sync with the Blynk server on (re)connect
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.03 - Removed unused noteLocalSettingChange(); config copies the version table under syncMux
+15/10/2026 - 0.02 - Valores do app e do OLED escritos pela tarefa de controle (via comandos), não pela rede/UI.
+15/10/2026 - 0.01 - Per-setting version/source, three-way delta sync on reconnect with single-batch apply (replaces Blynk.syncAll())
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - (this file) Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- SINCRONIZAÇÃO DE ESTADO COM O BLYNK ---
+// Cada configuração editável pelo app e pelo OLED tem uma versão (cresce a cada alteração), a
+// origem da última alteração e o valor que o servidor tinha na última sincronização. Na
+// reconexão, em vez do Blynk.syncAll() (que reexecutava TODOS os BLYNK_WRITE, inclusive botões de
+// comando, com recálculo, log e gravação em cada um), pede ao servidor só os pinos desta tabela e
+// compara em três vias:
+//   servidor == base e local sem alteração  -> nada a fazer
+//   servidor != base e local sem alteração  -> aplica o valor do servidor (editado no app offline)
+//   servidor == base e local alterado       -> envia o valor local (editado no OLED offline)
+//   os dois alterados                       -> conflito: vale o local (determinístico; o app recebe o valor)
+//   sem resposta na janela                  -> servidor sem valor: envia o local
+// Tudo o que veio do servidor é aplicado num único lote: um calculateTpaVolume(), um
+// requestScheduleRecompute() e um markConfigDirty() (uma gravação, com o debounce do config).
+// Com a conexão ativa, escritas do app são aplicadas na hora e edições do OLED são enviadas no
+// próximo tick (STATE_SYNC_TASK_PERIOD_MS).
+// As variáveis são lidas pelo controle (agenda, volume da TPA), então só a tarefa de controle as
+// escreve: rede e UI decidem o valor e mandam CMD_SET_SETTING; os efeitos de um lote vão num
+// único CMD_APPLY_SETTING_EFFECTS logo atrás (a fila é FIFO por produtor).
+
+SyncSettingState syncSettingState[SYNC_SET_COUNT];
+StateSyncStats stateSyncStats;
+
+// Efeitos de uma alteração (acumulados no lote)
+#define SYNC_EFFECT_SAVE       0x01   // markConfigDirty()
+#define SYNC_EFFECT_TPA_VOLUME 0x02   // calculateTpaVolume() + eco do volume extraído
+#define SYNC_EFFECT_SCHEDULE   0x04   // requestScheduleRecompute()
+
+struct SyncSettingDef {
+    uint8_t vpin;
+    bool isInt;                   // Enviado com publishVirtualPinInt()
+    uint8_t effects;              // SYNC_EFFECT_* além de SYNC_EFFECT_SAVE
+    const char* name;             // Log/console
+};
+static const SyncSettingDef SYNC_SETTINGS[SYNC_SET_COUNT] = {
+    // vpin                        int    efeitos                 nome
+    { VPIN_TOTAL_VOLUME,           false, SYNC_EFFECT_TPA_VOLUME, "volume_total" },
+    { VPIN_EXTRACTION_PERCENT,     false, SYNC_EFFECT_TPA_VOLUME, "percentual_tpa" },
+    { VPIN_REPOSITION_VOLUME_L,    false, 0,                      "volume_reposicao" },
+    { VPIN_RAN_BUFFER_VOLUME,      true,  0,                      "volume_buffer" },
+    { VPIN_PH_CAL_POINTS,          true,  0,                      "pontos_cal_ph" },
+    { VPIN_LOCAL_SCHEDULE_ACTIVE,  true,  SYNC_EFFECT_SCHEDULE,   "agenda_local" },
+    { VPIN_SCHEDULE_FREQUENCY,     true,  SYNC_EFFECT_SCHEDULE,   "agenda_frequencia" },
+    { VPIN_SCHEDULE_DAY,           true,  SYNC_EFFECT_SCHEDULE,   "agenda_dia" },
+    { VPIN_SCHEDULE_HOUR,          true,  SYNC_EFFECT_SCHEDULE,   "agenda_hora" },
+    { VPIN_SCHEDULE_MINUTE,        true,  SYNC_EFFECT_SCHEDULE,   "agenda_minuto" },
+};
+
+// Versões: escritas pelo controle (valores aplicados) e lidas/confirmadas pela rede
+static portMUX_TYPE syncMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Janela da reconexão (só tarefa de rede)
+static bool syncWindowOpen = false;
+static unsigned long syncWindowStartMs = 0;
+static uint16_t syncReceivedMask = 0;
+static float syncStaged[SYNC_SET_COUNT];   // Respostas do servidor guardadas até o lote
+static uint16_t syncForcePushMask = 0;     // Servidor sem valor: envia mesmo sem alteração local
+
+
+// 1. --- ACESSO AOS VALORES ---
+static float readSettingValue(uint8_t id) {
+    switch (id) {
+        case SYNC_SET_TOTAL_VOLUME:       return aquariumTotalVolume;
+        case SYNC_SET_EXTRACTION_PERCENT: return tpaExtractionPercent;
+        case SYNC_SET_REPOSITION_VOLUME:  return volumeToRepositionLiters;
+        case SYNC_SET_BUFFER_VOLUME:      return (float)ranBufferVolumeML;
+        case SYNC_SET_PH_CAL_POINTS:      return (float)phCal.points;
+        case SYNC_SET_LOCAL_SCHEDULE:     return tpaLocalScheduleActive ? 1.0f : 0.0f;
+        case SYNC_SET_SCHEDULE_FREQUENCY: return (float)tpaScheduleFrequency;
+        case SYNC_SET_SCHEDULE_DAY:       return (float)tpaScheduleDay;
+        case SYNC_SET_SCHEDULE_HOUR:      return (float)tpaScheduleHour;
+        case SYNC_SET_SCHEDULE_MINUTE:    return (float)tpaScheduleMinute;
+    }
+    return 0.0f;
+}
+
+// O valor já chega validado pelo BLYNK_WRITE do pino. Só a tarefa de controle chama.
+static void writeSettingValue(uint8_t id, float value) {
+    int intValue = (int)lroundf(value);
+    switch (id) {
+        case SYNC_SET_TOTAL_VOLUME:       aquariumTotalVolume = value; break;
+        case SYNC_SET_EXTRACTION_PERCENT: tpaExtractionPercent = value; break;
+        case SYNC_SET_REPOSITION_VOLUME:  volumeToRepositionLiters = value; break;
+        case SYNC_SET_BUFFER_VOLUME:      ranBufferVolumeML = intValue; break;
+        case SYNC_SET_PH_CAL_POINTS:      phCal.points = (uint8_t)intValue; break;
+        case SYNC_SET_LOCAL_SCHEDULE:     tpaLocalScheduleActive = intValue == 1; break;
+        case SYNC_SET_SCHEDULE_FREQUENCY: tpaScheduleFrequency = intValue; break;
+        case SYNC_SET_SCHEDULE_DAY:       tpaScheduleDay = intValue; break;
+        case SYNC_SET_SCHEDULE_HOUR:      tpaScheduleHour = intValue; break;
+        case SYNC_SET_SCHEDULE_MINUTE:    tpaScheduleMinute = intValue; break;
+    }
+}
+
+static bool sameSettingValue(float a, float b) {
+    return fabsf(a - b) < STATE_SYNC_FLOAT_EPSILON;
+}
+
+// synced = o servidor já tem este valor (veio dele): versão e confirmação na mesma seção
+// crítica, senão a rede poderia ver a versão nova como pendente e devolvê-la ao app
+static void bumpSettingVersion(uint8_t id, uint8_t source, bool synced = false, float serverValue = 0.0f) {
+    uint32_t epoch = clockIsValid() ? clockNowEpoch() : 0;
+    portENTER_CRITICAL(&syncMux);
+    SyncSettingState& st = syncSettingState[id];
+    st.version++;
+    st.modifiedEpoch = epoch;
+    st.source = source;
+    if (synced) {
+        st.syncedVersion = st.version;
+        st.syncedValue = serverValue;
+    }
+    portEXIT_CRITICAL(&syncMux);
+}
+
+// O servidor passa a ter o valor atual (versão atual confirmada)
+static void markSettingSynced(uint8_t id, float serverValue) {
+    portENTER_CRITICAL(&syncMux);
+    SyncSettingState& st = syncSettingState[id];
+    st.syncedVersion = st.version;
+    st.syncedValue = serverValue;
+    portEXIT_CRITICAL(&syncMux);
+}
+
+static bool isSettingPending(uint8_t id) {
+    portENTER_CRITICAL(&syncMux);
+    bool pending = syncSettingState[id].version != syncSettingState[id].syncedVersion;
+    portEXIT_CRITICAL(&syncMux);
+    return pending;
+}
+
+
+// Persistência: a tabela inteira é copiada sob a mesma trava das versões, senão a gravação
+// (tarefa de rede) poderia pegar versão e confirmação de um ajuste pela metade
+void copySyncSettingState(SyncSettingState* out) {
+    portENTER_CRITICAL(&syncMux);
+    memcpy(out, syncSettingState, sizeof(syncSettingState));
+    portEXIT_CRITICAL(&syncMux);
+}
+
+void restoreSyncSettingState(const SyncSettingState* in) {
+    portENTER_CRITICAL(&syncMux);
+    memcpy(syncSettingState, in, sizeof(syncSettingState));
+    portEXIT_CRITICAL(&syncMux);
+}
+
+
+// 2. --- ALTERAÇÕES (executadas na tarefa de controle) ---
+// CMD_SET_SETTING
+void applySettingValue(uint8_t id, float value, uint8_t source) {
+    if (id >= SYNC_SET_COUNT) return;
+    writeSettingValue(id, value);
+    bumpSettingVersion(id, source, source == SYNC_SOURCE_BLYNK, value);
+}
+
+// CMD_APPLY_SETTING_EFFECTS
+void runSettingEffects(uint8_t effects) {
+    if (effects & SYNC_EFFECT_TPA_VOLUME) {
+        calculateTpaVolume();
+        publishVirtualPin(VPIN_EXTRACTION_VOLUME_L, volumeToExtractLiters);
+    }
+    if (effects & SYNC_EFFECT_SCHEDULE) requestScheduleRecompute();
+    if (effects & SYNC_EFFECT_SAVE) markConfigDirty();
+}
+
+// Edição no OLED (tarefa de UI): o controle aplica, versiona e grava (debounce do config)
+void postLocalSettingChange(uint8_t id, float value) {
+    if (id >= SYNC_SET_COUNT) return;
+    postControlSetting(id, value, SYNC_SOURCE_LOCAL);
+    postControlCommand(CMD_APPLY_SETTING_EFFECTS, SYNC_EFFECT_SAVE | SYNC_SETTINGS[id].effects);
+}
+
+void markAllSettingsChanged(uint8_t source) {
+    for (uint8_t id = 0; id < SYNC_SET_COUNT; id++) bumpSettingVersion(id, source);
+}
+
+
+// 3. --- APLICAÇÃO DE VALORES DO SERVIDOR (tarefa de rede) ---
+// Retorna os efeitos a executar (0 = valor igual, nada muda). O valor é enviado ao controle;
+// a versão sobe quando ele o escreve.
+static uint8_t applyServerValue(uint8_t id, float value) {
+    if (sameSettingValue(value, readSettingValue(id))) {
+        stateSyncStats.unchanged++;
+        markSettingSynced(id, value);
+        return 0;
+    }
+    postControlSetting(id, value, SYNC_SOURCE_BLYNK);
+    stateSyncStats.applied++;
+    return SYNC_EFFECT_SAVE | SYNC_SETTINGS[id].effects;
+}
+
+static void postSyncEffects(uint8_t effects) {
+    if (effects) postControlCommand(CMD_APPLY_SETTING_EFFECTS, effects);
+}
+
+// Envia ao servidor os valores alterados localmente (ou que o servidor não tem)
+static uint8_t pushPendingSettings() {
+    uint8_t pushedCount = 0;
+    for (uint8_t id = 0; id < SYNC_SET_COUNT; id++) {
+        uint16_t bit = (uint16_t)(1U << id);
+        if (!isSettingPending(id) && !(syncForcePushMask & bit)) continue;
+
+        portENTER_CRITICAL(&syncMux);
+        uint32_t version = syncSettingState[id].version;
+        float value = readSettingValue(id);
+        portEXIT_CRITICAL(&syncMux);
+
+        if (SYNC_SETTINGS[id].isInt) publishVirtualPinInt(SYNC_SETTINGS[id].vpin, (int32_t)lroundf(value));
+        else publishVirtualPin(SYNC_SETTINGS[id].vpin, value);
+
+        // Uma edição do OLED no meio do envio deixa a versão à frente: sai no próximo tick
+        portENTER_CRITICAL(&syncMux);
+        syncSettingState[id].syncedVersion = version;
+        syncSettingState[id].syncedValue = value;
+        portEXIT_CRITICAL(&syncMux);
+        syncForcePushMask &= ~bit;
+        stateSyncStats.pushed++;
+        pushedCount++;
+    }
+    // A contabilidade de versões não marca o config como sujo: vai junto na próxima gravação
+    // real (no pior caso, um reboot reenvia valores que o servidor já tem).
+    return pushedCount;
+}
+
+
+// 4. --- RECONEXÃO ---
+// Chamada em BLYNK_CONNECTED() (tarefa de rede). As respostas chegam como BLYNK_WRITE nos
+// próximos Blynk.run() e ficam guardadas até o lote.
+void startStateSync() {
+    syncWindowOpen = true;
+    syncWindowStartMs = halMillis();
+    syncReceivedMask = 0;
+    stateSyncStats.syncs++;
+
+    for (uint8_t id = 0; id < SYNC_SET_COUNT; id++) {
+        Blynk.syncVirtual(SYNC_SETTINGS[id].vpin);
+    }
+    stateSyncStats.requested += SYNC_SET_COUNT;
+}
+
+static void commitStateSync() {
+    syncWindowOpen = false;
+    uint8_t effects = 0;
+    uint8_t appliedCount = 0;
+    uint8_t conflictCount = 0;
+    uint8_t missingCount = 0;
+
+    for (uint8_t id = 0; id < SYNC_SET_COUNT; id++) {
+        uint16_t bit = (uint16_t)(1U << id);
+        if (!(syncReceivedMask & bit)) {
+            syncForcePushMask |= bit; // Servidor sem valor (pino nunca escrito)
+            stateSyncStats.missing++;
+            missingCount++;
+            continue;
+        }
+        float serverValue = syncStaged[id];
+        portENTER_CRITICAL(&syncMux);
+        bool serverChanged = !sameSettingValue(serverValue, syncSettingState[id].syncedValue);
+        portEXIT_CRITICAL(&syncMux);
+        bool localChanged = isSettingPending(id);
+
+        if (localChanged) {
+            if (serverChanged && !sameSettingValue(serverValue, readSettingValue(id))) {
+                stateSyncStats.conflicts++; // Vale o local; o envio abaixo corrige o app
+                conflictCount++;
+                LOG_WARNING(LOG_SRC_NET, "Sincronizacao: conflito em %s (app %.2f, local %.2f): mantido o local.",
+                            SYNC_SETTINGS[id].name, serverValue, readSettingValue(id));
+            } else if (serverChanged) {
+                markSettingSynced(id, serverValue); // Os dois chegaram ao mesmo valor
+            }
+            continue;
+        }
+        if (serverChanged) {
+            uint8_t e = applyServerValue(id, serverValue);
+            if (e) appliedCount++;
+            effects |= e;
+        } else {
+            stateSyncStats.unchanged++;
+        }
+    }
+
+    postSyncEffects(effects); // Um recálculo, um reagendamento, uma gravação (no controle)
+    uint8_t pushedCount = pushPendingSettings();
+    if (!(effects & SYNC_EFFECT_TPA_VOLUME)) {
+        publishVirtualPin(VPIN_EXTRACTION_VOLUME_L, volumeToExtractLiters); // Derivado: sempre ecoado
+    }
+
+    stateSyncStats.lastDurationMs = halMillis() - syncWindowStartMs;
+    LOG_INFO(LOG_SRC_NET, "Sincronizacao Blynk: %u aplicados, %u enviados, %u conflitos, %u sem valor (%lu ms).",
+             appliedCount, pushedCount, conflictCount, missingCount, stateSyncStats.lastDurationMs);
+}
+
+
+// 5. --- ENTRADA DOS BLYNK_WRITE ---
+// O handler do pino valida (faixa, formato) e entrega aqui.
+void receiveBlynkSetting(uint8_t id, float value) {
+    if (id >= SYNC_SET_COUNT) return;
+
+    if (syncWindowOpen) {
+        syncStaged[id] = value;
+        syncReceivedMask |= (uint16_t)(1U << id);
+        if (syncReceivedMask == (uint16_t)((1U << SYNC_SET_COUNT) - 1)) commitStateSync();
+        return;
+    }
+
+    // Ao vivo: o usuário acabou de mexer no app, o valor dele é o mais novo
+    uint8_t effects = applyServerValue(id, value);
+    if (effects) {
+        Serial.print(F("Blynk: "));
+        Serial.print(SYNC_SETTINGS[id].name);
+        Serial.print(F(" = "));
+        Serial.println(value, 2);
+    }
+    postSyncEffects(effects);
+}
+
+
+// 6. --- TAREFA PERIÓDICA (rede) ---
+void runStateSync() {
+    if (!Blynk.connected()) {
+        syncWindowOpen = false; // Caiu no meio da janela: recomeça na próxima conexão
+        return;
+    }
+    if (syncWindowOpen) {
+        if (halMillis() - syncWindowStartMs >= STATE_SYNC_WINDOW_MS) commitStateSync();
+        return;
+    }
+    pushPendingSettings(); // Edições do OLED com a conexão ativa
+}
+
+void reportStateSyncStats() {
+    char line[128];
+    snprintf(line, sizeof(line), "SYNC: %lu reconexoes, %lu pedidos, %lu iguais, %lu aplicados, %lu enviados, %lu conflitos, %lu sem valor (ultima %lu ms)",
+             stateSyncStats.syncs, stateSyncStats.requested, stateSyncStats.unchanged, stateSyncStats.applied,
+             stateSyncStats.pushed, stateSyncStats.conflicts, stateSyncStats.missing, stateSyncStats.lastDurationMs);
+    Serial.println(line);
+    for (uint8_t id = 0; id < SYNC_SET_COUNT; id++) {
+        const SyncSettingState& st = syncSettingState[id];
+        snprintf(line, sizeof(line), "  %-18s v%lu (servidor v%lu) origem %u epoch %lu",
+                 SYNC_SETTINGS[id].name, (unsigned long)st.version, (unsigned long)st.syncedVersion,
+                 st.source, (unsigned long)st.modifiedEpoch);
+        Serial.println(line);
+    }
+}
@@ -0,0 +1,285 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: TASK_SCHEDULER              |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Cooperative task scheduler with main-loop latency statistics and budget
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.04 - runTaskScheduler() returns the time until the next periodic task
+15/10/2026 - 0.03 - Blynk.run() instrumented (PROF_BLYNK_RUN)
+15/10/2026 - 0.02 - Tasks grouped per FreeRTOS task (control, network, UI); statistics per group
+15/10/2026 - 0.01 - First installment: cooperative scheduler, loop() worst-case/p99 and budget
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - (this file) Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+// task_scheduler.ino
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- TABELA DE TAREFAS COOPERATIVAS ---
+// Cada FSM/rotina periódica do sistema se registra aqui (ver setup() em main.ino), em um grupo.
+// Cada tarefa FreeRTOS (rtos_tasks.ino) chama runTaskScheduler(grupo), que executa as tarefas
+// do seu grupo na ordem de registro.
+SchedulerTask schedulerTasks[MAX_SCHEDULER_TASKS];
+int schedulerTaskCount = 0;
+
+// --- ESTATÍSTICAS DE LATÊNCIA (uma janela por grupo) ---
+LoopStats loopStats[SCHED_GROUP_COUNT];
+const char* schedulerGroupNames[SCHED_GROUP_COUNT] = {"controle", "rede", "ui"};
+unsigned long loopBudgetUs = LOOP_BUDGET_US_DEFAULT; // Orçamento configurável por iteração (us)
+
+// Limites superiores (us) de cada faixa do histograma de duração de iteração.
+// A última faixa acumula tudo acima de 250 ms.
+const unsigned long LOOP_HIST_BOUNDS_US[LOOP_HIST_BUCKETS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 0xFFFFFFFFUL
+};
+
+
+// --- REGISTRO DE TAREFAS ---
+/**
+ * Registra uma tarefa no escalonador cooperativo.
+ * @param group    SchedulerGroup (tarefa FreeRTOS) que executa a função.
+ * @param name     Nome curto (aparece nos relatórios de latência).
+ * @param fn       Função a ser chamada. NÃO pode bloquear (sem delay()).
+ * @param periodMs Intervalo mínimo entre execuções (0 = toda iteração do loop).
+ * @param critical true = sempre executa (FSMs com bombas/válvulas);
+ *                 false = pode ser adiada se o orçamento da iteração já foi consumido.
+ */
+bool registerSchedulerTask(uint8_t group, const char* name, SchedulerTaskFn fn, unsigned long periodMs, bool critical) {
+    if (schedulerTaskCount >= MAX_SCHEDULER_TASKS) {
+        Serial.print(F("ERRO: Tabela de tarefas cheia. Tarefa nao registrada: "));
+        Serial.println(name);
+        logSystemEvent("error", "Escalonador: tabela de tarefas cheia.");
+        return false;
+    }
+
+    SchedulerTask& task = schedulerTasks[schedulerTaskCount++];
+    task.name = name;
+    task.group = group;
+    task.fn = fn;
+    task.periodMs = periodMs;
+    task.critical = critical;
+    task.lastRunMs = 0;
+    task.runCount = 0;
+    task.deferCount = 0;
+    task.maxRunUs = 0;
+
+    Serial.print(F("Escalonador: tarefa registrada: "));
+    Serial.println(name);
+    return true;
+}
+
+void setLoopBudgetUs(unsigned long budgetUs) {
+    // Limita a valores razoáveis (1 ms a 1 s) para não desativar a proteção por engano
+    loopBudgetUs = constrain(budgetUs, 1000UL, 1000000UL);
+}
+
+
+// --- EXECUÇÃO: UMA ITERAÇÃO DO GRUPO ---
+// Chamada a cada passagem do laço da tarefa FreeRTOS do grupo (rtos_tasks.ino).
+// A tabela só é escrita no setup(), antes da criação das tarefas; depois disso é apenas lida.
+// Devolve quantos ms faltam para a próxima tarefa periódica do grupo vencer (0 = alguma foi
+// adiada pelo orçamento): a tarefa FreeRTOS pode dormir até lá (power_manager.ino).
+unsigned long runTaskScheduler(uint8_t group) {
+    LoopStats& stats = loopStats[group];
+    unsigned long iterStartUs = micros();
+    unsigned long nowMs = millis();
+    const char* slowestTask = NULL;
+    unsigned long slowestUs = 0;
+    unsigned long nextDueMs = RTOS_IDLE_MAX_MS;
+
+    for (int i = 0; i < schedulerTaskCount; i++) {
+        SchedulerTask& task = schedulerTasks[i];
+        if (task.group != group) continue;
+
+        // 1. Respeita o período da tarefa
+        if (task.periodMs > 0 && nowMs - task.lastRunMs < task.periodMs) {
+            unsigned long remainingMs = task.periodMs - (nowMs - task.lastRunMs);
+            if (remainingMs < nextDueMs) nextDueMs = remainingMs;
+            continue;
+        }
+
+        // 2. Aplica o orçamento: tarefas não críticas ficam para a próxima iteração
+        if (!task.critical && (micros() - iterStartUs) >= loopBudgetUs) {
+            task.deferCount++;
+            stats.deferredRuns++;
+            nextDueMs = 0;
+            continue;
+        }
+        if (task.periodMs > 0 && task.periodMs < nextDueMs) nextDueMs = task.periodMs;
+
+        // 3. Executa e mede
+        unsigned long taskStartUs = micros();
+        task.fn();
+        unsigned long taskUs = micros() - taskStartUs;
+
+        task.lastRunMs = nowMs;
+        task.runCount++;
+        if (taskUs > task.maxRunUs) task.maxRunUs = taskUs;
+        if (taskUs > slowestUs) {
+            slowestUs = taskUs;
+            slowestTask = task.name;
+        }
+    }
+
+    recordLoopIteration(group, micros() - iterStartUs, slowestTask);
+
+    // 4. Relatório periódico (Serial) e abertura de nova janela de medição
+    if (nowMs - stats.windowStartMs >= LOOP_STATS_REPORT_MS) {
+        reportLoopStats(group);
+        resetLoopStatsWindow(group);
+    }
+    return nextDueMs;
+}
+
+
+// --- ESTATÍSTICAS ---
+
+void recordLoopIteration(uint8_t group, unsigned long iterUs, const char* slowestTask) {
+    LoopStats& stats = loopStats[group];
+    stats.iterations++;
+    if (iterUs > stats.windowMaxUs) stats.windowMaxUs = iterUs;
+    if (iterUs > stats.lifetimeMaxUs) stats.lifetimeMaxUs = iterUs;
+
+    int bucket = 0;
+    while (bucket < LOOP_HIST_BUCKETS - 1 && iterUs > LOOP_HIST_BOUNDS_US[bucket]) bucket++;
+    stats.histogram[bucket]++;
+
+    if (iterUs > loopBudgetUs) {
+        stats.overruns++;
+        stats.lastOverrunUs = iterUs;
+        stats.lastOverrunTask = slowestTask;
+    }
+}
+
+// Percentil 99 da janela atual, com a resolução das faixas do histograma (limite superior da faixa).
+unsigned long getLoopP99Us(uint8_t group) {
+    const LoopStats& stats = loopStats[group];
+    if (stats.iterations == 0) return 0;
+
+    unsigned long target = stats.iterations - (stats.iterations / 100); // ceil(0.99 * n)
+    unsigned long cumulative = 0;
+    for (int i = 0; i < LOOP_HIST_BUCKETS; i++) {
+        cumulative += stats.histogram[i];
+        if (cumulative >= target) {
+            // A última faixa não tem limite: usa o pior caso medido
+            return (i == LOOP_HIST_BUCKETS - 1) ? stats.windowMaxUs : LOOP_HIST_BOUNDS_US[i];
+        }
+    }
+    return stats.windowMaxUs;
+}
+
+void resetLoopStatsWindow(uint8_t group) {
+    LoopStats& stats = loopStats[group];
+    stats.windowStartMs = millis();
+    stats.iterations = 0;
+    stats.windowMaxUs = 0;
+    stats.overruns = 0;
+    stats.deferredRuns = 0;
+    stats.lastOverrunUs = 0;
+    stats.lastOverrunTask = NULL;
+    for (int i = 0; i < LOOP_HIST_BUCKETS; i++) stats.histogram[i] = 0;
+}
+
+void reportLoopStats(uint8_t group) {
+    const LoopStats& stats = loopStats[group];
+    Serial.print(F("LOOP["));
+    Serial.print(schedulerGroupNames[group]);
+    Serial.print(F("]: iter="));
+    Serial.print(stats.iterations);
+    Serial.print(F(" max="));
+    Serial.print(stats.windowMaxUs);
+    Serial.print(F("us p99<="));
+    Serial.print(getLoopP99Us(group));
+    Serial.print(F("us orcamento="));
+    Serial.print(loopBudgetUs);
+    Serial.print(F("us estouros="));
+    Serial.print(stats.overruns);
+    Serial.print(F(" adiadas="));
+    Serial.println(stats.deferredRuns);
+
+    if (stats.overruns > 0) {
+        Serial.print(F("LOOP: ultimo estouro de "));
+        Serial.print(stats.lastOverrunUs);
+        Serial.print(F("us causado por: "));
+        Serial.println(stats.lastOverrunTask ? stats.lastOverrunTask : "?");
+        logSystemEvent("warning", "Escalonador: orcamento do loop excedido.");
+    }
+
+    // Pior tempo por tarefa do grupo (acumulado desde o boot)
+    for (int i = 0; i < schedulerTaskCount; i++) {
+        if (schedulerTasks[i].group != group) continue;
+        Serial.print(F("  - "));
+        Serial.print(schedulerTasks[i].name);
+        Serial.print(F(": runs="));
+        Serial.print(schedulerTasks[i].runCount);
+        Serial.print(F(" max="));
+        Serial.print(schedulerTasks[i].maxRunUs);
+        Serial.print(F("us adiadas="));
+        Serial.println(schedulerTasks[i].deferCount);
+    }
+}
+
+
+// --- SETUP ---
+void setupTaskScheduler() {
+    schedulerTaskCount = 0;
+    for (int g = 0; g < SCHED_GROUP_COUNT; g++) {
+        loopStats[g].lifetimeMaxUs = 0;
+        resetLoopStatsWindow(g);
+    }
+}
+
+// Wrapper para o Blynk (o escalonador só aceita funções void sem parâmetros)
+void runBlynkTask() {
+    PROFILE_SCOPE(PROF_BLYNK_RUN);
+    Blynk.run();
+}
@@ -0,0 +1,317 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: TELEMETRY                   |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Central Blynk telemetry publisher (deadband, rate limits, offline backfill)
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.03 - VPIN_DIAGNOSTICS policy (1 send/min); publisher instrumented
+15/10/2026 - 0.02 - Backfill timestamps from clockNowEpoch()
+15/10/2026 - 0.01 - First installment: per-pin deadband/min/max interval, coalescing and offline backfill
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - (this file) Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+// telemetry.ino
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- PUBLICADOR CENTRAL DE TELEMETRIA (tarefa de rede) ---
+// Todo publishVirtualPin*() termina aqui (deliverNetMessage -> submitTelemetry). Cada pino
+// virtual tem um "slot" com o último valor pedido e o último valor enviado. A cada tick o
+// publicador decide, por pino, se envia, se segura (intervalo mínimo) ou se descarta (zona morta).
+// Várias escritas do mesmo pino dentro do intervalo viram um único envio (coalescência).
+// Offline, pinos de histórico vão para um buffer circular com carimbo de hora do RTC e são
+// reenviados depois da reconexão (Blynk.beginGroup(timestamp)) em ritmo limitado.
+
+// Política por pino. deadband < 0 (TELEMETRY_NO_DEDUP) = todo valor pedido é enviado.
+// Pinos fora desta tabela usam telemetryDefaultPolicy (sem descarte, sem intervalo mínimo):
+// são comandos/ecos de configuração que o app precisa receber mesmo se repetidos.
+const TelemetryPolicy telemetryPolicies[] = {
+    // vpin                   zona morta  mín (ms)  máx (ms)  histórico
+    { VPIN_TEMP,              0.05f,      5000UL,   300000UL, true  },
+    { VPIN_TEMP_SUMP,         0.05f,      5000UL,   300000UL, true  },
+    { VPIN_TEMP_RAN,          0.10f,      5000UL,   300000UL, true  },
+    { VPIN_PH_VAL,            0.01f,      5000UL,   300000UL, true  },
+    { VPIN_RAN_LEVEL_PERCENT, 1.0f,       10000UL,  600000UL, true  },
+    { VPIN_RAN_VOLUME,        0.1f,       5000UL,   600000UL, true  },
+    { VPIN_RAN_FILL_RATE,     0.05f,      5000UL,   600000UL, false },
+    { VPIN_TIME,              0.0f,       60000UL,  0UL,      false }, // Texto "hh:mm:ss": 1 envio/min
+    { VPIN_TEMP_ALERT,        0.0f,       0UL,      300000UL, false }, // LEDs: só mudanças + confirmação
+    { VPIN_PH_ALERT,          0.0f,       0UL,      300000UL, false },
+    { VPIN_RAN_REFILL_ALERT,  0.0f,       0UL,      300000UL, false },
+    { VPIN_TPA_MASTER_STATE,  0.0f,       0UL,      300000UL, false },
+    { VPIN_TPA_EXTRACTION_PUMP, 0.0f,     0UL,      300000UL, false },
+    { VPIN_DIAGNOSTICS,       0.0f,       60000UL,  0UL,      false }, // Resumo do profiler: 1 envio/min
+};
+const int TELEMETRY_POLICY_COUNT = sizeof(telemetryPolicies) / sizeof(telemetryPolicies[0]);
+const TelemetryPolicy telemetryDefaultPolicy = { 0xFF, TELEMETRY_NO_DEDUP, 0UL, 0UL, false };
+
+TelemetrySlot telemetrySlots[TELEMETRY_MAX_PINS];
+int telemetrySlotCount = 0;
+int telemetryCursor = 0;                 // Rodízio entre os slots (nenhum pino monopoliza o orçamento)
+
+TelemetrySample telemetryBackfill[TELEMETRY_BACKFILL_SIZE]; // Amostras guardadas offline
+int telemetryBackfillHead = 0;           // Próxima amostra a reenviar (mais antiga)
+int telemetryBackfillCount = 0;
+
+TelemetryStats telemetryStats;
+unsigned long telemetryLastReportMs = 0;
+
+
+// --- FUNÇÕES AUXILIARES ---
+
+const TelemetryPolicy* findTelemetryPolicy(uint8_t vpin) {
+    for (int i = 0; i < TELEMETRY_POLICY_COUNT; i++) {
+        if (telemetryPolicies[i].vpin == vpin) return &telemetryPolicies[i];
+    }
+    return &telemetryDefaultPolicy;
+}
+
+static uint32_t hashTelemetryText(const char* text) {
+    uint32_t h = 2166136261UL; // FNV-1a
+    while (*text) {
+        h ^= (uint8_t)*text++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+static float telemetryNumericValue(const TelemetrySlot& slot) {
+    return (slot.type == NET_MSG_PIN_INT) ? (float)slot.intValue : slot.floatValue;
+}
+
+TelemetrySlot* getTelemetrySlot(uint8_t vpin) {
+    for (int i = 0; i < telemetrySlotCount; i++) {
+        if (telemetrySlots[i].vpin == vpin) return &telemetrySlots[i];
+    }
+    if (telemetrySlotCount >= TELEMETRY_MAX_PINS) return NULL;
+
+    TelemetrySlot& slot = telemetrySlots[telemetrySlotCount++];
+    memset(&slot, 0, sizeof(slot));
+    slot.vpin = vpin;
+    slot.policy = findTelemetryPolicy(vpin);
+    return &slot;
+}
+
+
+// --- ENTRADA: pedidos de publicação (tarefa de rede) ---
+void submitTelemetry(const NetMessage& msg) {
+    telemetryStats.submitted++;
+
+    TelemetrySlot* slot = getTelemetrySlot(msg.vpin);
+    if (slot == NULL) {
+        // Tabela cheia: não perde o valor, envia sem política
+        telemetryStats.overflow++;
+        if (Blynk.connected()) writeTelemetryValue(msg.vpin, msg.type, msg.intValue, msg.floatValue, msg.text);
+        return;
+    }
+
+    if (slot->pending) telemetryStats.coalesced++; // O valor anterior ainda não saiu: substituído
+    slot->type = msg.type;
+    slot->intValue = msg.intValue;
+    slot->floatValue = msg.floatValue;
+    if (msg.type == NET_MSG_PIN_TEXT) {
+        strncpy(slot->text, msg.text, NET_MSG_TEXT_LEN - 1);
+        slot->text[NET_MSG_TEXT_LEN - 1] = '\0';
+    }
+    slot->pending = true;
+}
+
+void writeTelemetryValue(uint8_t vpin, uint8_t type, int32_t intValue, float floatValue, const char* text) {
+    switch (type) {
+        case NET_MSG_PIN_INT:
+            Blynk.virtualWrite(vpin, intValue);
+            break;
+        case NET_MSG_PIN_FLOAT:
+            Blynk.virtualWrite(vpin, floatValue);
+            break;
+        case NET_MSG_PIN_TEXT:
+            Blynk.virtualWrite(vpin, text);
+            break;
+    }
+}
+
+
+// --- BUFFER DE HISTÓRICO OFFLINE ---
+void pushTelemetryBackfill(const TelemetrySlot& slot) {
+    // Sem hora confiável não há como carimbar a amostra
+    if (!clockIsValid()) {
+        telemetryStats.backfillDropped++;
+        return;
+    }
+
+    if (telemetryBackfillCount == TELEMETRY_BACKFILL_SIZE) {
+        // Cheio: descarta a mais antiga para manter o histórico mais recente
+        telemetryBackfillHead = (telemetryBackfillHead + 1) % TELEMETRY_BACKFILL_SIZE;
+        telemetryBackfillCount--;
+        telemetryStats.backfillDropped++;
+    }
+
+    int index = (telemetryBackfillHead + telemetryBackfillCount) % TELEMETRY_BACKFILL_SIZE;
+    TelemetrySample& sample = telemetryBackfill[index];
+    sample.epoch = clockNowEpoch();
+    sample.vpin = slot.vpin;
+    sample.type = slot.type;
+    sample.value = telemetryNumericValue(slot);
+    telemetryBackfillCount++;
+}
+
+// Reenvia amostras antigas com o carimbo de hora original. Retorna quantas foram enviadas.
+int drainTelemetryBackfill(int budget) {
+    int sent = 0;
+    while (sent < budget && telemetryBackfillCount > 0) {
+        const TelemetrySample& sample = telemetryBackfill[telemetryBackfillHead];
+        Blynk.beginGroup((uint64_t)sample.epoch * 1000ULL);
+        if (sample.type == NET_MSG_PIN_INT) {
+            Blynk.virtualWrite(sample.vpin, (int32_t)sample.value);
+        } else {
+            Blynk.virtualWrite(sample.vpin, sample.value);
+        }
+        Blynk.endGroup();
+
+        telemetryBackfillHead = (telemetryBackfillHead + 1) % TELEMETRY_BACKFILL_SIZE;
+        telemetryBackfillCount--;
+        telemetryStats.backfilled++;
+        sent++;
+    }
+    return sent;
+}
+
+
+// --- TAREFA DO ESCALONADOR (grupo de rede, a cada TELEMETRY_TICK_MS) ---
+void runTelemetryPublisher() {
+    PROFILE_SCOPE(PROF_TELEMETRY);
+    unsigned long now = millis();
+    bool online = Blynk.connected();
+    int budget = TELEMETRY_MAX_SENDS_PER_TICK;
+
+    for (int n = 0; n < telemetrySlotCount; n++) {
+        TelemetrySlot& slot = telemetrySlots[(telemetryCursor + n) % telemetrySlotCount];
+        const TelemetryPolicy* policy = slot.policy;
+
+        bool heartbeatDue = slot.hasSent && policy->maxIntervalMs > 0 &&
+                            (now - slot.lastSentMs >= policy->maxIntervalMs);
+        if (!slot.pending && !heartbeatDue) continue;
+
+        if (slot.pending && slot.hasSent && policy->deadband >= 0.0f) {
+            bool changed;
+            if (slot.type == NET_MSG_PIN_TEXT) {
+                changed = hashTelemetryText(slot.text) != slot.lastSentHash;
+            } else {
+                changed = fabsf(telemetryNumericValue(slot) - slot.lastSentValue) > policy->deadband;
+            }
+            if (!changed && !heartbeatDue) {
+                slot.pending = false;          // Dentro da zona morta: nada a enviar
+                telemetryStats.suppressed++;
+                continue;
+            }
+            // Mudou, mas ainda no intervalo mínimo: fica pendente (próximos valores substituem este)
+            if (!heartbeatDue && now - slot.lastSentMs < policy->minIntervalMs) continue;
+        }
+
+        if (!online) {
+            // Histórico: guarda com carimbo de hora. Estado: segura o último valor até reconectar.
+            if (policy->backfill && slot.type != NET_MSG_PIN_TEXT) {
+                pushTelemetryBackfill(slot);
+                markTelemetrySent(slot, now);
+            }
+            continue;
+        }
+
+        if (budget == 0) {
+            telemetryCursor = (telemetryCursor + n) % telemetrySlotCount; // Continua daqui no próximo tick
+            break;
+        }
+        writeTelemetryValue(slot.vpin, slot.type, slot.intValue, slot.floatValue, slot.text);
+        markTelemetrySent(slot, now);
+        telemetryStats.sent++;
+        budget--;
+    }
+
+    // Orçamento que sobrou vai para o histórico (nunca mais que TELEMETRY_BACKFILL_PER_TICK)
+    if (online && budget > 0) {
+        drainTelemetryBackfill(min(budget, TELEMETRY_BACKFILL_PER_TICK));
+    }
+
+    if (now - telemetryLastReportMs >= LOOP_STATS_REPORT_MS) {
+        telemetryLastReportMs = now;
+        reportTelemetryStats();
+    }
+}
+
+void markTelemetrySent(TelemetrySlot& slot, unsigned long now) {
+    slot.pending = false;
+    slot.hasSent = true;
+    slot.lastSentMs = now;
+    if (slot.type == NET_MSG_PIN_TEXT) {
+        slot.lastSentHash = hashTelemetryText(slot.text);
+    } else {
+        slot.lastSentValue = telemetryNumericValue(slot);
+    }
+}
+
+// --- RELATÓRIO ---
+void reportTelemetryStats() {
+    Serial.print(F("TELEMETRIA: pedidos="));
+    Serial.print(telemetryStats.submitted);
+    Serial.print(F(" enviados="));
+    Serial.print(telemetryStats.sent);
+    Serial.print(F(" suprimidos="));
+    Serial.print(telemetryStats.suppressed);
+    Serial.print(F(" agrupados="));
+    Serial.print(telemetryStats.coalesced);
+    Serial.print(F(" historico="));
+    Serial.print(telemetryStats.backfilled);
+    Serial.print(F(" pendente="));
+    Serial.print(telemetryBackfillCount);
+    Serial.print(F(" perdidos="));
+    Serial.println(telemetryStats.backfillDropped);
+}
@@ -21,6 +21,19 @@
 
 
 == Version History ==
+15/10/2026 - 0.13 - Settings handlers hand validated values to the state sync; setupTpaManager() no longer republishes every pin
+15/10/2026 - 0.12 - Entry point instrumented with PROFILE_SCOPE
+15/10/2026 - 0.11 - Schedule hour/minute handlers read param.asStr() (no String)
+15/10/2026 - 0.10 - Cycle runs as a stage plan (tpa_plan): buffer dosing (M5.4) now part of the full cycle
+15/10/2026 - 0.09 - Extraction duration from calibrated flow (removed hardcoded 10 ml/s); buffer dose by volume
+15/10/2026 - 0.08 - Local schedule moved to tpa_scheduler (no RTC reads in the TPA loop, double call removed)
+                    Partial flows for schedule jobs: buffer dosing only, RAN top-up only
+15/10/2026 - 0.07 - Time via HAL (halMillis); end-to-end TPA cycle duration stats
+15/10/2026 - 0.06 - Config changes use markConfigDirty()
+15/10/2026 - 0.05 - TPA milestones recorded in the local history
+15/10/2026 - 0.04 - Blynk echo/sync writes through the telemetry publisher
+15/10/2026 - 0.03 - Blynk TPA triggers posted as commands to the control task
+15/10/2026 - 0.02 - Extraction (M5.1) coordinated as a non-blocking stage; startTpaCycle() entry point
 01/11/2025 - 0.01 - First installment based on code created by Gemini AI (Google)
 
 == Project file structure ==
@@ -37,12 +50,29 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - (this file) Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 */
 
 #include "config.h"
 #include "global.h"
 #include "utils.h"
 
+TpaCycleStats tpaCycleStats;
+
 // 1. --- LÓGICA DE CÁLCULO DE VOLUME ---
 void calculateTpaVolume() {
     if (aquariumTotalVolume <= 0 || tpaExtractionPercent <= 0) {
@@ -54,10 +84,8 @@ void calculateTpaVolume() {
     // Volume (L) = Volume Total * Percentual / 100
     volumeToExtractLiters = aquariumTotalVolume * (tpaExtractionPercent / 100.0f);
     
-    // Calcula a duracao necessaria 
-    // OBS: A função calculatePumpDuration() deve ser implementada no actuators_manager.ino (Próximo módulo)
-    // Por enquanto, usaremos um placeholder: 10ml/s (10.0 ml/s)
-    tpaPumpDurationMs = (unsigned long)((volumeToExtractLiters * 1000.0f) / 10.0f) * 1000UL;
+    // Duração prevista com a vazão calibrada da bomba de extração (o término real é pelo volume)
+    tpaPumpDurationMs = calculatePumpDuration(PUMP_EXTRACTION, volumeToExtractLiters);
 
     Serial.print(F("TPA Calculado: Extrair "));
     Serial.print(volumeToExtractLiters, 2);
@@ -70,153 +98,76 @@ void calculateTpaVolume() {
 
 
 // 2. Lógica  de Coordenação do Loop TPA Master
+// Os estágios (extração, reposição, enchimento, buffer) são escalonados pelo plano TPA
+// (tpa_plan.ino): dependências e recursos decidem o que roda em paralelo.
 void runTpaManagerLoop() {
-    // 2.1. Lógica de Agendamento Local
-    if (tpaMasterCurrentState == TPA_MASTER_IDLE) {
-        // Se estiver IDLE, checa se a hora de um agendamento local (se ativo) chegou
-        checkLocalSchedule();
-    }
-    
-    // 2.2. Coordenação da Extração (M5.1)
-// 1. MÓDULO 5.1: Extração (Se estiver em andamento)
-    if (tpaMasterCurrentState == TPA_MASTER_EXTRACTION_RUNNING_M51) {
-        // A lógica de execução do M5.1 está dentro da função executeTpaExtraction(), que é síncrona/bloqueante
-        // Portanto, o estado M51 só existe enquanto a bomba está ligada.
-        // O estado de M5.2 (Reposição) é quem assume após a extração.
+    PROFILE_SCOPE(PROF_TPA_LOOP);
+    // O agendamento local roda na própria tarefa (tpa_scheduler.ino): nada de RTC aqui
+    // 2.5. Se o processo terminou, volta ao IDLE apos um ciclo completo
+    if (tpaMasterCurrentState == TPA_MASTER_COMPLETED) {
+        tpaMasterCurrentState = TPA_MASTER_IDLE;
+        return;
     }
+    runTpaPlan();
+}
 
-    // 2.3. Coordenação da Reposição (M5.2)
-    else if (tpaMasterCurrentState == TPA_MASTER_REPOSITION_RUNNING_M52) {
-        runTpaRepositionLoop(); // Executa o loop da reposição (bomba ligada por tempo)
 
-        if (isTpaRepositionFinished()) {
-            Serial.println(F("TPA: Reposicao concluida. Inicia Enchimento do RAN (M5.3)..."));
-            // Transição para o Módulo 5.3
-            tpaMasterCurrentState = TPA_MASTER_REFILL_RUNNING_M53; 
-            startRanRefillFlow(); // Inicia o novo fluxo de enchimento do RAN
-            resetTpaRepositionFlow(); // Limpa o estado do M5.2
-        }
-    }
-    
-    // 2.4: ENCHIMENTO DO RAN (RO -> RAN) ***
-    else if (tpaMasterCurrentState == TPA_MASTER_REFILL_RUNNING_M53) {
-        runRanRefillLoop(); // Executa a máquina de estados do enchimento por nível
-
-        if (isRanRefillFinished()) {
-            Serial.println(F("TPA: Enchimento do RAN concluido. Ciclo TPA finalizado."));
-            // Transição para o estado final
-            tpaMasterCurrentState = TPA_MASTER_COMPLETED; 
-            resetRanRefillFlow(); // Limpa o estado do M5.3
-            logSystemEvent("info", "Ciclo TPA completo.");
-        }
-    }
-
-    // 2.5: DOSAGEM DE BUFFER (BUFFER -> RAN) ***
-    else if (tpaMasterCurrentState == TPA_MASTER_BUFFER_DOSING_M54) {
-        runTpaBufferDosingLoop();
-        if (isTpaBufferDosingFinished()) {
-            Serial.println(F("M5.4 CONCLUÍDO. Ciclo TPA finalizado."));
-            resetTpaBufferDosingFlow(); // Limpa o estado do M5.4
-            tpaMasterCurrentState = TPA_MASTER_COMPLETED;
-            Blynk.virtualWrite(VPIN_TPA_MASTER_STATE, tpaMasterCurrentState);
-        }
+// 2.7. Dispara um ciclo TPA completo (Blynk manual, Timer Widget ou agendamento local)
+// Só troca o estado mestre se o plano realmente começou.
+bool startTpaCycle(const char* source) {
+    if (!startTpaPlan(TPA_STAGES_FULL_CYCLE, source)) {
+        return false; // Motivo já registrado por startTpaPlan()
     }
+    recordHistoryEvent(HISTORY_EVT_TPA_STARTED);
+    noteScheduleJobRun(SCHED_JOB_TPA); // Base do quinzenal e da verificação de execuções perdidas
+    return true;
+}
 
-    // 2.5. Se o processo terminou, volta ao IDLE apos um ciclo completo
-    else if (tpaMasterCurrentState == TPA_MASTER_COMPLETED) {
-        tpaMasterCurrentState = TPA_MASTER_IDLE;
-    }
+// 2.9. Fluxos parciais disparados pelos jobs de agenda (tpa_scheduler.ino)
+bool startBufferDosingOnly(const char* source) {
+    Serial.print(F("Buffer: Dosagem avulsa disparada por "));
+    Serial.println(source);
+    return startTpaPlan(TPA_STAGE_BIT(TPA_STAGE_BUFFER), source);
+}
 
-    // 2.6. MÓDULO DE AGENDAMENTO LOCAL (Funciona em IDLE)
-    if (tpaMasterCurrentState == TPA_MASTER_IDLE) {
-        // Checa se é hora de executar a TPA de acordo com o agendamento local.
-        checkLocalSchedule();
-    }
+bool startRanTopUpOnly(const char* source) {
+    Serial.print(F("RAN: Enchimento avulso disparado por "));
+    Serial.println(source);
+    return startTpaPlan(TPA_STAGE_BIT(TPA_STAGE_REFILL), source);
+}
 
+// 2.8. Fecha a medição do ciclo (base para comparar desempenho na simulação e no hardware)
+void finishTpaCycleStats(bool completed) {
+    unsigned long durationMs = halMillis() - tpaCycleStats.startMs;
+    if (completed) tpaCycleStats.completed++;
+    else tpaCycleStats.aborted++;
+    tpaCycleStats.lastDurationMs = durationMs;
+    if (durationMs > tpaCycleStats.maxDurationMs) tpaCycleStats.maxDurationMs = durationMs;
+
+    Serial.print(F("TPA: Ciclo "));
+    Serial.print(completed ? F("concluido") : F("cancelado"));
+    Serial.print(F(" em "));
+    Serial.print(durationMs / 1000);
+    Serial.print(F(" s (max "));
+    Serial.print(tpaCycleStats.maxDurationMs / 1000);
+    Serial.println(F(" s)."));
 }
 
 
 // 3. Modificação dos Handlers BLYNK_WRITE (Onde o processo é disparado):
-// Assumindo que executeTpaExtraction() é uma função de INICIALIZAÇÃO da extração M5.1
+// Os handlers rodam na tarefa de rede: apenas enviam o comando; a tarefa de controle chama
+// startTpaCycle(), e os estágios seguintes são escalonados por runTpaPlan()
 BLYNK_WRITE(VPIN_EXTRACTION_BUTTON) {
     if (param.asInt() == 1) { 
         Serial.println(F("Comando Blynk: TPA Manual recebido."));
-        if (tpaMasterCurrentState == TPA_MASTER_IDLE) {
-            // Dispara o inicio da Extração M5.1
-            tpaMasterCurrentState = TPA_MASTER_EXTRACTION_RUNNING_M51;
-            executeTpaExtraction(); 
-        } else {
-            Serial.println(F("AVISO: TPA ja esta em execucao."));
-        }
+        postControlCommand(CMD_START_TPA, TPA_SOURCE_BLYNK_MANUAL);
     }
 }
 
 // BLYNK_WRITE(VPIN_TPA_SCHEDULE)
 BLYNK_WRITE(VPIN_TPA_SCHEDULE) {
     Serial.println(F("Agendamento TPA disparado pelo Blynk."));
-    if (tpaMasterCurrentState == TPA_MASTER_IDLE) {
-        tpaMasterCurrentState = TPA_MASTER_EXTRACTION_RUNNING_M51;
-        executeTpaExtraction(); 
-    } else {
-        Serial.println(F("AVISO: TPA ja esta em execucao."));
-    }
-}
-
-// 4.--- LÓGICA DE AGENDAMENTO LOCAL (FALLBACK) ---
-void checkLocalSchedule() {
-    // Nao execute se:
-    // 1. O agendamento local nao estiver ativo
-    // 2. A bomba ja estiver rodando
-    // 3. O Blynk estiver conectado (A TPA deve ser agendada pelo Timer Widget do Blynk)
-    if (!tpaLocalScheduleActive || tpaExtractionPumpState || Blynk.connected()) return;
-
-    bool readyToExecute = false;
-    unsigned long currentTimeMs = millis();
-    
-    // --- 4.1. Checa a Frequencia Minima (Intervalo de 23h para evitar execucoes em loop) ---
-    // A logica do agendamento so checa uma vez por hora, mas a execucao real deve ser limitada.
-    if (currentTimeMs - lastTpaExecution < (23 * 60 * 60 * 1000UL)) { 
-        return; 
-    }
-    
-    // Obtem dados atuais do RTC (ou NTP, via a função unificada)
-    DateTime now = getDateTimeNow(); 
-    
-    // --- 4.2. Checa a Hora e Minuto ---
-    if (now.hour() == tpaScheduleHour && now.minute() == tpaScheduleMinute) {
-        // --- 4.3. Checa as Regras de Frequencia ---
-        switch (tpaScheduleFrequency) {
-            case 0: // Diaria
-                readyToExecute = true;
-                break;
-            case 1: // Semanal (1=Dom, 7=Sab. dayOfTheWeek() retorna 0=Dom a 6=Sab. Ajuste!)
-                // O Blynk/Config usa 1..7 (ou 1..6 + 0) para dias. 
-                // Assumimos que tpaScheduleDay esta mapeado para 0 (Dom) a 6 (Sab)
-                if (now.dayOfTheWeek() == tpaScheduleDay) { 
-                    readyToExecute = true;
-                }
-                break;
-            case 2: // Quinzenal 
-                if (now.dayOfTheWeek() == tpaScheduleDay) {
-                    // Logica de 14 dias: Se a ultima execucao foi ha mais de 13 dias
-                    if (now.unixtime() - (lastTpaExecution / 1000UL) > (13 * 24 * 60 * 60UL)) {
-                        readyToExecute = true;
-                    }
-                }
-                break;
-            case 3: // Mensal (Checa o dia do mes: 1-31)
-                if (now.day() == tpaScheduleDay) {
-                    readyToExecute = true;
-                }
-                break;
-        }
-    }
-
-    if (readyToExecute) {
-        logSystemEvent("warning", "Agendamento Local TPA disparado. (OFFLINE)");
-        lastTpaExecution = currentTimeMs; // Registra o tempo de execucao em millis
-        executeTpaExtraction();
-    }
+    postControlCommand(CMD_START_TPA, TPA_SOURCE_BLYNK_SCHEDULE);
 }
 
 // ------------------------------------------------------------------
@@ -230,10 +181,9 @@ void startTpaBufferDosing() {
         return;
     }
 
-    // 1. Calcula a duração do acionamento da bomba (em ms)
-    // Converte mL para Litros (float) e usa a função de cálculo de duração existente
+    // 1. Duração prevista (só informativa: a dose termina pelo volume integrado)
     float bufferVolumeLiters = (float)ranBufferVolumeML / 1000.0f;
-    bufferDosingDurationMs = calculatePumpDuration(bufferVolumeLiters);
+    bufferDosingDurationMs = calculatePumpDuration(PUMP_BUFFER, bufferVolumeLiters);
 
     Serial.print(F("Iniciando Dosagem de Buffer: "));
     Serial.print(ranBufferVolumeML);
@@ -243,17 +193,19 @@ void startTpaBufferDosing() {
     logSystemEvent("info", "Dosagem de Buffer (M5.4) iniciada.");
 
     // 2. Inicia a dosagem e seta o estado
-    setBufferPumpState(true); // Função implementada em actuators_manager.ino
-    bufferPreviousMillis = millis();
+    if (!setBufferPumpState(true)) { // Função implementada em actuators_manager.ino
+        logSystemEvent("warning", "Dosagem de Buffer (M5.4) nao iniciada.");
+        tpaBufferCurrentState = TPA_BUFFER_FINISHED;
+        return;
+    }
+    bufferPreviousMillis = halMillis();
     tpaBufferCurrentState = TPA_BUFFER_DOSING;
 }
 
 void runTpaBufferDosingLoop() {
     if (tpaBufferCurrentState == TPA_BUFFER_DOSING) {
-        unsigned long currentMillis = millis();
-
-        // Checa se o tempo de dosagem terminou
-        if (currentMillis - bufferPreviousMillis >= bufferDosingDurationMs) {
+        // Checa se o volume foi entregue (o motor de dosagem desliga a bomba)
+        if (!isPumpDoseActive(PUMP_BUFFER)) {
             // DESLIGA a Bomba de Buffer
             setBufferPumpState(false);
             
@@ -280,14 +232,14 @@ void resetTpaBufferDosingFlow() {
 
 
 // 5.--- HANDLERS BLYNK PARA PERSISTÊNCIA E SINCRONIZAÇÃO ---
+// Os handlers só validam e entregam a receiveBlynkSetting() (state_sync.ino): ao vivo o valor é
+// aplicado na hora; na reconexão fica guardado e entra no lote único (um recálculo, uma gravação).
 
 // SINCRONIZAÇÃO BLYNK: Volume Total (L) ---
 BLYNK_WRITE(VPIN_TOTAL_VOLUME) {
     float newVolume = param.asFloat();
     if (newVolume > 0 && newVolume <= 5000) { 
-        aquariumTotalVolume = newVolume;
-        calculateTpaVolume(); 
-        configIsDirty = true;
+        receiveBlynkSetting(SYNC_SET_TOTAL_VOLUME, newVolume);
     }
 }
 
@@ -295,24 +247,20 @@ BLYNK_WRITE(VPIN_TOTAL_VOLUME) {
 BLYNK_WRITE(VPIN_EXTRACTION_PERCENT) {
     float newPercent = param.asFloat();
     if (newPercent > 0 && newPercent <= 50) { 
-        tpaExtractionPercent = newPercent;
-        calculateTpaVolume(); 
-        configIsDirty = true; 
+        receiveBlynkSetting(SYNC_SET_EXTRACTION_PERCENT, newPercent);
     }
 }
 
 // SINCRONIZAÇÃO BLYNK: Ativa Agendamento Local (Fallback) ---
 BLYNK_WRITE(VPIN_LOCAL_SCHEDULE_ACTIVE) {
-    tpaLocalScheduleActive = param.asInt() == 1;
-    configIsDirty = true; 
+    receiveBlynkSetting(SYNC_SET_LOCAL_SCHEDULE, param.asInt() == 1 ? 1.0f : 0.0f);
 }
 
 // SINCRONIZAÇÃO BLYNK: Frequencia (0:Diaria, 1:Semanal, 2:Quinzenal, 3:Mensal)
 BLYNK_WRITE(VPIN_SCHEDULE_FREQUENCY) {
     int freq = param.asInt();
     if (freq >= 0 && freq <= 3) {
-        tpaScheduleFrequency = freq;
-        configIsDirty = true; 
+        receiveBlynkSetting(SYNC_SET_SCHEDULE_FREQUENCY, (float)freq);
     }
 }
 
@@ -320,20 +268,17 @@ BLYNK_WRITE(VPIN_SCHEDULE_FREQUENCY) {
 BLYNK_WRITE(VPIN_SCHEDULE_DAY) {
     int day = param.asInt();
     if (day >= 1 && day <= 31) {
-        tpaScheduleDay = day;
-        configIsDirty = true; 
+        receiveBlynkSetting(SYNC_SET_SCHEDULE_DAY, (float)day);
     }
 }
 
 // SINCRONIZAÇÃO BLYNK: Hora (V16) - Recebe String do Input Web
 BLYNK_WRITE(VPIN_SCHEDULE_HOUR) {
-    String hourStr = param.asString();
-    int hour = atoi(hourStr.c_str());
+    const char* hourStr = param.asStr();
+    int hour = atoi(hourStr);
     
     if (hour >= 0 && hour <= 23) { // Validação de 0 a 23
-        tpaScheduleHour = hour;
-        Serial.printf("Hora Agendada (Blynk): %d\n", hour);
-        configIsDirty = true;
+        receiveBlynkSetting(SYNC_SET_SCHEDULE_HOUR, (float)hour);
     } else {
         Serial.print(F("ERRO: Hora agendada invalida ("));
         Serial.print(hourStr);
@@ -343,13 +288,11 @@ BLYNK_WRITE(VPIN_SCHEDULE_HOUR) {
 
 // SINCRONIZAÇÃO BLYNK: Minuto (V30) - Recebe String do Input Web
 BLYNK_WRITE(VPIN_SCHEDULE_MINUTE) {
-    String minuteStr = param.asString();
-    int minute = atoi(minuteStr.c_str());
+    const char* minuteStr = param.asStr();
+    int minute = atoi(minuteStr);
     
     if (minute >= 0 && minute <= 59) { // Validação de 0 a 59
-        tpaScheduleMinute = minute;
-        Serial.printf("Minuto Agendado (Blynk): %d\n", minute);
-        configIsDirty = true;
+        receiveBlynkSetting(SYNC_SET_SCHEDULE_MINUTE, (float)minute);
     } else {
         Serial.print(F("ERRO: Minuto agendado invalido ("));
         Serial.print(minuteStr);
@@ -361,7 +304,8 @@ BLYNK_WRITE(VPIN_SCHEDULE_MINUTE) {
 // SINCRONIZAÇÃO BLYNK: Slider de Volume de Reposição (VPIN_REPOSITION_VOLUME_L)
 BLYNK_WRITE(VPIN_REPOSITION_VOLUME_L) {
     // Valor recebido do slider/widget.
-    float newVolume = param.asFloat();
+    float requestedVolume = param.asFloat();
+    float newVolume = requestedVolume;
     
     // O valor do slider deve ser limitado (ex: entre 0.1L e 1.5x o volume extraído)
     // Usamos o volume extraído como referência de limite superior para evitar erros grotescos.
@@ -373,20 +317,13 @@ BLYNK_WRITE(VPIN_REPOSITION_VOLUME_L) {
         newVolume = maxLimit;
     }
 
-    if (volumeToRepositionLiters != newVolume) {
-        volumeToRepositionLiters = newVolume;
-        configIsDirty = true; // Sinaliza que a configuração precisa ser salva
-        
-        Serial.print(F("Blynk: Volume de Reposicao ajustado para "));
-        Serial.print(volumeToRepositionLiters, 2);
-        Serial.println(F(" L."));
-        logSystemEvent("info", "Volume de Reposicao ajustado via Blynk.");
+    receiveBlynkSetting(SYNC_SET_REPOSITION_VOLUME, newVolume);
+
+    // Feedback: se o valor foi limitado, devolve o valor aceito para o slider se ajustar
+    // (uma boa prática de UI/UX). Aceito como veio: nada a ecoar.
+    if (newVolume != requestedVolume) {
+        publishVirtualPin(VPIN_REPOSITION_VOLUME_L, newVolume);
     }
-    
-    // Feedback: Força a escrita do valor de volta para o widget.
-    // Isso garante que, se o valor for limitado (como acima), o slider se ajuste
-    // ao valor real aceito pelo sistema (uma boa prática de UI/UX).
-    Blynk.virtualWrite(VPIN_REPOSITION_VOLUME_L, volumeToRepositionLiters);
 }
 
 // --- BLYNK: Handlers de Sincronização de Configuração (M5.4 - Buffer) ---
@@ -396,21 +333,13 @@ BLYNK_WRITE(VPIN_RAN_BUFFER_VOLUME) {
 
     // Validação de intervalo (0-999)
     if (newVolume >= BUFFER_VOLUME_MIN && newVolume <= BUFFER_VOLUME_MAX) {
-        if (ranBufferVolumeML != newVolume) {
-            ranBufferVolumeML = newVolume;
-            configIsDirty = true; // Sinaliza que a configuração precisa ser salva
-            Serial.print(F("Volume de Buffer ajustado via Blynk: "));
-            Serial.print(ranBufferVolumeML);
-            Serial.println(F(" mL."));
-        }
+        receiveBlynkSetting(SYNC_SET_BUFFER_VOLUME, (float)newVolume);
     } else {
         Serial.print(F("ERRO BLYNK: Volume de Buffer ("));
         Serial.print(newVolume);
         Serial.println(F(") fora do intervalo."));
         // Opcional: Enviar o valor atual de volta para o Blynk para corrigir o slider/numeric input
-        if (Blynk.connected()) {
-            Blynk.virtualWrite(VPIN_RAN_BUFFER_VOLUME, ranBufferVolumeML);
-        }
+        publishVirtualPinInt(VPIN_RAN_BUFFER_VOLUME, ranBufferVolumeML);
     }
 }
 
@@ -428,19 +357,7 @@ void setupTpaManager() {
         volumeToRepositionLiters = volumeToExtractLiters; 
     }
 
-    // Sincroniza o Blynk com os valores persistidos
-    if (Blynk.connected()) {
-        Blynk.virtualWrite(VPIN_TOTAL_VOLUME, aquariumTotalVolume);
-        Blynk.virtualWrite(VPIN_EXTRACTION_PERCENT, tpaExtractionPercent);
-        Blynk.virtualWrite(VPIN_EXTRACTION_VOLUME_L, volumeToExtractLiters);
-        Blynk.virtualWrite(VPIN_LOCAL_SCHEDULE_ACTIVE, tpaLocalScheduleActive);
-        Blynk.virtualWrite(VPIN_SCHEDULE_FREQUENCY, tpaScheduleFrequency);
-        Blynk.virtualWrite(VPIN_SCHEDULE_DAY, tpaScheduleDay);
-        Blynk.virtualWrite(VPIN_SCHEDULE_HOUR, String(tpaScheduleHour));
-        Blynk.virtualWrite(VPIN_SCHEDULE_MINUTE, String(tpaScheduleMinute));
-        Blynk.virtualWrite(VPIN_REPOSITION_VOLUME_L, volumeToRepositionLiters);
-        Blynk.virtualWrite(VPIN_RAN_BUFFER_VOLUME, ranBufferVolumeML);
-    }
+    // O Blynk recebe só o que mudou, na conexão (sincronização por versão em state_sync.ino)
 
 
 }
\ No newline at end of file
@@ -0,0 +1,485 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: TPA_PLAN                    |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: TPA cycle as a stage graph: dependencies, resources, concurrent executor, split-batch exchange
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.05 - Reposition capped per plan: chunk count and total pumped volume
+15/10/2026 - 0.04 - finishTpaPlan() flushes the pump runtime once
+15/10/2026 - 0.03 - Reposition credited with the measured litres (pump estimate only without level sensor)
+15/10/2026 - 0.02 - Plan start blocked while a STOP_TPA alert rule is active
+15/10/2026 - 0.01 - Stage graph executor with overlapping refill/extraction and split-batch exchange
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - (this file) TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- PLANO TPA: GRAFO DE ESTÁGIOS E EXECUTOR ---
+// O ciclo deixa de ser uma cadeia fixa M5.1 -> M5.2 -> M5.3: cada estágio declara do que
+// depende e quais recursos físicos ocupa, e o executor (tarefa de controle "tpa") inicia
+// em paralelo tudo o que estiver pronto. Os módulos M5.1..M5.4 continuam sendo as FSMs
+// que ligam e desligam o hardware; aqui só se decide QUANDO cada um roda e com qual volume.
+
+TpaPlanState tpaPlan;
+uint8_t tpaPlanMode = TPA_PLAN_MODE_DEFAULT;
+float tpaMaxLevelDeltaL = TPA_MAX_LEVEL_DELTA_L_DEFAULT;
+
+// Uma linha por estágio (ordem de TpaStage): dependências, produtor em fluxo, recursos.
+// - O RAN é um recurso único: nem completar nem dosar buffer enquanto a reposição puxa
+//   de lá (diluiria a água preparada). Completar o RAN pode correr junto com a extração.
+// - No modo em lotes a reposição não espera a extração terminar: acompanha o volume já
+//   extraído (streamsFrom), e a extração espera quando o desnível chega ao limite.
+static const TpaStageDef TPA_PLAN_GRAPH[TPA_PLAN_MODE_COUNT][TPA_STAGE_COUNT] = {
+    { // TPA_PLAN_SEQUENTIAL
+        { 0,                                  0, TPA_RES_RAN,                    "Completar RAN" },
+        { TPA_STAGE_BIT(TPA_STAGE_TOPUP),     0, TPA_RES_TANK_OUT,               "Extracao" },
+        { TPA_STAGE_BIT(TPA_STAGE_EXTRACT),   0, TPA_RES_TANK_IN | TPA_RES_RAN,  "Reposicao" },
+        { TPA_STAGE_BIT(TPA_STAGE_REPOSITION),0, TPA_RES_RAN,                    "Enchimento RAN" },
+        { TPA_STAGE_BIT(TPA_STAGE_REFILL),    0, TPA_RES_RAN | TPA_RES_BUFFER,   "Buffer" }
+    },
+    { // TPA_PLAN_SPLIT_BATCH
+        { 0,                                  0, TPA_RES_RAN,                    "Completar RAN" },
+        { 0,                                  0, TPA_RES_TANK_OUT,               "Extracao" },
+        { TPA_STAGE_BIT(TPA_STAGE_TOPUP),     TPA_STAGE_BIT(TPA_STAGE_EXTRACT),
+                                                 TPA_RES_TANK_IN | TPA_RES_RAN,  "Reposicao" },
+        { TPA_STAGE_BIT(TPA_STAGE_REPOSITION),0, TPA_RES_RAN,                    "Enchimento RAN" },
+        { TPA_STAGE_BIT(TPA_STAGE_REFILL),    0, TPA_RES_RAN | TPA_RES_BUFFER,   "Buffer" }
+    }
+};
+
+static const TpaStageDef& tpaStageDef(uint8_t stage) {
+    return TPA_PLAN_GRAPH[tpaPlan.mode][stage];
+}
+
+static bool isTpaStageSettled(uint8_t stage) {
+    return tpaPlan.status[stage] == TPA_STAGE_DONE || tpaPlan.status[stage] == TPA_STAGE_SKIPPED;
+}
+
+// Reposição acompanha a extração? (modo em lotes e os dois estágios no plano)
+static bool isRepositionStreaming() {
+    const TpaStageDef& def = tpaStageDef(TPA_STAGE_REPOSITION);
+    return (def.streamsFrom & TPA_STAGE_BIT(TPA_STAGE_EXTRACT)) &&
+           tpaPlan.status[TPA_STAGE_EXTRACT] != TPA_STAGE_SKIPPED;
+}
+
+// Proporção reposição/extração (o usuário pode repor mais ou menos do que tirou)
+static float repositionRatio() {
+    return tpaPlan.extractTargetL > 0.0f ? tpaPlan.repositionTargetL / tpaPlan.extractTargetL : 1.0f;
+}
+
+
+// 1. --- INÍCIO DO PLANO ---
+// stageMask: TPA_STAGES_FULL_CYCLE ou um subconjunto (jobs de agenda: só buffer, só completar RAN).
+// Estágios fora da máscara contam como concluídos para as dependências.
+bool startTpaPlan(uint8_t stageMask, const char* source) {
+    if (tpaPlan.active || tpaMasterCurrentState != TPA_MASTER_IDLE) {
+        Serial.println(F("AVISO: TPA ja esta em execucao."));
+        return false;
+    }
+    if (serviceModeActive) {
+        Serial.println(F("TPA abortada: Modo de Servico ATIVO."));
+        logSystemEvent("warning", "TPA abortada devido ao Modo de Servico.");
+        return false;
+    }
+    if (isAlertInterlockActive(ALERT_ACTION_STOP_TPA)) {
+        Serial.println(F("TPA bloqueada: alerta de intertravamento ATIVO."));
+        LOG_WARNING(LOG_SRC_TPA, "TPA bloqueada por alerta ativo (%s).", source);
+        return false;
+    }
+
+    memset(&tpaPlan, 0, sizeof(tpaPlan));
+    tpaPlan.mode = tpaPlanMode < TPA_PLAN_MODE_COUNT ? tpaPlanMode : (uint8_t)TPA_PLAN_MODE_DEFAULT;
+    tpaPlan.stageMask = stageMask;
+
+    if (stageMask & TPA_STAGE_BIT(TPA_STAGE_EXTRACT)) {
+        calculateTpaVolume();
+        if (volumeToExtractLiters <= 0.0f) {
+            Serial.println(F("ERRO: Volume de extracao zero. Verifique configuracoes TPA."));
+            logSystemEvent("error", "Tentativa de TPA com volume zero.");
+            return false;
+        }
+        tpaPlan.extractTargetL = volumeToExtractLiters;
+        // 0 = devolve o mesmo volume extraído
+        tpaPlan.repositionTargetL = volumeToRepositionLiters > 0.0f ? volumeToRepositionLiters : volumeToExtractLiters;
+
+        // Lote: dois lotes cabem no desnível máximo (um sendo reposto enquanto o próximo é extraído)
+        float batchL = tpaMaxLevelDeltaL / 2.0f;
+        if (batchL < TPA_MIN_BATCH_L) batchL = TPA_MIN_BATCH_L;
+        tpaPlan.batchL = (tpaPlan.mode == TPA_PLAN_SEQUENTIAL || batchL > tpaPlan.extractTargetL)
+                             ? tpaPlan.extractTargetL : batchL;
+    } else {
+        tpaPlan.repositionTargetL = volumeToRepositionLiters;
+    }
+    // Teto de lotes de reposição: no streaming um lote por lote de extração (mais os parciais
+    // quando o desnível segura a extração); sem lotes, um só
+    float chunkRefL = tpaPlan.batchL > 0.0f ? tpaPlan.batchL * repositionRatio() : tpaPlan.repositionTargetL;
+    tpaPlan.repositionChunkLimit = TPA_PLAN_REPOSITION_EXTRA_CHUNKS +
+        (chunkRefL > 0.0f ? 2 * (uint16_t)ceilf(tpaPlan.repositionTargetL / chunkRefL) : 0);
+
+    // ranLevelFull (boia ou volume alvo medido) é mantido pela tarefa "nivel_ran": decide o TOPUP
+
+    for (uint8_t i = 0; i < TPA_STAGE_COUNT; i++) {
+        tpaPlan.status[i] = (stageMask & TPA_STAGE_BIT(i)) ? TPA_STAGE_PENDING : TPA_STAGE_SKIPPED;
+    }
+    // Sem reposição no plano não há o que completar antes
+    if (tpaPlan.status[TPA_STAGE_REPOSITION] == TPA_STAGE_SKIPPED) {
+        tpaPlan.status[TPA_STAGE_TOPUP] = TPA_STAGE_SKIPPED;
+    }
+    tpaPlan.active = true;
+
+    Serial.print(F("TPA: Plano "));
+    Serial.print(tpaPlan.mode == TPA_PLAN_SPLIT_BATCH ? F("em lotes") : F("sequencial"));
+    Serial.print(F(" disparado por "));
+    Serial.print(source);
+    if (tpaPlan.extractTargetL > 0.0f) {
+        Serial.print(F(": extrair "));
+        Serial.print(tpaPlan.extractTargetL, 2);
+        Serial.print(F(" L em lotes de "));
+        Serial.print(tpaPlan.batchL, 2);
+        Serial.print(F(" L, repor "));
+        Serial.print(tpaPlan.repositionTargetL, 2);
+        Serial.print(F(" L"));
+    }
+    Serial.println();
+
+    tpaCycleStats.started++;
+    tpaCycleStats.startMs = halMillis();
+    runTpaPlan(); // Já inicia o que estiver pronto nesta passagem
+    return true;
+}
+
+
+// 2. --- EXECUÇÃO DOS ESTÁGIOS ---
+
+static bool startTpaStage(uint8_t stage) {
+    switch (stage) {
+        case TPA_STAGE_TOPUP:
+        case TPA_STAGE_REFILL:
+            startRanRefillFlow(); // Já cheio: o M5.3 vai direto para FINISHED
+            return true;
+        case TPA_STAGE_EXTRACT:
+        case TPA_STAGE_REPOSITION:
+            return true;          // Os lotes são disparados em stepTpaStage()
+        case TPA_STAGE_BUFFER:
+            startTpaBufferDosing();
+            return true;
+    }
+    return false;
+}
+
+// Extração em lotes: só começa o próximo se o desnível (extraído - reposto) continuar no limite
+static bool stepExtractionStage() {
+    if (tpaPlan.extractBatchRunning) {
+        if (isTpaExtractionAborted()) return false;
+        if (!isTpaExtractionFinished()) return true;
+        tpaPlan.extractedL += getPumpDeliveredMl(PUMP_EXTRACTION) / 1000.0f;
+        resetTpaExtractionFlow();
+        tpaPlan.extractBatchRunning = false;
+    }
+
+    float remainingL = tpaPlan.extractTargetL - tpaPlan.extractedL;
+    if (remainingL <= TPA_PLAN_EPSILON_L) {
+        tpaPlan.status[TPA_STAGE_EXTRACT] = TPA_STAGE_DONE;
+        recordHistoryEvent(HISTORY_EVT_EXTRACTION_DONE);
+        return true;
+    }
+
+    float batchL = remainingL < tpaPlan.batchL ? remainingL : tpaPlan.batchL;
+    if (isRepositionStreaming()) {
+        float repositionedAsExtractedL = tpaPlan.repositionedL / repositionRatio();
+        if (tpaPlan.extractedL + batchL - repositionedAsExtractedL > tpaMaxLevelDeltaL + TPA_PLAN_EPSILON_L) {
+            return true; // Aguarda a reposição alcançar
+        }
+    }
+
+    if (!executeTpaExtraction(batchL)) return false;
+    tpaPlan.extractBatchRunning = true;
+    return true;
+}
+
+// Reposição: no sequencial um lote só (com pausa de segurança); em lotes, acompanha o extraído
+static bool stepRepositionStage() {
+    if (tpaPlan.repositionChunkRunning) {
+        if (tpaRepositionCurrentState == TPA_REPOSITION_ABORTED) return false;
+        if (!isTpaRepositionFinished()) return true;
+        tpaPlan.repositionedL += getRepositionDeliveredLiters(); // Medido no RAN quando há sensor
+        tpaPlan.repositionPumpedL += getPumpDeliveredMl(PUMP_REPOSITION) / 1000.0f;
+        resetTpaRepositionFlow();
+        tpaPlan.repositionChunkRunning = false;
+    }
+
+    bool streaming = isRepositionStreaming();
+    bool producerDone = !streaming || isTpaStageSettled(TPA_STAGE_EXTRACT);
+    float remainingL = tpaPlan.repositionTargetL - tpaPlan.repositionedL;
+    if (remainingL <= TPA_PLAN_EPSILON_L && producerDone) {
+        tpaPlan.status[TPA_STAGE_REPOSITION] = TPA_STAGE_DONE;
+        recordHistoryEvent(HISTORY_EVT_REPOSITION_DONE);
+        return true;
+    }
+
+    float chunkL = remainingL;
+    if (!producerDone) {
+        // Só o que já saiu do aquário; com a extração rodando espera juntar um lote para não
+        // picar a bomba (parada no limite de desnível, devolve o que houver)
+        float availableL = tpaPlan.extractedL * repositionRatio() - tpaPlan.repositionedL;
+        if (tpaPlan.extractBatchRunning &&
+            availableL < tpaPlan.batchL * repositionRatio() - TPA_PLAN_EPSILON_L) return true;
+        chunkL = availableL < remainingL ? availableL : remainingL;
+    }
+    if (chunkL <= TPA_PLAN_EPSILON_L) return true;
+
+    // Lotes que terminam sem creditar (ex.: RAN medido sem baixar) não podem repetir sem fim
+    float chunkDoseL = chunkL * (isRanLevelMeasured() ? RAN_REPOSITION_DOSE_MARGIN : 1.0f);
+    if (tpaPlan.repositionChunks >= tpaPlan.repositionChunkLimit ||
+        tpaPlan.repositionPumpedL + chunkDoseL >
+            tpaPlan.repositionTargetL * TPA_PLAN_REPOSITION_PUMP_LIMIT + TPA_PLAN_EPSILON_L) {
+        LOG_CRITICAL(LOG_SRC_TPA, "TPA: reposicao acima do limite (%u lotes, %.2f L bombeados, %.2f L creditados de %.2f L).",
+                     tpaPlan.repositionChunks, tpaPlan.repositionPumpedL, tpaPlan.repositionedL,
+                     tpaPlan.repositionTargetL);
+        return false;
+    }
+
+    tpaPlan.repositionChunks++;
+    tpaPlan.repositionChunkL = chunkL;
+    startTpaRepositionFlow(chunkL, !streaming);
+    tpaPlan.repositionChunkRunning = true;
+    return true;
+}
+
+static bool stepRanRefillStage(uint8_t stage) {
+    if (!isRanRefillFinished()) return true;
+    if (ranRefillAlertSent && stage == TPA_STAGE_TOPUP) {
+        // Sem água nova suficiente a reposição pode secar o RAN: segue, mas fica registrado
+        logSystemEvent("warning", "TPA: RAN nao completou antes da reposicao.");
+    }
+    resetRanRefillFlow();
+    tpaPlan.status[stage] = TPA_STAGE_DONE;
+    return true;
+}
+
+// Avança um estágio em execução. Retorna false se o estágio falhou (aborta o plano).
+static bool stepTpaStage(uint8_t stage) {
+    switch (stage) {
+        case TPA_STAGE_TOPUP:
+        case TPA_STAGE_REFILL:
+            return stepRanRefillStage(stage);
+        case TPA_STAGE_EXTRACT:
+            return stepExtractionStage();
+        case TPA_STAGE_REPOSITION:
+            return stepRepositionStage();
+        case TPA_STAGE_BUFFER:
+            if (isTpaBufferDosingFinished()) {
+                resetTpaBufferDosingFlow();
+                tpaPlan.status[TPA_STAGE_BUFFER] = TPA_STAGE_DONE;
+            }
+            return true;
+    }
+    return false;
+}
+
+// Para todo o hardware dos estágios em execução
+static void stopTpaRunningStages() {
+    if (tpaPlan.status[TPA_STAGE_EXTRACT] == TPA_STAGE_RUNNING) resetTpaExtractionFlow();
+    if (tpaPlan.status[TPA_STAGE_REPOSITION] == TPA_STAGE_RUNNING) resetTpaRepositionFlow();
+    if (tpaPlan.status[TPA_STAGE_TOPUP] == TPA_STAGE_RUNNING ||
+        tpaPlan.status[TPA_STAGE_REFILL] == TPA_STAGE_RUNNING) resetRanRefillFlow();
+    if (tpaPlan.status[TPA_STAGE_BUFFER] == TPA_STAGE_RUNNING) resetTpaBufferDosingFlow();
+}
+
+static void finishTpaPlan(bool completed) {
+    unsigned long nowMs = halMillis();
+    for (uint8_t i = 0; i < TPA_STAGE_COUNT; i++) {
+        if (tpaPlan.status[i] == TPA_STAGE_RUNNING) tpaPlan.stageEndMs[i] = nowMs;
+    }
+    bool fullCycle = (tpaPlan.stageMask & TPA_STAGE_BIT(TPA_STAGE_EXTRACT)) != 0;
+    tpaPlan.active = false;
+    flushPumpRuntime(); // Desgaste de todos os lotes numa gravação só
+    tpaMasterCurrentState = TPA_MASTER_COMPLETED;
+    publishVirtualPinInt(VPIN_TPA_MASTER_STATE, tpaMasterCurrentState);
+
+    if (completed) {
+        if (fullCycle) recordHistoryEvent(HISTORY_EVT_TPA_COMPLETED);
+        logSystemEvent("info", "Ciclo TPA completo.");
+    } else {
+        if (fullCycle) recordHistoryEvent(HISTORY_EVT_TPA_ABORTED);
+        logSystemEvent("warning", "Ciclo TPA cancelado.");
+    }
+    finishTpaCycleStats(completed);
+    reportTpaPlan();
+}
+
+// Estado mestre publicado (display/Blynk): o estágio mais "cedo" ainda em execução
+static void updateTpaMasterFromPlan() {
+    TpaMasterState state = tpaMasterCurrentState;
+    if (tpaPlan.status[TPA_STAGE_EXTRACT] == TPA_STAGE_RUNNING) state = TPA_MASTER_EXTRACTION_RUNNING_M51;
+    else if (tpaPlan.status[TPA_STAGE_REPOSITION] == TPA_STAGE_RUNNING) state = TPA_MASTER_REPOSITION_RUNNING_M52;
+    else if (tpaPlan.status[TPA_STAGE_TOPUP] == TPA_STAGE_RUNNING ||
+             tpaPlan.status[TPA_STAGE_REFILL] == TPA_STAGE_RUNNING) state = TPA_MASTER_REFILL_RUNNING_M53;
+    else if (tpaPlan.status[TPA_STAGE_BUFFER] == TPA_STAGE_RUNNING) state = TPA_MASTER_BUFFER_DOSING_M54;
+
+    if (state != tpaMasterCurrentState) {
+        tpaMasterCurrentState = state;
+        publishVirtualPinInt(VPIN_TPA_MASTER_STATE, tpaMasterCurrentState);
+    }
+}
+
+
+// 3. --- EXECUTOR (chamado por runTpaManagerLoop a cada passagem da tarefa de controle) ---
+void runTpaPlan() {
+    if (!tpaPlan.active) return;
+
+    // FSMs de M5.1 e M5.4 rodam aqui; M5.2 e M5.3 têm tarefas próprias (reposicao/enchimento)
+    runTpaExtractionLoop();
+    runTpaBufferDosingLoop();
+
+    // Intertravamento: Modo de Serviço cancela o plano inteiro (as bombas já param no motor de dosagem)
+    if (serviceModeActive) {
+        Serial.println(F("TPA: Plano cancelado pelo Modo de Servico."));
+        stopTpaRunningStages();
+        finishTpaPlan(false);
+        return;
+    }
+
+    // 3.1. Avança os estágios em execução
+    unsigned long nowMs = halMillis();
+    uint8_t busyResources = 0;
+    for (uint8_t i = 0; i < TPA_STAGE_COUNT; i++) {
+        if (tpaPlan.status[i] != TPA_STAGE_RUNNING) continue;
+        if (!stepTpaStage(i)) {
+            Serial.print(F("TPA: Estagio falhou: "));
+            Serial.println(tpaStageDef(i).name);
+            stopTpaRunningStages();
+            finishTpaPlan(false);
+            return;
+        }
+        if (tpaPlan.status[i] == TPA_STAGE_RUNNING) busyResources |= tpaStageDef(i).resources;
+        else tpaPlan.stageEndMs[i] = nowMs;
+    }
+
+    // 3.2. Inicia os estágios prontos (dependências concluídas e recursos livres)
+    bool allSettled = true;
+    for (uint8_t i = 0; i < TPA_STAGE_COUNT; i++) {
+        if (tpaPlan.status[i] == TPA_STAGE_PENDING) {
+            const TpaStageDef& def = tpaStageDef(i);
+            bool depsDone = true;
+            for (uint8_t d = 0; d < TPA_STAGE_COUNT; d++) {
+                if ((def.dependsOn & TPA_STAGE_BIT(d)) && !isTpaStageSettled(d)) depsDone = false;
+            }
+            if (depsDone && !(def.resources & busyResources) && startTpaStage(i)) {
+                tpaPlan.status[i] = TPA_STAGE_RUNNING;
+                tpaPlan.stageStartMs[i] = nowMs;
+                Serial.print(F("TPA: Estagio iniciado: "));
+                Serial.println(def.name);
+                if (!stepTpaStage(i)) { // Primeiro lote já nesta passagem
+                    stopTpaRunningStages();
+                    finishTpaPlan(false);
+                    return;
+                }
+                if (tpaPlan.status[i] == TPA_STAGE_RUNNING) busyResources |= def.resources;
+                else tpaPlan.stageEndMs[i] = nowMs; // Nada a fazer (RAN já cheio, buffer zero)
+            }
+        }
+        if (!isTpaStageSettled(i)) allSettled = false;
+    }
+
+    // 3.3. Desnível do aquário (inclui os lotes em andamento)
+    float extractedNowL = tpaPlan.extractedL;
+    if (tpaPlan.extractBatchRunning) extractedNowL += getPumpDeliveredMl(PUMP_EXTRACTION) / 1000.0f;
+    float repositionedNowL = tpaPlan.repositionedL;
+    if (tpaPlan.repositionChunkRunning) repositionedNowL += getRepositionDeliveredLiters();
+    float deficitL = extractedNowL - repositionedNowL;
+    if (deficitL > tpaPlan.maxLevelDeficitL) tpaPlan.maxLevelDeficitL = deficitL;
+
+    if (allSettled) {
+        finishTpaPlan(true);
+        return;
+    }
+    updateTpaMasterFromPlan();
+}
+
+bool isTpaPlanActive() {
+    return tpaPlan.active;
+}
+
+// Cancela o plano em andamento (comando/UI); o hardware é desligado na hora
+void abortTpaPlan(const char* reason) {
+    if (!tpaPlan.active) return;
+    Serial.print(F("TPA: Plano cancelado: "));
+    Serial.println(reason);
+    stopTpaRunningStages();
+    finishTpaPlan(false);
+}
+
+
+// 4. --- RELATÓRIO ---
+// Duração de cada estágio (sobreposição visível pelos inícios) e o maior desnível do aquário
+void reportTpaPlan() {
+    Serial.println(F("--- Plano TPA ---"));
+    for (uint8_t i = 0; i < TPA_STAGE_COUNT; i++) {
+        if (tpaPlan.status[i] == TPA_STAGE_SKIPPED) continue;
+        Serial.print(tpaStageDef(i).name);
+        Serial.print(F(": inicio +"));
+        Serial.print((tpaPlan.stageStartMs[i] - tpaCycleStats.startMs) / 1000);
+        Serial.print(F(" s, duracao "));
+        Serial.print((tpaPlan.stageEndMs[i] - tpaPlan.stageStartMs[i]) / 1000);
+        Serial.println(F(" s"));
+    }
+    if (tpaPlan.extractTargetL > 0.0f) {
+        Serial.print(F("Extraido "));
+        Serial.print(tpaPlan.extractedL, 2);
+        Serial.print(F(" L, reposto "));
+        Serial.print(tpaPlan.repositionedL, 2);
+        Serial.print(F(" L, desnivel maximo "));
+        Serial.print(tpaPlan.maxLevelDeficitL, 2);
+        Serial.println(F(" L"));
+    }
+}
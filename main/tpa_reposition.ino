@@ -9,6 +9,12 @@
  Author: Alberto Tolentino (and Gemini AI)
  
  == Version History ==
+15/10/2026 - 0.07 - Batch whose dose limit ends without the RAN dropping aborts (no blind repeat)
+15/10/2026 - 0.06 - getRepositionDeliveredLiters(): measured RAN drawdown for level-terminated batches
+15/10/2026 - 0.05 - Reposition ends on volume drawn from the RAN when the level is measured; dry-run guard
+15/10/2026 - 0.04 - Reposition takes the batch volume and optional safety pause from the TPA plan
+15/10/2026 - 0.03 - Reposition doses its own volume on the reposition pump (was the extraction pump's run time)
+15/10/2026 - 0.02 - Pump GPIO and timing via HAL (host simulation hooks)
  03/11/2025 - 0.01 - Primeira implementação do Fluxo Pós-Extração (Módulo 5.2)
                      Refatorado para usar variaveis e funcoes globais existentes.
 == Functional specification ==
@@ -29,6 +35,21 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - (this file) Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
@@ -36,18 +57,24 @@ tpa_reposition    - (this file) Control return of water volume
 #include "global.h"
 #include "utils.h"
 
+static float repositionBatchLiters = 0.0f; // Volume do lote em andamento (L)
+static float repositionStartRanLiters = 0.0f; // Volume medido no RAN ao ligar a bomba
+static bool repositionByLevel = false;     // Lote terminado pelo nível do RAN (a dose é só o limite)
+
 // --- 2. FUNÇÕES DE CONTROLE (Módulo 5.2) ---
 
 /**
  * Inicia o fluxo de Reposição (Módulo 5.2). 
- * Esta função é chamada pelo TPA_MANAGER após a conclusão da extração.
+ * Esta função é chamada pelo plano TPA (tpa_plan.ino): uma vez com o volume todo no modo
+ * sequencial, ou lote a lote acompanhando a extração no modo em lotes.
  * * Dependências: 
  * - logSystemEvent() (main.ino)
- * - tpaPumpDurationMs (global.h, setado em actuators_manager.ino)
+ * - volumeLiters: volume deste lote (o plano parte de volumeToRepositionLiters)
+ * - safetyPause: aguarda SAFETY_PAUSE_MS antes de ligar a bomba (modo sequencial)
  */
-void startTpaRepositionFlow() {
-    // A duração da bomba de extração (tpaPumpDurationMs) é o tempo que a bomba
-    // de reposição deve funcionar para devolver o volume exato.
+void startTpaRepositionFlow(float volumeLiters, bool safetyPause) {
+    // A bomba de reposição tem vazão própria: a dose é por volume (motor de dosagem),
+    // não pelo tempo que a bomba de extração ficou ligada.
 
     if (tpaRepositionCurrentState != TPA_REPOSITION_IDLE && tpaRepositionCurrentState != TPA_REPOSITION_FINISHED) {
         Serial.println(F("ERRO: O fluxo de reposicao ja esta em execucao."));
@@ -58,21 +85,21 @@ void startTpaRepositionFlow() {
     Serial.println(F("M5.2: Iniciando Fluxo de Execucao Pos-Extracao (RAN -> Aquario)..."));
     logSystemEvent("info", "Iniciando Reposicao TPA.");
 
-    // --- CÁLCULO DA DURAÇÃO COM O VOLUME AJUSTADO PELO USUÁRIO ---
-    repositionIntervalMs = calculatePumpDuration(volumeToRepositionLiters); 
+    repositionBatchLiters = volumeLiters;
+    repositionByLevel = false; // Decidido ao ligar a bomba
     
-    Serial.print(F("Volume de Reposicao (Ajustado): ")); 
-    Serial.print(volumeToRepositionLiters, 2); 
+    Serial.print(F("Volume de Reposicao (Lote): ")); 
+    Serial.print(repositionBatchLiters, 2); 
     Serial.print(F(" L. Duracao: "));
-    Serial.print(repositionIntervalMs / 1000); Serial.println(F("s."));
+    Serial.print(calculatePumpDuration(PUMP_REPOSITION, repositionBatchLiters) / 1000); Serial.println(F("s."));
 
-    // --- 1.1 Aguardar 5s ---
-    repositionPreviousMillis = millis();
-    repositionIntervalMs = SAFETY_PAUSE_MS; 
+    // --- 1.1 Aguardar 5s (só no modo sequencial; em lotes a bomba já está escorvada) ---
+    repositionPreviousMillis = halMillis();
+    repositionIntervalMs = safetyPause ? SAFETY_PAUSE_MS : 0; 
     tpaRepositionCurrentState = TPA_REPOSITION_WAIT_SAFETY_PAUSE;
     
     Serial.print(F("1.1 Aguardando pausa de seguranca: ")); 
-    Serial.print(SAFETY_PAUSE_MS / 1000); Serial.println(F("s."));
+    Serial.print(repositionIntervalMs / 1000); Serial.println(F("s."));
 }
 
 
@@ -80,11 +107,11 @@ void startTpaRepositionFlow() {
  * Função de loop principal para o Módulo 5.2. 
  * Deve ser chamada dentro da funcao loop() do main.ino.
  * * Dependencias: 
- * - digitalRead()/digitalWrite() para TPA_REPOSITION_PUMP_PIN
- * - RELAY_ON/RELAY_OFF (global.h ou config.h)
+ * - startPumpDose()/isPumpDoseActive() (dosing_engine.ino) para PUMP_REPOSITION
+ * - ranLevel (ran_level.ino): com o nível medido, o lote termina pelo volume que saiu do RAN
  */
 void runTpaRepositionLoop() {
-    unsigned long currentMillis = millis();
+    unsigned long currentMillis = halMillis();
 
     switch (tpaRepositionCurrentState) {
         case TPA_REPOSITION_IDLE:
@@ -94,16 +121,25 @@ void runTpaRepositionLoop() {
         case TPA_REPOSITION_WAIT_SAFETY_PAUSE:
             // --- 1.1 Aguardar 5s ---
             if (currentMillis - repositionPreviousMillis >= repositionIntervalMs) {
-                Serial.println(F("1.1 Pausa de seguranca (5s) concluida."));
+                Serial.println(F("1.1 Pausa de seguranca concluida."));
                 
                 // Transição para a próxima etapa: Reposição Principal
                 repositionPreviousMillis = currentMillis; // Reinicia o contador
-                repositionIntervalMs = tpaPumpDurationMs; // Tempo de extração (em ms)
                 
-                // LIGA a Bomba de Reposição (RAN -> Aquário)
-                digitalWrite(TPA_REPOSITION_PUMP_PIN, RELAY_ON); // **ASSUME PINO GLOBAL**
-                Serial.print(F("1.2 Iniciando Reposicao Principal por "));
-                Serial.print(tpaPumpDurationMs / 1000); Serial.println(F(" segundos..."));
+                // LIGA a Bomba de Reposição (RAN -> Aquário) com o volume a devolver.
+                // Com o nível medido, o lote termina pelo que saiu do RAN e a dose (com margem)
+                // só protege contra sensor travado; sem sensor, vale a dose calibrada.
+                repositionByLevel = isRanLevelMeasured();
+                repositionStartRanLiters = ranLevel.liters;
+                if (!startPumpDose(PUMP_REPOSITION, repositionBatchLiters * 1000.0f *
+                                                    (repositionByLevel ? RAN_REPOSITION_DOSE_MARGIN : 1.0f))) {
+                    Serial.println(F("ERRO: Bomba de Reposicao nao pode iniciar."));
+                    logSystemEvent("error", "Bomba de Reposicao nao pode iniciar.");
+                    tpaRepositionCurrentState = TPA_REPOSITION_ABORTED; // O plano TPA cancela o ciclo
+                    break;
+                }
+                Serial.print(F("1.2 Iniciando Reposicao Principal: "));
+                Serial.print(repositionBatchLiters, 2); Serial.println(F(" L..."));
                 logSystemEvent("info", "Bomba de Reposicao ligada.");
 
                 tpaRepositionCurrentState = TPA_REPOSITION_TRANSFER_RAN_TO_AQUARIO;
@@ -112,24 +148,60 @@ void runTpaRepositionLoop() {
 
         case TPA_REPOSITION_TRANSFER_RAN_TO_AQUARIO:
             // --- 1.2 Reposição Principal (RAN -> Aquário) ---
-            if (currentMillis - repositionPreviousMillis >= repositionIntervalMs) {
-                // DESLIGA a Bomba de Reposição
-                digitalWrite(TPA_REPOSITION_PUMP_PIN, RELAY_OFF); // **ASSUME PINO GLOBAL**
+            if (repositionByLevel && isRanLevelMeasured()) {
+                float drawnL = repositionStartRanLiters - ranLevel.liters;
+                if (ranLevel.liters <= RAN_MIN_RESERVE_L) {
+                    // RAN vazio: para antes que a bomba rode a seco; o plano cancela o ciclo
+                    stopPumpDose(PUMP_REPOSITION);
+                    LOG_CRITICAL(LOG_SRC_TPA, "Reposicao interrompida: RAN vazio (%.2f L) apos %.2f L.",
+                                 ranLevel.liters, drawnL);
+                    tpaRepositionCurrentState = TPA_REPOSITION_ABORTED;
+                    break;
+                }
+                if (drawnL >= repositionBatchLiters && isPumpDoseActive(PUMP_REPOSITION)) {
+                    stopPumpDose(PUMP_REPOSITION); // Volume medido atingido
+                }
+                if (!isPumpDoseActive(PUMP_REPOSITION) && drawnL < repositionBatchLiters * RAN_REPOSITION_MIN_RATIO) {
+                    // A dose-limite acabou sem o RAN baixar: bomba parada, mangueira solta/entupida ou
+                    // sensor de nível travado. Repetir o lote só jogaria mais água (ou nenhuma) às cegas:
+                    // o plano cancela o ciclo.
+                    LOG_CRITICAL(LOG_SRC_TPA, "Reposicao abortada: %.2f L medidos de %.2f L pedidos (verificar bomba/mangueira/sensor de nivel).",
+                                 drawnL, repositionBatchLiters);
+                    tpaRepositionCurrentState = TPA_REPOSITION_ABORTED;
+                    break;
+                }
+            }
+            // O motor de dosagem desliga a bomba quando o volume é entregue (ou foi parado acima)
+            if (!isPumpDoseActive(PUMP_REPOSITION)) {
                 Serial.println(F("1.2 Reposicao Principal concluida."));
                 logSystemEvent("info", "Reposicao TPA concluida.");
                 
                 // Transição para o estado final
                 tpaRepositionCurrentState = TPA_REPOSITION_FINISHED;
-                Serial.println(F("M5.2 CONCLUÍDO. Aguardando proximo módulo do TPA Manager."));
+                Serial.println(F("M5.2 CONCLUÍDO. Aguardando proximo estágio do plano TPA."));
             }
             break;
 
         case TPA_REPOSITION_FINISHED:
-            // A TPA_MANAGER deve verificar este estado e iniciar o proximo módulo (Enchimento do RAN).
+        case TPA_REPOSITION_ABORTED:
+            // O plano TPA verifica este estado e contabiliza o lote (ou cancela o ciclo).
             break;
     }
 }
 
+// --- VOLUME DEVOLVIDO NO LOTE ATUAL (CHAMADA PELO PLANO TPA) ---
+// Com o nível medido, vale o que saiu do RAN (é o que terminou o lote); sem sensor, a estimativa
+// do motor de dosagem.
+float getRepositionDeliveredLiters() {
+    if (tpaRepositionCurrentState == TPA_REPOSITION_IDLE ||
+        tpaRepositionCurrentState == TPA_REPOSITION_WAIT_SAFETY_PAUSE) return 0.0f;
+    if (repositionByLevel && isRanLevelMeasured()) {
+        float drawnL = repositionStartRanLiters - ranLevel.liters;
+        return drawnL > 0.0f ? drawnL : 0.0f;
+    }
+    return getPumpDeliveredMl(PUMP_REPOSITION) / 1000.0f;
+}
+
 // --- FUNÇÃO PARA VERIFICAR O FIM DO FLUXO (CHAMADA PELO TPA_MANAGER) ---
 bool isTpaRepositionFinished() {
     return tpaRepositionCurrentState == TPA_REPOSITION_FINISHED;
@@ -137,6 +209,7 @@ bool isTpaRepositionFinished() {
 
 // --- FUNÇÃO PARA RESETAR O FLUXO (CHAMADA PELO TPA_MANAGER) ---
 void resetTpaRepositionFlow() {
+    stopPumpDose(PUMP_REPOSITION); // Garantir que a bomba esteja desligada
     if (tpaRepositionCurrentState != TPA_REPOSITION_IDLE) {
         tpaRepositionCurrentState = TPA_REPOSITION_IDLE;
         Serial.println(F("M5.2 Reposicao resetado para IDLE."));
@@ -0,0 +1,300 @@
+/*
+ +---------------------------------------+
+ |      Aquarium Command & Control       |
+ |                  ACC                  |  
+ |Procedure: TPA_SCHEDULER               |      
+ +---------------------------------------+
+ Project Purpose: Control an Aquarium parameters like Temperarture
+                  pH, other water quality parameters from data received
+                  of probes. It also will count with schedule to water
+                  change useing actuators (like peristaltc pumps). All
+                  data will be plotted on Web using an IoT cloud (like Blynk)
+                  core will be an ESP32 board.
+
+
+ Procedure Purpose: Event-driven local scheduler (TPA, buffer dosing, RAN top-up) with precomputed next-fire times
+
+ Author: Alberto Tolentino (and Gemini AI)
+ 
+== Functional specification ==
+
+
+
+== Version History ==
+15/10/2026 - 0.02 - Uses the clock service instead of its own RTC anchor
+15/10/2026 - 0.01 - First installment: cron-like jobs, RTC-epoch last run, missed-run catch-up
+
+== Project file structure ==
+main.ino          - Main program with setup parameters and loop functions
+config.h          - Pin definitions, passwords, IDs (Auth, SSID, Pass)
+global.h          - Global definitions
+utils.h           - Functions prototypes
+rtc_time.ino      - setupNTP(), getCurrentTime(), BLYNK_CONNECTED(), BLYNK_WRITE(RTC_RESET)
+sensors.ino       - readTemperature(), readPH(), alert code
+ph_sensor         - Deal with readings from pH probe
+config_manager    - Used to save config/data on JSON on SPIFF(LittleFS) partition on ESP32
+display_manager   - Deal with all output on OLED Display
+hardware_manager  - Deal with all physical buttons in the project
+actuators_manager - Deal with all pump e actuator hardware in the system
+tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
+tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - (this file) Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
+
+*/
+
+#include "config.h"
+#include "global.h"
+#include "utils.h"
+
+// --- AGENDADOR DE TAREFAS PERIÓDICAS (TPA, BUFFER, COMPLETAR RAN) ---
+// Em vez de perguntar a hora ao RTC a cada passagem do loop, o próximo disparo de cada job é
+// calculado UMA vez (boot, mudança de configuração, sincronização do relógio, execução) como
+// epoch do RTC. A tarefa periódica só compara um inteiro com clockNowEpoch() (serviço de
+// relógio em rtc_time.ino), sem nenhuma transação I2C.
+// O job TPA continua usando as variáveis tpaLocalScheduleActive/tpaSchedule* (Blynk, OLED).
+ScheduleJobConfig scheduleJobs[SCHED_JOB_COUNT];
+ScheduleJobState scheduleJobStates[SCHED_JOB_COUNT];
+volatile bool scheduleRecomputePending = true; // Sinalizado por outras tarefas (Blynk, botões, NTP)
+
+bool scheduleBootCheckDone = false;     // Verificação de execuções perdidas (uma vez por boot)
+uint32_t scheduleEarliestFire = 0;      // Menor nextFireEpoch entre os jobs ativos (0 = nenhum)
+
+const char* const SCHEDULE_JOB_NAMES[SCHED_JOB_COUNT] = { "TPA", "Buffer", "Completar RAN" };
+
+
+// --- DEFAULTS (usados por setConfigDefaults) ---
+void setScheduleJobDefaults(ScheduleJobConfig* jobs) {
+    for (uint8_t i = 0; i < SCHED_JOB_COUNT; i++) {
+        memset(&jobs[i], 0, sizeof(ScheduleJobConfig));
+        jobs[i].enabled = false;
+        jobs[i].frequency = SCHED_FREQ_DAILY;
+        jobs[i].day = 1;
+        jobs[i].missedPolicy = SCHED_MISSED_RUN_ONCE;
+        jobs[i].lastRunEpoch = 0;
+    }
+}
+
+// Qualquer alteração de agenda ou do relógio: recalcula na próxima passagem da tarefa
+void requestScheduleRecompute() {
+    scheduleRecomputePending = true;
+}
+
+
+// --- RELÓGIO DO AGENDADOR ---
+// Sem hora confiável (clockIsValid() falso) nada é agendado: a hora seria a da compilação.
+uint32_t scheduleNowEpoch() {
+    return clockNowEpoch();
+}
+
+
+// --- CÁLCULO DO PRÓXIMO DISPARO ---
+static uint8_t daysInMonth(uint16_t year, uint8_t month) {
+    static const uint8_t DAYS[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) return 29;
+    return DAYS[month - 1];
+}
+
+// Menor epoch estritamente maior que 'after' que satisfaz a agenda do job
+uint32_t computeNextFireEpoch(const ScheduleJobConfig& job, uint32_t after) {
+    DateTime ref(after);
+    DateTime candidate(ref.year(), ref.month(), ref.day(), job.hour, job.minute, 0);
+
+    switch (job.frequency) {
+        case SCHED_FREQ_DAILY:
+            if (candidate.unixtime() <= after) candidate = DateTime(candidate.unixtime() + 86400UL);
+            break;
+
+        case SCHED_FREQ_WEEKLY:
+        case SCHED_FREQ_BIWEEKLY: {
+            // tpaScheduleDay: 1 = Dom ... 7 = Sab; dayOfTheWeek(): 0 = Dom ... 6 = Sab
+            uint8_t targetDow = (uint8_t)((job.day >= 1 && job.day <= 7 ? job.day : 1) - 1);
+            uint8_t daysAhead = (uint8_t)((targetDow + 7 - candidate.dayOfTheWeek()) % 7);
+            candidate = DateTime(candidate.unixtime() + daysAhead * 86400UL);
+            if (candidate.unixtime() <= after) candidate = DateTime(candidate.unixtime() + 7UL * 86400UL);
+            // Quinzenal: ancorado na última execução (no mínimo 13 dias depois dela)
+            if (job.frequency == SCHED_FREQ_BIWEEKLY && job.lastRunEpoch != 0) {
+                while (candidate.unixtime() < job.lastRunEpoch + 13UL * 86400UL) {
+                    candidate = DateTime(candidate.unixtime() + 7UL * 86400UL);
+                }
+            }
+            break;
+        }
+
+        case SCHED_FREQ_MONTHLY: {
+            // Dia 29-31 em meses mais curtos: executa no último dia do mês
+            uint16_t year = ref.year();
+            uint8_t month = ref.month();
+            for (uint8_t attempt = 0; attempt < 2; attempt++) {
+                uint8_t day = job.day < 1 ? 1 : job.day;
+                if (day > daysInMonth(year, month)) day = daysInMonth(year, month);
+                candidate = DateTime(year, month, day, job.hour, job.minute, 0);
+                if (candidate.unixtime() > after) break;
+                if (++month > 12) { month = 1; year++; }
+            }
+            break;
+        }
+    }
+    return candidate.unixtime();
+}
+
+
+// --- RECÁLCULO ---
+// O job TPA espelha as variáveis editadas pelo Blynk/botões
+static void syncTpaScheduleJob() {
+    ScheduleJobConfig& job = scheduleJobs[SCHED_JOB_TPA];
+    job.enabled = tpaLocalScheduleActive;
+    job.frequency = (uint8_t)tpaScheduleFrequency;
+    job.day = (uint8_t)tpaScheduleDay;
+    job.hour = (uint8_t)tpaScheduleHour;
+    job.minute = (uint8_t)tpaScheduleMinute;
+}
+
+static void refreshEarliestFire() {
+    scheduleEarliestFire = 0;
+    for (uint8_t i = 0; i < SCHED_JOB_COUNT; i++) {
+        const ScheduleJobState& st = scheduleJobStates[i];
+        if (!scheduleJobs[i].enabled) continue;
+        uint32_t due = st.catchUpPending ? 1 : st.nextFireEpoch;
+        if (scheduleEarliestFire == 0 || due < scheduleEarliestFire) scheduleEarliestFire = due;
+    }
+}
+
+void recomputeSchedule() {
+    uint32_t now = scheduleNowEpoch();
+    syncTpaScheduleJob();
+
+    for (uint8_t i = 0; i < SCHED_JOB_COUNT; i++) {
+        ScheduleJobConfig& job = scheduleJobs[i];
+        ScheduleJobState& st = scheduleJobStates[i];
+        st.catchUpPending = false;
+        st.deferLogged = false;
+        if (!job.enabled) {
+            st.nextFireEpoch = 0;
+            continue;
+        }
+
+        // Execução perdida (equipamento desligado/sem relógio na hora agendada): só no boot.
+        // Em mudanças de configuração um horário que "já passou hoje" não é considerado perdido.
+        if (!scheduleBootCheckDone && job.lastRunEpoch != 0) {
+            uint32_t missedFire = computeNextFireEpoch(job, job.lastRunEpoch);
+            if (missedFire <= now) {
+                if (job.missedPolicy == SCHED_MISSED_RUN_ONCE && now - missedFire <= SCHEDULE_CATCHUP_WINDOW_S) {
+                    st.catchUpPending = true; // Uma única execução, mesmo que vários disparos tenham sido perdidos
+                    Serial.print(F("AGENDA: Execucao perdida sera recuperada: "));
+                } else {
+                    Serial.print(F("AGENDA: Execucao perdida ignorada: "));
+                }
+                Serial.println(SCHEDULE_JOB_NAMES[i]);
+                logSystemEvent("warning", "Execucao agendada perdida durante desligamento.");
+            }
+        }
+        st.nextFireEpoch = computeNextFireEpoch(job, now);
+    }
+    scheduleBootCheckDone = true;
+    refreshEarliestFire();
+    reportSchedule();
+}
+
+void reportSchedule() {
+    char buf[20];
+    for (uint8_t i = 0; i < SCHED_JOB_COUNT; i++) {
+        if (!scheduleJobs[i].enabled) continue;
+        DateTime next(scheduleJobStates[i].nextFireEpoch);
+        snprintf(buf, sizeof(buf), "%02d/%02d %02d:%02d", next.day(), next.month(), next.hour(), next.minute());
+        Serial.print(F("AGENDA: "));
+        Serial.print(SCHEDULE_JOB_NAMES[i]);
+        Serial.print(F(" -> proximo disparo "));
+        Serial.print(buf);
+        if (scheduleJobStates[i].catchUpPending) Serial.print(F(" (recuperacao pendente)"));
+        Serial.println();
+    }
+}
+
+
+// --- REGISTRO DE EXECUÇÃO ---
+// Chamado também pelas execuções disparadas pelo Blynk (manual ou Timer Widget): a TPA
+// quinzenal e a verificação de perdidas passam a contar a partir da execução real.
+void noteScheduleJobRun(uint8_t jobIndex) {
+    if (jobIndex >= SCHED_JOB_COUNT || !clockIsValid()) return;
+    scheduleJobs[jobIndex].lastRunEpoch = scheduleNowEpoch();
+    scheduleJobStates[jobIndex].catchUpPending = false;
+    markConfigDirty();
+    requestScheduleRecompute();
+}
+
+static bool startScheduleJob(uint8_t jobIndex) {
+    switch (jobIndex) {
+        case SCHED_JOB_TPA:          return startTpaCycle("agendamento local");
+        case SCHED_JOB_BUFFER_DOSE:  return startBufferDosingOnly("agendamento local");
+        case SCHED_JOB_RAN_TOPUP:    return startRanTopUpOnly("agendamento local");
+    }
+    return false;
+}
+
+static void fireScheduleJob(uint8_t jobIndex, uint32_t now) {
+    ScheduleJobConfig& job = scheduleJobs[jobIndex];
+    ScheduleJobState& st = scheduleJobStates[jobIndex];
+
+    // Outro fluxo usando as bombas: tenta de novo na próxima passagem (sem perder o disparo)
+    if (tpaMasterCurrentState != TPA_MASTER_IDLE) {
+        if (!st.deferLogged) {
+            Serial.print(F("AGENDA: Adiado (fluxo TPA ativo): "));
+            Serial.println(SCHEDULE_JOB_NAMES[jobIndex]);
+            st.deferLogged = true;
+        }
+        return;
+    }
+
+    // Online, a TPA é agendada pelo Timer Widget do Blynk (agendamento local = fallback)
+    if (jobIndex == SCHED_JOB_TPA && Blynk.connected()) {
+        Serial.println(F("AGENDA: TPA local ignorada (Blynk conectado, Timer Widget assume)."));
+    } else {
+        logSystemEvent("warning", "Agendamento local disparado. (OFFLINE)");
+        if (startScheduleJob(jobIndex)) {
+            if (jobIndex != SCHED_JOB_TPA) noteScheduleJobRun(jobIndex); // TPA: registrado por startTpaCycle()
+        } else {
+            logSystemEvent("error", "Execucao agendada nao pode iniciar.");
+        }
+    }
+
+    st.catchUpPending = false;
+    st.deferLogged = false;
+    st.nextFireEpoch = computeNextFireEpoch(job, now);
+    refreshEarliestFire();
+}
+
+
+// --- TAREFA PERIÓDICA (GRUPO DE CONTROLE) ---
+void runTpaScheduler() {
+    if (!clockIsValid()) return; // Sem relógio válido: tenta na próxima passagem
+    if (scheduleRecomputePending) {
+        scheduleRecomputePending = false;
+        recomputeSchedule();
+    }
+
+    // Caminho comum: nada vence antes do próximo disparo
+    uint32_t now = scheduleNowEpoch();
+    if (scheduleEarliestFire == 0 || now < scheduleEarliestFire) return;
+
+    for (uint8_t i = 0; i < SCHED_JOB_COUNT; i++) {
+        if (!scheduleJobs[i].enabled) continue;
+        if (scheduleJobStates[i].catchUpPending || now >= scheduleJobStates[i].nextFireEpoch) {
+            fireScheduleJob(i, now);
+            if (tpaMasterCurrentState != TPA_MASTER_IDLE) break; // Um fluxo por vez
+        }
+    }
+}
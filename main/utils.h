@@ -21,6 +21,18 @@
 
 
 == Version History ==
+15/10/2026 - 0.14 - Prototypes for the task iterations and the OLED page renderers (native build has no auto-prototypes)
+15/10/2026 - 0.13 - flushPumpRuntime()
+15/10/2026 - 0.12 - Temperature probe map prototypes
+15/10/2026 - 0.11 - State sync prototypes
+15/10/2026 - 0.10 - Button interrupt and power manager prototypes; runTaskScheduler() returns next deadline
+15/10/2026 - 0.09 - History store prototypes
+15/10/2026 - 0.08 - Telemetry publisher prototypes
+15/10/2026 - 0.07 - Incremental OLED renderer prototypes
+15/10/2026 - 0.06 - pH acquisition engine and calibration prototypes
+15/10/2026 - 0.05 - Added FreeRTOS task split / SPSC messaging prototypes
+15/10/2026 - 0.04 - Added DS18B20 acquisition pipeline prototypes
+15/10/2026 - 0.03 - Added non-blocking extraction FSM and cooperative scheduler prototypes
 02/11/2025 - 0.02 - Added new functions prototypes fro actuators and display management
 01/11/2025 - 0.02 - Added Display management functions prototypes
 01/11/2025 - 0.01 - First installment based on code created by Gemini AI (Google)
@@ -39,37 +51,77 @@ hardware_manager  - Deal with all physical buttons in the project
 actuators_manager - Deal with all pump e actuator hardware in the system
 tpa_manager       - Coordinate the partial water change (in portuguese TPA ou troca parcial de água)
 tpa_reposition    - Control return of water volume
+task_scheduler    - Cooperative task scheduler, loop() latency statistics and budget
+spsc_queue.h      - Lock-free SPSC ring buffer used between FreeRTOS tasks
+rtos_tasks        - FreeRTOS tasks (control/network/UI) and SPSC messaging
+telemetry         - Central Blynk telemetry publisher (deadband, coalescing, offline backfill)
+history_store     - Append-only sensor/TPA history on LittleFS (segment ring + summaries)
+hal.h             - Time/GPIO abstraction (inline on ESP32, virtual clock in host simulation)
+tpa_scheduler     - Local schedule jobs (precomputed next fire, missed-run policy)
+dosing_engine     - Per-pump calibrated, volume-terminated dosing (soft-start, wear drift)
+tpa_plan          - TPA stage graph (dependencies, resources) and concurrent/split-batch executor
+event_log         - Structured event log (RTC crash ring, lock-free, async drain to Serial/Blynk/flash)
+profiler          - Runtime profiler (cycle-counter probes, heap/stack watermarks, serial console, diagnostics page)
+alert_rules       - Table-driven alert rules (hysteresis, dwell, rate of change, TPA interlock)
+ran_level         - Continuous RAN level (analog/ultrasonic input, geometry table, fill rate, stuck-valve detection)
+power_manager     - Tickless idle (deadline waits, automatic light sleep, idle/wake-latency stats)
+state_sync        - Versioned Blynk state sync (per-setting version/source, delta exchange, single-batch apply)
 
 */
 
 #pragma once // Garante que este arquivo seja incluído apenas uma vez por unidade de compilação
 
-// --- Protótipo da Função de Log (Definida em main.ino) ---
-void sendSensorData();            // Rotina do Ticker
-void logSystemEvent(const char* category, const char* message);
+// --- Tarefas periódicas (Definidas em main.ino) ---
+void sendSensorData();            // Tarefa de controle: leituras periódicas dos sensores
+void runNetworkHousekeeping();    // Tarefa de rede: hora no Blynk e alerta de bateria do RTC
 
 // --- Protótipos de Funções RTC/Tempo (Definidas em rtc_time.ino) ---
 DateTime getDateTimeNow();
-String getCurrentTimeString();
+uint32_t clockNowEpoch();                          // Epoch atual sem I2C (serviço de relógio)
+bool clockIsValid();
+void formatClockTime(char* buf, size_t len);       // "HH:MM:SS"
+void formatClockDateTime(char* buf, size_t len);   // "DD/MM/AAAA HH:MM:SS"
+void setupClockService();
 void setupRTC();
 void checkRtcStatus();
-void syncRtcFromNtp(time_t ntpTime);
+void syncRtcFromNtp(time_t ntpTime);               // Só registra: aplicado por runClockService()
+void runClockService();                            // Tarefa de UI (dona do I2C)
 
 // --- Protótipos de Funções Sensores (Definidas em sensors.ino) ---
-float readTemperature();
-void checkTempAlert(float tempC);
+float readTemperature();                    // Última amostra da sonda do aquário (não bloqueante)
+void setupTemperatureProbes();              // Descobre as sondas e associa os papéis pelo mapa ROM do config
+void reportTemperatureProbes();             // Console: papel -> ROM, presente/ausente
+void clearTemperatureProbeMap();            // Console "temp reset": reassocia no próximo boot
+void runTemperatureAcquisition();           // Tarefa do escalonador: conversão/coleta em pipeline
+void publishTemperatureSample(int role, float tempC, unsigned long timestampMs);
+float getProbeTemperature(int role);        // Última amostra de uma sonda (-999.0 se inválida)
 
 // --- Protótipos de Funções pH (Definidas em ph_sensor.ino) ---
-float readPH();
-void checkPhAlert(float currentPh);
-void executePhCalibration();  // Faz a calibração do sensor de pH
-void resetSensorData();  //Reset de Temperatura e pH para zero
+float readPH();                        // Converte a última saída filtrada (não lê o ADC)
+void setupPhSensor();                  // Configura o ADC1 e lê a caracterização do eFuse
+void runPhAcquisition();               // Tarefa do escalonador: rajada de leituras + filtros
+float convertMvToPh(float mv);
+void executePhCalibration();  // Inicia/avança/cancela a calibração de pH (não bloqueante)
+void startPhCalibration(uint8_t points);
+void beginPhCalibrationPoint();
+void runPhCalibrationStep();           // Detecção de estabilidade do ponto atual
+void finishPhCalibration();            // Calcula ponto neutro e inclinações e marca para salvar
+void cancelPhCalibration(const char* reason);
+void publishPhCalStatus(const char* text);
+void resetSensorData();  // Descarta as leituras atuais de temperatura e pH (tarefa de controle)
 
 // --- Protótipos de Funções de Configuração/Persistência (Definidas em config_manager.ino) ---
 void setupConfigManager();
 void loadConfig();
 void saveConfig();
 void checkConfigSave();
+void markConfigDirty();                            // Sinaliza alteração (gravação com debounce)
+void setConfigDefaults(PersistentConfig& cfg);
+void captureConfig(PersistentConfig& cfg);         // Globais -> struct persistida
+void applyConfig(const PersistentConfig& cfg);     // Struct persistida -> globais
+bool readConfigSlot(uint8_t slot, PersistentConfig& cfg, uint32_t& generation);
+bool importConfigJson(const char* path);
+bool exportConfigJson(const char* path);
 
 // --- Protótipos de Funções Display OLED (Definidas em display_manager.ino) ---
 void setupDisplay();            // --- SETUP DO DISPLAY ---
@@ -79,50 +131,94 @@ void drawTpaRepositionPage();   // --- DESENHO: TPA REPOSIÇÃO (Página 2) ---
 void drawBufferInjectionPage(); // --- DESENHO: INJEÇÃO BUFFER (Página 3) ---
 void drawCustomDashboardPage(); // --- DESENHO: CUSTOM DASH (Página 4) ---
 void updateDisplay();           // --- FUNÇÃO CENTRAL DE ATUALIZAÇÃO ---
+uint32_t computePageSignature(int page); // Assinatura dos valores exibidos numa página
+size_t flushDirtyPages();       // Envia ao SSD1306 só as colunas alteradas de cada página
+void reportDisplayStats();      // Tempo de quadro e bytes I2C no Serial
+void renderPage0Dashboard();    // Página 0 (temperaturas, pH, nível do RAN)
 void renderPage1TpaSchedule();  // --- Para programação de schedule como falback de TPA
+void renderPage2TpaReposition(); // Página 2 (reposição)
+void renderPage3TpaBuffer();    // Página 3 (buffer)
+void renderPage4Diagnostics();  // Heap, pilhas e sondas mais lentas do profiler
 void updateRanLevelDisplay(); // Atualiza o percentual de nível no Blynk e Display
 
 // --- Protótipos de Funções para ação com botões físicos (Definidas em hardware_manager.ino) ---
    
-void resetCriticalAlerts();     // Botão para resetar alertas criticos (PH, TEMP)
-void resetRtcOsfAlert();        // Botão para resetar alertas criticos (PH, TEMP)
+void resetRtcOsfAlert();        // Limpa o alerta OSF do RTC (tarefa de controle, CMD_RESET_RTC_OSF)
 void executePhCalibration();    // Botão/Menu para acionar a calibração
-void executeTpaExtraction();    //Botão para execução de TPA
 void calculateTpaVolume();      //Para cálculo de volume de TPA
 
-// --- FUNÇÕES DE NAVEGAÇÃO E EDIÇÃO (CALLBACKS DO Button2) ---
-void handleOledPageTap(Button2& btn);
-void handleOledPageLongPress(Button2& btn);
-void handleUpTap(Button2& btn);
-void handleDownTap(Button2& btn);
-void handleAlertResetTap(Button2& btn);
-void handleAlertResetLongPress(Button2& btn);
-void handleRtcResetTap(Button2& btn);
-void handlePhCalLongPress(Button2& btn);
-void handleServiceModeLongPress(Button2& btn);
-void runHardwareManagerLoop();
-void setupHardwareButtons(); // Define os botões
+// --- FUNÇÕES DE NAVEGAÇÃO E EDIÇÃO (HANDLERS DOS BOTÕES) ---
+void handleOledPageTap();
+void handleOledPageLongPress();
+void handleUpTap();
+void handleDownTap();
+void handleAlertResetTap();
+void handleAlertResetLongPress();
+void handleRtcResetTap();
+void handlePhCalLongPress();
+void handleServiceModeLongPress();
+void runHardwareManagerLoop();  // UI: consome as bordas das ISRs (debounce por tempo, curto/longo)
+void setupHardwareButtons();    // Pinos + ISRs por borda
+void enableButtonWakeups();     // Botões acordam o chip do sono leve
+unsigned long getButtonNextCheckMs(); // Prazo até o fim da janela de debounce mais próxima
+void reportButtonStats();
 
 
 // --- Protótipos de Funções para ação com atuadores (Definidas em actuators_manager.ino) ---
 void setupActuators();                   // --- SETUP DOS ATUADORES ---
 void setExtractionPumpState(bool state); // --- CONTROLE DA BOMBA DE EXTRACAO ---
-unsigned long calculatePumpDuration(float volumeLiters); // --- CÁLCULO DA DURAÇÃO DA BOMBA ---
-void executeTpaExtraction();             // --- ATUADOR: EXECUTA O CICLO DE EXTRACAO TPA ---
+bool executeTpaExtraction(float volumeLiters); // --- ATUADOR: INICIA UM LOTE DE EXTRACAO TPA (não bloqueante) ---
+void runTpaExtractionLoop();             // Máquina de estados da extração (M5.1)
+bool isTpaExtractionFinished();          // Verifica se a extração terminou com sucesso
+bool isTpaExtractionAborted();           // Verifica se a extração foi interrompida
+void resetTpaExtractionFlow();           // Reseta o estado da extração
+float getExtractedVolumeLiters();        // Volume extraído até agora (publicado para a UI)
 
 // --- Protótipos de Funções para ação com atuadores (Definidas em tpa_manager.ino) ---
 void calculateTpaVolume();                               // --- LÓGICA DE CÁLCULO DE VOLUME ---
-unsigned long calculatePumpDuration(float volumeLiters); // Calcula a duração de acionamento da bomba
-void executeTpaExtraction();                             // Executa a extração no TPA
-void saveTpaConfig(StaticJsonDocument<1024>& doc);       // Salva as configurações no SPIFFS/LittleFS
-void checkLocalSchedule();                               // Para verificar o schedule local
+void runTpaManagerLoop();                                // Coordena o fluxo geral da TPA
+bool startTpaCycle(const char* source);                  // Dispara um ciclo TPA completo (M5.1 -> ...)
+void finishTpaCycleStats(bool completed);               // Duração fim-a-fim do ciclo (tpaCycleStats)
+bool startBufferDosingOnly(const char* source);          // Só M5.4 (job de agenda)
+bool startRanTopUpOnly(const char* source);              // Só M5.3 (job de agenda)
 
 // --- Protótipos de Funções para ação com atuadores (Definidas em tpa_reposition.ino) ---
-void startTpaRepositionFlow();   // Inicia o processo de reposição
+void startTpaRepositionFlow(float volumeLiters, bool safetyPause); // Inicia um lote de reposição
 void runTpaRepositionLoop();     // Executa a reposição até os limites estabelecidos.
 bool isTpaRepositionFinished();  // Averigua se a reposição está encerrada
+float getRepositionDeliveredLiters(); // Lote atual: litros medidos no RAN (ou estimativa da bomba sem sensor)
 void resetTpaRepositionFlow();   // Reset do estado do fluxo de reposição
-extern unsigned long calculatePumpDuration(float volumeLiters);
+
+// --- Protótipos do Log de Eventos (Definidas em event_log.ino) ---
+void setupEventLog();                    // Anel na RTC + trilha pós-morte (logo após Serial.begin)
+void logSystemEvent(const char* category, const char* message); // Categoria em texto ("info", "critical"...)
+void logEvent(uint8_t level, uint8_t source, const char* message);
+void logEventf(uint8_t level, uint8_t source, const char* format, ...); // Use as macros LOG_*()
+void runEventLogDrain();                 // Tarefa de rede: Serial, Blynk e flash
+void reportEventLogStats();
+
+// --- Protótipos do Profiler (Definidas em profiler.ino) ---
+void runProfilerTask();                  // Tarefa de rede: heap/pilhas, console serial, resumo no Blynk
+void reportProfiler();                   // Tabela de sondas no Serial (comando "prof")
+void resetProfiler();
+uint32_t profileCyclesToUs(uint32_t cycles);
+uint32_t getProfilePercentileUs(uint8_t probe, uint8_t percent);
+const char* getProfileProbeName(uint8_t probe);
+
+// --- Protótipos do Plano TPA (Definidas em tpa_plan.ino) ---
+bool startTpaPlan(uint8_t stageMask, const char* source); // Inicia os estágios da máscara (TPA_STAGE_BIT)
+void runTpaPlan();                       // Executor: avança, inicia em paralelo e fecha o plano
+bool isTpaPlanActive();
+void abortTpaPlan(const char* reason);   // Cancela e desliga o hardware dos estágios em execução
+void reportTpaPlan();                    // Duração por estágio e desnível máximo no Serial
+
+// --- Protótipos das Regras de Alerta (Definidas em alert_rules.ino) ---
+void setAlertRuleDefaults(AlertRule* rules); // Tabela padrão (temperatura, taxa, pH)
+void setupAlertRules();                  // Zera estados e histórico de taxa
+void evaluateAlertRules();               // Uma passada por lote de amostras (tarefa de controle)
+bool isAlertInterlockActive(uint8_t action); // Alguma regra com esta ação está ativa?
+void resetCriticalAlerts();              // Reconhece os alertas ativos (CMD_RESET_ALERTS)
+void reportAlertRules();                 // Tabela e estado de cada regra no Serial
 
 // --- Protótipos de Funções para Módulo 5.3 (Enchimento do RAN) ---
 void setupRanRefill();                   // Inicializa pinos e estado do RAN (chamado em setupActuators)
@@ -134,6 +230,121 @@ bool readRanLevelSensor();               // Função auxiliar para ler o sensor
 void setRANSolenoidState(bool state);    // Função auxiliar para controlar a válvula
 void checkRanRefillAlert();              // Verifica se houve falha no enchimento
 
+// --- Protótipos do Nível Contínuo do RAN (Definidas em ran_level.ino) ---
+void setupRanLevel();                    // Boia + sensor contínuo (chamado em setupActuators)
+void runRanLevelAcquisition();           // Tarefa do escalonador: leitura, filtro, litros, vazão
+bool isRanLevelMeasured();               // Sensor contínuo com leitura válida?
+float getRanCapacityLiters();            // Volume do último ponto da tabela de geometria
+void setRanLevelCalibrationDefaults(RanLevelCalibration& cal);
+bool isRanLevelCalibrationValid(const RanLevelCalibration& cal);
+void reportRanLevel();                   // Nível, vazão e contadores no Serial
+bool isRanSolenoidOpen();                // Último comando da válvula (actuators_manager.ino)
+
+// --- Protótipos de Energia e Sono Leve (Definidas em power_manager.ino) ---
+void setupPowerManagement();             // DFS + sono leve automático + despertar por botões/Wi-Fi DTIM
+void waitForSchedulerWork(uint8_t group, unsigned long waitMs); // Bloqueia até o prazo ou uma notificação
+void setPowerBusy(uint8_t source, bool busy); // PowerBusySource: segura/libera o impedimento de sono leve
+void reportPowerStats();                 // Ocioso por núcleo, despertares e atraso de despertar
+
+// --- Protótipos da Sincronização de Estado (Definidas em state_sync.ino) ---
+void startStateSync();                   // BLYNK_CONNECTED: pede ao servidor só o que não está pendente
+void runStateSync();                     // Tarefa de rede: fecha a janela (lote único) e envia pendentes
+void receiveBlynkSetting(uint8_t id, float value); // BLYNK_WRITE validado: lote da reconexão ou aplicação ao vivo
+void postLocalSettingChange(uint8_t id, float value); // Edição no OLED: aplicada e gravada pela tarefa de controle
+void applySettingValue(uint8_t id, float value, uint8_t source); // Controle: escreve e versiona (CMD_SET_SETTING)
+void runSettingEffects(uint8_t effects); // Controle: recálculo, reagendamento e gravação de um lote
+void markAllSettingsChanged(uint8_t source); // Importação: todos os valores locais vencem na próxima sincronização
+void copySyncSettingState(SyncSettingState* out); // Config: cópia coerente das versões (sob syncMux)
+void restoreSyncSettingState(const SyncSettingState* in); // Config: versões lidas do registro salvo
+void reportStateSyncStats();
+
+// --- Protótipos de Funções do Escalonador Cooperativo (Definidas em task_scheduler.ino) ---
+void setupTaskScheduler();                 // Limpa a tabela de tarefas e as estatísticas
+bool registerSchedulerTask(uint8_t group, const char* name, SchedulerTaskFn fn, unsigned long periodMs, bool critical);
+unsigned long runTaskScheduler(uint8_t group); // Uma iteração do grupo; devolve ms até a próxima tarefa periódica
+void setLoopBudgetUs(unsigned long budgetUs);
+void recordLoopIteration(uint8_t group, unsigned long iterUs, const char* slowestTask);
+unsigned long getLoopP99Us(uint8_t group); // Percentil 99 da duração de iteração (janela atual)
+void resetLoopStatsWindow(uint8_t group);
+void reportLoopStats(uint8_t group);       // Relatório de latência no Serial
+void runBlynkTask();                       // Wrapper de Blynk.run() para o escalonador
+
+// --- Protótipos de Funções das Tarefas FreeRTOS (Definidas em rtos_tasks.ino) ---
+void setupRtosTasks();                     // Cria as tarefas de controle, rede e UI
+unsigned long runControlTaskIteration();   // Uma passagem de cada tarefa; devolve a espera (ms)
+unsigned long runNetworkTaskIteration();
+unsigned long runUiTaskIteration();
+int getCurrentTaskGroup();                 // Grupo (SchedulerGroup) da tarefa chamadora
+void postControlCommand(uint8_t type, int32_t arg);     // Envia um comando à tarefa de controle
+void postControlSetting(uint8_t id, float value, uint8_t source); // CMD_SET_SETTING (valor + origem)
+void notifySchedulerGroup(uint8_t group);  // Acorda a tarefa FreeRTOS do grupo (trabalho novo)
+void notifySchedulerGroupFromIsr(uint8_t group);
+bool isControlBusy();                      // Bomba, válvula, TPA ou calibração em andamento
+void processControlCommands();             // Controle: aplica os comandos recebidos
+void applyControlCommand(const ControlCommand& cmd);
+void publishVirtualPin(uint8_t vpin, float value);      // Escreve um pino Blynk a partir de qualquer tarefa
+void publishVirtualPinInt(uint8_t vpin, int32_t value);
+void publishVirtualPinText(uint8_t vpin, const char* text);
+bool enqueueNetMessage(const NetMessage& msg);          // Encaminha para a fila da tarefa chamadora
+void deliverNetMessage(const NetMessage& msg);          // Rede: envia de fato ao Blynk
+void runNetworkOutbox();                   // Rede: esvazia as filas vindas do controle e da UI
+void publishControlSnapshot();             // Controle: publica o estado de processo para a UI
+void receiveControlSnapshots();            // UI: guarda a fotografia mais recente
+void runDisplayTask();                     // UI: redesenho periódico do OLED
+void runSpscQueueSelfTest();               // Auto-teste de vazão/ordem das filas (ACC_SPSC_SELFTEST)
+
+// --- Protótipos de Funções do Publicador de Telemetria (Definidas em telemetry.ino) ---
+void submitTelemetry(const NetMessage& msg);   // Rede: registra o valor pedido para um pino
+void runTelemetryPublisher();                  // Rede: decide e envia (zona morta, intervalos, histórico)
+void writeTelemetryValue(uint8_t vpin, uint8_t type, int32_t intValue, float floatValue, const char* text);
+void markTelemetrySent(TelemetrySlot& slot, unsigned long now);
+void pushTelemetryBackfill(const TelemetrySlot& slot);
+int drainTelemetryBackfill(int budget);
+const TelemetryPolicy* findTelemetryPolicy(uint8_t vpin);
+TelemetrySlot* getTelemetrySlot(uint8_t vpin);
+void reportTelemetryStats();
+
+// --- Protótipos de Funções do Histórico Local (Definidas em history_store.ino) ---
+void setupHistoryStore();                      // Monta /hist, carrega o índice e recupera o segmento aberto
+void sampleHistory();                          // Controle: amostra temperatura, pH e nível do RAN
+void recordHistoryEvent(uint8_t eventCode);    // Controle: registra um marco do ciclo TPA
+bool pushHistorySample(uint8_t channel, uint8_t kind, int16_t value);
+void runHistoryStore();                        // Rede: consome a fila e grava em lote
+void appendHistorySample(const HistorySample& sample);
+void flushHistoryBatch();
+void rotateHistorySegment(uint32_t baseEpoch);
+bool recoverHistorySegment();
+void saveHistoryIndex();
+void decodeHistoryRecord(HistoryDecoder& d, const HistoryRecord& r, HistorySample& out);
+bool queryHistoryRange(uint8_t channel, uint32_t fromEpoch, uint32_t toEpoch, HistoryRangeResult& out);
+void reportHistorySummary();                   // Mín/máx/média das últimas 24 h e 7 d no Serial
+
+// --- Agendador local (tpa_scheduler.ino) ---
+void setScheduleJobDefaults(ScheduleJobConfig* jobs);
+void requestScheduleRecompute();                         // Agenda/relógio mudou: recalcula próximos disparos
+uint32_t scheduleNowEpoch();
+uint32_t computeNextFireEpoch(const ScheduleJobConfig& job, uint32_t after);
+void recomputeSchedule();
+void reportSchedule();
+void noteScheduleJobRun(uint8_t jobIndex);               // Registra a execução (epoch do RTC)
+void runTpaScheduler();                                  // Tarefa de controle (1 s)
+
+// --- Motor de dosagem (dosing_engine.ino) ---
+void setPumpCalibrationDefaults(PumpCalibration* cal);
+void setupDosingEngine();                                // Depois de setupConfigManager()
+float getPumpEffectiveFlow(uint8_t pump);                // mL/s com compensação de desgaste
+unsigned long calculatePumpDuration(uint8_t pump, float volumeLiters); // Duração prevista (ms)
+bool startPumpDose(uint8_t pump, float volumeMl);        // Termina pelo volume integrado
+void stopPumpDose(uint8_t pump);
+void flushPumpRuntime();                                 // Grava o tempo de uso acumulado (fim do plano TPA)
+bool isPumpDoseActive(uint8_t pump);
+float getPumpDeliveredMl(uint8_t pump);
+void runDosingEngine();                                  // Tarefa de controle (crítica)
+void publishPumpCalStatus(const char* text);
+bool startPumpCalibration(uint8_t pump);
+void finishPumpCalibrationRun(uint8_t pump);
+void finishPumpCalibration(float measuredMl);
+
 // --- Protótipos das Funções (Para o compilador) ---
 
 
@@ -0,0 +1,19 @@
+// GFX de mentira: o texto não é desenhado (o buffer do SSD1306 fica como o sketch deixar)
+#pragma once
+
+#include <Arduino.h>
+
+class Adafruit_GFX : public Print {
+public:
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+    void setTextSize(uint8_t) {}
+    void setTextColor(uint16_t) {}
+    void setTextColor(uint16_t, uint16_t) {}
+    void setCursor(int16_t, int16_t) {}
+    void setTextWrap(bool) {}
+    void fillRect(int16_t, int16_t, int16_t, int16_t, uint16_t) {}
+    void drawFastHLine(int16_t, int16_t, int16_t, uint16_t) {}
+    void drawRect(int16_t, int16_t, int16_t, int16_t, uint16_t) {}
+    void drawPixel(int16_t, int16_t, uint16_t) {}
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_WHITE 1
+#define SSD1306_BLACK 0
+#define SSD1306_PAGEADDR 0x22
+#define SSD1306_COLUMNADDR 0x21
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+    Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* wire, int8_t resetPin = -1,
+                     uint32_t clkDuring = 400000UL, uint32_t clkAfter = 100000UL)
+        : width_(w), height_(h), buffer_(new uint8_t[w * ((h + 7) / 8)]()) {
+        (void)wire; (void)resetPin; (void)clkDuring; (void)clkAfter;
+    }
+    ~Adafruit_SSD1306() { delete[] buffer_; }
+    bool begin(uint8_t vcs = SSD1306_SWITCHCAPVCC, uint8_t addr = 0, bool reset = true, bool periphBegin = true) {
+        (void)vcs; (void)addr; (void)reset; (void)periphBegin;
+        return true;
+    }
+    void clearDisplay() { memset(buffer_, 0, width_ * ((height_ + 7) / 8)); }
+    void display() {}
+    uint8_t* getBuffer() { return buffer_; }
+    void ssd1306_command(uint8_t) {}
+    void dim(bool) {}
+
+private:
+    uint8_t width_;
+    uint8_t height_;
+    uint8_t* buffer_;
+};
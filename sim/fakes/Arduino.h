@@ -0,0 +1,189 @@
+// Núcleo Arduino/ESP32 de mentira para a simulação nativa (sim/).
+// Só o que o sketch usa: tempo e pinos vêm do relógio virtual e da planta simulada
+// (sim_platform.cpp), o Serial escreve no stdout (se habilitado) e o FreeRTOS é o
+// escalonador de eventos do harness (as tarefas nunca rodam em threads).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <type_traits>
+
+typedef uint8_t byte;
+class __FlashStringHelper;
+#define F(x) (reinterpret_cast<const __FlashStringHelper*>(x))
+#define PSTR(x) (x)
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define ONLOW 0x04
+#define ONHIGH 0x05
+#define A0 36
+#define DEC 10
+#define HEX 16
+#define BIN 2
+#define ADC_11db 3
+
+// --- Print / Serial ---
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t n) {
+        size_t written = 0;
+        while (n--) written += write(*buf++);
+        return written;
+    }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(int v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(long v, int base = DEC) {
+        if (base == DEC) return printFormatted("%ld", v);
+        return print((unsigned long)v, base);
+    }
+    size_t print(unsigned long v, int base = DEC) {
+        if (base == HEX) return printFormatted("%lX", v);
+        if (base == BIN) {
+            char buf[33];
+            int i = 32;
+            buf[i] = '\0';
+            do { buf[--i] = (char)('0' + (v & 1)); v >>= 1; } while (v && i > 0);
+            return write(buf + i);
+        }
+        return printFormatted("%lu", v);
+    }
+    size_t print(long long v, int base = DEC) { (void)base; return printFormatted("%lld", v); }
+    size_t print(unsigned long long v, int base = DEC) { (void)base; return printFormatted("%llu", v); }
+    size_t print(double v, int digits = 2) { return printFormatted("%.*f", digits, v); }
+
+    size_t println() { return write("\r\n"); }
+    template <class T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    template <class T> size_t println(T v, int d) { size_t n = print(v, d); return n + println(); }
+
+    size_t printf(const char* fmt, ...) {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        if (n < 0) return 0;
+        return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+    }
+
+private:
+    size_t printFormatted(const char* fmt, ...) {
+        char buf[64];
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        return n > 0 ? write(buf) : 0;
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+};
+
+// Saída no stdout só com simSetSerialEcho(true); a entrada vem de simSerialInput()
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    void flush() {}
+};
+extern HardwareSerial Serial;
+
+// --- Tempo e pinos (relógio virtual e planta em sim_platform.cpp) ---
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+void ledcSetup(uint8_t channel, double freq, uint8_t resolutionBits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+inline int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterrupt(int pin, void (*isr)(), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int mode);
+void detachInterrupt(int pin);
+
+template <class T> T constrain(T x, T a, T b) { return x < a ? a : (x > b ? b : x); }
+// Por valor: decltype(a < b ? a : b) com a/b do mesmo tipo seria T& para o parâmetro (ponteiro pendurado)
+template <class T, class U> typename std::common_type<T, U>::type min(T a, U b) { return a < b ? a : b; }
+template <class T, class U> typename std::common_type<T, U>::type max(T a, U b) { return a > b ? a : b; }
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// --- ESP ---
+class EspClass {
+public:
+    uint32_t getFreeHeap();      // Heap total simulado menos o que o firmware alocou com new
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getCycleCount() { return (uint32_t)micros(); }
+    uint32_t getCpuFreqMHz() { return 240; }
+    void restart() {}
+};
+extern EspClass ESP;
+
+// --- FreeRTOS (escalonador de eventos do harness) ---
+typedef int portMUX_TYPE;              // Uma só thread: seções críticas não fazem nada
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void (*TaskFunction_t)(void*);
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define pdPASS 1
+#define pdTRUE 1
+#define pdFALSE 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define portYIELD_FROM_ISR(x) ((void)(x))
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t handle);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle);
+BaseType_t xPortGetCoreID();
+TickType_t xTaskGetTickCount();
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t handle);
+void vTaskNotifyGiveFromISR(TaskHandle_t handle, BaseType_t* woken);
@@ -0,0 +1,72 @@
+// ArduinoJson de mentira: só a API que o config_manager usa, SEM modelo de documento.
+// deserializeJson() sempre falha (NotSupported) e serializeJson() não escreve nada (retorna 0),
+// então importação/exportação JSON ficam fora da simulação; a configuração binária A/B
+// (caminho normal de gravação) roda inteira sobre o LittleFS em memória.
+#pragma once
+
+#include <Arduino.h>
+
+class JsonArray;
+class JsonObject;
+
+class JsonVariant {
+public:
+    operator JsonArray() const;
+    operator JsonObject() const;
+    template <class T> JsonVariant& operator=(T) { return *this; }
+    template <class T> T operator|(T fallback) const { return fallback; }
+    const char* operator|(const char* fallback) const { return fallback; }
+    JsonVariant operator[](const char*) const { return JsonVariant(); }
+    JsonVariant operator[](int) const { return JsonVariant(); }
+    bool isNull() const { return true; }
+};
+
+class JsonArray {
+public:
+    template <class T> bool add(T) { return false; }
+    size_t size() const { return 0; }
+    JsonVariant operator[](int) const { return JsonVariant(); }
+    JsonObject createNestedObject();
+    JsonArray createNestedArray() { return JsonArray(); }
+    bool isNull() const { return true; }
+};
+
+class JsonObject {
+public:
+    JsonVariant operator[](const char*) const { return JsonVariant(); }
+    bool isNull() const { return true; }
+    JsonArray createNestedArray(const char*) { return JsonArray(); }
+    JsonObject createNestedObject(const char*) { return JsonObject(); }
+};
+
+inline JsonVariant::operator JsonArray() const { return JsonArray(); }
+inline JsonVariant::operator JsonObject() const { return JsonObject(); }
+inline JsonObject JsonArray::createNestedObject() { return JsonObject(); }
+
+#define JSON_ARRAY_SIZE(n) ((n) * 16)
+#define JSON_OBJECT_SIZE(n) ((n) * 16)
+#define JSON_STRING_SIZE(n) ((n) + 1)
+
+class DynamicJsonDocument {
+public:
+    explicit DynamicJsonDocument(size_t capacity) : cap(capacity) {}
+    size_t capacity() const { return cap; }
+    bool overflowed() const { return false; }
+    JsonVariant operator[](const char*) const { return JsonVariant(); }
+    JsonArray createNestedArray(const char*) { return JsonArray(); }
+    JsonObject createNestedObject(const char*) { return JsonObject(); }
+    bool containsKey(const char*) const { return false; }
+    void clear() {}
+private:
+    size_t cap;
+};
+
+class DeserializationError {
+public:
+    operator bool() const { return true; } // Sempre erro: nada é importado
+    const char* c_str() const { return "NotSupported"; }
+    const __FlashStringHelper* f_str() const { return F("NotSupported"); }
+};
+
+template <class Doc, class Source> DeserializationError deserializeJson(Doc&, Source&) { return DeserializationError(); }
+template <class Doc, class Dest> size_t serializeJson(const Doc&, Dest&) { return 0; }
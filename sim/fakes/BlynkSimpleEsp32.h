@@ -0,0 +1,111 @@
+// Blynk de mentira: servidor em memória (sim_platform.cpp). virtualWrite() guarda o valor do pino
+// no "servidor", syncVirtual() devolve o valor guardado pelo handler BLYNK_WRITE do pino no próximo
+// run(), e simBlynkAppWrite() simula o usuário mexendo no app. Conexão controlada pelo teste.
+#pragma once
+
+#include <Arduino.h>
+#include <TimeLib.h>
+
+class BlynkParam {
+public:
+    explicit BlynkParam(const char* text) { strncpy(text_, text, sizeof(text_) - 1); text_[sizeof(text_) - 1] = '\0'; }
+    int asInt() const { return atoi(text_); }
+    float asFloat() const { return (float)atof(text_); }
+    double asDouble() const { return atof(text_); }
+    const char* asStr() const { return text_; }
+private:
+    char text_[64];
+};
+
+typedef void (*BlynkWriteHandler)(const BlynkParam& param);
+
+class BlynkClass {
+public:
+    void config(const char* auth, const char* domain, uint16_t port);
+    bool connect(unsigned long timeoutMs = 0);
+    bool connected();
+    void run();
+    void virtualWrite(int pin, int value);
+    void virtualWrite(int pin, unsigned int value) { virtualWrite(pin, (long)value); }
+    void virtualWrite(int pin, long value);
+    void virtualWrite(int pin, unsigned long value) { virtualWrite(pin, (long)value); }
+    void virtualWrite(int pin, float value) { virtualWrite(pin, (double)value); }
+    void virtualWrite(int pin, double value);
+    void virtualWrite(int pin, const char* value);
+    void syncVirtual(int pin);
+    void syncAll();
+    void logEvent(const char* event, const char* description = "");
+    void logEvent(const char* event, const __FlashStringHelper* description) { logEvent(event, (const char*)description); }
+    void beginGroup(uint64_t timestamp = 0) { (void)timestamp; }
+    void endGroup() {}
+};
+extern BlynkClass Blynk;
+
+// Registro dos handlers: cada BLYNK_WRITE do sketch vira uma função estática registrada no boot
+struct BlynkWriteRegistrar {
+    BlynkWriteRegistrar(int pin, BlynkWriteHandler handler);
+};
+
+#define BLYNK_CAT_(a, b) a##b
+#define BLYNK_CAT(a, b) BLYNK_CAT_(a, b)
+#define BLYNK_WRITE_IMPL(pin, id)                                                   \
+    static void BLYNK_CAT(blynkWriteHandler_, id)(const BlynkParam& param);         \
+    static BlynkWriteRegistrar BLYNK_CAT(blynkWriteRegistrar_, id)(pin, BLYNK_CAT(blynkWriteHandler_, id)); \
+    static void BLYNK_CAT(blynkWriteHandler_, id)(const BlynkParam& param)
+#define BLYNK_WRITE(pin) BLYNK_WRITE_IMPL(pin, __COUNTER__)
+#define BLYNK_CONNECTED() void BlynkOnConnected()
+#define BLYNK_DISCONNECTED() void BlynkOnDisconnected()
+void BlynkOnConnected();
+void BlynkOnDisconnected();
+
+#define V0 0
+#define V1 1
+#define V2 2
+#define V3 3
+#define V4 4
+#define V5 5
+#define V6 6
+#define V7 7
+#define V8 8
+#define V9 9
+#define V10 10
+#define V11 11
+#define V12 12
+#define V13 13
+#define V14 14
+#define V15 15
+#define V16 16
+#define V17 17
+#define V18 18
+#define V19 19
+#define V20 20
+#define V21 21
+#define V22 22
+#define V23 23
+#define V24 24
+#define V25 25
+#define V26 26
+#define V27 27
+#define V28 28
+#define V29 29
+#define V30 30
+#define V31 31
+#define V32 32
+#define V33 33
+#define V34 34
+#define V35 35
+#define V36 36
+#define V37 37
+#define V38 38
+#define V39 39
+#define V40 40
+#define V41 41
+#define V42 42
+#define V43 43
+#define V44 44
+#define V45 45
+#define V46 46
+#define V47 47
+#define V48 48
+#define V49 49
+#define V50 50
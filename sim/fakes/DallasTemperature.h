@@ -0,0 +1,20 @@
+// DS18B20 de mentira: as sondas e as temperaturas vêm da planta simulada (sim_platform.cpp)
+#pragma once
+
+#include <OneWire.h>
+
+typedef uint8_t DeviceAddress[8];
+#define DEVICE_DISCONNECTED_C -127
+
+class DallasTemperature {
+public:
+    explicit DallasTemperature(OneWire* bus) { (void)bus; }
+    void begin() {}
+    void setWaitForConversion(bool wait) { (void)wait; }
+    uint8_t getDeviceCount();
+    bool getAddress(uint8_t* address, uint8_t index);
+    bool setResolution(const uint8_t* address, uint8_t bits, bool skipSave = false) { (void)address; (void)bits; (void)skipSave; return true; }
+    int16_t millisToWaitForConversion(uint8_t bits) { return 750 / (1 << (12 - bits)); }
+    void requestTemperatures() {}
+    float getTempC(const uint8_t* address);
+};
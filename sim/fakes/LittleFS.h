@@ -0,0 +1,72 @@
+// LittleFS de mentira: sistema de arquivos em memória (sim_platform.cpp), com os modos
+// "r", "w" (trunca) e "a" (acrescenta). O conteúdo vive enquanto o processo
+// do teste durar.
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> SimFileData;
+
+class File : public Stream {
+public:
+    File() : pos_(0), writable_(false) {}
+    File(const std::string& path, std::shared_ptr<SimFileData> data, size_t pos, bool writable)
+        : path_(path), data_(data), pos_(pos), writable_(writable) {}
+
+    operator bool() const { return data_ != nullptr; }
+    void close() { data_.reset(); }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t n) override {
+        if (!data_ || !writable_) return 0;
+        if (pos_ + n > data_->size()) data_->resize(pos_ + n);
+        memcpy(data_->data() + pos_, buf, n);
+        pos_ += n;
+        return n;
+    }
+    using Print::write;
+    int read() override {
+        if (!data_ || pos_ >= data_->size()) return -1;
+        return (*data_)[pos_++];
+    }
+    size_t read(uint8_t* buf, size_t n) {
+        if (!data_) return 0;
+        size_t left = pos_ < data_->size() ? data_->size() - pos_ : 0;
+        if (n > left) n = left;
+        memcpy(buf, data_->data() + pos_, n);
+        pos_ += n;
+        return n;
+    }
+    int available() override { return data_ && pos_ < data_->size() ? (int)(data_->size() - pos_) : 0; }
+    bool seek(uint32_t pos) {
+        if (!data_ || pos > data_->size()) return false;
+        pos_ = pos;
+        return true;
+    }
+    size_t position() const { return pos_; }
+    size_t size() const { return data_ ? data_->size() : 0; }
+    void flush() {}
+    const char* name() const { return path_.c_str(); }
+    bool isDirectory() const { return false; }
+
+private:
+    std::string path_;
+    std::shared_ptr<SimFileData> data_;
+    size_t pos_;
+    bool writable_;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false);
+    File open(const char* path, const char* mode = "r");
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+    size_t totalBytes();
+    size_t usedBytes();
+};
+extern LittleFSFS LittleFS;
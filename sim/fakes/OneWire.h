@@ -0,0 +1,8 @@
+#pragma once
+
+#include <Arduino.h>
+
+class OneWire {
+public:
+    explicit OneWire(uint8_t pin) { (void)pin; }
+};
@@ -0,0 +1,41 @@
+// RTClib de mentira: o DS3231 conta a partir do relógio virtual (sim_platform.cpp).
+// DateTime faz a conversão de calendário de verdade (o agendador depende dela).
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class DateTime {
+public:
+    DateTime(uint32_t unixTime = 946684800UL);
+    DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t minute = 0, uint8_t second = 0);
+    DateTime(const char* date, const char* time);  // __DATE__, __TIME__
+    DateTime(const __FlashStringHelper* date, const __FlashStringHelper* time)
+        : DateTime((const char*)date, (const char*)time) {}
+
+    uint16_t year() const { return year_; }
+    uint8_t month() const { return month_; }
+    uint8_t day() const { return day_; }
+    uint8_t hour() const { return hour_; }
+    uint8_t minute() const { return minute_; }
+    uint8_t second() const { return second_; }
+    uint8_t dayOfTheWeek() const;  // 0 = domingo
+    uint32_t unixtime() const;
+
+private:
+    uint16_t year_;
+    uint8_t month_, day_, hour_, minute_, second_;
+};
+
+enum Ds3231SqwPinMode { DS3231_OFF = 0x1C, DS3231_SquareWave1Hz = 0x00 };
+
+class RTC_DS3231 {
+public:
+    bool begin(TwoWire* wire = &Wire) { (void)wire; return true; }
+    bool lostPower();
+    DateTime now();
+    void adjust(const DateTime& dt);
+    void clearAlarm(uint8_t alarm) { (void)alarm; }
+    void writeSqwPinMode(Ds3231SqwPinMode mode) { (void)mode; }
+    float getTemperature() { return 25.0f; }
+};
@@ -0,0 +1,12 @@
+// TimeLib de mentira: hora do "NTP" (widget RTC do Blynk) definida pelo teste com setTime()
+#pragma once
+
+#include <time.h>
+
+enum timeStatus_t { timeNotSet, timeNeedsSync, timeSet };
+typedef time_t (*getExternalTime)();
+
+time_t now();
+void setTime(time_t t);
+void setSyncProvider(getExternalTime provider);
+timeStatus_t timeStatus();
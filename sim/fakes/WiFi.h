@@ -0,0 +1,12 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define WL_CONNECTED 3
+
+class WiFiClass {
+public:
+    int status() { return WL_CONNECTED; }
+    void setSleep(bool enable) { (void)enable; }
+};
+extern WiFiClass WiFi;
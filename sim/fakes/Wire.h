@@ -0,0 +1,17 @@
+// I2C de mentira: só conta os bytes enviados (OLED)
+#pragma once
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    void begin() {}
+    void begin(int sda, int scl) { (void)sda; (void)scl; }
+    void setClock(uint32_t hz) { (void)hz; }
+    void beginTransmission(uint8_t address) { (void)address; }
+    uint8_t endTransmission(bool stop = true) { (void)stop; return 0; }
+    size_t write(uint8_t) { bytesWritten++; return 1; }
+    size_t write(const uint8_t* buf, size_t n) { (void)buf; bytesWritten += n; return n; }
+    uint32_t bytesWritten = 0;
+};
+extern TwoWire Wire;
@@ -0,0 +1,17 @@
+// ADC1 de mentira: as tensões vêm da planta simulada (pH e nível do RAN)
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+    ADC1_CHANNEL_0 = 0, ADC1_CHANNEL_1, ADC1_CHANNEL_2, ADC1_CHANNEL_3,
+    ADC1_CHANNEL_4, ADC1_CHANNEL_5, ADC1_CHANNEL_6, ADC1_CHANNEL_7
+} adc1_channel_t;
+typedef enum { ADC_ATTEN_DB_0 = 0, ADC_ATTEN_DB_2_5, ADC_ATTEN_DB_6, ADC_ATTEN_DB_11 } adc_atten_t;
+typedef enum { ADC_WIDTH_BIT_12 = 3 } adc_bits_width_t;
+typedef enum { ADC_UNIT_1 = 1, ADC_UNIT_2 = 2 } adc_unit_t;
+typedef int esp_err_t;
+
+inline esp_err_t adc1_config_width(adc_bits_width_t) { return 0; }
+inline esp_err_t adc1_config_channel_atten(adc1_channel_t, adc_atten_t) { return 0; }
+int adc1_get_raw(adc1_channel_t channel);  // mV simulados (esp_adc_cal_raw_to_voltage é identidade)
@@ -0,0 +1,12 @@
+// Registradores de GPIO de mentira: só o tipo de interrupção por pino (a ISR dos botões o rearma)
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    struct {
+        uint32_t int_type;
+        uint32_t wakeup_enable;
+    } pin[40];
+} gpio_dev_t;
+extern gpio_dev_t GPIO;
@@ -0,0 +1,106 @@
+// API do harness de simulação nativa (Linux) do ACC.
+//
+// O sketch inteiro (main.ino + módulos, na ordem do Arduino) é compilado num único arquivo com
+// ACC_HOST_SIM=1 contra as bibliotecas de mentira de sim/fakes. O tempo é um relógio virtual:
+// as três tarefas FreeRTOS (controle, rede, UI) não são threads, e sim iterações
+// (runControlTaskIteration() etc.) chamadas por um escalonador de eventos na ordem de
+// prioridade; quando todas esperam, o relógio salta direto para o próximo prazo. A planta
+// (aquário, RAN, bombas, válvula, boia, sondas) integra os volumes entre um salto e outro.
+//
+// Este cabeçalho NÃO inclui config.h/global.h (config.h define variáveis; só pode entrar no
+// arquivo do sketch). O acesso ao estado do firmware passa pelas funções simSketch*(),
+// definidas em sketch_glue.h, que é compilado junto com o sketch.
+#pragma once
+
+#include <stdint.h>
+
+// --- Relógio virtual ---
+uint64_t simNowUs();
+void simSetRtcEpoch(uint32_t epoch);       // Hora do DS3231 no instante virtual atual
+uint32_t simRtcEpoch();
+
+// --- Execução ---
+void simRunFor(uint64_t durationUs);       // Roda as tarefas até agora + durationUs
+void simRunUntil(uint64_t targetUs);
+void simSkipTo(uint64_t targetUs);         // Ocioso comprimido: avança sem acordar as tarefas
+
+struct SimRunStats {
+    uint64_t iterations[3];                // Por tarefa: controle, rede, UI
+    uint64_t wakeups;                      // Saltos do relógio
+    uint64_t skippedUs;                    // Tempo pulado por simSkipTo()
+};
+const SimRunStats& simRunStats();
+
+// --- Memória (operator new/delete enquanto o firmware roda) ---
+uint32_t simHeapInUse();
+uint32_t simHeapPeak();
+uint32_t simHeapAllocations();
+
+// --- Serial ---
+void simSetSerialEcho(bool enabled);       // Espelha o Serial do firmware no stdout
+void simSerialInput(const char* text);     // Console serial (profiler)
+
+// --- Blynk (servidor em memória) ---
+void simBlynkSetConnected(bool connected);
+void simBlynkAppWrite(int vpin, const char* value); // Usuário mexendo no app
+bool simBlynkServerValue(int vpin, char* out, int outLen);
+uint32_t simBlynkWrites();                 // virtualWrite() recebidos pelo "servidor"
+uint32_t simBlynkEvents();                 // logEvent() recebidos
+
+// --- Planta simulada ---
+struct SimPlant {
+    double tankLiters;                     // Aquário
+    double ranLiters;                      // Reservatório de água nova
+    float ranCapacityLiters;
+    float ranFloatLiters;                  // Boia fecha (nível cheio) a partir daqui
+    float pumpFlowMlPerSec[3];             // Extração, reposição, buffer (vazão real)
+    float valveInflowMlPerSec;             // Entrada de água do RAN com a válvula aberta
+    float phMv;                            // Tensão da sonda de pH
+    float ranLevelStuckMv;                 // > 0: sensor de nível do RAN travado nesta leitura
+    float probeTempC[3];                   // Sondas DS18B20 presentes no barramento
+    uint8_t probeCount;
+    // Totais acumulados
+    double extractedLiters;
+    double repositionedLiters;
+    double bufferDosedMl;
+    double ranFilledLiters;
+    double ranOverflowLiters;              // Válvula aberta com o RAN cheio
+    double pumpDryRunSec;                  // Bomba ligada sem água na origem
+};
+extern SimPlant simPlant;
+void simPlantReset();                      // Planta de referência (96 L, RAN cheio, 10 mL/s)
+
+// Ligação da planta aos pinos do firmware (preenchida por sketch_glue.h a partir do config.h)
+struct SimWiring {
+    uint8_t pumpPin[3];                    // Extração, reposição, buffer
+    uint8_t pumpOnLevel[3];                // Nível do pino com a bomba ligada
+    uint8_t valvePin;
+    uint8_t valveOnLevel;
+    uint8_t floatPin;                      // LOW = RAN cheio
+    uint8_t sqwPin;                        // SQW 1 Hz do DS3231
+    uint8_t phAdcChannel;
+    uint8_t ranAdcChannel;
+    float ranEmptyMv;                      // Sensor de nível: RAN vazio
+    float ranFullMv;                       // Sensor de nível: RAN na capacidade
+};
+void simPlantWire(const SimWiring& wiring);
+void simSketchSetupBegin();                // Em volta do setup(): conta o heap do boot
+void simSketchSetupEnd();
+
+// --- Estado do firmware (sketch_glue.h) ---
+struct SimTpaStats {
+    unsigned long started;
+    unsigned long completed;
+    unsigned long aborted;
+    unsigned long lastDurationMs;
+    unsigned long maxDurationMs;
+};
+void simSketchSetup();                     // setup() do sketch (cria as tarefas no harness)
+void simSketchTpaStats(SimTpaStats* out);
+bool simSketchIsIdle();                    // Sem TPA, bomba, válvula ou gravação pendente
+uint32_t simSketchNextScheduledEpoch();    // Próximo disparo da agenda local (0 = nenhum)
+uint32_t simSketchNowEpoch();              // Hora do firmware (clockNowEpoch)
+float simSketchTpaVolumeLiters();          // Volume a extrair por ciclo (volumeToExtractLiters)
+int simSketchBufferVolumeMl();
+// Edição local (como os botões do OLED): passa pela fila de comandos da tarefa de controle
+void simSketchSetSchedule(bool active, int frequency, int day, int hour, int minute);
@@ -0,0 +1,562 @@
+// Plataforma da simulação nativa: relógio virtual, escalonador das tarefas, planta simulada e
+// as implementações das bibliotecas de mentira de sim/fakes. NÃO inclui config.h/global.h: o que
+// a planta precisa saber do firmware (pinos, canais do ADC) chega por simPlantWire().
+#include <Arduino.h>
+#include <BlynkSimpleEsp32.h>
+#include <DallasTemperature.h>
+#include <LittleFS.h>
+#include <RTClib.h>
+#include <TimeLib.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <driver/adc.h>
+#include <soc/gpio_struct.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+
+#include <map>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "sim.h"
+
+// Tarefas do sketch (rtos_tasks.ino): o harness chama uma iteração de cada vez
+void controlTaskMain(void* pvParameters);
+void networkTaskMain(void* pvParameters);
+void uiTaskMain(void* pvParameters);
+unsigned long runControlTaskIteration();
+unsigned long runNetworkTaskIteration();
+unsigned long runUiTaskIteration();
+
+// ===================================================================================
+// --- HEAP ---
+// ===================================================================================
+// Só as alocações feitas enquanto o firmware roda (setup() e iterações das tarefas) contam.
+static const uint32_t SIM_HEAP_TOTAL = 300000; // ~DRAM livre de um ESP32 depois do Wi-Fi
+static const size_t HEAP_HEADER = 16;          // Mantém o alinhamento de malloc
+static int firmwareDepth = 0;
+static uint32_t heapInUse = 0;
+static uint32_t heapPeak = 0;
+static uint32_t heapAllocations = 0;
+
+void* operator new(size_t size) {
+    uint8_t* block = (uint8_t*)malloc(size + HEAP_HEADER);
+    if (!block) throw std::bad_alloc();
+    size_t tracked = firmwareDepth > 0 ? size : 0;
+    memcpy(block, &tracked, sizeof(tracked));
+    if (tracked) {
+        heapInUse += (uint32_t)tracked;
+        heapAllocations++;
+        if (heapInUse > heapPeak) heapPeak = heapInUse;
+    }
+    return block + HEAP_HEADER;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    uint8_t* block = (uint8_t*)ptr - HEAP_HEADER;
+    size_t tracked;
+    memcpy(&tracked, block, sizeof(tracked));
+    heapInUse -= (uint32_t)tracked;
+    free(block);
+}
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+uint32_t simHeapInUse() { return heapInUse; }
+uint32_t simHeapPeak() { return heapPeak; }
+uint32_t simHeapAllocations() { return heapAllocations; }
+
+EspClass ESP;
+static uint32_t heapMinFree = SIM_HEAP_TOTAL;
+uint32_t EspClass::getFreeHeap() {
+    uint32_t freeHeap = SIM_HEAP_TOTAL - heapInUse;
+    if (freeHeap < heapMinFree) heapMinFree = freeHeap;
+    return freeHeap;
+}
+uint32_t EspClass::getMinFreeHeap() { getFreeHeap(); return heapMinFree; }
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap() / 2; }
+esp_reset_reason_t esp_reset_reason() { return ESP_RST_POWERON; }
+
+// ===================================================================================
+// --- PLANTA ---
+// ===================================================================================
+SimPlant simPlant;
+static SimWiring wiring;
+static bool wired = false;
+static int8_t pinLevel[64];               // -1: nunca escrito (bomba/válvula desligada)
+
+void simPlantReset() {
+    memset(&simPlant, 0, sizeof(simPlant));
+    simPlant.tankLiters = 96.0f;
+    simPlant.ranCapacityLiters = 20.0f;
+    simPlant.ranLiters = 19.0f;
+    simPlant.ranFloatLiters = 19.6f;
+    for (int i = 0; i < 3; i++) simPlant.pumpFlowMlPerSec[i] = 10.0f;
+    simPlant.valveInflowMlPerSec = 33.0f;  // ~2 L/min da rede
+    simPlant.phMv = 1490.0f;               // pH 7.8 com a calibração padrão
+    simPlant.probeCount = 1;
+    simPlant.probeTempC[0] = 25.5f;
+    simPlant.probeTempC[1] = 26.0f;
+    simPlant.probeTempC[2] = 24.0f;
+}
+
+void simPlantWire(const SimWiring& w) {
+    memset(pinLevel, -1, sizeof(pinLevel));
+    wiring = w;
+    wired = true;
+}
+
+static bool outputIs(uint8_t pin, uint8_t onLevel) {
+    return pin < 64 && pinLevel[pin] >= 0 && pinLevel[pin] == onLevel;
+}
+
+// Integra os volumes por dt segundos com as saídas como estão. Bomba PWM (rampa) fica fora do
+// modelo: a configuração padrão usa relé (rampMs = 0).
+static void plantIntegrate(double dt) {
+    if (!wired || dt <= 0) return;
+    SimPlant& p = simPlant;
+    if (outputIs(wiring.pumpPin[0], wiring.pumpOnLevel[0])) {
+        double liters = p.pumpFlowMlPerSec[0] * dt / 1000.0;
+        if (liters > p.tankLiters) { p.pumpDryRunSec += dt; liters = p.tankLiters; }
+        p.tankLiters -= liters;
+        p.extractedLiters += liters;
+    }
+    if (outputIs(wiring.pumpPin[1], wiring.pumpOnLevel[1])) {
+        double liters = p.pumpFlowMlPerSec[1] * dt / 1000.0;
+        if (liters > p.ranLiters) { p.pumpDryRunSec += dt; liters = p.ranLiters; }
+        p.ranLiters -= liters;
+        p.tankLiters += liters;
+        p.repositionedLiters += liters;
+    }
+    if (outputIs(wiring.pumpPin[2], wiring.pumpOnLevel[2])) {
+        double ml = p.pumpFlowMlPerSec[2] * dt;
+        p.ranLiters += ml / 1000.0;
+        p.bufferDosedMl += ml;
+    }
+    if (outputIs(wiring.valvePin, wiring.valveOnLevel)) {
+        double liters = p.valveInflowMlPerSec * dt / 1000.0;
+        p.ranLiters += liters;
+        p.ranFilledLiters += liters;
+    }
+    if (p.ranLiters > p.ranCapacityLiters) {
+        p.ranOverflowLiters += p.ranLiters - p.ranCapacityLiters;
+        p.ranLiters = p.ranCapacityLiters;
+    }
+}
+
+int adc1_get_raw(adc1_channel_t channel) {
+    if (wired && channel == wiring.phAdcChannel) return (int)lroundf(simPlant.phMv);
+    if (wired && channel == wiring.ranAdcChannel) {
+        if (simPlant.ranLevelStuckMv > 0.0f) return (int)lroundf(simPlant.ranLevelStuckMv);
+        double fraction = simPlant.ranLiters / simPlant.ranCapacityLiters;
+        return (int)lround(wiring.ranEmptyMv + (wiring.ranFullMv - wiring.ranEmptyMv) * fraction);
+    }
+    return 0;
+}
+
+// Sondas DS18B20: ROM 28-53-49-4D-00-00-<n>-00, temperatura de simPlant.probeTempC[n - 1]
+uint8_t DallasTemperature::getDeviceCount() { return simPlant.probeCount; }
+bool DallasTemperature::getAddress(uint8_t* address, uint8_t index) {
+    if (index >= simPlant.probeCount) return false;
+    const uint8_t rom[8] = { 0x28, 0x53, 0x49, 0x4D, 0x00, 0x00, (uint8_t)(index + 1), 0x00 };
+    memcpy(address, rom, sizeof(rom));
+    return true;
+}
+float DallasTemperature::getTempC(const uint8_t* address) {
+    uint8_t n = address[6];
+    if (address[0] != 0x28 || n == 0 || n > simPlant.probeCount) return DEVICE_DISCONNECTED_C;
+    return simPlant.probeTempC[n - 1];
+}
+
+// ===================================================================================
+// --- RELÓGIO VIRTUAL E PINOS ---
+// ===================================================================================
+static uint64_t nowUs = 0;
+static uint32_t rtcBaseEpoch = 1767225600UL; // 2026-01-01 00:00:00
+static uint64_t rtcBaseUs = 0;
+
+uint64_t simNowUs() { return nowUs; }
+void simSetRtcEpoch(uint32_t epoch) { rtcBaseEpoch = epoch; rtcBaseUs = nowUs; }
+uint32_t simRtcEpoch() { return rtcBaseEpoch + (uint32_t)((nowUs - rtcBaseUs) / 1000000ULL); }
+
+// No host unsigned long tem 64 bits: millis() não dá a volta aos 49 dias como no ESP32
+unsigned long millis() { return (unsigned long)(nowUs / 1000ULL); }
+unsigned long micros() { return (unsigned long)nowUs; }
+int64_t esp_timer_get_time() { return (int64_t)nowUs; }
+unsigned long simMillis() { return millis(); }
+unsigned long simMicros() { return micros(); }
+
+static void (*isrPlain[64])();
+static void (*isrWithArg[64])(void*);
+static void* isrArg[64];
+
+static void fireSqwEdge() {
+    if (!wired) return;
+    uint8_t pin = wiring.sqwPin;
+    if (isrPlain[pin]) isrPlain[pin]();
+    else if (isrWithArg[pin]) isrWithArg[pin](isrArg[pin]);
+}
+
+// Avança o relógio integrando a planta; cada segundo inteiro é uma borda de descida do SQW
+static void advanceClock(uint64_t targetUs) {
+    while (nowUs < targetUs) {
+        uint64_t boundary = (nowUs / 1000000ULL + 1) * 1000000ULL;
+        uint64_t step = targetUs < boundary ? targetUs : boundary;
+        plantIntegrate((double)(step - nowUs) / 1e6);
+        nowUs = step;
+        if (nowUs == boundary) fireSqwEdge();
+    }
+}
+
+void delay(unsigned long ms) { advanceClock(nowUs + ms * 1000ULL); }
+void delayMicroseconds(unsigned int us) { advanceClock(nowUs + us); }
+void yield() {}
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+void digitalWrite(uint8_t pin, uint8_t level) { if (pin < 64) pinLevel[pin] = (int8_t)level; }
+int digitalRead(uint8_t pin) {
+    if (wired && pin == wiring.floatPin) return simPlant.ranLiters >= simPlant.ranFloatLiters ? LOW : HIGH;
+    if (pin < 64 && pinLevel[pin] >= 0) return pinLevel[pin];
+    return HIGH; // Entradas com pull-up (botões soltos)
+}
+void simPinMode(uint8_t pin, uint8_t mode) { pinMode(pin, mode); }
+void simDigitalWrite(uint8_t pin, uint8_t level) { digitalWrite(pin, level); }
+int simDigitalRead(uint8_t pin) { return digitalRead(pin); }
+
+gpio_dev_t GPIO;                          // Só guarda o que a ISR dos botões escreve
+
+void ledcSetup(uint8_t, double, uint8_t) {}
+void ledcAttachPin(uint8_t, uint8_t) {}
+void ledcWrite(uint8_t, uint32_t) {}
+
+void attachInterrupt(int pin, void (*isr)(), int) { if (pin >= 0 && pin < 64) isrPlain[pin] = isr; }
+void attachInterruptArg(uint8_t pin, void (*isr)(void*), void* arg, int) {
+    if (pin < 64) { isrWithArg[pin] = isr; isrArg[pin] = arg; }
+}
+void detachInterrupt(int pin) {
+    if (pin >= 0 && pin < 64) { isrPlain[pin] = nullptr; isrWithArg[pin] = nullptr; }
+}
+
+// ===================================================================================
+// --- ESCALONADOR (FreeRTOS) ---
+// ===================================================================================
+struct SimTask {
+    unsigned long (*step)();
+    UBaseType_t priority;
+    uint64_t wakeUs;
+    bool notified;
+    int statsIndex;                       // 0 controle, 1 rede, 2 UI
+};
+static SimTask tasks[3];
+static int taskCount = 0;
+static SimTask* currentTask = nullptr;
+static SimRunStats runStats;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    (void)name; (void)stack; (void)param; (void)core;
+    SimTask task = { nullptr, priority, nowUs, false, 0 };
+    if (fn == controlTaskMain) { task.step = runControlTaskIteration; task.statsIndex = 0; }
+    else if (fn == networkTaskMain) { task.step = runNetworkTaskIteration; task.statsIndex = 1; }
+    else if (fn == uiTaskMain) { task.step = runUiTaskIteration; task.statsIndex = 2; }
+    if (!task.step || taskCount >= 3) return pdFALSE; // Tarefas de diagnóstico não rodam no harness
+    tasks[taskCount] = task;
+    if (handle) *handle = &tasks[taskCount];
+    taskCount++;
+    return pdPASS;
+}
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+void vTaskDelete(TaskHandle_t handle) { (void)handle; }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return currentTask; }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle) { (void)handle; return 1024; }
+BaseType_t xPortGetCoreID() { return currentTask && currentTask->statsIndex == 1 ? 0 : 1; }
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) { (void)clearOnExit; (void)ticks; return 0; }
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+    if (handle) ((SimTask*)handle)->notified = true;
+    return pdPASS;
+}
+void vTaskNotifyGiveFromISR(TaskHandle_t handle, BaseType_t* woken) {
+    xTaskNotifyGive(handle);
+    if (woken) *woken = pdTRUE;
+}
+
+// Roda, por prioridade, toda tarefa notificada ou com o prazo vencido, até nenhuma estar pronta.
+// Uma iteração nunca dura tempo virtual (a não ser por delay()); a espera mínima é 1 ms.
+static void runReadyTasks() {
+    for (uint32_t guard = 0;; guard++) {
+        SimTask* next = nullptr;
+        for (int i = 0; i < taskCount; i++) {
+            SimTask& t = tasks[i];
+            if ((t.notified || t.wakeUs <= nowUs) && (!next || t.priority > next->priority)) next = &t;
+        }
+        if (!next) return;
+        if (guard > 1000000) {
+            fprintf(stderr, "sim: tarefas se notificando sem parar em t=%llu us\n", (unsigned long long)nowUs);
+            abort();
+        }
+        next->notified = false;
+        currentTask = next;
+        firmwareDepth++;
+        unsigned long waitMs = next->step();
+        firmwareDepth--;
+        currentTask = nullptr;
+        next->wakeUs = nowUs + (waitMs > 0 ? waitMs : 1) * 1000ULL;
+        runStats.iterations[next->statsIndex]++;
+    }
+}
+
+void simRunUntil(uint64_t targetUs) {
+    for (;;) {
+        runReadyTasks();
+        if (nowUs >= targetUs) return;
+        uint64_t next = targetUs;
+        for (int i = 0; i < taskCount; i++) {
+            if (tasks[i].wakeUs < next) next = tasks[i].wakeUs;
+        }
+        advanceClock(next);
+        runStats.wakeups++;
+    }
+}
+
+void simRunFor(uint64_t durationUs) { simRunUntil(nowUs + durationUs); }
+
+// Salto sem acordar as tarefas (o teste garante que o firmware está ocioso): a planta integra
+// o intervalo inteiro e só a última borda do SQW é entregue, para o relógio se realinhar.
+void simSkipTo(uint64_t targetUs) {
+    if (targetUs <= nowUs) return;
+    runStats.skippedUs += targetUs - nowUs;
+    plantIntegrate((double)(targetUs - nowUs) / 1e6);
+    uint64_t lastEdge = targetUs / 1000000ULL * 1000000ULL;
+    if (lastEdge > nowUs) {
+        nowUs = lastEdge;
+        fireSqwEdge();
+    }
+    nowUs = targetUs;
+}
+
+const SimRunStats& simRunStats() { return runStats; }
+
+void simSketchSetupBegin() { firmwareDepth++; }
+void simSketchSetupEnd() { firmwareDepth--; }
+
+// ===================================================================================
+// --- SERIAL ---
+// ===================================================================================
+HardwareSerial Serial;
+static bool serialEcho = false;
+static std::string serialInput;
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (serialEcho) fputc(c, stdout);
+    return 1;
+}
+int HardwareSerial::available() { return (int)serialInput.size(); }
+int HardwareSerial::read() {
+    if (serialInput.empty()) return -1;
+    int c = (uint8_t)serialInput[0];
+    serialInput.erase(0, 1);
+    return c;
+}
+void simSetSerialEcho(bool enabled) { serialEcho = enabled; }
+void simSerialInput(const char* text) { serialInput += text; }
+
+// ===================================================================================
+// --- BLYNK (servidor em memória) ---
+// ===================================================================================
+BlynkClass Blynk;
+WiFiClass WiFi;
+TwoWire Wire;
+
+static std::map<int, BlynkWriteHandler>& blynkHandlers() {
+    static std::map<int, BlynkWriteHandler> handlers; // Registrados antes do main()
+    return handlers;
+}
+static std::map<int, std::string> blynkServerPins;
+static std::vector<std::pair<int, std::string>> blynkInbox; // Entregues ao sketch no run()
+static bool blynkLinkUp = false;        // Rede/servidor disponíveis (controlado pelo teste)
+static bool blynkSession = false;       // O sketch já viu a conexão (BLYNK_CONNECTED rodou)
+static uint32_t blynkWriteCount = 0;
+static uint32_t blynkEventCount = 0;
+
+BlynkWriteRegistrar::BlynkWriteRegistrar(int pin, BlynkWriteHandler handler) { blynkHandlers()[pin] = handler; }
+__attribute__((weak)) void BlynkOnConnected() {}
+__attribute__((weak)) void BlynkOnDisconnected() {}
+
+void BlynkClass::config(const char*, const char*, uint16_t) {}
+bool BlynkClass::connect(unsigned long) { return blynkLinkUp; }
+bool BlynkClass::connected() { return blynkLinkUp && blynkSession; }
+void BlynkClass::run() {
+    if (blynkLinkUp && !blynkSession) {
+        blynkSession = true;
+        BlynkOnConnected();
+    } else if (!blynkLinkUp && blynkSession) {
+        blynkSession = false;
+        BlynkOnDisconnected();
+    }
+    if (!blynkSession) return;
+    std::vector<std::pair<int, std::string>> inbox;
+    inbox.swap(blynkInbox);
+    for (const auto& msg : inbox) {
+        auto it = blynkHandlers().find(msg.first);
+        if (it != blynkHandlers().end()) it->second(BlynkParam(msg.second.c_str()));
+    }
+}
+void BlynkClass::virtualWrite(int pin, int value) { virtualWrite(pin, (long)value); }
+void BlynkClass::virtualWrite(int pin, long value) { virtualWrite(pin, std::to_string(value).c_str()); }
+void BlynkClass::virtualWrite(int pin, double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.3f", value);
+    virtualWrite(pin, text);
+}
+void BlynkClass::virtualWrite(int pin, const char* value) {
+    blynkServerPins[pin] = value;
+    blynkWriteCount++;
+}
+void BlynkClass::syncVirtual(int pin) {
+    auto it = blynkServerPins.find(pin);
+    if (it != blynkServerPins.end()) blynkInbox.push_back(*it);
+}
+void BlynkClass::syncAll() {
+    for (const auto& pin : blynkServerPins) blynkInbox.push_back(pin);
+}
+void BlynkClass::logEvent(const char*, const char*) { blynkEventCount++; }
+
+void simBlynkSetConnected(bool connected) { blynkLinkUp = connected; }
+void simBlynkAppWrite(int vpin, const char* value) {
+    blynkServerPins[vpin] = value;
+    blynkInbox.push_back(std::make_pair(vpin, std::string(value)));
+}
+bool simBlynkServerValue(int vpin, char* out, int outLen) {
+    auto it = blynkServerPins.find(vpin);
+    if (it == blynkServerPins.end()) return false;
+    snprintf(out, outLen, "%s", it->second.c_str());
+    return true;
+}
+uint32_t simBlynkWrites() { return blynkWriteCount; }
+uint32_t simBlynkEvents() { return blynkEventCount; }
+
+// ===================================================================================
+// --- TEMPO: RTC (DS3231) E NTP (TimeLib) ---
+// ===================================================================================
+// Calendário civil (algoritmo de Howard Hinnant), dias desde 1970-01-01
+static int64_t daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+DateTime::DateTime(uint32_t unixTime) {
+    int64_t z = unixTime / 86400 + 719468;
+    uint32_t secs = unixTime % 86400;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    year_ = (uint16_t)(yoe + era * 400 + (m <= 2));
+    month_ = (uint8_t)m;
+    day_ = (uint8_t)d;
+    hour_ = (uint8_t)(secs / 3600);
+    minute_ = (uint8_t)(secs / 60 % 60);
+    second_ = (uint8_t)(secs % 60);
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+    : year_(year < 100 ? year + 2000 : year), month_(month), day_(day), hour_(hour), minute_(minute), second_(second) {}
+
+DateTime::DateTime(const char* date, const char* time) {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char name[4] = { date[0], date[1], date[2], '\0' };
+    const char* found = strstr(months, name);
+    month_ = found ? (uint8_t)((found - months) / 3 + 1) : 1;
+    day_ = (uint8_t)atoi(date + 4);
+    year_ = (uint16_t)atoi(date + 7);
+    hour_ = (uint8_t)atoi(time);
+    minute_ = (uint8_t)atoi(time + 3);
+    second_ = (uint8_t)atoi(time + 6);
+}
+
+uint8_t DateTime::dayOfTheWeek() const {
+    int64_t days = daysFromCivil(year_, month_, day_);
+    return (uint8_t)((days % 7 + 11) % 7); // 1970-01-01 foi quinta-feira (4)
+}
+
+uint32_t DateTime::unixtime() const {
+    return (uint32_t)(daysFromCivil(year_, month_, day_) * 86400 + hour_ * 3600 + minute_ * 60 + second_);
+}
+
+bool RTC_DS3231::lostPower() { return false; }
+DateTime RTC_DS3231::now() { return DateTime(simRtcEpoch()); }
+void RTC_DS3231::adjust(const DateTime& dt) { simSetRtcEpoch(dt.unixtime()); }
+
+static bool ntpSet = false;
+static time_t ntpBaseEpoch = 0;
+static uint64_t ntpBaseUs = 0;
+
+time_t now() { return ntpSet ? ntpBaseEpoch + (time_t)((nowUs - ntpBaseUs) / 1000000ULL) : 0; }
+void setTime(time_t t) { ntpSet = true; ntpBaseEpoch = t; ntpBaseUs = nowUs; }
+void setSyncProvider(getExternalTime provider) { (void)provider; }
+timeStatus_t timeStatus() { return ntpSet ? timeSet : timeNotSet; }
+
+// ===================================================================================
+// --- LITTLEFS (em memória) ---
+// ===================================================================================
+LittleFSFS LittleFS;
+static std::map<std::string, std::shared_ptr<SimFileData>> fsFiles;
+static std::set<std::string> fsDirs;
+static const size_t SIM_FS_TOTAL = 1507328; // Partição padrão de 1.44 MB
+
+bool LittleFSFS::begin(bool) { return true; }
+
+File LittleFSFS::open(const char* path, const char* mode) {
+    std::string key(path);
+    if (mode[0] == 'w') {
+        auto data = std::make_shared<SimFileData>();
+        fsFiles[key] = data;
+        return File(key, data, 0, true);
+    }
+    auto it = fsFiles.find(key);
+    if (mode[0] == 'a') {
+        if (it == fsFiles.end()) it = fsFiles.emplace(key, std::make_shared<SimFileData>()).first;
+        return File(key, it->second, it->second->size(), true);
+    }
+    if (it == fsFiles.end()) return File();
+    return File(key, it->second, 0, mode[1] == '+');
+}
+
+bool LittleFSFS::exists(const char* path) {
+    std::string key(path);
+    if (fsFiles.count(key) || fsDirs.count(key)) return true;
+    std::string prefix = key + "/";
+    auto it = fsFiles.lower_bound(prefix);
+    return it != fsFiles.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool LittleFSFS::remove(const char* path) { return fsFiles.erase(path) > 0; }
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    auto it = fsFiles.find(from);
+    if (it == fsFiles.end()) return false;
+    std::shared_ptr<SimFileData> data = it->second;
+    fsFiles.erase(it);
+    fsFiles[to] = data;
+    return true;
+}
+
+bool LittleFSFS::mkdir(const char* path) { fsDirs.insert(path); return true; }
+size_t LittleFSFS::totalBytes() { return SIM_FS_TOTAL; }
+size_t LittleFSFS::usedBytes() {
+    size_t used = 0;
+    for (const auto& file : fsFiles) used += (file.second->size() + 4095) / 4096 * 4096;
+    return used;
+}
@@ -0,0 +1,64 @@
+// Incluído no FIM do arquivo gerado com o sketch (sketch.cpp no diretório de build): aqui
+// config.h, global.h e as variáveis do firmware estão visíveis. Implementa a parte
+// simSketch*() de sim.h; nenhum outro arquivo do harness inclui os cabeçalhos do sketch.
+#pragma once
+
+#include "sim.h"
+
+void simSketchSetup() {
+    SimWiring wiring;
+    wiring.pumpPin[0] = TPA_EXTRACTION_PUMP_PIN;
+    wiring.pumpPin[1] = TPA_REPOSITION_PUMP_PIN;
+    wiring.pumpPin[2] = TPA_BUFFER_PUMP_PIN;
+    for (uint8_t i = 0; i < PUMP_COUNT; i++) {
+        wiring.pumpOnLevel[i] = PUMP_HW[i].activeHigh ? HIGH : RELAY_ON;
+    }
+    wiring.valvePin = RAN_SOLENOID_VALVE_PIN;
+    wiring.valveOnLevel = RELAY_ON;
+    wiring.floatPin = RAN_LEVEL_SENSOR_PIN;
+    wiring.sqwPin = RTC_SQW_PIN;
+    wiring.phAdcChannel = PH_ADC_CHANNEL;
+    wiring.ranAdcChannel = RAN_LEVEL_ADC_CHANNEL;
+    wiring.ranEmptyMv = RAN_LEVEL_EMPTY_MV_DEFAULT;
+    wiring.ranFullMv = RAN_LEVEL_FULL_MV_DEFAULT; // Geometria padrão: prisma, capacidade = altura cheia
+    simPlantWire(wiring);
+    simSketchSetupBegin();
+    setup();
+    simSketchSetupEnd();
+}
+
+void simSketchTpaStats(SimTpaStats* out) {
+    out->started = tpaCycleStats.started;
+    out->completed = tpaCycleStats.completed;
+    out->aborted = tpaCycleStats.aborted;
+    out->lastDurationMs = tpaCycleStats.lastDurationMs;
+    out->maxDurationMs = tpaCycleStats.maxDurationMs;
+}
+
+bool simSketchIsIdle() {
+    return !isControlBusy() && !configIsDirty && netToControlQueue.isEmpty() && uiToControlQueue.isEmpty();
+}
+
+uint32_t simSketchNextScheduledEpoch() {
+    return scheduleRecomputePending ? 0 : scheduleEarliestFire;
+}
+
+uint32_t simSketchNowEpoch() {
+    return clockNowEpoch();
+}
+
+float simSketchTpaVolumeLiters() {
+    return volumeToExtractLiters;
+}
+
+int simSketchBufferVolumeMl() {
+    return ranBufferVolumeML;
+}
+
+void simSketchSetSchedule(bool active, int frequency, int day, int hour, int minute) {
+    postLocalSettingChange(SYNC_SET_SCHEDULE_FREQUENCY, (float)frequency);
+    postLocalSettingChange(SYNC_SET_SCHEDULE_DAY, (float)day);
+    postLocalSettingChange(SYNC_SET_SCHEDULE_HOUR, (float)hour);
+    postLocalSettingChange(SYNC_SET_SCHEDULE_MINUTE, (float)minute);
+    postLocalSettingChange(SYNC_SET_LOCAL_SCHEDULE, active ? 1.0f : 0.0f);
+}
@@ -0,0 +1,133 @@
+// Teste de host das filas lock-free (main/spsc_queue.h) com threads de verdade: o produtor e o
+// consumidor rodam em núcleos diferentes, como no ESP32. Confere ordem, integridade dos itens
+// (nada rasgado no meio de uma cópia) e mede a vazão. Complementa o auto-teste no alvo
+// (ACC_SPSC_SELFTEST), que fica desligado no firmware normal.
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+#include "spsc_queue.h"
+
+static const uint32_t ITEMS = 1000000UL;
+static const uint32_t GOLDEN = 2654435761UL; // Espalha os bits da sequência por todas as palavras
+
+// Mensagem maior que uma palavra: todas as posições carregam o mesmo número de sequência
+struct Payload {
+    uint32_t seq;
+    uint32_t words[7];
+};
+
+static Payload makePayload(uint32_t seq) {
+    Payload p;
+    p.seq = seq;
+    for (uint32_t& w : p.words) w = seq * GOLDEN;
+    return p;
+}
+
+static bool isIntact(const Payload& p) {
+    for (uint32_t w : p.words) {
+        if (w != p.seq * GOLDEN) return false;
+    }
+    return true;
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("[%s] %s\n", ok ? " OK " : "FALHA", what);
+    if (!ok) failures++;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// SpscQueue: todo item chega, na ordem, inteiro; o produtor repete quando a fila está cheia
+static void testQueue() {
+    static SpscQueue<Payload, 256> queue;
+    uint32_t fullRetries = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < ITEMS;) {
+            if (queue.push(makePayload(i))) {
+                i++;
+            } else {
+                fullRetries++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t orderErrors = 0;
+    uint32_t torn = 0;
+    Payload item;
+    while (expected < ITEMS) {
+        if (queue.pop(item)) {
+            if (item.seq != expected) orderErrors++;
+            if (!isIntact(item)) torn++;
+            expected = item.seq + 1;
+        } else {
+            std::this_thread::yield(); // Poucos núcleos no host: deixa o produtor andar
+        }
+    }
+    producer.join();
+    double elapsed = secondsSince(start);
+
+    printf("SpscQueue: %u itens em %.3f s (%.0f itens/s), fila cheia %u vezes\n", ITEMS, elapsed,
+           ITEMS / elapsed, fullRetries);
+    check(orderErrors == 0, "fila: ordem preservada");
+    check(torn == 0, "fila: nenhum item rasgado");
+    check(queue.dropped() == fullRetries, "fila: dropped() conta cada push recusado");
+    check(queue.isEmpty() && queue.size() == 0, "fila: vazia no fim");
+}
+
+// SpscLatest: o consumidor só vê valores inteiros e cada vez mais novos, e o último sempre chega
+static void testLatest() {
+    static SpscLatest<Payload> latest;
+    std::atomic<bool> producerDone(false);
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&] {
+        for (uint32_t i = 1; i <= ITEMS; i++) {
+            latest.write(makePayload(i));
+            if ((i & 63) == 0) std::this_thread::yield(); // Com um núcleo só, o consumidor também lê no meio
+        }
+        producerDone.store(true, std::memory_order_release);
+    });
+
+    uint32_t lastSeen = 0;
+    uint32_t reads = 0;
+    uint32_t backwards = 0;
+    uint32_t torn = 0;
+    Payload item;
+    for (;;) {
+        bool done = producerDone.load(std::memory_order_acquire);
+        while (latest.read(item)) {
+            reads++;
+            if (item.seq <= lastSeen) backwards++;
+            if (!isIntact(item)) torn++;
+            lastSeen = item.seq;
+        }
+        if (done) break; // Lido depois do fim do produtor: nada mais pode chegar
+        std::this_thread::yield();
+    }
+    producer.join();
+    double elapsed = secondsSince(start);
+
+    printf("SpscLatest: %u escritas em %.3f s (%.0f escritas/s), %u leituras, %u substituidas\n", ITEMS,
+           elapsed, ITEMS / elapsed, reads, latest.overwritten());
+    check(torn == 0, "ultimo valor: nenhuma leitura rasgada");
+    check(backwards == 0, "ultimo valor: nunca volta para um valor antigo");
+    check(lastSeen == ITEMS, "ultimo valor: a escrita final é lida");
+    check(reads + latest.overwritten() == ITEMS, "ultimo valor: cada escrita é lida ou substituída");
+    check(!latest.read(item), "ultimo valor: sem valor novo depois de lido");
+}
+
+int main() {
+    testQueue();
+    testLatest();
+    return failures == 0 ? 0 : 1;
+}
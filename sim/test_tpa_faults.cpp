@@ -0,0 +1,80 @@
+// Falhas na reposição da TPA: a bomba de reposição parada e o sensor de nível do RAN travado
+// não podem fazer o plano repetir lotes sem fim (aquário sem água de volta, ou água demais).
+// Cada cenário roda um processo novo do harness (o estado do firmware é global).
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+static const uint32_t START_EPOCH = 1767225600UL; // 2026-01-01 00:00:00 (quinta-feira)
+static const uint64_t SECOND_US = 1000000ULL;
+static const uint64_t HOUR_US = 3600ULL * SECOND_US;
+static const int PUMP_REPOSITION = 1;              // Índice em SimPlant::pumpFlowMlPerSec
+static const double MAX_LEVEL_DELTA_L = 2.0;       // TPA_MAX_LEVEL_DELTA_L_DEFAULT
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("[%s] %s\n", ok ? " OK " : "FALHA", what);
+    if (!ok) failures++;
+}
+
+// Boot, agenda semanal (domingo 09:00) e salto até 30 s antes do primeiro disparo
+static void bootUntilFirstTpa() {
+    simPlantReset();
+    simSetRtcEpoch(START_EPOCH);
+    simBlynkSetConnected(false);
+    simSketchSetup();
+    simRunFor(10 * SECOND_US);
+    simSketchSetSchedule(true, 1, 1, 9, 0);
+    simRunFor(5 * SECOND_US);
+    uint32_t next = simSketchNextScheduledEpoch();
+    uint32_t nowEpoch = simSketchNowEpoch();
+    simSkipTo(simNowUs() + (uint64_t)(next - nowEpoch - 30) * SECOND_US);
+}
+
+static void report(const char* scenario, const SimTpaStats& stats) {
+    printf("%s: %lu iniciados, %lu completos, %lu abortados; extraido %.2f L, reposto %.2f L\n", scenario,
+           stats.started, stats.completed, stats.aborted, simPlant.extractedLiters, simPlant.repositionedLiters);
+}
+
+// Bomba de reposição sem vazão: o RAN não baixa, o lote termina sem crédito e o ciclo aborta
+static void pumpDead() {
+    bootUntilFirstTpa();
+    simPlant.pumpFlowMlPerSec[PUMP_REPOSITION] = 0.0f;
+    simRunFor(4 * HOUR_US);
+    SimTpaStats stats;
+    simSketchTpaStats(&stats);
+    report("bomba de reposicao parada", stats);
+    check(stats.started == 1 && stats.aborted == 1 && stats.completed == 0, "bomba parada: ciclo abortado");
+    check(simPlant.extractedLiters <= MAX_LEVEL_DELTA_L + 0.05,
+          "bomba parada: extração para no limite de desnível");
+    check(simSketchIsIdle(), "bomba parada: firmware ocioso depois do cancelamento");
+}
+
+// Sensor de nível travado com a bomba boa: cada lote bombeia a dose-limite sem o nível baixar;
+// o primeiro lote assim aborta o ciclo (antes do conserto, repetia sem fim)
+static void levelStuck() {
+    bootUntilFirstTpa();
+    simPlant.ranLevelStuckMv = 400.0f + 2400.0f * (float)(simPlant.ranLiters / simPlant.ranCapacityLiters);
+    simRunFor(4 * HOUR_US);
+    SimTpaStats stats;
+    simSketchTpaStats(&stats);
+    report("sensor de nivel travado", stats);
+    check(stats.started == 1 && stats.aborted == 1 && stats.completed == 0, "nivel travado: ciclo abortado");
+    check(simPlant.repositionedLiters <= simSketchTpaVolumeLiters() * 1.5 + 0.05,
+          "nivel travado: água reposta limitada");
+    check(simSketchIsIdle(), "nivel travado: firmware ocioso depois do cancelamento");
+}
+
+int main(int argc, char** argv) {
+    const char* scenario = argc > 1 ? argv[1] : "";
+    if (strcmp(scenario, "pump-dead") == 0) pumpDead();
+    else if (strcmp(scenario, "level-stuck") == 0) levelStuck();
+    else {
+        fprintf(stderr, "uso: %s pump-dead|level-stuck\n", argv[0]);
+        return 2;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// Regressão de um ano de TPA agendada (agenda local, Blynk desconectado) no relógio virtual.
+// Confere contagem de ciclos, volumes na planta e duração dos ciclos, e imprime o desempenho do
+// harness (aceleração sobre o tempo real, iterações/s por tarefa, pico de heap).
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+
+#include "sim.h"
+
+static const uint32_t START_EPOCH = 1767225600UL;   // 2026-01-01 00:00:00 (quinta-feira)
+static const uint64_t YEAR_US = 365ULL * 86400ULL * 1000000ULL;
+static const uint64_t SECOND_US = 1000000ULL;
+static const unsigned long EXPECTED_CYCLES = 52;    // Domingos às 09:00 de 2026
+static const unsigned long MAX_CYCLE_MS = 60UL * 60UL * 1000UL;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("[%s] %s\n", ok ? " OK " : "FALHA", what);
+    if (!ok) failures++;
+}
+
+int main() {
+    simPlantReset();
+    simSetRtcEpoch(START_EPOCH);
+    simBlynkSetConnected(false);
+    simSketchSetup();
+    simRunFor(10 * SECOND_US);
+    simSketchSetSchedule(true, 1, 1, 9, 0); // Semanal, domingo, 09:00
+    simRunFor(5 * SECOND_US);
+
+    const double tankStart = simPlant.tankLiters;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    // Ocioso e longe do próximo disparo: salta até 30 s antes; senão roda em passos de 1 min
+    while (simNowUs() < YEAR_US) {
+        uint32_t next = simSketchNextScheduledEpoch();
+        uint32_t nowEpoch = simSketchNowEpoch();
+        if (simSketchIsIdle() && next > nowEpoch + 60) {
+            uint64_t target = simNowUs() + (uint64_t)(next - nowEpoch - 30) * SECOND_US;
+            simSkipTo(target < YEAR_US ? target : YEAR_US);
+            simRunFor(SECOND_US);
+        } else {
+            simRunFor(60 * SECOND_US);
+        }
+    }
+
+    double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    SimTpaStats stats;
+    simSketchTpaStats(&stats);
+    const SimRunStats& run = simRunStats();
+    const double cycles = (double)stats.completed;
+    const double expectedLiters = cycles * simSketchTpaVolumeLiters();
+
+    printf("\n--- TPA: um ano simulado ---\n");
+    printf("ciclos: %lu iniciados, %lu completos, %lu abortados\n", stats.started, stats.completed, stats.aborted);
+    printf("duracao do ciclo: ultimo %lu ms, maximo %lu ms\n", stats.lastDurationMs, stats.maxDurationMs);
+    printf("extraido %.2f L (esperado %.2f L), reposto %.2f L, buffer %.0f mL, RAN abastecido %.2f L\n",
+           simPlant.extractedLiters, expectedLiters, simPlant.repositionedLiters, simPlant.bufferDosedMl,
+           simPlant.ranFilledLiters);
+    printf("aquario %.2f L -> %.2f L, transbordo do RAN %.2f L, bomba a seco %.1f s\n",
+           tankStart, simPlant.tankLiters, simPlant.ranOverflowLiters, simPlant.pumpDryRunSec);
+    printf("\n--- Desempenho do harness ---\n");
+    printf("tempo real %.2f s, aceleracao %.0fx (%.1f%% do ano pulado ocioso)\n", wallSec,
+           (double)YEAR_US / 1e6 / wallSec, 100.0 * (double)run.skippedUs / (double)YEAR_US);
+    printf("iteracoes: controle %llu, rede %llu, UI %llu (%.0f/s de tempo real no total)\n",
+           (unsigned long long)run.iterations[0], (unsigned long long)run.iterations[1],
+           (unsigned long long)run.iterations[2],
+           (double)(run.iterations[0] + run.iterations[1] + run.iterations[2]) / wallSec);
+    printf("heap do firmware: pico %u B, em uso %u B, %u alocacoes\n\n", simHeapPeak(), simHeapInUse(),
+           simHeapAllocations());
+
+    check(stats.completed == EXPECTED_CYCLES, "um ciclo por domingo (52)");
+    check(stats.aborted == 0, "nenhum ciclo abortado");
+    check(fabs(simPlant.extractedLiters - expectedLiters) <= 0.02 * expectedLiters, "volume extraído dentro de 2%");
+    check(fabs(simPlant.repositionedLiters - simPlant.extractedLiters) <= 0.02 * expectedLiters,
+          "reposição devolve o que foi extraído");
+    check(fabs(simPlant.tankLiters - tankStart) <= 0.02 * expectedLiters, "nível do aquário estável no ano (deriva < 2% do trocado)");
+    check(simPlant.pumpDryRunSec == 0.0, "nenhuma bomba a seco");
+    check(stats.maxDurationMs > 0 && stats.maxDurationMs <= MAX_CYCLE_MS, "ciclo completo em menos de 1 h");
+    return failures == 0 ? 0 : 1;
+}